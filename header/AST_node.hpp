@@ -151,6 +151,13 @@ struct ASTFunctionParam {
     // std::optional<ASTExpression> initial_value; // TODO: support initial value
 };
 
+// the 'inline'/'noinline' annotation in front of 'func'
+enum class InlineHint {
+    NONE = 0,
+    always,
+    never,
+};
+
 struct ASTStatementFunction {
     TokenMeta start_token_meta;
     std::string name;
@@ -159,6 +166,11 @@ struct ASTStatementFunction {
 
     std::vector<Token> return_data_type_tokens;
     std::shared_ptr<DataType> return_data_type;
+    InlineHint inline_hint;
+
+    // [token_begin, token_end) indices of the function in the token stream
+    size_t token_begin;
+    size_t token_end;
 };
 
 struct ASTStatementReturn {
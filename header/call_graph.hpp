@@ -0,0 +1,25 @@
+#pragma once
+#include <map>
+#include <set>
+#include <string>
+
+#include "AST_node.hpp"
+
+// whole-program call graph, from the function calls in the AST. the top-level statements are the root- a
+// function no chain of calls from them reaches is never run, so it needs neither analysis nor code
+class CallGraph {
+   public:
+    explicit CallGraph(const ASTProgram& program);
+
+    // the functions called directly by the function, or by the top-level statements for TOP_LEVEL
+    const std::set<std::string>& get_callees(const std::string& function) const;
+    // the functions reachable from the top-level statements
+    std::set<std::string> get_reachable_functions() const;
+
+    static const std::string TOP_LEVEL;
+
+   private:
+    struct CallCollector;
+
+    std::map<std::string, std::set<std::string>> m_callees;
+};
@@ -0,0 +1,90 @@
+#pragma once
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace dlvc {
+
+struct CompileOptions;
+struct Diagnostic;
+
+struct CacheStatistics {
+    size_t hits = 0;
+    size_t misses = 0;
+    size_t evictions = 0;
+    // current contents of the cache directory
+    size_t entries = 0;
+    size_t size_bytes = 0;
+};
+
+// content addressed store of compilation outputs.
+// an entry is keyed by a hash of the source, the compiler build and every output-affecting option, and holds
+// the generated assembly, the object file and the linked executable- whichever of them were produced so far.
+// entries are directories under the cache directory, and their modification time is the LRU clock.
+// multiple processes may share a cache directory- files are published with an atomic rename.
+class CompileCache {
+   public:
+    enum class Artifact {
+        Asm,
+        Object,
+        Executable,
+    };
+
+    static constexpr size_t DEFAULT_MAX_SIZE_BYTES = 256 * 1024 * 1024;
+
+    CompileCache(const std::string& directory, size_t max_size_bytes = DEFAULT_MAX_SIZE_BYTES);
+    // merges this process' hit/miss counters into the statistics file
+    ~CompileCache();
+
+    // $DLVC_CACHE_DIR, $XDG_CACHE_HOME/dlvc, or ~/.cache/dlvc
+    static std::string default_directory();
+
+    std::string make_key(const std::string& source, const CompileOptions& options) const;
+
+    // reads an artifact of an entry, counting a hit or a miss.
+    // 'diagnostics' receives the warnings reported when the entry was created
+    std::optional<std::string> lookup(const std::string& key, Artifact artifact, std::vector<Diagnostic>& diagnostics);
+    // reads an artifact without counting it as a lookup, or refreshing the entry
+    std::optional<std::string> peek(const std::string& key, Artifact artifact,
+                                    std::vector<Diagnostic>& diagnostics) const;
+    // adds an artifact to an entry. once the cache grew too big, evicts least recently used entries down to 90% of
+    // its maximum size
+    void store(const std::string& key, Artifact artifact, const std::string& contents,
+               const std::vector<Diagnostic>& diagnostics);
+
+    // copies a cached executable to 'output_path' and makes it executable. counts a hit or a miss
+    bool restore_executable(const std::string& key, const std::string& output_path,
+                            std::vector<Diagnostic>& diagnostics);
+
+    // persisted statistics, including this process' counters
+    CacheStatistics get_statistics() const;
+    void clear();
+
+    const std::string& get_directory() const { return m_directory; }
+
+   private:
+    std::string m_directory;
+    size_t m_max_size_bytes;
+
+    mutable std::mutex m_mutex;
+    size_t m_hits;
+    size_t m_misses;
+    size_t m_evictions;
+    // total size of the entries, scanned at the first store and kept up to date by the following ones- the cache
+    // directory is rescanned only when the total exceeds the maximum size
+    std::optional<size_t> m_size_bytes;
+    // guards m_size_bytes- one eviction at a time within the process
+    std::mutex m_size_mutex;
+
+    std::string entry_path(const std::string& key) const;
+    std::string artifact_path(const std::string& key, Artifact artifact) const;
+    // warnings reported while producing the artifact, as a JSON array
+    std::string diagnostics_path(const std::string& key, Artifact artifact) const;
+    void touch(const std::string& key) const;
+    // called with m_size_mutex held
+    void evict_to_fit();
+    void flush_statistics();
+};
+
+}  // namespace dlvc
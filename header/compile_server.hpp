@@ -0,0 +1,68 @@
+#pragma once
+#include <functional>
+#include <string>
+
+#include "dlvc.hpp"
+
+// compile server- a long running process serving compile requests over a Unix domain socket, so many small
+// compilations share one warm process, its worker threads and its compile cache.
+//
+// the protocol is newline delimited JSON. requests:
+//   {"type": "compile", "id": 1, "file_path": "a.dlv", "source": "...", "output": "/abs/a", "asm": "/abs/a.asm",
+//    "incremental": false, "emit": "executable", "pass_statistics": false,
+//    "options": {"debug_info": true, "backend": "ast", "optimization_level": 0, "passes": [], "print_after": [],
+//                "eliminate_dead_functions": true, "inline_threshold": -1, "remarks": [], "unroll_factor": -1,
+//                "avx2": false}}
+//       "source" is optional- the server reads file_path when it's missing. "asm" and every field of "options"
+//       are optional. "emit": "ir" only generates the code(no "output" needed), and returns the IR.
+//       "options" mirror dlvc::CompileOptions, and are part of the compile cache key. the cache is skipped when
+//       the request asks for the IR, the pass statistics or the remarks, which only an actual compilation produces
+//   {"type": "cancel", "id": 1}   stops a queued or running compilation of this connection
+//   {"type": "stats"}             cache and request counters
+//   {"type": "shutdown"}          stops accepting connections, and exits once running compilations finish
+// responses:
+//   {"type": "result", "id": 1, "success": true, "cancelled": false, "diagnostics": [...], "ir_dump": "...",
+//    "pass_report": "...", "remarks": "...", "eliminated_functions": 0, "elapsed_ms": 2.5}
+//   {"type": "stats", ...}
+//   {"type": "error", "id": 1, "message": "..."}   malformed request
+// requests of a connection are served concurrently, their results are sent in completion order.
+namespace dlvc {
+
+struct ServerOptions {
+    std::string socket_path;
+    // 0- one per hardware thread
+    size_t thread_count = 0;
+    // empty- no compile cache
+    std::string cache_directory;
+    size_t cache_size_bytes;
+    // receives the server's status lines("serving on ..."). the server itself never prints
+    std::function<void(const std::string& status)> on_status;
+};
+
+// blocks until a shutdown request. returns the process exit status- on failure 'error' says why the server
+// couldn't start
+int serve(const ServerOptions& options, std::string& error);
+
+struct ClientRequest {
+    std::string socket_path;
+    std::string file_path;
+    std::string output_path;
+    std::string asm_path;
+    bool incremental = false;
+    // --emit=ir- generate the code and return the IR, instead of building an executable
+    bool emit_ir = false;
+    // --pass-stats- the result needs a pass report, so the server's cache is skipped
+    bool pass_statistics = false;
+    // the code generation options. file_path, cache, cancelled and incremental_state_path are the server's
+    CompileOptions options;
+};
+
+// sends a compile request and waits for its result. SIGINT while waiting sends a cancellation instead of
+// killing the client. connection problems are reported as an Input diagnostic
+CompileResult compile_on_server(const ClientRequest& request);
+
+// sends a request without an id(stats, shutdown) and returns the response, or an error message
+bool send_server_command(const std::string& socket_path, const std::string& type, JsonValue& response,
+                         std::string& error);
+
+}  // namespace dlvc
@@ -0,0 +1,183 @@
+#pragma once
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include "json.hpp"
+
+// libdlvc- the compiler as an in-process library.
+// nothing in here prints or exits the process, every problem is reported through CompileResult::diagnostics.
+namespace dlvc {
+
+// part of every compile cache key
+constexpr const char* VERSION = "0.1.0";
+
+class CompileCache;
+
+enum class DiagnosticSeverity {
+    Warning,
+    Error,
+};
+
+enum class CompileStage {
+    Input,
+    Lexer,
+    Parser,
+    SemanticAnalyzer,
+    Generator,
+    Assembler,
+    Linker,
+};
+
+// code generation path
+enum class Backend {
+    // the generator, straight from the analyzed AST
+    AST,
+    // lowered to the SSA IR, verified, and generated from the IR
+    IR,
+};
+
+struct Diagnostic {
+    DiagnosticSeverity severity;
+    CompileStage stage;
+    std::string message;
+    std::string file_path;
+    // 1-based source position, 0 when the diagnostic has no position(EOF, assembler errors..)
+    size_t line;
+    size_t col;
+    // the message as the command line tool reports it
+    std::string formatted;
+};
+
+struct CompileOptions {
+    // path used when reporting diagnostics
+    std::string file_path = "<source>";
+    // assemble and link with debug information(nasm -g, gcc -g)
+    bool debug_info = true;
+    // fill CompileResult::ast_dump with the analyzed AST. not available when the result comes from the cache
+    bool dump_ast = false;
+    Backend backend = Backend::AST;
+    // functions the top-level statements never reach, directly or through other calls, skip semantic analysis of
+    // their bodies and code generation
+    bool eliminate_dead_functions = true;
+    // -O<level>. above 0 the IR pass pipeline of the level runs, which implies the IR backend
+    int optimization_level = 0;
+    // when not empty, these IR passes run instead of the level's pipeline(implies the IR backend as well)
+    std::vector<std::string> passes;
+    // fill CompileResult::ir_dump with the textual IR(IR backend only), after all passes.
+    // not available when the result comes from the cache
+    bool dump_ir = false;
+    // also print the IR into CompileResult::ir_dump after each of these passes, "all" for every pass
+    std::vector<std::string> print_after;
+    // the inliner's cost threshold, -1 for the optimization level's default
+    int inline_threshold = -1;
+    // loop-unroll's factor, -1 for the optimization level's default
+    int unroll_factor = -1;
+    // -mavx2: loop-vectorize uses AVX2's 32 byte vectors instead of SSE2's 16 byte ones
+    bool avx2 = false;
+    // fill CompileResult::remarks with the decisions of these passes("inline"), "all" for every pass.
+    // not available when the result comes from the cache
+    std::vector<std::string> remarks;
+    // when set, outputs are looked up in and added to this cache
+    CompileCache* cache = nullptr;
+    // when set, per-function records are kept in this file between compilations, and functions that didn't
+    // change since the previous compilation skip semantic analysis and code generation. AST backend only
+    std::string incremental_state_path;
+    // when set, checked between compilation stages- once it's true the compilation stops and fails
+    const std::atomic<bool>* cancelled = nullptr;
+
+    // every option that affects the outputs- part of the compile cache key.
+    // NOTE: new output-affecting options must be added here
+    std::string fingerprint() const;
+};
+
+struct CompileResult {
+    bool success = false;
+    // assembly text, or object file bytes, depending on the requested output
+    std::string buffer;
+    // the generated assembly, for every kind of output
+    std::string asm_code;
+    std::vector<Diagnostic> diagnostics;
+    std::string ast_dump;
+    std::string ir_dump;
+    // per-pass wall time and change counters of the IR pipeline, as a table. empty when no passes ran
+    std::string pass_report;
+    // "remark: <pass>: <decision>" lines of the passes in CompileOptions::remarks
+    std::string remarks;
+    // stopped through CompileOptions::cancelled
+    bool cancelled = false;
+    // function-level incremental compilation- functions reused from the previous compilation, out of all
+    size_t reused_functions = 0;
+    size_t total_functions = 0;
+    // dead function elimination- functions never called from the top-level statements
+    size_t eliminated_functions = 0;
+
+    bool has_errors() const;
+};
+
+// identifies the compiler executable- cached outputs of a different build are never reused
+const std::string& build_fingerprint();
+
+// source code -> x86-64 NASM assembly
+CompileResult compile_to_asm(const std::string& source, const CompileOptions& options = CompileOptions());
+
+// source code -> ELF64 object file
+CompileResult compile_to_object(const std::string& source, const CompileOptions& options = CompileOptions());
+
+// source code -> executable written to output_path. buffer is left empty
+CompileResult compile_to_executable(const std::string& source, const std::string& output_path,
+                                    const CompileOptions& options = CompileOptions());
+
+// assembly -> ELF64 object file, using nasm
+CompileResult assemble_object(const std::string& asm_code, const CompileOptions& options = CompileOptions());
+
+// ELF64 object file -> executable written to output_path, using gcc
+CompileResult link_executable(const std::string& object_code, const std::string& output_path,
+                              const CompileOptions& options = CompileOptions());
+
+// ---- batch compilation- many sources compiled within a single process
+
+struct BatchJob {
+    std::string source_path;
+    // path of the linked executable
+    std::string output_path;
+    // optional, the generated assembly is also written here
+    std::string asm_path;
+};
+
+struct BatchJobResult {
+    BatchJob job;
+    CompileResult result;
+    // wall time spent on the job, in milliseconds
+    double elapsed_ms;
+};
+
+// a manifest is a JSON array of jobs. each job is either a source path, or an object with "source" and
+// optional "output" and "asm" paths. relative paths are resolved against base_dir.
+// returns false and sets 'error' if the manifest is malformed
+bool parse_batch_manifest(const std::string& manifest, const std::string& base_dir, std::vector<BatchJob>& jobs,
+                          std::string& error);
+
+// one job per non-empty line- "<source> [output]"
+std::vector<BatchJob> parse_batch_list(const std::string& list);
+
+// output path used when a job doesn't specify one- the source path without its extension
+std::string default_output_path(const std::string& source_path);
+
+// compiles the jobs one after the other, in order
+std::vector<BatchJobResult> compile_batch(const std::vector<BatchJob>& jobs,
+                                          const CompileOptions& options = CompileOptions());
+
+std::string to_string(Backend backend);
+// "ast" or "ir". returns false for any other name
+bool parse_backend(const std::string& name, Backend& backend);
+// the backend actually generating the code- optimizations imply the IR backend
+Backend effective_backend(const CompileOptions& options);
+std::string to_string(DiagnosticSeverity severity);
+std::string to_string(CompileStage stage);
+JsonValue to_json(const Diagnostic& diagnostic);
+// inverse of to_json(const Diagnostic&). throws JsonException on a malformed diagnostic
+Diagnostic diagnostic_from_json(const JsonValue& value);
+JsonValue to_json(const std::vector<BatchJobResult>& results);
+
+}  // namespace dlvc
@@ -0,0 +1,15 @@
+#pragma once
+#include <exception>
+#include <string>
+
+class IRException : public std::exception {
+   public:
+    IRException(const std::string& message) : m_message(message) {}
+
+    const char* what() const noexcept override { return m_message.c_str(); }
+
+    const std::string& get_message() const { return m_message; }
+
+   private:
+    std::string m_message;
+};
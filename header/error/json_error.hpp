@@ -0,0 +1,24 @@
+#pragma once
+#include <exception>
+#include <sstream>
+#include <string>
+
+class JsonException : public std::exception {
+   public:
+    JsonException(const std::string& message, size_t position) : m_message(message), m_position(position) {}
+
+    const char* what() const noexcept override {
+        std::stringstream stream;
+        stream << "JSON EXCEPTION at offset " << m_position << ": " << m_message;
+
+        m_formatted_message = stream.str();
+
+        return m_formatted_message.c_str();
+    }
+
+   private:
+    std::string m_message;
+    const size_t m_position;
+
+    mutable std::string m_formatted_message;
+};
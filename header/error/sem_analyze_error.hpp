@@ -21,6 +21,10 @@ class SemanticAnalyzerException : public std::exception {
         return m_formatted_message.c_str();
     }
 
+    const std::string& get_message() const { return m_message; }
+    size_t get_line() const { return m_line; }
+    size_t get_col() const { return m_col; }
+
    private:
     std::string m_message;
     const size_t m_line;
@@ -2,8 +2,15 @@
 
 #include <fstream>
 #include <iostream>
+#include <optional>
 #include <vector>
 
 std::string read_file(const std::string& path);
 
-void write_file(std::string filename, std::string contents);
\ No newline at end of file
+// reads the entire file, byte for byte. nullopt if the file could not be opened
+std::optional<std::string> try_read_file(const std::string& path);
+
+bool write_file(std::string filename, std::string contents);
+
+// creates an empty, uniquely named file in the system's temp directory and returns its path
+std::string create_temp_file(const std::string& suffix);
@@ -0,0 +1,60 @@
+#pragma once
+#include <map>
+#include <string>
+#include <vector>
+
+#include "AST_node.hpp"
+#include "json.hpp"
+
+// function-level incremental compilation.
+// every top-level function gets a record holding a fingerprint of its tokens and signature, the callees and
+// globals its analysis depended on, and the assembly generated for it. when the file is compiled again, a
+// function whose fingerprint and dependencies didn't change skips semantic analysis and code generation.
+namespace FunctionCache {
+
+struct Fingerprint {
+    // every token of the function. lines are relative to the function's first line, so moving a function
+    // around the file doesn't invalidate it
+    std::string body;
+    // return and parameter types- what callers depend on
+    std::string signature;
+
+    bool operator==(const Fingerprint& other) const { return body == other.body && signature == other.signature; }
+    bool operator!=(const Fingerprint& other) const { return !(*this == other); }
+};
+
+// state of a global variable referenced by the function
+struct GlobalUse {
+    std::string data_type;
+    // analysis of the function reads and updates whether the global is initialized
+    bool initialized_before;
+    bool initialized_after;
+};
+
+struct RecordedWarning {
+    std::string message;
+    size_t line_offset;  // relative to the function's first line
+    size_t col;
+};
+
+struct FunctionRecord {
+    Fingerprint fingerprint;
+    // callee name -> signature fingerprint the function was compiled against
+    std::map<std::string, std::string> callees;
+    std::map<std::string, GlobalUse> globals;
+    std::vector<RecordedWarning> warnings;
+    std::string asm_code;
+};
+
+using FunctionRecords = std::map<std::string, FunctionRecord>;
+using Fingerprints = std::map<std::string, Fingerprint>;
+
+Fingerprint fingerprint_function(const std::vector<Token>& tokens, const ASTStatementFunction& function);
+Fingerprints fingerprint_functions(const std::vector<Token>& tokens, const ASTProgram& program);
+
+// 'compiler_id' identifies the compiler build and options the records were created with.
+// records of a different compiler_id, or a missing / malformed file, load as no records at all
+FunctionRecords load_records(const std::string& path, const std::string& compiler_id);
+bool save_records(const std::string& path, const std::string& compiler_id, const FunctionRecords& records);
+
+}  // namespace FunctionCache
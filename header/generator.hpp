@@ -1,39 +1,87 @@
 #pragma once
 #include <cassert>
+#include <functional>
 #include <iostream>
 #include <map>
+#include <set>
 #include <sstream>
 #include <string>
+#include <vector>
 
+#include "./error/generator_error.hpp"
 #include "AST_node.hpp"
 #include "scope_stack.hpp"
 
-extern std::map<size_t, std::string> size_bytes_to_size_keyword;
-extern std::map<size_t, std::string> size_bytes_to_register;
-extern std::map<BinOperation, std::string> comparison_operation;
+extern const std::map<size_t, std::string> size_bytes_to_size_keyword;
+extern const std::map<size_t, std::string> size_bytes_to_register;
+// the registers expressions are evaluated in, each by size- the caller-saved ones first, so most functions have no
+// callee-saved one to keep. rax, rdx and r11 are left to the sequences with fixed registers. the last one, rcx, is
+// only where an operand kept on the stack is popped back into
+extern const std::vector<std::map<size_t, std::string>> expression_registers;
+// the registers the first integer arguments are passed in, each by size- rdi, rsi, rdx, rcx, r8 and r9
+extern const std::vector<std::map<size_t, std::string>> argument_registers;
+// the ones a function returns as it got them
+extern const std::set<std::string> callee_saved_registers;
+extern const std::map<BinOperation, std::string> comparison_operation;
 
 class Generator {
    public:
-    Generator(ASTProgram program) : m_prog(program), m_stack_size(0), m_condition_counter(0) {}
+    Generator(ASTProgram program)
+        : m_prog(program), m_pushed_size(0), m_condition_counter(0), m_registers_used(0), m_rodata_counter(0) {}
     std::string generate_program();
 
+    // function name -> previously generated assembly, used instead of generating the function
+    void set_reused_functions(std::map<std::string, std::string> reused_functions) {
+        m_reused_functions = std::move(reused_functions);
+    }
+    // assembly of every function, generated or reused
+    const std::map<std::string, std::string>& get_function_asm() const { return m_function_asm; }
+
    private:
     struct Variable;
 
     void generate_statement(const ASTStatement& statement);
-    // Pushes the result expression onto the stack
-    void generate_expression(const ASTExpression& expression);
-
-    void generate_expression_identifier(const ASTIdentifier& identifier, size_t size_bytes);
-    void generate_expression_int_literal(const ASTIntLiteral& literal, size_t size_bytes);
-    void generate_expression_char_literal(const ASTCharLiteral& literal, size_t size_bytes);
-    void generate_expression_array_initializer(const ASTArrayInitializer& array_initializer);
 
-    void generate_expression_unary(const std::shared_ptr<ASTUnaryExpression>& unary, size_t size_bytes);
-    void generate_expression_binary(const std::shared_ptr<ASTBinExpression>& binary, size_t size_bytes);
+    // expressions are evaluated into registers, in the order of their Sethi-Ullman numbers- "The Generation of
+    // Optimal Code for Arithmetic Expressions", Sethi and Ullman. the operand needing more registers goes first, so
+    // the other fits in what's left, and only when both need all of them is one kept on the stack meanwhile.
+    //
+    // the 'generate_expression_*' functions evaluate into expression register 'first', free to use the ones above
+    // it, and leave the value zero-extended from its size
+    void evaluate_expression(const ASTExpression& expression, size_t first);
+    // the registers the expression takes to evaluate without spilling
+    static size_t register_need(const ASTExpression& expression);
+    static size_t address_register_need(const ASTExpression& expression);
+    // calls may change memory, so the operands around them are evaluated in order
+    static bool has_call(const ASTExpression& expression);
+    // evaluates two operands into expression registers- returns the lhs's and the rhs's
+    std::pair<size_t, size_t> evaluate_operands(const std::function<void(size_t)>& evaluate_lhs, size_t lhs_need,
+                                                const std::function<void(size_t)>& evaluate_rhs, size_t rhs_need,
+                                                bool in_order, size_t first);
+    // the name of expression register 'index', marked as used by the function
+    std::string register_name(size_t index, size_t size_bytes);
+    // zero-extends expression register 'index' from 'size_bytes'
+    void truncate_register(size_t index, size_t size_bytes);
+    // loads 'size_bytes' from the address into expression register 'index', zero-extended
+    void load_register(size_t index, size_t size_bytes, const std::string& address);
+    void load_constant(size_t index, uint64_t value, size_t size_bytes);
+
+    void generate_expression_identifier(const ASTIdentifier& identifier, size_t size_bytes, size_t first);
+    void generate_expression_int_literal(const ASTIntLiteral& literal, size_t size_bytes, size_t first);
+    void generate_expression_char_literal(const ASTCharLiteral& literal, size_t size_bytes, size_t first);
+
+    void generate_expression_unary(const std::shared_ptr<ASTUnaryExpression>& unary, size_t size_bytes, size_t first);
+    void generate_expression_binary(const std::shared_ptr<ASTBinExpression>& binary, size_t size_bytes,
+                                    size_t first);
     void generate_expression_array_index(const std::shared_ptr<ASTArrayIndexExpression>& array_index,
-                                         size_t return_size_bytes);
-    void generate_expression_function_call(const ASTFunctionCall& function_call_expr, size_t return_size_bytes);
+                                         size_t return_size_bytes, size_t first);
+    // calls follow the System V AMD64 ABI- the first six arguments in rdi, rsi, rdx, rcx, r8 and r9, the rest on the
+    // stack, the result in rax. the caller-saved expression registers below 'first' are saved around the call
+    void generate_expression_function_call(const ASTFunctionCall& function_call_expr, size_t return_size_bytes,
+                                           size_t first);
+    // multiplication, division and modulo by a constant, strength-reduced. generates nothing and returns false when
+    // neither operand is a usable constant
+    bool generate_binary_by_constant(const ASTBinExpression& binary, size_t first);
 
     void generate_statement_exit(const std::shared_ptr<ASTStatementExit>& exit_statement);
     void generate_statement_var_declare(const std::shared_ptr<ASTStatementVar>& var_statement);
@@ -47,10 +95,59 @@ class Generator {
     void enter_scope();
     void exit_scope();
 
-    void load_memory_address_var(const ASTIdentifier& variable);
-    void load_memory_address_arr_index(const std::shared_ptr<ASTArrayIndexExpression>& index_expr);
-    void load_memory_address_expr(const ASTExpression& expression);
+    // the frame is laid out before its code is generated- every variable declared in it gets a slot below rbp,
+    // aligned to its type. the variables of sibling scopes are never alive together, so they share their slots.
+    //
+    // lays out the variables declared by the statement from 'offset' below rbp- moving 'offset' past the ones
+    // staying in scope after it, and 'frame_size' past all of them
+    void layout_statement(const ASTStatement& statement, size_t& offset, size_t& frame_size);
+    // the variables declared outside of any scope are globals- they aren't in main's frame, but in .data when their
+    // initializer is constant and in .bss, zeroed, otherwise. lays out a top-level statement, writing the storage of
+    // its globals to 'data' and 'bss'
+    void layout_global_statement(const ASTStatement& statement, size_t& offset, size_t& frame_size,
+                                 std::stringstream& data, std::stringstream& bss);
+    // the values of an initializer made of int/char literals only, flattened to its innermost elements
+    static std::optional<std::vector<uint64_t>> constant_initializer(const ASTExpression& value);
+
+    // constant array initializers are kept in .rodata- copied into the variable at its declaration, or referred to
+    // by the variable itself when it's never written.
+    //
+    // adds the names the statement uses other than to read their elements- assigned to, or decaying to a pointer
+    static void collect_written_names(const ASTStatement& statement, std::set<std::string>& names);
+    bool is_read_only_array(const ASTStatementVar& var_statement) const;
+    // writes the values as data directives of the type, labeled 'symbol'
+    static void write_data(std::ostream& section, const std::string& symbol, const std::shared_ptr<DataType>& data_type,
+                           const std::vector<uint64_t>& values);
+    // the symbol of a new .rodata constant holding the variable's initializer
+    std::string rodata_initializer(const ASTStatementVar& var_statement);
+    // writes the constants of the function being generated
+    void generate_rodata();
+    // copies 'size_bytes' from the symbol to 'frame_offset' bytes from rbp
+    void copy_from_rodata(const std::string& symbol, int64_t frame_offset, size_t size_bytes);
+    static size_t alignment_of(const std::shared_ptr<DataType>& data_type);
+    // the memory operand 'offset' bytes from 'base'- a register, or 'rel <symbol>'
+    static std::string memory_address(const std::string& base, int64_t offset);
+    // stores the value, or the elements of an array initializer, 'offset' bytes from 'base'
+    void store_initializer(const std::string& base, int64_t offset, const ASTExpression& value);
+
+    // the memory operand of the variable- rbp-relative in the frame, rip-relative for a global
+    std::string variable_address(const ASTIdentifier& variable);
+    // evaluates the address of the expression into expression register 'first'
+    void load_memory_address_expr(const ASTExpression& expression, size_t first);
+    // the memory operand of an element- evaluates the indexed expression and the index
+    std::string array_element_address(const ASTArrayIndexExpression& array_index, size_t first);
     Generator::Variable assert_get_variable_data(std::string variable_name);
+    // memory operand of base + index * element_size. scales the index register in place when the addressing mode
+    // can't
+    std::string indexed_address(const std::string& base, const std::string& index, size_t element_size);
+    // the value of an int/char literal, possibly parenthesized, as the generated code would see it
+    static std::optional<uint64_t> constant_value(const ASTExpression& expression);
+    // the operand multiplied, divided or taken modulo by a constant- what a strength-reduced binary evaluates
+    static const ASTExpression* reduced_operand(const ASTBinExpression& binary);
+    // the rhs of an addition, subtraction or comparison, when it's a constant fitting an immediate
+    static std::optional<uint64_t> immediate_operand(const ASTBinExpression& binary);
+    // the symbol of a global variable's storage
+    static std::string global_symbol(const std::string& variable_name);
 
     // push a literal value to the stack
     void push_stack_literal(const std::string& value, size_t size);
@@ -66,15 +163,36 @@ class Generator {
 
     // map from variable name to variable details
     ScopeStack<Generator::Variable> m_stack;
-    size_t m_stack_size;
+    // bytes pushed below the frame- operands waiting on the stack, and the registers saved around calls
+    size_t m_pushed_size;
     size_t m_condition_counter;
+    // the expression registers, from 0, the function being generated evaluates in
+    size_t m_registers_used;
+    // the slot of every variable declaration of the frame being generated, as its distance below rbp
+    std::map<const ASTStatementVar*, size_t> m_slots;
+    // the top-level variable declarations
+    std::set<const ASTStatementVar*> m_globals;
+    // the names the code being generated may write an array through- globals are checked against the whole program
+    std::set<std::string> m_written_names;
+    // the function being generated- 'main' for the top-level code
+    std::string m_function_name;
+    // the .rodata constants of the function being generated, written after its code
+    std::stringstream m_rodata;
+    size_t m_rodata_counter;
+
+    std::map<std::string, std::string> m_reused_functions;
+    std::map<std::string, std::string> m_function_asm;
 
     struct StatementVisitor;
     struct ExpressionVisitor;
 
     struct Variable {
-        // stack location in bytes
-        size_t stack_location_bytes;
+        // address relative to rbp- negative for the frame's slots, positive for parameters passed on the stack
+        int64_t frame_offset;
+
+        // the symbol of the variable's storage when it's outside of the frame- a global's, or the .rodata
+        // initializer of an array that's never written
+        std::string symbol;
 
         // variable size in bytes
         size_t size_bytes;
@@ -27,47 +27,55 @@ struct Generator::StatementVisitor {
         generator.generate_statement_return(return_statement);
     }
     void operator()(const std::shared_ptr<ASTFunctionCall>& function_call_statement) const {
-        generator.generate_expression_function_call(*function_call_statement, 0);
+        generator.generate_expression_function_call(*function_call_statement, 0, 0);
     }
 };
 
 struct Generator::ExpressionVisitor {
     Generator& generator;
     size_t size;
+    // the expression register to evaluate into
+    size_t first;
 
     void operator()(const ASTIdentifier& identifier) const {
-        generator.generate_expression_identifier(identifier, size);
+        generator.generate_expression_identifier(identifier, size, first);
     }
 
-    void operator()(const ASTIntLiteral& literal) const { generator.generate_expression_int_literal(literal, size); }
+    void operator()(const ASTIntLiteral& literal) const {
+        generator.generate_expression_int_literal(literal, size, first);
+    }
 
-    void operator()(const ASTCharLiteral& literal) const { generator.generate_expression_char_literal(literal, size); }
+    void operator()(const ASTCharLiteral& literal) const {
+        generator.generate_expression_char_literal(literal, size, first);
+    }
 
-    void operator()(const ASTArrayInitializer& initializer) const {
-        generator.generate_expression_array_initializer(initializer);
+    void operator()(const ASTArrayInitializer&) const {
+        // its elements are pushed where it's declared- there's no value to hold in a register
+        throw GeneratorException("Generation: unexpected array initializer in an expression");
     }
 
     void operator()(const std::shared_ptr<ASTBinExpression>& binary) const {
-        generator.generate_expression_binary(binary, size);
+        generator.generate_expression_binary(binary, size, first);
     }
 
     void operator()(const std::shared_ptr<ASTAtomicExpression>& atomic) const {
-        std::visit(Generator::ExpressionVisitor{.generator = generator, .size = size}, atomic->value);
+        std::visit(Generator::ExpressionVisitor{.generator = generator, .size = size, .first = first}, atomic->value);
     }
     void operator()(const std::shared_ptr<ASTUnaryExpression>& unary) const {
-        generator.generate_expression_unary(unary, size);
+        generator.generate_expression_unary(unary, size, first);
     }
 
     void operator()(const ASTParenthesisExpression& paren_expr) const {
         auto& inner_expression = *paren_expr.expression;
-        std::visit(Generator::ExpressionVisitor{.generator = generator, .size = size}, inner_expression.expression);
+        std::visit(Generator::ExpressionVisitor{.generator = generator, .size = size, .first = first},
+                   inner_expression.expression);
     }
 
     void operator()(const ASTFunctionCall& function_call_expr) const {
-        generator.generate_expression_function_call(function_call_expr, size);
+        generator.generate_expression_function_call(function_call_expr, size, first);
     }
 
     void operator()(const std::shared_ptr<ASTArrayIndexExpression>& arr_index) const {
-        generator.generate_expression_array_index(arr_index, size);
+        generator.generate_expression_array_index(arr_index, size, first);
     }
 };
\ No newline at end of file
@@ -14,8 +14,9 @@ class Globals {
 
    public:
     // Static member function to get the singleton instance
+    // NOTE: one instance per thread, so concurrent compilations(compile server) report their own file paths
     static Globals& getInstance() {
-        static Globals instance;  // Guaranteed to be initialized only once
+        static thread_local Globals instance;  // Guaranteed to be initialized only once per thread
         return instance;
     }
 
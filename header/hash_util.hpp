@@ -0,0 +1,42 @@
+#pragma once
+#include <string>
+
+// FNV-1a, 128 bit. not cryptographic- used for content addressing and change detection
+class ContentHash {
+   public:
+    ContentHash() : m_state(offset_basis()) {}
+
+    ContentHash& update(const std::string& data) {
+        for (unsigned char byte : data) {
+            m_state ^= byte;
+            m_state *= prime();
+        }
+        return *this;
+    }
+
+    // length-prefixed, so consecutive fields can't be confused with each other ("ab" + "c" vs "a" + "bc")
+    ContentHash& update_field(const std::string& data) {
+        update(std::to_string(data.size()));
+        update(":");
+        return update(data);
+    }
+
+    std::string hex_digest() const {
+        static const char digits[] = "0123456789abcdef";
+        std::string out(32, '0');
+        unsigned __int128 state = m_state;
+        for (int i = 31; i >= 0; --i) {
+            out[i] = digits[(size_t)(state & 0xF)];
+            state >>= 4;
+        }
+        return out;
+    }
+
+   private:
+    unsigned __int128 m_state;
+
+    static unsigned __int128 offset_basis() {
+        return ((unsigned __int128)0x6c62272e07bb0142ULL << 64) | 0x62b821756295c58dULL;
+    }
+    static unsigned __int128 prime() { return ((unsigned __int128)0x0000000001000000ULL << 64) | 0x000000000000013BULL; }
+};
@@ -0,0 +1,203 @@
+#pragma once
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "../error/ir_error.hpp"
+
+// three-address SSA intermediate representation, between semantic analysis and code generation.
+//
+// every value is defined by exactly one instruction and has a type. pointers are i64.
+// integer semantics mirror the AST generator:
+//   - values of types narrower than i64 are kept zero-extended
+//   - arithmetic wraps at the width of the instruction's type, division and modulo are unsigned
+//   - comparisons compare their zero-extended operands as signed 64 bit numbers- signed for i64, unsigned for
+//     narrower types. the result is 0 or 1, of the instruction's type
+//   - vectors are 16 or 32 bytes of lanes of an integer type, which the vector instructions name by their size in
+//     bytes in <immediate>. lanes wrap like scalars of their type. vectors are never constants, phis or parameters
+
+enum class IRType {
+    Void,
+    I8,
+    I16,
+    I32,
+    I64,
+    V128,
+    V256,
+};
+
+size_t ir_type_size(IRType type);
+std::string ir_type_name(IRType type);
+IRType ir_type_from_size(size_t size_bytes);
+// 'value' truncated to the width of 'type', zero-extended
+int64_t ir_normalize(int64_t value, IRType type);
+
+// 0 is never a valid value id
+using IRValueId = uint32_t;
+using IRBlockId = uint32_t;
+
+struct IROperand {
+    enum class Kind {
+        Value,
+        Constant,
+    };
+    Kind kind;
+    IRType type;
+    IRValueId value;
+    // normalized to 'type'
+    int64_t constant;
+
+    static IROperand make_value(IRValueId value, IRType type);
+    static IROperand make_constant(int64_t constant, IRType type);
+
+    bool is_value() const { return kind == Kind::Value; }
+    bool is_constant() const { return kind == Kind::Constant; }
+    bool operator==(const IROperand& other) const;
+    bool operator!=(const IROperand& other) const { return !(*this == other); }
+};
+
+enum class IROpcode {
+    // %r = param <immediate>- the function's parameter. the params open the entry block, before any other instruction
+    Param,
+    // %r = alloca <immediate>- address of an uninitialized stack slot of <immediate> bytes
+    Alloca,
+    // %r = global_addr @<symbol>
+    GlobalAddr,
+    // %r = load <address>
+    Load,
+    // store <value>, <address>
+    Store,
+    // zero <address>, <immediate>- fills <immediate> bytes with zeros
+    Zero,
+
+    Add,
+    Sub,
+    Mul,
+    UDiv,
+    URem,
+    Neg,
+    CmpEq,
+    CmpLt,
+    CmpLe,
+    CmpGt,
+    CmpGe,
+    ZExt,
+    Trunc,
+
+    // %r = call @<symbol>(<operands>)
+    Call,
+    // %r = phi [<operand i>, <block i>]...
+    Phi,
+
+    // %r = vector_splat <operand>- every lane the scalar operand
+    VectorSplat,
+    // %r = vector_load <address>, vector_store <vector>, <address>- lanes in order from the address up, which
+    // needn't be aligned
+    VectorLoad,
+    VectorStore,
+    VectorAdd,
+    VectorSub,
+    VectorMul,
+    // %r = vector_reduce_add <vector>- the i64 sum of the lanes, zero-extended each
+    VectorReduceAdd,
+
+    // terminators- the last instruction of every block, and only there
+    Jump,
+    // branch <condition>, <blocks[0] if non-zero>, <blocks[1] if zero>
+    Branch,
+    Return,
+    // exits the process with the operand as the status code
+    Exit,
+};
+
+std::string ir_opcode_name(IROpcode opcode);
+bool ir_is_terminator(IROpcode opcode);
+bool ir_is_binary(IROpcode opcode);
+bool ir_is_comparison(IROpcode opcode);
+// removing the instruction changes more than its result- memory, control flow, the process
+bool ir_has_side_effects(IROpcode opcode);
+// arithmetic, comparisons and conversions- the result depends on nothing but the operands
+bool ir_is_foldable(IROpcode opcode);
+bool ir_is_vector(IRType type);
+
+struct IRInstruction {
+    IROpcode opcode;
+    // type of the result, Void when there's none
+    IRType type = IRType::Void;
+    IRValueId result = 0;
+    std::vector<IROperand> operands = {};
+    // jump/branch targets, or the incoming block of each phi operand
+    std::vector<IRBlockId> blocks = {};
+    // callee of a call, global of a global_addr
+    std::string symbol = "";
+    // parameter index, alloca/zero size, lane size of a vector instruction
+    int64_t immediate = 0;
+
+    bool has_result() const { return result != 0; }
+    IROperand result_operand() const { return IROperand::make_value(result, type); }
+};
+
+// a division or modulo whose divisor isn't a known non-zero constant- it may trap, so it's neither removed nor
+// moved, even when its result is unused
+bool ir_may_trap(const IRInstruction& instruction);
+
+struct IRBasicBlock {
+    IRBlockId id;
+    std::vector<IRInstruction> instructions;
+
+    bool is_terminated() const { return !instructions.empty() && ir_is_terminator(instructions.back().opcode); }
+    const IRInstruction& terminator() const { return instructions.back(); }
+    IRInstruction& terminator() { return instructions.back(); }
+    std::vector<IRBlockId> successors() const;
+};
+
+// the source's 'inline'/'noinline' annotation
+enum class IRInlineHint {
+    None,
+    Always,
+    Never,
+};
+
+struct IRFunction {
+    std::string name;
+    IRType return_type = IRType::Void;
+    std::vector<IRType> parameter_types;
+    // the top-level statements of the program. ends with an exit instead of returning
+    bool is_entry = false;
+    IRInlineHint inline_hint = IRInlineHint::None;
+    // blocks[0] is the entry block
+    std::vector<IRBasicBlock> blocks;
+    IRValueId next_value_id = 1;
+    IRBlockId next_block_id = 0;
+
+    IRValueId new_value() { return next_value_id++; }
+    IRBasicBlock& add_block();
+    IRBasicBlock* find_block(IRBlockId id);
+    const IRBasicBlock* find_block(IRBlockId id) const;
+    size_t instruction_count() const;
+};
+
+struct IRGlobal {
+    std::string name;
+    size_t size_bytes;
+};
+
+struct IRModule {
+    std::vector<IRGlobal> globals;
+    std::vector<IRFunction> functions;
+
+    IRFunction* find_function(const std::string& name);
+    const IRFunction* find_function(const std::string& name) const;
+    size_t instruction_count() const;
+};
+
+// the result of a foldable instruction over constant operands, with the AST generator's semantics.
+// nothing for a division by zero, which is left to trap at runtime
+std::optional<int64_t> ir_evaluate(IROpcode opcode, IRType type, const std::vector<int64_t>& operands);
+
+// textual form of the IR- --emit=ir
+std::string to_string(const IROperand& operand);
+std::string to_string(const IRInstruction& instruction);
+std::string to_string(const IRFunction& function);
+std::string to_string(const IRModule& module);
@@ -0,0 +1,50 @@
+#pragma once
+#include <map>
+#include <vector>
+
+#include "ir.hpp"
+
+// control flow graph queries and rewrites over an IRFunction.
+// block ids index the per-block tables, so they're valid until blocks are added
+
+// predecessors of every block, indexed by block id. a block appears once per edge into the successor
+std::vector<std::vector<IRBlockId>> ir_predecessors(const IRFunction& function);
+
+// the blocks reachable from the entry block, in reverse post-order
+std::vector<IRBlockId> ir_reverse_post_order(const IRFunction& function);
+
+class IRDominatorTree {
+   public:
+    explicit IRDominatorTree(const IRFunction& function);
+
+    bool is_reachable(IRBlockId block) const;
+    // every block dominates itself. unreachable blocks dominate and are dominated by nothing
+    bool dominates(IRBlockId dominator, IRBlockId block) const;
+    // the entry block is its own immediate dominator
+    IRBlockId immediate_dominator(IRBlockId block) const;
+    const std::vector<IRBlockId>& children(IRBlockId block) const;
+    // the blocks in reverse post-order, which visits every dominator before the blocks it dominates
+    const std::vector<IRBlockId>& get_order() const { return m_order; }
+
+   private:
+    static constexpr size_t UNREACHABLE = (size_t)-1;
+
+    // reverse post-order index of every block, UNREACHABLE for unreachable blocks
+    std::vector<size_t> m_order_index;
+    std::vector<IRBlockId> m_order;
+    std::vector<IRBlockId> m_immediate_dominator;
+    std::vector<std::vector<IRBlockId>> m_children;
+};
+
+// the block defining every value
+std::map<IRValueId, IRBlockId> ir_definition_blocks(const IRFunction& function);
+
+// removes the blocks unreachable from the entry, along with the phi operands flowing out of them.
+// returns the number of removed blocks
+size_t ir_remove_unreachable_blocks(IRFunction& function);
+
+// replaces every use of 'value' in the function with 'replacement'
+void ir_replace_uses(IRFunction& function, IRValueId value, const IROperand& replacement);
+
+// replaces uses through a map of value -> replacement, following chains of replacements
+void ir_replace_uses(IRFunction& function, const std::map<IRValueId, IROperand>& replacements);
@@ -0,0 +1,130 @@
+#pragma once
+#include <map>
+#include <optional>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "ir.hpp"
+#include "ir_register_allocation.hpp"
+
+// IR -> x86-64 NASM assembly.
+//
+// scalar SSA values live in the registers the linear scan allocation gives them, zero-extended- the ones it spills
+// in 8 byte stack slots at [rbp-offset], vectors in 16 or 32 byte slots, which need no alignment. vector
+// instructions work in xmm/ymm 0-3, with SSE2 for v128 and AVX2 for v256. an instruction needing a register of its
+// own takes one no value lives in at that point- or saves one around itself when all of them do- and the ones with
+// fixed registers, division, the strength-reduced sequences, rep stosb and calls, save the values living across
+// them in those. phis are resolved on the edges into their block- the predecessor copies the incoming values into
+// the phis' locations as a parallel move before jumping.
+// calls follow the System V AMD64 ABI- the first six arguments in rdi, rsi, rdx, rcx, r8 and r9, the rest pushed as
+// qwords from the last, the result in rax and rsp 16 byte aligned at the call. a function moves its parameters to
+// their values' locations on entry, keeps the callee-saved registers it uses in its frame, and restores them on
+// return. a call whose result is returned right away is a tail call- it reuses the caller's frame and stack
+// argument slots and jumps to the callee, which returns to the caller's caller
+class IRGenerator {
+   public:
+    IRGenerator(const IRModule& module)
+        : m_module(module),
+          m_function(nullptr),
+          m_frame_size(0),
+          m_edge_counter(0),
+          m_tail_calls_allowed(false),
+          m_instruction(nullptr) {}
+    std::string generate_program();
+
+   private:
+    void generate_function(const IRFunction& function);
+    void generate_instruction(const IRBasicBlock& block, const IRInstruction& instruction, IRBlockId next_block);
+    void generate_binary(const IRInstruction& instruction);
+    void generate_comparison(const IRInstruction& instruction);
+    void generate_division(const IRInstruction& instruction);
+    // multiplication, division and modulo by a constant, strength-reduced into rax. false when there's no constant
+    // operand to reduce by
+    bool generate_binary_by_constant(const IRInstruction& instruction);
+    void generate_store(const IRInstruction& instruction);
+    void generate_call(const IRInstruction& call);
+    void generate_vector(const IRInstruction& instruction);
+    void generate_vector_reduce_add(const IRInstruction& instruction);
+    // the call at 'index' is followed by a return of its result
+    bool is_tail_call(const IRBasicBlock& block, size_t index) const;
+    void generate_tail_call(const IRInstruction& call);
+    // (phi, incoming value) of the phis of 'target' whose values from 'block' are elsewhere
+    std::vector<std::pair<IROperand, IROperand>> edge_moves(IRBlockId block, IRBlockId target) const;
+    // jumps to 'target', copying the values its phis receive from 'block' first
+    void generate_edge(IRBlockId block, IRBlockId target, IRBlockId next_block);
+
+    // what a move reads or writes- a register the calling convention fixes, or an operand's own location
+    struct MoveLocation {
+        MoveLocation(IRRegister reg) : reg(reg) {}
+        MoveLocation(const IROperand& operand) : operand(operand) {}
+
+        std::optional<IRRegister> reg;
+        std::optional<IROperand> operand;
+    };
+    // (destination, source) pairs, all sources read before any destination is written
+    void generate_parallel_move(std::vector<std::pair<MoveLocation, MoveLocation>> moves);
+    // destination = source, for a destination that's a register or a value
+    void generate_move(const MoveLocation& destination, const MoveLocation& source);
+    // the parameters from the argument registers and the caller's frame to their values
+    void generate_parameters(const IRFunction& function);
+    void generate_return_sequence();
+    void layout_frame(const IRFunction& function);
+
+    // the registers the instruction may use- none of the values live across it, and it pushes what it borrows
+    void begin_instruction(const IRInstruction& instruction);
+    // pops what the instruction pushed
+    void end_instruction();
+    // pushes the values living across the instruction in the registers it overwrites, and keeps it from handing
+    // them out
+    void save_clobbered(const std::set<IRRegister>& clobbered);
+    // a register of the instruction's own, for intermediate values. callee-saved registers the prologue didn't save
+    // are only borrowed
+    IRRegister scratch();
+    // the register the instruction computes its result in- the result's own, or a scratch register for a spilled
+    // result
+    IRRegister result_register(const IRInstruction& instruction);
+    // a register holding the operand- its own, or a scratch one it's moved to
+    IRRegister operand_register(const IROperand& operand);
+
+    std::optional<IRRegister> register_of(const IROperand& operand) const;
+    std::optional<IRRegister> register_of(const MoveLocation& location) const;
+    bool same_location(const MoveLocation& a, const MoveLocation& b) const;
+    // the operand as the source of an instruction- a register, a stack slot or an immediate. an immediate
+    // outside of 32 bits is moved to a scratch register
+    std::string source(const IROperand& operand);
+    // mov 'reg', operand
+    void load_operand(IRRegister reg, const IROperand& operand);
+    void push_operand(const IROperand& operand);
+    // moves 'reg' to the instruction's result
+    void store_result(const IRInstruction& instruction, IRRegister reg);
+    void zero_extend(IRRegister reg, IRType type);
+    // the stack slot of a spilled value, or of a vector
+    std::string slot(IRValueId value) const;
+    std::string block_label(IRBlockId block) const;
+    static std::string global_symbol(const std::string& name);
+
+    const IRModule& m_module;
+    std::stringstream m_generated;
+
+    const IRFunction* m_function;
+    std::optional<IRRegisterAllocation> m_allocation;
+    // value -> offset of its slot below rbp
+    std::map<IRValueId, size_t> m_slots;
+    // alloca value -> offset of the memory below rbp
+    std::map<IRValueId, size_t> m_alloca_offsets;
+    // callee-saved register -> offset of the slot it's kept in
+    std::map<IRRegister, size_t> m_saved_offsets;
+    size_t m_frame_size;
+    size_t m_edge_counter;
+    // no alloca of the function escapes
+    bool m_tail_calls_allowed;
+
+    // the instruction being generated, the registers it mustn't hand out, the ones it mustn't borrow, and the ones
+    // it pushed
+    const IRInstruction* m_instruction;
+    std::set<IRRegister> m_taken;
+    std::set<IRRegister> m_reserved;
+    std::vector<IRRegister> m_pushed;
+};
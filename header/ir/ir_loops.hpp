@@ -0,0 +1,66 @@
+#pragma once
+#include <optional>
+#include <set>
+#include <utility>
+#include <vector>
+
+#include "ir.hpp"
+
+// natural loops of an IRFunction, and the rewrites that give a loop the shape the loop passes expect.
+// a back edge is an edge into a block that dominates its source- the block is the loop's header, and the loop is
+// every block that reaches a back edge without passing through the header. back edges into the same header make one
+// loop
+
+struct IRLoop {
+    IRBlockId header;
+    std::set<IRBlockId> blocks;
+    // sources of the back edges
+    std::vector<IRBlockId> latches;
+
+    bool contains(IRBlockId block) const { return blocks.count(block) > 0; }
+};
+
+// the loops of the function, inner loops before the loops containing them
+std::vector<IRLoop> ir_find_loops(const IRFunction& function);
+
+// the edges leaving the loop- (block in the loop, block outside)
+std::vector<std::pair<IRBlockId, IRBlockId>> ir_loop_exits(const IRFunction& function, const IRLoop& loop);
+
+// the loop's preheader- its only predecessor from outside, which jumps nowhere but the header. created when
+// missing, merging the header's incoming phi values from outside the loop into phis of its own
+IRBlockId ir_ensure_preheader(IRFunction& function, const IRLoop& loop);
+
+// places an empty block on the edge, which jumps on to 'to'. returns the new block
+IRBlockId ir_split_edge(IRFunction& function, IRBlockId from, IRBlockId to);
+
+// a phi of the header stepping by the same invariant amount every iteration- phi = [init, preheader],
+// [next, latch] with next = phi + step or phi - step
+struct IRInductionVariable {
+    IRValueId phi;
+    IRType type;
+    IROperand init;
+    IROperand step;
+    // Add or Sub
+    IROpcode direction;
+    IRValueId next;
+};
+
+// the basic induction variables of a loop with a single latch and a preheader, in the order of their phis
+std::vector<IRInductionVariable> ir_induction_variables(const IRFunction& function, const IRLoop& loop);
+
+// a loop leaving only from its header, once a counter stepping by a constant fails a comparison with an invariant
+// bound- while (i < n) { ...; i = i + 2; }
+struct IRCountedLoop {
+    IRInductionVariable counter;
+    // the loop goes on while 'counter <comparison> bound' holds- CmpLt/CmpLe counting up, CmpGt/CmpGe down
+    IROpcode comparison;
+    IROperand bound;
+    // signed, per iteration
+    int64_t step;
+    // the header's successors in and out of the loop
+    IRBlockId body;
+    IRBlockId exit;
+};
+
+// the loop as a counted loop, for a loop with a single latch, a preheader and no exit but its header's branch
+std::optional<IRCountedLoop> ir_counted_loop(const IRFunction& function, const IRLoop& loop);
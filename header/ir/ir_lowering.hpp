@@ -0,0 +1,118 @@
+#pragma once
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "../AST_node.hpp"
+#include "../scope_stack.hpp"
+#include "ir.hpp"
+
+// lowers the analyzed AST into the SSA IR.
+//
+// scalar locals and parameters whose address is never taken(no '&x') become SSA values directly, with phis placed
+// while lowering- "Simple and Efficient Construction of Static Single Assignment Form", Braun et al.
+// arrays, address-taken locals and globals live in memory- allocas in the entry block, and module globals.
+// the top-level statements become the entry function 'main'
+class IRLowering {
+   public:
+    IRLowering(const ASTProgram& program) : m_prog(program), m_function(nullptr), m_current_block(0), m_scope_depth(0) {}
+    IRModule lower();
+
+   private:
+    struct Variable;
+    struct StatementVisitor;
+    struct ExpressionVisitor;
+
+    void lower_entry_function();
+    void lower_function(const ASTStatementFunction& function_statement);
+    void begin_function(IRFunction& function, const std::set<std::string>& address_taken);
+    void finish_function();
+
+    void lower_statement(const ASTStatement& statement);
+    void lower_statement_exit(const ASTStatementExit& exit_statement);
+    void lower_statement_var_declare(const ASTStatementVar& var_statement);
+    void lower_statement_var_assignment(const ASTStatementAssign& var_assign_statement);
+    void lower_statement_scope(const ASTStatementScope& scope_statement);
+    void lower_statement_if(const ASTStatementIf& if_statement);
+    void lower_statement_while(const ASTStatementWhile& while_statement);
+    void lower_statement_return(const ASTStatementReturn& return_statement);
+
+    // the value of the expression, converted to the expression's type
+    IROperand lower_expression(const ASTExpression& expression);
+    IROperand lower_expression_identifier(const ASTIdentifier& identifier, IRType requested_type);
+    IROperand lower_expression_binary(const ASTBinExpression& binary, IRType requested_type);
+    IROperand lower_expression_unary(const ASTUnaryExpression& unary, IRType requested_type);
+    IROperand lower_expression_array_index(const ASTArrayIndexExpression& array_index, IRType requested_type);
+    IROperand lower_expression_function_call(const ASTFunctionCall& function_call, IRType requested_type);
+    // address of an lvalue- a variable in memory, an array element or '*pointer'
+    IROperand lower_address(const ASTExpression& expression);
+    IROperand lower_element_address(const ASTArrayIndexExpression& array_index);
+    // stores the elements of an array initializer, recursively for nested arrays
+    void store_initializer(const IROperand& address, size_t offset, const ASTExpression& value);
+
+    // ---- emission
+    IROperand emit(IROpcode opcode, IRType type, std::vector<IROperand> operands);
+    void emit_void(IROpcode opcode, std::vector<IROperand> operands);
+    IROperand emit_address_of(const Variable& variable);
+    IROperand convert(const IROperand& value, IRType type);
+    IRBlockId new_block();
+    void set_current_block(IRBlockId block);
+    void jump(IRBlockId target);
+    void branch(const IROperand& condition, IRBlockId on_true, IRBlockId on_false);
+    void terminate(IRInstruction terminator);
+    // code after exit/return still has to be lowered somewhere- a fresh block with no predecessors
+    void ensure_open_block();
+    IRBasicBlock& current_block() { return m_function->blocks.at(m_current_block); }
+
+    // ---- SSA construction
+    void write_variable(size_t variable, IRBlockId block, const IROperand& value);
+    IROperand read_variable(size_t variable, IRBlockId block);
+    IROperand read_variable_recursive(size_t variable, IRBlockId block);
+    IROperand add_phi_operands(size_t variable, IRValueId phi, IRBlockId block);
+    IRValueId new_phi(IRBlockId block, IRType type);
+    void seal_block(IRBlockId block);
+    // removes phis whose operands are all the same value(or the phi itself)
+    void remove_trivial_phis();
+
+    void declare_variable(const std::string& name, const std::shared_ptr<DataType>& data_type, bool in_memory,
+                          const std::string& global_name);
+    Variable& assert_get_variable(const std::string& name);
+
+    const ASTProgram& m_prog;
+    IRModule m_module;
+
+    IRFunction* m_function;
+    IRBlockId m_current_block;
+    // 0 in the outermost scope of the top-level statements- variables declared there are globals
+    size_t m_scope_depth;
+    std::set<std::string> m_address_taken;
+    ScopeStack<Variable> m_scopes;
+    // allocas, moved to the entry block once the function is lowered
+    std::vector<IRInstruction> m_allocas;
+
+    // SSA construction state of the current function
+    std::vector<IRType> m_ssa_types;
+    // variable -> block -> the variable's value at the end of the block
+    std::vector<std::map<IRBlockId, IROperand>> m_definitions;
+    std::vector<std::vector<IRBlockId>> m_predecessors;
+    std::vector<bool> m_sealed;
+    // block -> phis waiting for the block's predecessors, (variable, phi)
+    std::map<IRBlockId, std::vector<std::pair<size_t, IRValueId>>> m_incomplete_phis;
+
+    struct Variable {
+        std::shared_ptr<DataType> data_type;
+        // type of the variable's value. arrays decay to their address
+        IRType type;
+        bool in_memory;
+        // index into the SSA construction tables, for variables that aren't in memory
+        size_t ssa_index;
+        // alloca of locals in memory
+        IROperand address;
+        // name of the module global, empty for locals
+        std::string global_name;
+    };
+};
+
+// IR type of values of the data type. arrays and pointers are addresses- i64
+IRType ir_type_of(const std::shared_ptr<DataType>& data_type);
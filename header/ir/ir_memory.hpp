@@ -0,0 +1,76 @@
+#pragma once
+#include <map>
+#include <optional>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "ir.hpp"
+
+// the memory a function touches- its allocas and the module's globals- and which objects each address may point
+// into. a flow-insensitive points-to analysis: addresses are followed through additions, phis, and the pointers
+// stored to and loaded from the objects, for the whole function at once.
+//
+// where an address can't be followed- parameters, call results, pointers loaded from visible objects- it may point
+// into any visible object. such addresses are trusted to honour the types: memory is read with the width it was
+// written with, so an int_8 access through an unknown pointer never touches what an int_64 one does. the semantic
+// analyzer warns on the pointer conversions that would break this
+
+struct IRMemoryObject {
+    enum class Kind {
+        Alloca,
+        Global,
+    };
+    Kind kind;
+    // the alloca's result, or the global's name
+    IRValueId alloca = 0;
+    std::string global = "";
+    size_t size_bytes = 0;
+    // the address flows somewhere the analysis doesn't follow- a call, a return, arithmetic other than an
+    // offset, a visible object... or for a global, a function other than the entry uses it
+    bool escaped = false;
+};
+
+// the objects an address may point into
+struct IRPointsTo {
+    std::set<size_t> objects = {};
+    // and any visible object- the address came from somewhere the analysis doesn't follow
+    bool unknown = false;
+};
+
+class IRMemoryObjects {
+   public:
+    IRMemoryObjects(const IRFunction& function, const IRModule& module);
+
+    size_t size() const { return m_objects.size(); }
+    const IRMemoryObject& object(size_t index) const { return m_objects.at(index); }
+
+    IRPointsTo points_to(const IROperand& address) const;
+    // the only object the address points into, nothing when it may point into several
+    std::optional<size_t> base_object(const IROperand& address) const;
+    // the address is the start of its object, not an offset into it
+    bool is_exact(const IROperand& address) const;
+    // the object may be read or written by calls, and through addresses of unknown objects
+    bool is_visible(size_t object) const { return m_objects.at(object).escaped; }
+    // accesses of the types through the two addresses may touch the same memory. Void for an access of any type
+    bool may_alias(const IROperand& a, IRType a_type, const IROperand& b, IRType b_type) const;
+    bool may_alias(const IRPointsTo& a, IRType a_type, const IRPointsTo& b, IRType b_type) const;
+    // a call may read or write through the address
+    bool is_visible_to_calls(const IROperand& address) const;
+
+   private:
+    std::vector<IRMemoryObject> m_objects;
+    // address value -> the objects it may point into
+    std::map<IRValueId, IRPointsTo> m_points_to;
+    // object -> the objects the pointers stored in it may point into
+    std::vector<IRPointsTo> m_contents;
+    std::map<IRValueId, bool> m_exact;
+
+    // merges 'from' into 'into', true when that added anything
+    static bool merge(IRPointsTo& into, const IRPointsTo& from);
+    // the object escapes, and so does everything it points to. true when it hadn't before
+    bool escape(size_t object);
+    bool escape(const IRPointsTo& points_to);
+    bool update(const IRInstruction& instruction);
+    bool reaches_visible(const IRPointsTo& points_to) const;
+};
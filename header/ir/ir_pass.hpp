@@ -0,0 +1,96 @@
+#pragma once
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "ir.hpp"
+
+// optimization passes over the IR, and the pass manager running them in a pipeline.
+// every pass is registered by name- the pipelines, --passes and --print-after refer to passes by that name
+
+struct IRPassStatistics {
+    std::string pass;
+    double elapsed_ms = 0;
+    // measured by the pass manager, from the instruction and block counts before and after the pass
+    size_t instructions_removed = 0;
+    size_t instructions_added = 0;
+    size_t blocks_removed = 0;
+    // function -> instructions removed from it, for the functions the pass shrank
+    std::map<std::string, size_t> function_instructions_removed;
+    // reported by the pass
+    size_t blocks_merged = 0;
+    // pass specific counters, "branches folded" -> 3
+    std::map<std::string, size_t> counters;
+    // the pass's decisions, one line each- "inlined 'f' into 'main': ..."
+    std::vector<std::string> remarks;
+};
+
+// tunables of the passes
+struct IRPassOptions {
+    // the inliner inlines callees whose cost is at most this
+    int inline_threshold = 0;
+    // loop-unroll runs this many iterations of a counted loop per trip around it, 1 or less leaves loops alone
+    int unroll_factor = 4;
+    // the most instructions an unrolled loop may have- a fully unrolled loop counts every iteration
+    size_t unroll_size_budget = 128;
+    // the bytes of loop-vectorize's vectors- 16 for SSE2, 32 for AVX2. anything else leaves loops alone
+    size_t vector_width = 16;
+};
+
+// the tunables of -O<level>
+IRPassOptions ir_pass_options(int optimization_level);
+
+class IRPass {
+   public:
+    virtual ~IRPass() = default;
+    virtual std::string name() const = 0;
+    // returns whether the module changed
+    virtual bool run(IRModule& module, IRPassStatistics& statistics) = 0;
+};
+
+// a pass that handles each function on its own
+class IRFunctionPass : public IRPass {
+   public:
+    bool run(IRModule& module, IRPassStatistics& statistics) override;
+    virtual bool run_on_function(IRFunction& function, IRModule& module, IRPassStatistics& statistics) = 0;
+};
+
+// throws IRException for an unknown pass name
+std::unique_ptr<IRPass> ir_create_pass(const std::string& name, const IRPassOptions& options = IRPassOptions());
+std::vector<std::string> ir_pass_names();
+// the passes of -O<level>. -O0 runs none
+std::vector<std::string> ir_pipeline(int optimization_level);
+
+class IRPassManager {
+   public:
+    explicit IRPassManager(IRPassOptions options = IRPassOptions()) : m_options(options) {}
+
+    // throws IRException for an unknown pass name
+    void add_pass(const std::string& name);
+    void add_pass(std::unique_ptr<IRPass> pass);
+    // the module is printed after each of these passes, "all" prints after every pass
+    void set_print_after(std::set<std::string> passes) { m_print_after = std::move(passes); }
+    // the remarks of these passes are collected, "all" collects every pass's remarks
+    void set_remarks(std::set<std::string> passes) { m_remark_passes = std::move(passes); }
+
+    // runs the passes in order, verifying the module after each one
+    void run(IRModule& module);
+
+    // one entry per pass run, in order
+    const std::vector<IRPassStatistics>& get_statistics() const { return m_statistics; }
+    std::string format_statistics() const;
+    const std::string& get_printed() const { return m_printed; }
+    // "remark: <pass>: <remark>" lines
+    const std::string& get_remarks() const { return m_remarks; }
+
+   private:
+    IRPassOptions m_options;
+    std::vector<std::unique_ptr<IRPass>> m_passes;
+    std::set<std::string> m_print_after;
+    std::set<std::string> m_remark_passes;
+    std::string m_remarks;
+    std::vector<IRPassStatistics> m_statistics;
+    std::string m_printed;
+};
@@ -0,0 +1,132 @@
+#pragma once
+#include "ir_pass.hpp"
+
+// the optimization passes, by their registered names
+
+// simplify-cfg- removes unreachable blocks, folds branches on constants, bypasses empty blocks and merges
+// blocks into their only predecessor
+class IRSimplifyCFGPass : public IRFunctionPass {
+   public:
+    std::string name() const override { return "simplify-cfg"; }
+    bool run_on_function(IRFunction& function, IRModule& module, IRPassStatistics& statistics) override;
+};
+
+// sccp- sparse conditional constant propagation. folds instructions over constants, propagates constants through
+// phis- across ifs and loops- removes the branches that can never be taken, and simplifies identities such as
+// x + 0 and x * 1
+class IRConstantPropagationPass : public IRFunctionPass {
+   public:
+    std::string name() const override { return "sccp"; }
+    bool run_on_function(IRFunction& function, IRModule& module, IRPassStatistics& statistics) override;
+};
+
+// dse- removes stores and zeroing of memory objects nobody reads afterwards, from a backwards liveness analysis
+// of the function's allocas and the globals
+class IRDeadStoreEliminationPass : public IRFunctionPass {
+   public:
+    std::string name() const override { return "dse"; }
+    bool run_on_function(IRFunction& function, IRModule& module, IRPassStatistics& statistics) override;
+};
+
+// dce- removes unreachable blocks, and the instructions whose results are never used and that have no side
+// effects
+class IRDeadCodeEliminationPass : public IRFunctionPass {
+   public:
+    std::string name() const override { return "dce"; }
+    bool run_on_function(IRFunction& function, IRModule& module, IRPassStatistics& statistics) override;
+};
+
+// dead-functions- removes the functions no chain of calls from the entry function reaches, such as the ones every
+// call site of was folded away
+class IRDeadFunctionEliminationPass : public IRPass {
+   public:
+    std::string name() const override { return "dead-functions"; }
+    bool run(IRModule& module, IRPassStatistics& statistics) override;
+};
+
+// inline- replaces calls with the callee's body, bottom-up over the call graph. a callee is inlined when its
+// cost- its size, less the call it saves and its constant arguments- is within the threshold, when it has a
+// single call site, or when it's annotated 'inline'. recursive and 'noinline' functions are never inlined
+class IRInlinerPass : public IRPass {
+   public:
+    explicit IRInlinerPass(int threshold) : m_threshold(threshold) {}
+    std::string name() const override { return "inline"; }
+    bool run(IRModule& module, IRPassStatistics& statistics) override;
+
+   private:
+    int m_threshold;
+};
+
+// tail-recursion- turns calls of the function itself whose result is returned into jumps back to its start, so the
+// recursion runs as a loop in constant stack space. 'return n * f(n - 1)' and 'return f(n - 1) + x' become loops
+// too, through an accumulator the remaining returns are combined with
+class IRTailRecursionPass : public IRFunctionPass {
+   public:
+    std::string name() const override { return "tail-recursion"; }
+    bool run_on_function(IRFunction& function, IRModule& module, IRPassStatistics& statistics) override;
+};
+
+// mem2reg- keeps the memory objects nothing but whole loads and stores of one type reach in values instead, with
+// phis where the stored values meet- the locals whose address is taken but goes nowhere the points-to analysis
+// loses it, such as into an inlined callee, and the globals of the top-level statements no function uses
+class IRPromoteMemoryPass : public IRFunctionPass {
+   public:
+    std::string name() const override { return "mem2reg"; }
+    bool run_on_function(IRFunction& function, IRModule& module, IRPassStatistics& statistics) override;
+};
+
+// gvn- global value numbering. an instruction computing what an instruction dominating it computed already is
+// replaced by the earlier result- the same arithmetic of the same operands, the same global's address, and loads of
+// an address whose value is known from an earlier load or store, as long as no store or call in between may have
+// changed it
+class IRGlobalValueNumberingPass : public IRFunctionPass {
+   public:
+    std::string name() const override { return "gvn"; }
+    bool run_on_function(IRFunction& function, IRModule& module, IRPassStatistics& statistics) override;
+};
+
+// licm- loop invariant code motion. moves the computations that give the same result every iteration to a
+// preheader before the loop, and keeps the variables a loop reads and writes as a whole- the globals of the top-level
+// statements among them- in values through the loop, loaded before it and stored back on the way out. inner loops
+// are handled first, so what they hoist can move further out
+class IRLoopInvariantCodeMotionPass : public IRFunctionPass {
+   public:
+    std::string name() const override { return "licm"; }
+    bool run_on_function(IRFunction& function, IRModule& module, IRPassStatistics& statistics) override;
+};
+
+// loop-strength-reduce- replaces multiplications of a loop's induction variables, such as the base + i * size of
+// an array index, with variables of their own stepping by an addition every iteration
+class IRLoopStrengthReductionPass : public IRFunctionPass {
+   public:
+    std::string name() const override { return "loop-strength-reduce"; }
+    bool run_on_function(IRFunction& function, IRModule& module, IRPassStatistics& statistics) override;
+};
+
+// loop-vectorize- runs the iterations of an innermost loop over the elements of arrays side by side, one per lane
+// of an SSE2 or AVX2 vector- element-wise additions, subtractions and multiplications, copies and sums of int_8,
+// int_32 or char arrays and the like. the original loop runs the remaining iterations. the vector width comes from
+// the options
+class IRLoopVectorizePass : public IRFunctionPass {
+   public:
+    explicit IRLoopVectorizePass(IRPassOptions options) : m_options(options) {}
+    std::string name() const override { return "loop-vectorize"; }
+    bool run_on_function(IRFunction& function, IRModule& module, IRPassStatistics& statistics) override;
+
+   private:
+    IRPassOptions m_options;
+};
+
+// loop-unroll- runs several iterations of an innermost counted loop- a counter stepping by a constant until it
+// fails a comparison with an invariant bound- per trip around it, while the counter stays within the bound for all
+// of them. the original loop runs the remaining iterations. loops of a few constant iterations are unrolled fully.
+// the factor and the size budget come from the options
+class IRLoopUnrollPass : public IRFunctionPass {
+   public:
+    explicit IRLoopUnrollPass(IRPassOptions options) : m_options(options) {}
+    std::string name() const override { return "loop-unroll"; }
+    bool run_on_function(IRFunction& function, IRModule& module, IRPassStatistics& statistics) override;
+
+   private:
+    IRPassOptions m_options;
+};
@@ -0,0 +1,83 @@
+#pragma once
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "ir.hpp"
+
+// linear scan register allocation of an IRFunction's scalar values- "Linear Scan Register Allocation", Poletto and
+// Sarkar.
+//
+// the blocks are numbered in the order they're generated in. every instruction reads its operands at an even
+// position and writes its result at the odd one after, so a result may take the register of an operand read for the
+// last time. a value lives in one interval, from its definition to its last use, covering every block it's live
+// through- phis are defined at the start of their block, and their operands used at the end of the predecessors.
+// parameters are defined together at the start of the entry block. intervals are given the 14 registers other than
+// rsp and rbp- the ones living across a call preferably the callee-saved ones, the rest preferably the register
+// the calling convention passes them in- and when there aren't enough, the interval ending last is spilled to a
+// stack slot for all of its life. vectors always live in stack slots
+
+enum class IRRegister {
+    RAX,
+    RBX,
+    RCX,
+    RDX,
+    RSI,
+    RDI,
+    R8,
+    R9,
+    R10,
+    R11,
+    R12,
+    R13,
+    R14,
+    R15,
+};
+
+// the name of the register's low 'size_bytes' bytes- 'rax', 'eax', 'ax' or 'al'
+std::string ir_register_name(IRRegister reg, size_t size_bytes = 8);
+// rbx and r12-r15- a function keeps them as it got them, while the rest are its callees' to change
+bool ir_is_callee_saved(IRRegister reg);
+// the registers the first integer arguments are passed in, in order- rdi, rsi, rdx, rcx, r8 and r9
+const std::vector<IRRegister>& ir_argument_registers();
+const std::vector<IRRegister>& ir_all_registers();
+
+class IRRegisterAllocation {
+   public:
+    explicit IRRegisterAllocation(const IRFunction& function);
+
+    // the register holding the value, nothing for a value in a stack slot
+    std::optional<IRRegister> register_of(IRValueId value) const;
+    // the registers of the values the instruction reads before, and that are read after it- the ones it must leave
+    // as they are
+    std::set<IRRegister> live_across(const IRInstruction& instruction) const;
+    // the registers of the values live at the instruction- its operands, its result and the ones live across it
+    std::set<IRRegister> busy(const IRInstruction& instruction) const;
+    // every register a value was given
+    std::set<IRRegister> used_registers() const;
+    size_t spilled_count() const { return m_spilled; }
+
+   private:
+    struct Interval {
+        IRValueId value;
+        size_t start;
+        size_t end;
+    };
+
+    const IRFunction& m_function;
+    // instruction -> its index in the order of generation. it reads at twice the index, and writes one after
+    std::map<const IRInstruction*, size_t> m_indices;
+    std::vector<Interval> m_intervals;
+    std::map<IRValueId, IRRegister> m_registers;
+    // per instruction index, bit i for the register i
+    std::vector<uint32_t> m_live_across;
+    std::vector<uint32_t> m_busy;
+    size_t m_spilled = 0;
+
+    void build_intervals();
+    void allocate();
+    void find_live_registers();
+};
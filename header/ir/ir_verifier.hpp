@@ -0,0 +1,13 @@
+#pragma once
+#include <string>
+#include <vector>
+
+#include "ir.hpp"
+
+// checks the structural and SSA invariants of the IR- terminators, phis matching the predecessors, operand types,
+// single definitions that dominate their uses and call signatures. returns one message per problem found
+std::vector<std::string> ir_verify(const IRModule& module);
+std::vector<std::string> ir_verify(const IRFunction& function, const IRModule& module);
+
+// throws IRException listing the problems, if there are any. 'stage' names what produced the IR
+void ir_assert_valid(const IRModule& module, const std::string& stage);
@@ -0,0 +1,62 @@
+#pragma once
+#include <map>
+#include <string>
+#include <variant>
+#include <vector>
+
+#include "./error/json_error.hpp"
+
+// minimal JSON document model, used for manifests, caches and the compile server protocol
+class JsonValue {
+   public:
+    using Array = std::vector<JsonValue>;
+    using Object = std::map<std::string, JsonValue>;
+
+    JsonValue() : m_value(nullptr) {}
+    JsonValue(std::nullptr_t) : m_value(nullptr) {}
+    JsonValue(bool value) : m_value(value) {}
+    JsonValue(double value) : m_value(value) {}
+    JsonValue(int value) : m_value((double)value) {}
+    JsonValue(long value) : m_value((double)value) {}
+    JsonValue(long long value) : m_value((double)value) {}
+    JsonValue(unsigned long value) : m_value((double)value) {}
+    JsonValue(unsigned long long value) : m_value((double)value) {}
+    JsonValue(const char* value) : m_value(std::string(value)) {}
+    JsonValue(std::string value) : m_value(std::move(value)) {}
+    JsonValue(Array value) : m_value(std::move(value)) {}
+    JsonValue(Object value) : m_value(std::move(value)) {}
+
+    bool is_null() const { return std::holds_alternative<std::nullptr_t>(m_value); }
+    bool is_bool() const { return std::holds_alternative<bool>(m_value); }
+    bool is_number() const { return std::holds_alternative<double>(m_value); }
+    bool is_string() const { return std::holds_alternative<std::string>(m_value); }
+    bool is_array() const { return std::holds_alternative<Array>(m_value); }
+    bool is_object() const { return std::holds_alternative<Object>(m_value); }
+
+    // accessors throw std::bad_variant_access on a type mismatch
+    bool as_bool() const { return std::get<bool>(m_value); }
+    double as_number() const { return std::get<double>(m_value); }
+    const std::string& as_string() const { return std::get<std::string>(m_value); }
+    const Array& as_array() const { return std::get<Array>(m_value); }
+    const Object& as_object() const { return std::get<Object>(m_value); }
+    Array& as_array() { return std::get<Array>(m_value); }
+    Object& as_object() { return std::get<Object>(m_value); }
+
+    // member lookup. nullptr if this isn't an object, or the key doesn't exist
+    const JsonValue* find(const std::string& key) const;
+    // string member, or 'fallback' if it doesn't exist / isn't a string
+    std::string get_string(const std::string& key, const std::string& fallback = "") const;
+    double get_number(const std::string& key, double fallback = 0) const;
+    bool get_bool(const std::string& key, bool fallback = false) const;
+
+    // serializes to a single line
+    std::string dump() const;
+
+    // throws JsonException on malformed input
+    static JsonValue parse(const std::string& text);
+
+   private:
+    std::variant<std::nullptr_t, bool, double, std::string, Array, Object> m_value;
+
+    void dump(std::string& out) const;
+};
@@ -42,10 +42,13 @@ enum class TokenType {
     _while,
     _function,
     _return,
+    _inline,
+    _noinline,
 };
 
-extern std::map<std::string, TokenType> tokenMappingsKeywords;
-extern std::map<char, TokenType> tokenMappingsSymbols;
+// read-only after static initialization, shared by concurrent compilations
+extern const std::map<std::string, TokenType> tokenMappingsKeywords;
+extern const std::map<char, TokenType> tokenMappingsSymbols;
 
 struct TokenMeta {
     size_t line_num;
@@ -58,6 +61,9 @@ struct Token {
     std::optional<std::string> value;
 };
 
+// the value of an int_lit token- 0x1f, 0b1001 or decimal, wrapping past 64 bits is an error of std::stoull
+uint64_t parse_int_literal(const std::string& literal);
+
 // Lexical analysis unit
 class Lexer {
    public:
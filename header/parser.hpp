@@ -9,7 +9,7 @@
 #include "./lexer.hpp"
 #include "parse_statement_stack.hpp"
 
-extern std::map<TokenType, BinOperation> singleCharBinOperationMapping;
+extern const std::map<TokenType, BinOperation> singleCharBinOperationMapping;
 class Parser {
    public:
     Parser(std::vector<Token> tokens) : m_tokens(tokens), m_token_index(0) {}
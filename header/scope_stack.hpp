@@ -56,6 +56,9 @@ class ScopeStack {
         return false;
     }
 
+    // the lowest scope(global scope)
+    scope& global_scope() { return scope_stack.front(); }
+
    private:
     std::vector<scope> scope_stack;
 };
\ No newline at end of file
@@ -3,11 +3,13 @@
 
 #include <iostream>
 #include <map>
+#include <set>
 #include <stack>
 #include <string>
 
 #include "./error/sem_analyze_error.hpp"
 #include "AST_node.hpp"
+#include "function_cache.hpp"
 #include "globals.hpp"
 #include "scope_stack.hpp"
 
@@ -30,10 +32,29 @@ using SemanticScopeStack = ScopeStack<Variable>;
 using SemanticFunctionTable = std::map<std::string, SymbolTable::FunctionHeader>;
 };  // namespace SymbolTable
 
+struct SemanticWarning {
+    std::string message;
+    TokenMeta position;
+};
+
 class SemanticAnalyzer {
    public:
     SemanticAnalyzer(ASTProgram program) : m_prog(program), m_current_function_name("") {}
     void analyze();
+    // warnings collected during analysis, in the order they were found
+    const std::vector<SemanticWarning>& get_warnings() const { return m_warnings; }
+
+    // function-level incremental compilation- a function whose previous record is still valid isn't analyzed,
+    // its recorded effects are replayed instead. must be called before analyze()
+    void set_function_cache(const FunctionCache::FunctionRecords* previous_records,
+                            const FunctionCache::Fingerprints* fingerprints);
+    // functions that weren't analyzed. their AST is left without data types
+    const std::set<std::string>& get_reused_functions() const { return m_reused_functions; }
+    // dead function elimination- only the bodies of these functions are analyzed, the others just get their
+    // headers checked. must be called before analyze()
+    void set_live_functions(const std::set<std::string>* live_functions) { m_live_functions = live_functions; }
+    // records of every function, without the generated assembly
+    const FunctionCache::FunctionRecords& get_function_records() const { return m_function_records; }
 
    private:
     struct ExpressionVisitor;
@@ -43,6 +64,9 @@ class SemanticAnalyzer {
     void analyze_function_header(ASTStatementFunction& func);
     void analyze_function_body(ASTStatementFunction& func);
     void analyze_function_param(ASTFunctionParam& param);
+    bool can_reuse_function(const ASTStatementFunction& func);
+    void reuse_function(const ASTStatementFunction& func);
+    void record_global_use(const std::string& name);
 
     ExpressionAnalysisResult analyze_expression(ASTExpression& expression,
                                                 const std::shared_ptr<DataType>& lhs_datatype = nullptr);
@@ -73,11 +97,10 @@ class SemanticAnalyzer {
     void analyze_statement_function(const std::shared_ptr<ASTStatementFunction>& function_statement);
     void analyze_statement_return(const std::shared_ptr<ASTStatementReturn>& return_statement);
 
-    static void assert_cast_expression(ASTExpression& expression, std::shared_ptr<DataType> data_type,
-                                       bool show_warning);
+    void assert_cast_expression(ASTExpression& expression, std::shared_ptr<DataType> data_type, bool show_warning);
     static std::shared_ptr<DataType> create_data_type(const std::vector<Token> data_type_tokens);
 
-    static void semantic_warning(const std::string& message, const TokenMeta& position);
+    void semantic_warning(const std::string& message, const TokenMeta& position);
 
     bool is_array_initializer(const ASTExpression& expr);
 
@@ -85,4 +108,17 @@ class SemanticAnalyzer {
     SymbolTable::SemanticScopeStack m_symbol_table;
     SymbolTable::SemanticFunctionTable m_function_table;
     std::string m_current_function_name;
+    std::vector<SemanticWarning> m_warnings;
+
+    const FunctionCache::FunctionRecords* m_previous_records = nullptr;
+    const FunctionCache::Fingerprints* m_fingerprints = nullptr;
+    FunctionCache::FunctionRecords m_function_records;
+    std::set<std::string> m_reused_functions;
+    // nullptr analyzes every function
+    const std::set<std::string>* m_live_functions = nullptr;
+    // record of the function being analyzed, nullptr when not recording
+    FunctionCache::FunctionRecord* m_current_record = nullptr;
+    size_t m_current_function_line = 0;
+    // whether each global was initialized when the current function's analysis began
+    std::map<std::string, bool> m_globals_initialized_before;
 };
\ No newline at end of file
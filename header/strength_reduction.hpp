@@ -0,0 +1,18 @@
+#pragma once
+#include <cstdint>
+#include <optional>
+#include <string>
+
+// x86-64 sequences for arithmetic by a constant, cheaper than mul/div- shifts, masks, lea and multiplication by a
+// magic number for division("Division by Invariant Integers using Multiplication", Granlund and Montgomery).
+//
+// shared by both generators. the sequences operate on rax in place, as an unsigned 64 bit number- division and
+// modulo are unsigned in both- and clobber rcx, rdx and r11. each line is tab-indented and newline-terminated
+
+std::string reduce_multiply(uint64_t constant);
+// nothing for a division by zero, which is left to trap
+std::optional<std::string> reduce_divide(uint64_t constant);
+std::optional<std::string> reduce_modulo(uint64_t constant);
+
+// an index multiplied by the element size folds into an [base+index*size] operand
+bool is_address_scale(uint64_t size);
@@ -0,0 +1,31 @@
+#pragma once
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// fixed number of worker threads running tasks in submission order
+class ThreadPool {
+   public:
+    // 0 threads- one per hardware thread
+    explicit ThreadPool(size_t thread_count = 0);
+    // runs the remaining queued tasks, then joins the workers
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    void submit(std::function<void()> task);
+    size_t get_thread_count() const { return m_workers.size(); }
+
+   private:
+    std::vector<std::thread> m_workers;
+    std::deque<std::function<void()>> m_tasks;
+    std::mutex m_mutex;
+    std::condition_variable m_task_available;
+    bool m_stopping;
+
+    void work();
+};
@@ -0,0 +1,210 @@
+#include <chrono>
+#include <filesystem>
+#include <sstream>
+
+#include "dlvc.hpp"
+#include "file_util.hpp"
+
+namespace {
+
+std::string resolve_path(const std::string& path, const std::string& base_dir) {
+    if (path.empty() || base_dir.empty() || std::filesystem::path(path).is_absolute()) {
+        return path;
+    }
+    return (std::filesystem::path(base_dir) / path).string();
+}
+
+}  // namespace
+
+std::string dlvc::default_output_path(const std::string& source_path) {
+    std::filesystem::path path(source_path);
+    if (!path.has_extension()) {
+        return source_path + ".out";
+    }
+    return path.replace_extension().string();
+}
+
+bool dlvc::parse_batch_manifest(const std::string& manifest, const std::string& base_dir,
+                                std::vector<BatchJob>& jobs, std::string& error) {
+    JsonValue document;
+    try {
+        document = JsonValue::parse(manifest);
+    } catch (const JsonException& e) {
+        error = e.what();
+        return false;
+    }
+    if (!document.is_array()) {
+        error = "Batch manifest must be a JSON array of jobs";
+        return false;
+    }
+
+    for (auto& entry : document.as_array()) {
+        BatchJob job;
+        if (entry.is_string()) {
+            job.source_path = entry.as_string();
+        } else if (entry.is_object()) {
+            job.source_path = entry.get_string("source");
+            job.output_path = entry.get_string("output");
+            job.asm_path = entry.get_string("asm");
+        }
+        if (job.source_path.empty()) {
+            error = "Batch job without a source path- " + entry.dump();
+            return false;
+        }
+        if (job.output_path.empty()) {
+            job.output_path = default_output_path(job.source_path);
+        }
+        job.source_path = resolve_path(job.source_path, base_dir);
+        job.output_path = resolve_path(job.output_path, base_dir);
+        job.asm_path = resolve_path(job.asm_path, base_dir);
+        jobs.push_back(job);
+    }
+    return true;
+}
+
+std::vector<dlvc::BatchJob> dlvc::parse_batch_list(const std::string& list) {
+    std::vector<BatchJob> jobs;
+    std::stringstream lines(list);
+    std::string line;
+    while (std::getline(lines, line)) {
+        std::stringstream words(line);
+        BatchJob job;
+        if (!(words >> job.source_path)) {
+            continue;  // empty line
+        }
+        if (!(words >> job.output_path)) {
+            job.output_path = default_output_path(job.source_path);
+        }
+        jobs.push_back(job);
+    }
+    return jobs;
+}
+
+std::vector<dlvc::BatchJobResult> dlvc::compile_batch(const std::vector<BatchJob>& jobs,
+                                                      const CompileOptions& options) {
+    std::vector<BatchJobResult> results;
+    results.reserve(jobs.size());
+
+    for (auto& job : jobs) {
+        auto start = std::chrono::steady_clock::now();
+        CompileOptions job_options = options;
+        job_options.file_path = job.source_path;
+
+        CompileResult result;
+        auto source = try_read_file(job.source_path);
+        if (!source.has_value()) {
+            std::string message = "Error opening file '" + job.source_path + "'";
+            result.diagnostics.push_back(Diagnostic{
+                .severity = DiagnosticSeverity::Error,
+                .stage = CompileStage::Input,
+                .message = message,
+                .file_path = job.source_path,
+                .line = 0,
+                .col = 0,
+                .formatted = message,
+            });
+        } else {
+            result = compile_to_executable(source.value(), job.output_path, job_options);
+            if (result.success && !job.asm_path.empty()) {
+                write_file(job.asm_path, result.asm_code);
+            }
+            result.asm_code.clear();
+        }
+
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        results.push_back(BatchJobResult{
+            .job = job,
+            .result = std::move(result),
+            .elapsed_ms = elapsed.count(),
+        });
+    }
+    return results;
+}
+
+std::string dlvc::to_string(DiagnosticSeverity severity) {
+    return severity == DiagnosticSeverity::Error ? "error" : "warning";
+}
+
+std::string dlvc::to_string(CompileStage stage) {
+    switch (stage) {
+        case CompileStage::Input:
+            return "input";
+        case CompileStage::Lexer:
+            return "lexer";
+        case CompileStage::Parser:
+            return "parser";
+        case CompileStage::SemanticAnalyzer:
+            return "semantic";
+        case CompileStage::Generator:
+            return "generator";
+        case CompileStage::Assembler:
+            return "assembler";
+        case CompileStage::Linker:
+            return "linker";
+        default:
+            return "unknown";
+    }
+}
+
+JsonValue dlvc::to_json(const Diagnostic& diagnostic) {
+    return JsonValue(JsonValue::Object{
+        {"severity", to_string(diagnostic.severity)},
+        {"stage", to_string(diagnostic.stage)},
+        {"message", diagnostic.message},
+        {"file", diagnostic.file_path},
+        {"line", diagnostic.line},
+        {"col", diagnostic.col},
+        {"formatted", diagnostic.formatted},
+    });
+}
+
+dlvc::Diagnostic dlvc::diagnostic_from_json(const JsonValue& value) {
+    if (!value.is_object()) {
+        throw JsonException("Diagnostic must be a JSON object", 0);
+    }
+    Diagnostic diagnostic{
+        .severity = value.get_string("severity") == "error" ? DiagnosticSeverity::Error : DiagnosticSeverity::Warning,
+        .stage = CompileStage::Input,
+        .message = value.get_string("message"),
+        .file_path = value.get_string("file"),
+        .line = (size_t)value.get_number("line"),
+        .col = (size_t)value.get_number("col"),
+        .formatted = value.get_string("formatted"),
+    };
+    std::string stage = value.get_string("stage");
+    for (auto candidate : {CompileStage::Input, CompileStage::Lexer, CompileStage::Parser,
+                           CompileStage::SemanticAnalyzer, CompileStage::Generator, CompileStage::Assembler,
+                           CompileStage::Linker}) {
+        if (to_string(candidate) == stage) {
+            diagnostic.stage = candidate;
+        }
+    }
+    return diagnostic;
+}
+
+JsonValue dlvc::to_json(const std::vector<BatchJobResult>& results) {
+    JsonValue::Array jobs;
+    size_t succeeded = 0;
+    double total_ms = 0;
+    for (auto& job_result : results) {
+        JsonValue::Array diagnostics;
+        for (auto& diagnostic : job_result.result.diagnostics) {
+            diagnostics.push_back(to_json(diagnostic));
+        }
+        jobs.push_back(JsonValue(JsonValue::Object{
+            {"source", job_result.job.source_path},
+            {"output", job_result.job.output_path},
+            {"success", job_result.result.success},
+            {"elapsed_ms", job_result.elapsed_ms},
+            {"diagnostics", diagnostics},
+        }));
+        succeeded += job_result.result.success ? 1 : 0;
+        total_ms += job_result.elapsed_ms;
+    }
+    return JsonValue(JsonValue::Object{
+        {"jobs", jobs},
+        {"succeeded", succeeded},
+        {"failed", results.size() - succeeded},
+        {"elapsed_ms", total_ms},
+    });
+}
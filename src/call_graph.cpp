@@ -0,0 +1,108 @@
+#include "call_graph.hpp"
+
+#include <vector>
+
+// NOTE: function names can't be empty, so the root never clashes with one
+const std::string CallGraph::TOP_LEVEL = "";
+
+struct CallGraph::CallCollector {
+    std::set<std::string>* callees;
+
+    void collect(const ASTExpression& expression) const { std::visit(*this, expression.expression); }
+    void collect(const ASTStatement& statement) const { std::visit(*this, statement.statement); }
+
+    // expressions
+    void operator()(const std::shared_ptr<ASTAtomicExpression>& atomic) const { std::visit(*this, atomic->value); }
+    void operator()(const std::shared_ptr<ASTBinExpression>& binary) const {
+        collect(*binary->lhs);
+        collect(*binary->rhs);
+    }
+    void operator()(const std::shared_ptr<ASTUnaryExpression>& unary) const { collect(*unary->expression); }
+    void operator()(const std::shared_ptr<ASTArrayIndexExpression>& array_index) const {
+        collect(*array_index->expression);
+        collect(*array_index->index);
+    }
+    void operator()(const ASTIntLiteral&) const {}
+    void operator()(const ASTCharLiteral&) const {}
+    void operator()(const ASTIdentifier&) const {}
+    void operator()(const ASTParenthesisExpression& parenthesis) const { collect(*parenthesis.expression); }
+    void operator()(const ASTArrayInitializer& initializer) const {
+        for (auto& value : initializer.initialize_values) {
+            collect(value);
+        }
+    }
+    void operator()(const ASTFunctionCall& call) const {
+        callees->insert(call.function_name);
+        for (auto& parameter : call.parameters) {
+            collect(parameter);
+        }
+    }
+
+    // statements
+    void operator()(const std::shared_ptr<ASTStatementExit>& exit) const { collect(exit->status_code); }
+    void operator()(const std::shared_ptr<ASTStatementVar>& var_declare) const {
+        if (var_declare->value.has_value()) {
+            collect(var_declare->value.value());
+        }
+    }
+    void operator()(const std::shared_ptr<ASTStatementScope>& scope) const {
+        for (auto& statement : scope->statements) {
+            collect(*statement);
+        }
+    }
+    void operator()(const std::shared_ptr<ASTStatementIf>& _if) const {
+        collect(_if->expression);
+        collect(*_if->success_statement);
+        if (_if->fail_statement != nullptr) {
+            collect(*_if->fail_statement);
+        }
+    }
+    void operator()(const std::shared_ptr<ASTStatementAssign>& var_assign) const {
+        collect(*var_assign->lhs);
+        collect(var_assign->value);
+    }
+    void operator()(const std::shared_ptr<ASTStatementWhile>& while_statement) const {
+        collect(while_statement->expression);
+        collect(*while_statement->success_statement);
+    }
+    void operator()(const std::shared_ptr<ASTStatementFunction>& function) const { collect(*function->statement); }
+    void operator()(const std::shared_ptr<ASTStatementReturn>& return_statement) const {
+        if (return_statement->expression.has_value()) {
+            collect(return_statement->expression.value());
+        }
+    }
+    void operator()(const std::shared_ptr<ASTFunctionCall>& call) const { (*this)(*call); }
+};
+
+CallGraph::CallGraph(const ASTProgram& program) {
+    CallCollector top_level{.callees = &m_callees[TOP_LEVEL]};
+    for (auto& statement : program.statements) {
+        top_level.collect(*statement);
+    }
+    for (auto& function : program.functions) {
+        CallCollector collector{.callees = &m_callees[function->name]};
+        collector.collect(*function->statement);
+    }
+}
+
+const std::set<std::string>& CallGraph::get_callees(const std::string& function) const {
+    static const std::set<std::string> none;
+    auto callees = m_callees.find(function);
+    return callees == m_callees.end() ? none : callees->second;
+}
+
+std::set<std::string> CallGraph::get_reachable_functions() const {
+    std::set<std::string> reachable;
+    std::vector<std::string> worklist(get_callees(TOP_LEVEL).begin(), get_callees(TOP_LEVEL).end());
+    while (!worklist.empty()) {
+        std::string function = worklist.back();
+        worklist.pop_back();
+        if (!reachable.insert(function).second) {
+            continue;
+        }
+        for (auto& callee : get_callees(function)) {
+            worklist.push_back(callee);
+        }
+    }
+    return reachable;
+}
@@ -0,0 +1,332 @@
+#include "compile_cache.hpp"
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <filesystem>
+
+#include "dlvc.hpp"
+#include "file_util.hpp"
+#include "hash_util.hpp"
+
+namespace fs = std::filesystem;
+
+namespace {
+
+const char* STATISTICS_FILE = "statistics.json";
+// length of a key- ContentHash::hex_digest
+const size_t KEY_LENGTH = 32;
+
+// an eviction frees a bit more than it has to, so a full cache isn't rescanned by each of the following stores
+size_t eviction_target(size_t max_size_bytes) { return max_size_bytes / 10 * 9; }
+
+// writes to a temporary file first, so other processes never observe a partially written file
+bool publish_file(const std::string& path, const std::string& contents) {
+    static std::atomic<size_t> publish_count(0);
+    std::string temp_path = path + ".tmp." + std::to_string(getpid()) + "." + std::to_string(publish_count++);
+    if (!write_file(temp_path, contents)) {
+        return false;
+    }
+    std::error_code error;
+    fs::rename(temp_path, path, error);
+    if (error) {
+        fs::remove(temp_path, error);
+        return false;
+    }
+    return true;
+}
+
+// entries are named by their key- the statistics, the incremental state and temporary files are not entries
+bool is_entry_name(const std::string& name) {
+    return name.size() == KEY_LENGTH && name.find_first_not_of("0123456789abcdef") == std::string::npos;
+}
+
+size_t file_size_or_zero(const std::string& path) {
+    std::error_code error;
+    size_t size = fs::file_size(path, error);
+    return error ? 0 : size;
+}
+
+struct CacheEntry {
+    fs::path path;
+    fs::file_time_type last_used;
+    size_t size_bytes;
+};
+
+// entries may be removed by other processes or threads while listing them, so nothing in here throws
+std::vector<CacheEntry> list_entries(const std::string& directory) {
+    std::vector<CacheEntry> entries;
+    std::error_code error;
+    for (fs::directory_iterator entry(directory, error), end; !error && entry != end; entry.increment(error)) {
+        std::error_code entry_error;
+        if (!is_entry_name(entry->path().filename().string()) || !entry->is_directory(entry_error)) {
+            continue;
+        }
+        CacheEntry cache_entry{
+            .path = entry->path(),
+            .last_used = entry->last_write_time(entry_error),
+            .size_bytes = 0,
+        };
+        for (fs::directory_iterator file(entry->path(), entry_error), file_end; !entry_error && file != file_end;
+             file.increment(entry_error)) {
+            std::error_code file_error;
+            size_t file_size = file->file_size(file_error);
+            cache_entry.size_bytes += file_error ? 0 : file_size;
+        }
+        entries.push_back(cache_entry);
+    }
+    return entries;
+}
+
+// holds an exclusive lock on the statistics file for the lifetime of the object
+class StatisticsLock {
+   public:
+    StatisticsLock(const std::string& path) : m_fd(open(path.c_str(), O_RDWR | O_CREAT, 0644)) {
+        if (m_fd != -1) {
+            flock(m_fd, LOCK_EX);
+        }
+    }
+    ~StatisticsLock() {
+        if (m_fd != -1) {
+            flock(m_fd, LOCK_UN);
+            close(m_fd);
+        }
+    }
+
+   private:
+    int m_fd;
+};
+
+}  // namespace
+
+dlvc::CompileCache::CompileCache(const std::string& directory, size_t max_size_bytes)
+    : m_directory(directory), m_max_size_bytes(max_size_bytes), m_hits(0), m_misses(0), m_evictions(0) {
+    std::error_code error;
+    fs::create_directories(m_directory, error);
+}
+
+dlvc::CompileCache::~CompileCache() { flush_statistics(); }
+
+std::string dlvc::CompileCache::default_directory() {
+    if (const char* directory = getenv("DLVC_CACHE_DIR"); directory && *directory) {
+        return directory;
+    }
+    if (const char* xdg_cache = getenv("XDG_CACHE_HOME"); xdg_cache && *xdg_cache) {
+        return (fs::path(xdg_cache) / "dlvc").string();
+    }
+    const char* home = getenv("HOME");
+    return (fs::path(home ? home : ".") / ".cache" / "dlvc").string();
+}
+
+std::string dlvc::CompileCache::make_key(const std::string& source, const CompileOptions& options) const {
+    ContentHash hash;
+    hash.update_field(build_fingerprint());
+    hash.update_field(options.fingerprint());
+    hash.update_field(source);
+    return hash.hex_digest();
+}
+
+std::string dlvc::CompileCache::entry_path(const std::string& key) const { return (fs::path(m_directory) / key).string(); }
+
+std::string dlvc::CompileCache::artifact_path(const std::string& key, Artifact artifact) const {
+    switch (artifact) {
+        case Artifact::Asm:
+            return (fs::path(entry_path(key)) / "out.asm").string();
+        case Artifact::Object:
+            return (fs::path(entry_path(key)) / "out.o").string();
+        default:
+            return (fs::path(entry_path(key)) / "output").string();
+    }
+}
+
+std::string dlvc::CompileCache::diagnostics_path(const std::string& key, Artifact artifact) const {
+    return artifact_path(key, artifact) + ".diagnostics.json";
+}
+
+void dlvc::CompileCache::touch(const std::string& key) const {
+    std::error_code error;
+    fs::last_write_time(entry_path(key), fs::file_time_type::clock::now(), error);
+}
+
+std::optional<std::string> dlvc::CompileCache::peek(const std::string& key, Artifact artifact,
+                                                    std::vector<Diagnostic>& diagnostics) const {
+    auto contents = try_read_file(artifact_path(key, artifact));
+    auto recorded_diagnostics = try_read_file(diagnostics_path(key, artifact));
+    if (!contents.has_value() || !recorded_diagnostics.has_value()) {
+        return std::nullopt;
+    }
+    std::vector<Diagnostic> replayed;
+    try {
+        JsonValue document = JsonValue::parse(recorded_diagnostics.value());
+        for (auto& diagnostic : document.as_array()) {
+            replayed.push_back(diagnostic_from_json(diagnostic));
+        }
+    } catch (const std::exception&) {
+        // corrupted entry- treated as missing, it will be overwritten
+        return std::nullopt;
+    }
+    diagnostics.insert(diagnostics.end(), replayed.begin(), replayed.end());
+    return contents;
+}
+
+std::optional<std::string> dlvc::CompileCache::lookup(const std::string& key, Artifact artifact,
+                                                      std::vector<Diagnostic>& diagnostics) {
+    auto contents = peek(key, artifact, diagnostics);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!contents.has_value()) {
+        ++m_misses;
+        return std::nullopt;
+    }
+    ++m_hits;
+    touch(key);
+    return contents;
+}
+
+bool dlvc::CompileCache::restore_executable(const std::string& key, const std::string& output_path,
+                                            std::vector<Diagnostic>& diagnostics) {
+    std::vector<Diagnostic> replayed;
+    auto executable = lookup(key, Artifact::Executable, replayed);
+    if (!executable.has_value() || !write_file(output_path, executable.value())) {
+        return false;
+    }
+    std::error_code error;
+    fs::permissions(output_path, fs::perms::owner_all | fs::perms::group_read | fs::perms::group_exec |
+                                     fs::perms::others_read | fs::perms::others_exec,
+                    error);
+    if (error) {
+        return false;
+    }
+    diagnostics.insert(diagnostics.end(), replayed.begin(), replayed.end());
+    return true;
+}
+
+void dlvc::CompileCache::store(const std::string& key, Artifact artifact, const std::string& contents,
+                               const std::vector<Diagnostic>& diagnostics) {
+    std::error_code error;
+    fs::create_directories(entry_path(key), error);
+
+    JsonValue::Array recorded_diagnostics;
+    for (auto& diagnostic : diagnostics) {
+        recorded_diagnostics.push_back(to_json(diagnostic));
+    }
+    std::string recorded = JsonValue(recorded_diagnostics).dump();
+    size_t replaced_bytes =
+        file_size_or_zero(diagnostics_path(key, artifact)) + file_size_or_zero(artifact_path(key, artifact));
+    // the artifact is published last- peek requires both files, so readers never see it without its diagnostics
+    publish_file(diagnostics_path(key, artifact), recorded);
+    publish_file(artifact_path(key, artifact), contents);
+    touch(key);
+
+    std::lock_guard<std::mutex> size_lock(m_size_mutex);
+    if (m_size_bytes.has_value()) {
+        *m_size_bytes += recorded.size() + contents.size();
+        *m_size_bytes -= std::min(replaced_bytes, *m_size_bytes);
+    }
+    // the first store of the process scans the directory, the published files included
+    if (!m_size_bytes.has_value() || *m_size_bytes > m_max_size_bytes) {
+        evict_to_fit();
+    }
+}
+
+void dlvc::CompileCache::evict_to_fit() {
+    // the running size misses what other processes stored and evicted- rescanning corrects it
+    std::vector<CacheEntry> entries = list_entries(m_directory);
+    size_t total_size = 0;
+    for (auto& entry : entries) {
+        total_size += entry.size_bytes;
+    }
+    m_size_bytes = total_size;
+    if (total_size <= m_max_size_bytes) {
+        return;
+    }
+
+    std::sort(entries.begin(), entries.end(),
+              [](const CacheEntry& a, const CacheEntry& b) { return a.last_used < b.last_used; });
+    size_t evicted = 0;
+    std::error_code error;
+    for (auto& entry : entries) {
+        if (total_size <= eviction_target(m_max_size_bytes)) {
+            break;
+        }
+        fs::remove_all(entry.path, error);
+        total_size -= entry.size_bytes;
+        ++evicted;
+    }
+    m_size_bytes = total_size;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_evictions += evicted;
+}
+
+void dlvc::CompileCache::flush_statistics() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_hits == 0 && m_misses == 0 && m_evictions == 0) {
+        return;
+    }
+    std::string path = (fs::path(m_directory) / STATISTICS_FILE).string();
+    StatisticsLock file_lock(path + ".lock");
+
+    JsonValue statistics = JsonValue(JsonValue::Object{});
+    auto contents = try_read_file(path);
+    try {
+        if (contents.has_value() && !contents.value().empty()) {
+            statistics = JsonValue::parse(contents.value());
+        }
+    } catch (const JsonException&) {
+        // start over with fresh statistics
+    }
+    auto add = [&](const std::string& field, size_t value) {
+        double current = statistics.is_object() ? statistics.get_number(field) : 0;
+        if (!statistics.is_object()) {
+            statistics = JsonValue(JsonValue::Object{});
+        }
+        statistics.as_object()[field] = JsonValue(current + value);
+    };
+    add("hits", m_hits);
+    add("misses", m_misses);
+    add("evictions", m_evictions);
+    publish_file(path, statistics.dump());
+    m_hits = m_misses = m_evictions = 0;
+}
+
+dlvc::CacheStatistics dlvc::CompileCache::get_statistics() const {
+    CacheStatistics statistics;
+    auto contents = try_read_file((fs::path(m_directory) / STATISTICS_FILE).string());
+    try {
+        if (contents.has_value() && !contents.value().empty()) {
+            auto persisted = JsonValue::parse(contents.value());
+            statistics.hits = persisted.get_number("hits");
+            statistics.misses = persisted.get_number("misses");
+            statistics.evictions = persisted.get_number("evictions");
+        }
+    } catch (const JsonException&) {
+        // unreadable statistics, report this process' counters only
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        statistics.hits += m_hits;
+        statistics.misses += m_misses;
+        statistics.evictions += m_evictions;
+    }
+
+    for (auto& entry : list_entries(m_directory)) {
+        ++statistics.entries;
+        statistics.size_bytes += entry.size_bytes;
+    }
+    return statistics;
+}
+
+void dlvc::CompileCache::clear() {
+    std::error_code error;
+    for (auto& directory_entry : fs::directory_iterator(m_directory, error)) {
+        fs::remove_all(directory_entry.path(), error);
+    }
+    {
+        std::lock_guard<std::mutex> size_lock(m_size_mutex);
+        m_size_bytes = 0;
+    }
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_hits = m_misses = m_evictions = 0;
+}
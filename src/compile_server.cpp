@@ -0,0 +1,561 @@
+#include "compile_server.hpp"
+
+#include <poll.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <mutex>
+
+#include "compile_cache.hpp"
+#include "file_util.hpp"
+#include "hash_util.hpp"
+#include "thread_pool.hpp"
+
+namespace {
+
+// fills 'address' for 'socket_path'. false if the path doesn't fit
+bool make_address(const std::string& socket_path, sockaddr_un& address) {
+    address = sockaddr_un();
+    address.sun_family = AF_UNIX;
+    if (socket_path.empty() || socket_path.size() >= sizeof(address.sun_path)) {
+        return false;
+    }
+    socket_path.copy(address.sun_path, socket_path.size());
+    return true;
+}
+
+bool send_all(int fd, const std::string& data) {
+    size_t sent = 0;
+    while (sent < data.size()) {
+        ssize_t count = send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        if (count <= 0) {
+            return false;
+        }
+        sent += count;
+    }
+    return true;
+}
+
+// reads newline delimited messages from a socket
+class LineReader {
+   public:
+    LineReader(int fd) : m_fd(fd) {}
+
+    // false on EOF or error
+    bool read_line(std::string& line) {
+        while (true) {
+            size_t newline = m_buffer.find('\n');
+            if (newline != std::string::npos) {
+                line = m_buffer.substr(0, newline);
+                m_buffer.erase(0, newline + 1);
+                return true;
+            }
+            char chunk[4096];
+            ssize_t count = recv(m_fd, chunk, sizeof(chunk), 0);
+            if (count < 0 && errno == EINTR) {
+                return false;  // let the caller check for signals
+            }
+            if (count <= 0) {
+                return false;
+            }
+            m_buffer.append(chunk, count);
+        }
+    }
+
+    bool has_buffered_line() const { return m_buffer.find('\n') != std::string::npos; }
+
+   private:
+    int m_fd;
+    std::string m_buffer;
+};
+
+struct Connection {
+    int fd;
+    std::mutex write_mutex;
+    std::mutex pending_mutex;
+    // request id -> cancellation flag, for requests that haven't finished yet
+    std::map<double, std::shared_ptr<std::atomic<bool>>> pending;
+
+    explicit Connection(int fd) : fd(fd) {}
+    ~Connection() { close(fd); }
+
+    void send_message(const JsonValue& message) {
+        std::lock_guard<std::mutex> lock(write_mutex);
+        send_all(fd, message.dump() + "\n");
+    }
+
+    void cancel_all() {
+        std::lock_guard<std::mutex> lock(pending_mutex);
+        for (auto& [id, cancelled] : pending) {
+            cancelled->store(true);
+        }
+    }
+};
+
+// a failed compilation with a single Input diagnostic- a bad request, or a connection problem
+dlvc::CompileResult make_input_error(const std::string& file_path, const std::string& message) {
+    dlvc::CompileResult result;
+    result.diagnostics.push_back(dlvc::Diagnostic{
+        .severity = dlvc::DiagnosticSeverity::Error,
+        .stage = dlvc::CompileStage::Input,
+        .message = message,
+        .file_path = file_path,
+        .line = 0,
+        .col = 0,
+        .formatted = message,
+    });
+    return result;
+}
+
+JsonValue make_error_response(const JsonValue& id, const std::string& message) {
+    return JsonValue(JsonValue::Object{{"type", "error"}, {"id", id}, {"message", message}});
+}
+
+std::string incremental_state_path(const std::string& cache_directory, const std::string& file_path) {
+    ContentHash source_path_hash;
+    source_path_hash.update(std::filesystem::absolute(file_path).string());
+    return (std::filesystem::path(cache_directory) / "incremental" / (source_path_hash.hex_digest() + ".json"))
+        .string();
+}
+
+JsonValue::Array to_json(const std::vector<std::string>& strings) {
+    return JsonValue::Array(strings.begin(), strings.end());
+}
+
+std::vector<std::string> strings_from_json(const JsonValue* value) {
+    std::vector<std::string> strings;
+    if (value && value->is_array()) {
+        for (auto& element : value->as_array()) {
+            if (element.is_string()) {
+                strings.push_back(element.as_string());
+            }
+        }
+    }
+    return strings;
+}
+
+// the code generation options of a compile request, every option that a local compilation takes
+JsonValue options_to_json(const dlvc::CompileOptions& options) {
+    return JsonValue(JsonValue::Object{
+        {"debug_info", options.debug_info},
+        {"backend", dlvc::to_string(options.backend)},
+        {"optimization_level", options.optimization_level},
+        {"passes", to_json(options.passes)},
+        {"eliminate_dead_functions", options.eliminate_dead_functions},
+        {"inline_threshold", options.inline_threshold},
+        {"unroll_factor", options.unroll_factor},
+        {"avx2", options.avx2},
+        {"dump_ir", options.dump_ir},
+        {"print_after", to_json(options.print_after)},
+        {"remarks", to_json(options.remarks)},
+    });
+}
+
+// inverse of options_to_json. missing fields keep their defaults
+void options_from_json(const JsonValue& value, dlvc::CompileOptions& options) {
+    options.debug_info = value.get_bool("debug_info", true);
+    dlvc::parse_backend(value.get_string("backend", "ast"), options.backend);
+    options.optimization_level = (int)value.get_number("optimization_level", 0);
+    options.passes = strings_from_json(value.find("passes"));
+    options.eliminate_dead_functions = value.get_bool("eliminate_dead_functions", true);
+    options.inline_threshold = (int)value.get_number("inline_threshold", -1);
+    options.unroll_factor = (int)value.get_number("unroll_factor", -1);
+    options.avx2 = value.get_bool("avx2");
+    options.dump_ir = value.get_bool("dump_ir");
+    options.print_after = strings_from_json(value.find("print_after"));
+    options.remarks = strings_from_json(value.find("remarks"));
+}
+
+class Server {
+   public:
+    Server(const dlvc::ServerOptions& options)
+        : m_options(options), m_listen_fd(-1), m_stopping(false), m_active_readers(0), m_requests(0), m_cancelled(0) {
+        if (!options.cache_directory.empty()) {
+            m_cache = std::make_unique<dlvc::CompileCache>(options.cache_directory, options.cache_size_bytes);
+        }
+    }
+
+    int run(std::string& error) {
+        sockaddr_un address;
+        if (!make_address(m_options.socket_path, address)) {
+            error = "Invalid socket path '" + m_options.socket_path + "'";
+            return EXIT_FAILURE;
+        }
+        m_listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        unlink(m_options.socket_path.c_str());  // stale socket of a previous server
+        if (m_listen_fd == -1 || bind(m_listen_fd, (sockaddr*)&address, sizeof(address)) == -1 ||
+            listen(m_listen_fd, SOMAXCONN) == -1) {
+            error = "Could not listen on '" + m_options.socket_path + "': " + strerror(errno);
+            return EXIT_FAILURE;
+        }
+
+        m_pool = std::make_unique<ThreadPool>(m_options.thread_count);
+        report_status("serving on " + m_options.socket_path + " with " +
+                      std::to_string(m_pool->get_thread_count()) + " threads");
+
+        while (!m_stopping) {
+            int fd = accept(m_listen_fd, nullptr, nullptr);
+            if (fd == -1) {
+                if (errno == EINTR || errno == ECONNABORTED) {
+                    continue;
+                }
+                break;  // shutdown() of the listening socket
+            }
+            auto connection = std::make_shared<Connection>(fd);
+            {
+                std::lock_guard<std::mutex> lock(m_readers_mutex);
+                ++m_active_readers;
+                m_connections.push_back(connection);
+            }
+            std::thread(&Server::read_requests, this, connection).detach();
+        }
+
+        // stop reading new requests, let the running ones finish
+        {
+            std::unique_lock<std::mutex> lock(m_readers_mutex);
+            for (auto& weak_connection : m_connections) {
+                if (auto connection = weak_connection.lock()) {
+                    ::shutdown(connection->fd, SHUT_RD);
+                }
+            }
+            m_readers_done.wait(lock, [this]() { return m_active_readers == 0; });
+        }
+        m_pool.reset();
+        close(m_listen_fd);
+        unlink(m_options.socket_path.c_str());
+        report_status("served " + std::to_string(m_requests) + " requests, " + std::to_string(m_cancelled) +
+                      " cancelled");
+        return EXIT_SUCCESS;
+    }
+
+   private:
+    dlvc::ServerOptions m_options;
+    std::unique_ptr<dlvc::CompileCache> m_cache;
+    std::unique_ptr<ThreadPool> m_pool;
+    int m_listen_fd;
+    std::atomic<bool> m_stopping;
+
+    std::mutex m_readers_mutex;
+    std::condition_variable m_readers_done;
+    size_t m_active_readers;
+    std::vector<std::weak_ptr<Connection>> m_connections;
+
+    std::atomic<size_t> m_requests;
+    std::atomic<size_t> m_cancelled;
+
+    void report_status(const std::string& status) {
+        if (m_options.on_status) {
+            m_options.on_status(status);
+        }
+    }
+
+    void read_requests(std::shared_ptr<Connection> connection) {
+        LineReader reader(connection->fd);
+        std::string line;
+        while (reader.read_line(line)) {
+            if (line.empty()) {
+                continue;
+            }
+            try {
+                handle_message(connection, JsonValue::parse(line));
+            } catch (const JsonException& e) {
+                connection->send_message(make_error_response(nullptr, e.what()));
+            }
+        }
+        // the client is gone, nobody is waiting for its results. on shutdown the reading side is closed by the
+        // server instead, and running compilations are allowed to finish
+        if (!m_stopping) {
+            connection->cancel_all();
+        }
+
+        std::lock_guard<std::mutex> lock(m_readers_mutex);
+        --m_active_readers;
+        m_connections.erase(std::remove_if(m_connections.begin(), m_connections.end(),
+                                           [](const std::weak_ptr<Connection>& c) { return c.expired(); }),
+                            m_connections.end());
+        m_readers_done.notify_all();
+    }
+
+    void handle_message(const std::shared_ptr<Connection>& connection, const JsonValue& message) {
+        std::string type = message.get_string("type");
+        const JsonValue* id = message.find("id");
+        if (type == "compile") {
+            if (!id || !id->is_number()) {
+                connection->send_message(make_error_response(nullptr, "Compile request without a numeric id"));
+                return;
+            }
+            auto cancelled = std::make_shared<std::atomic<bool>>(false);
+            {
+                std::lock_guard<std::mutex> lock(connection->pending_mutex);
+                connection->pending[id->as_number()] = cancelled;
+            }
+            m_pool->submit([this, connection, message, cancelled]() { compile(connection, message, cancelled); });
+        } else if (type == "cancel") {
+            std::lock_guard<std::mutex> lock(connection->pending_mutex);
+            auto pending = id && id->is_number() ? connection->pending.find(id->as_number()) : connection->pending.end();
+            if (pending != connection->pending.end()) {
+                pending->second->store(true);
+            }
+        } else if (type == "stats") {
+            dlvc::CacheStatistics statistics = m_cache ? m_cache->get_statistics() : dlvc::CacheStatistics();
+            connection->send_message(JsonValue(JsonValue::Object{
+                {"type", "stats"},
+                {"requests", m_requests.load()},
+                {"cancelled", m_cancelled.load()},
+                {"threads", m_pool->get_thread_count()},
+                {"cache_hits", statistics.hits},
+                {"cache_misses", statistics.misses},
+                {"cache_entries", statistics.entries},
+            }));
+        } else if (type == "shutdown") {
+            connection->send_message(JsonValue(JsonValue::Object{{"type", "shutdown"}}));
+            m_stopping = true;
+            ::shutdown(m_listen_fd, SHUT_RDWR);
+        } else {
+            connection->send_message(make_error_response(id ? *id : JsonValue(), "Unknown request type '" + type + "'"));
+        }
+    }
+
+    void compile(const std::shared_ptr<Connection>& connection, const JsonValue& request,
+                 const std::shared_ptr<std::atomic<bool>>& cancelled) {
+        auto start = std::chrono::steady_clock::now();
+        JsonValue id = *request.find("id");
+
+        dlvc::CompileResult result;
+        try {
+            result = compile_request(request, cancelled);
+        } catch (const std::exception& e) {
+            // an internal error fails this request alone- the server goes on serving the others
+            result = make_input_error(request.get_string("file_path", "<source>"),
+                                      std::string("Internal server error- ") + e.what());
+        } catch (...) {
+            result = make_input_error(request.get_string("file_path", "<source>"), "Internal server error");
+        }
+        {
+            std::lock_guard<std::mutex> lock(connection->pending_mutex);
+            connection->pending.erase(id.as_number());
+        }
+        ++m_requests;
+        m_cancelled += result.cancelled ? 1 : 0;
+
+        JsonValue::Array diagnostics;
+        for (auto& diagnostic : result.diagnostics) {
+            diagnostics.push_back(dlvc::to_json(diagnostic));
+        }
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        connection->send_message(JsonValue(JsonValue::Object{
+            {"type", "result"},
+            {"id", id},
+            {"success", result.success},
+            {"cancelled", result.cancelled},
+            {"diagnostics", diagnostics},
+            {"ir_dump", result.ir_dump},
+            {"pass_report", result.pass_report},
+            {"remarks", result.remarks},
+            {"reused_functions", result.reused_functions},
+            {"total_functions", result.total_functions},
+            {"eliminated_functions", result.eliminated_functions},
+            {"elapsed_ms", elapsed.count()},
+        }));
+    }
+
+    dlvc::CompileResult compile_request(const JsonValue& request, const std::shared_ptr<std::atomic<bool>>& cancelled) {
+        dlvc::CompileOptions options;
+        const JsonValue* request_options = request.find("options");
+        if (request_options && request_options->is_object()) {
+            options_from_json(*request_options, options);
+        }
+        options.file_path = request.get_string("file_path", "<source>");
+        options.cache = m_cache.get();
+        options.cancelled = cancelled.get();
+        if (request.get_bool("incremental") && m_cache) {
+            options.incremental_state_path = incremental_state_path(m_cache->get_directory(), options.file_path);
+        }
+        bool emit_ir = request.get_string("emit", "executable") == "ir";
+        if (emit_ir || options.dump_ir || !options.print_after.empty() || !options.remarks.empty() ||
+            request.get_bool("pass_statistics")) {
+            // the IR, the pass statistics and the remarks are only produced by an actual compilation
+            options.cache = nullptr;
+        }
+
+        std::string output_path = request.get_string("output");
+        const JsonValue* source = request.find("source");
+        std::optional<std::string> source_code;
+        if (source && source->is_string()) {
+            source_code = source->as_string();
+        } else {
+            source_code = try_read_file(options.file_path);
+        }
+        if (!source_code.has_value()) {
+            return make_input_error(options.file_path, "Error opening file '" + options.file_path + "'");
+        }
+        if (emit_ir) {
+            return dlvc::compile_to_asm(source_code.value(), options);
+        }
+        if (output_path.empty()) {
+            return make_input_error(options.file_path, "Compile request without an output path");
+        }
+        dlvc::CompileResult result = dlvc::compile_to_executable(source_code.value(), output_path, options);
+        std::string asm_path = request.get_string("asm");
+        if (!asm_path.empty() && !result.asm_code.empty()) {
+            write_file(asm_path, result.asm_code);
+        }
+        return result;
+    }
+};
+
+volatile sig_atomic_t client_interrupted = 0;
+
+void handle_client_interrupt(int) { client_interrupted = 1; }
+
+// -1 if the server can't be reached
+int connect_to_server(const std::string& socket_path, std::string& error) {
+    sockaddr_un address;
+    if (!make_address(socket_path, address)) {
+        error = "Invalid socket path '" + socket_path + "'";
+        return -1;
+    }
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd == -1 || connect(fd, (sockaddr*)&address, sizeof(address)) == -1) {
+        error = "Could not connect to compile server at '" + socket_path + "': " + strerror(errno);
+        if (fd != -1) {
+            close(fd);
+        }
+        return -1;
+    }
+    return fd;
+}
+
+}  // namespace
+
+int dlvc::serve(const ServerOptions& options, std::string& error) { return Server(options).run(error); }
+
+dlvc::CompileResult dlvc::compile_on_server(const ClientRequest& request) {
+    std::string error;
+    int fd = connect_to_server(request.socket_path, error);
+    if (fd == -1) {
+        return make_input_error(request.file_path, error);
+    }
+    auto source = try_read_file(request.file_path);
+    if (!source.has_value()) {
+        close(fd);
+        return make_input_error(request.file_path, "Error opening file '" + request.file_path + "'");
+    }
+
+    JsonValue::Object message{
+        {"type", "compile"},
+        {"id", 1},
+        {"file_path", request.file_path},
+        {"source", source.value()},
+        {"output", std::filesystem::absolute(request.output_path).string()},
+        {"incremental", request.incremental},
+        {"emit", request.emit_ir ? "ir" : "executable"},
+        {"pass_statistics", request.pass_statistics},
+        {"options", options_to_json(request.options)},
+    };
+    if (!request.asm_path.empty()) {
+        message["asm"] = std::filesystem::absolute(request.asm_path).string();
+    }
+    if (!send_all(fd, JsonValue(message).dump() + "\n")) {
+        close(fd);
+        return make_input_error(request.file_path, "Could not send the compile request");
+    }
+
+    // ctrl+c cancels the compilation on the server, the result still arrives
+    struct sigaction interrupt_action = {}, previous_action;
+    interrupt_action.sa_handler = handle_client_interrupt;
+    sigaction(SIGINT, &interrupt_action, &previous_action);
+    client_interrupted = 0;
+    bool sent_cancel = false;
+
+    LineReader reader(fd);
+    std::string line;
+    CompileResult result;
+    bool received = false;
+    while (!received) {
+        if (client_interrupted && !sent_cancel) {
+            send_all(fd, JsonValue(JsonValue::Object{{"type", "cancel"}, {"id", 1}}).dump() + "\n");
+            sent_cancel = true;
+        }
+        if (!reader.has_buffered_line()) {
+            pollfd poll_fd{.fd = fd, .events = POLLIN, .revents = 0};
+            if (poll(&poll_fd, 1, 100) <= 0) {
+                continue;  // timeout, or interrupted- check for a cancellation
+            }
+        }
+        if (!reader.read_line(line)) {
+            if (errno == EINTR) {
+                continue;
+            }
+            result = make_input_error(request.file_path, "Compile server closed the connection");
+            break;
+        }
+        try {
+            JsonValue response = JsonValue::parse(line);
+            if (response.get_string("type") == "error") {
+                result = make_input_error(request.file_path, response.get_string("message"));
+                break;
+            }
+            if (response.get_string("type") != "result" || response.get_number("id") != 1) {
+                continue;
+            }
+            result.success = response.get_bool("success");
+            result.cancelled = response.get_bool("cancelled");
+            result.ir_dump = response.get_string("ir_dump");
+            result.pass_report = response.get_string("pass_report");
+            result.remarks = response.get_string("remarks");
+            result.reused_functions = response.get_number("reused_functions");
+            result.total_functions = response.get_number("total_functions");
+            result.eliminated_functions = response.get_number("eliminated_functions");
+            if (auto diagnostics = response.find("diagnostics"); diagnostics && diagnostics->is_array()) {
+                for (auto& diagnostic : diagnostics->as_array()) {
+                    result.diagnostics.push_back(diagnostic_from_json(diagnostic));
+                }
+            }
+            received = true;
+        } catch (const JsonException& e) {
+            result = make_input_error(request.file_path, std::string("Malformed server response- ") + e.what());
+            break;
+        }
+    }
+
+    sigaction(SIGINT, &previous_action, nullptr);
+    close(fd);
+    return result;
+}
+
+bool dlvc::send_server_command(const std::string& socket_path, const std::string& type, JsonValue& response,
+                               std::string& error) {
+    int fd = connect_to_server(socket_path, error);
+    if (fd == -1) {
+        return false;
+    }
+    bool success = false;
+    if (send_all(fd, JsonValue(JsonValue::Object{{"type", type}}).dump() + "\n")) {
+        LineReader reader(fd);
+        std::string line;
+        if (reader.read_line(line)) {
+            try {
+                response = JsonValue::parse(line);
+                success = true;
+            } catch (const JsonException& e) {
+                error = e.what();
+            }
+        } else {
+            error = "Compile server closed the connection";
+        }
+    } else {
+        error = "Could not send the request";
+    }
+    close(fd);
+    return success;
+}
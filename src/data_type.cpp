@@ -18,7 +18,17 @@ const std::map<BasicDataType, size_t> DataType::data_type_to_size_bytes = {
     {BasicDataType::INT32, 4}, {BasicDataType::INT64, 8}, {BasicDataType::CHAR, 1},
 };
 
-std::shared_ptr<DataType> BasicType::makeBasicType(BasicDataType type) { return std::make_shared<BasicType>(type); }
+std::shared_ptr<DataType> BasicType::makeBasicType(BasicDataType type) {
+    // basic types are immutable, so all uses of a type share a single interned instance
+    static const std::map<BasicDataType, std::shared_ptr<DataType>> interned_types = []() {
+        std::map<BasicDataType, std::shared_ptr<DataType>> types;
+        for (const auto& pair : DataType::data_type_value_to_name) {
+            types[pair.first] = std::make_shared<BasicType>(pair.first);
+        }
+        return types;
+    }();
+    return interned_types.at(type);
+}
 std::shared_ptr<DataType> BasicType::makeBasicType(const std::string& type_str) {
     if (data_type_name_to_value.count(type_str) == 0) {
         throw std::invalid_argument("Unknown data type " + type_str);
@@ -62,10 +72,10 @@ CompatibilityStatus StructType::is_compatible(const DataType& other) const {
 }
 
 CompatibilityStatus PointerType::is_compatible(const DataType& other) const {
-    // Pointers are compatible
+    // Pointers are compatible, without a warning when they point to the same type
     if (const auto* otherPointer = dynamic_cast<const PointerType*>(&other)) {
-        return baseType == otherPointer->baseType ? CompatibilityStatus::Compatible
-                                                  : CompatibilityStatus::CompatibleWithWarning;
+        return *baseType == *(otherPointer->baseType) ? CompatibilityStatus::Compatible
+                                                      : CompatibilityStatus::CompatibleWithWarning;
     }
 
     // could also cast to basic types(numerics)
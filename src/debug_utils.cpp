@@ -90,7 +90,16 @@ std::string debug_utils::visualize_statement_exit(const ASTStatementExit& stmt)
 
 std::string debug_utils::visualize_statement_var(const ASTStatementVar& stmt) {
     std::stringstream out;
-    out << stmt.data_type->toString() << " " << stmt.name;
+    if (stmt.data_type) {
+        out << stmt.data_type->toString() << " ";
+    } else {
+        // not analyzed- a function reused by incremental compilation
+        for (auto& token : stmt.data_type_tokens) {
+            out << token.value.value_or("");
+        }
+        out << " ";
+    }
+    out << stmt.name;
     if (stmt.value.has_value()) {
         out << " = " << visualize_expression(std::make_shared<ASTExpression>(stmt.value.value()));
     }
@@ -133,6 +142,9 @@ std::string debug_utils::visualize_statement_while(const ASTStatementWhile& stmt
 
 std::string debug_utils::visualize_statement_function(const ASTStatementFunction& stmt, int level) {
     std::stringstream out;
+    if (stmt.inline_hint != InlineHint::NONE) {
+        out << (stmt.inline_hint == InlineHint::always ? "inline " : "noinline ");
+    }
     out << "func " << stmt.return_data_type->toString() << " " << stmt.name;
     std::stringstream parameters;
     for (const auto& param : stmt.parameters) {
@@ -0,0 +1,508 @@
+#include "dlvc.hpp"
+
+#include <stdio.h>
+#include <sys/wait.h>
+
+#include <algorithm>
+#include <filesystem>
+#include <memory>
+#include <optional>
+
+#include "call_graph.hpp"
+#include "compile_cache.hpp"
+#include "debug_utils.hpp"
+#include "file_util.hpp"
+#include "function_cache.hpp"
+#include "generator.hpp"
+#include "globals.hpp"
+#include "hash_util.hpp"
+#include "ir/ir_generator.hpp"
+#include "ir/ir_lowering.hpp"
+#include "ir/ir_pass.hpp"
+#include "ir/ir_verifier.hpp"
+#include "lexer.hpp"
+#include "parser.hpp"
+#include "semantic_analyzer.hpp"
+
+namespace {
+
+dlvc::Diagnostic make_diagnostic(dlvc::DiagnosticSeverity severity, dlvc::CompileStage stage,
+                                 const std::string& message, size_t line, size_t col, const std::string& formatted) {
+    return dlvc::Diagnostic{
+        .severity = severity,
+        .stage = stage,
+        .message = message,
+        .file_path = Globals::getInstance().getCurrentFilePath(),
+        .line = line,
+        .col = col,
+        .formatted = formatted,
+    };
+}
+
+dlvc::Diagnostic make_error(dlvc::CompileStage stage, const std::string& message) {
+    return make_diagnostic(dlvc::DiagnosticSeverity::Error, stage, message, 0, 0, message);
+}
+
+std::string shell_quote(const std::string& value) {
+    std::string quoted = "'";
+    for (char ch : value) {
+        if (ch == '\'') {
+            quoted += "'\\''";
+        } else {
+            quoted += ch;
+        }
+    }
+    return quoted + "'";
+}
+
+// runs a shell command, capturing both stdout and stderr into 'output'. returns the exit status
+int run_command(const std::string& command, std::string& output) {
+    FILE* pipe = popen((command + " 2>&1").c_str(), "r");
+    if (!pipe) {
+        output = "Failed to run '" + command + "'";
+        return -1;
+    }
+    char buffer[512];
+    size_t read_count;
+    while ((read_count = fread(buffer, 1, sizeof(buffer), pipe)) > 0) {
+        output.append(buffer, read_count);
+    }
+    int status = pclose(pipe);
+    return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+void append_result(dlvc::CompileResult& into, const dlvc::CompileResult& from) {
+    into.diagnostics.insert(into.diagnostics.end(), from.diagnostics.begin(), from.diagnostics.end());
+    into.success = from.success;
+}
+
+// fails the result if the compilation was cancelled before 'stage'
+bool check_cancelled(const dlvc::CompileOptions& options, dlvc::CompileStage stage, dlvc::CompileResult& result) {
+    if (!options.cancelled || !options.cancelled->load()) {
+        return false;
+    }
+    result.success = false;
+    result.cancelled = true;
+    result.diagnostics.push_back(make_error(stage, "Compilation cancelled"));
+    return true;
+}
+
+}  // namespace
+
+bool dlvc::CompileResult::has_errors() const {
+    for (auto& diagnostic : diagnostics) {
+        if (diagnostic.severity == DiagnosticSeverity::Error) {
+            return true;
+        }
+    }
+    return false;
+}
+
+const std::string& dlvc::build_fingerprint() {
+    // the executable's size and modification time stand in for its contents, hashing the binary costs more than
+    // a typical compilation
+    static const std::string fingerprint = []() {
+        ContentHash hash;
+        hash.update_field(VERSION);
+        std::error_code error;
+        std::filesystem::path executable = std::filesystem::read_symlink("/proc/self/exe", error);
+        if (!error) {
+            hash.update_field(executable.string());
+            hash.update_field(std::to_string(std::filesystem::file_size(executable, error)));
+            hash.update_field(
+                std::to_string(std::filesystem::last_write_time(executable, error).time_since_epoch().count()));
+        }
+        return hash.hex_digest();
+    }();
+    return fingerprint;
+}
+
+std::string dlvc::CompileOptions::fingerprint() const {
+    // file_path is part of every diagnostic, so it affects the cached warnings
+    std::string pass_names;
+    for (auto& pass : passes) {
+        pass_names += pass + ",";
+    }
+    return "debug_info=" + std::to_string(debug_info) + ";backend=" + to_string(effective_backend(*this)) +
+           ";optimization_level=" + std::to_string(optimization_level) + ";passes=" + pass_names +
+           ";eliminate_dead_functions=" + std::to_string(eliminate_dead_functions) +
+           ";inline_threshold=" + std::to_string(inline_threshold) + ";unroll_factor=" + std::to_string(unroll_factor) +
+           ";avx2=" + std::to_string(avx2) + ";file_path=" + file_path;
+}
+
+dlvc::Backend dlvc::effective_backend(const CompileOptions& options) {
+    return options.optimization_level > 0 || !options.passes.empty() ? Backend::IR : options.backend;
+}
+
+std::string dlvc::to_string(Backend backend) { return backend == Backend::IR ? "ir" : "ast"; }
+
+bool dlvc::parse_backend(const std::string& name, Backend& backend) {
+    if (name == "ast" || name == "ir") {
+        backend = name == "ir" ? Backend::IR : Backend::AST;
+        return true;
+    }
+    return false;
+}
+
+namespace {
+
+using dlvc::CompileCache;
+using dlvc::CompileOptions;
+using dlvc::CompileResult;
+using dlvc::CompileStage;
+using dlvc::DiagnosticSeverity;
+
+// lowering to the IR, optimizing and generating from it
+CompileResult generate_asm_from_ir(const ASTProgram& program, const CompileOptions& options, CompileResult result) {
+    try {
+        IRModule module = IRLowering(program).lower();
+        ir_assert_valid(module, "lowering");
+
+        IRPassOptions pass_options = ir_pass_options(options.optimization_level);
+        if (options.inline_threshold >= 0) {
+            pass_options.inline_threshold = options.inline_threshold;
+        }
+        if (options.unroll_factor >= 0) {
+            pass_options.unroll_factor = options.unroll_factor;
+        }
+        if (options.avx2) {
+            pass_options.vector_width = 32;
+        }
+        IRPassManager pass_manager(pass_options);
+        auto passes = options.passes.empty() ? ir_pipeline(options.optimization_level) : options.passes;
+        for (auto& pass : passes) {
+            pass_manager.add_pass(pass);
+        }
+        pass_manager.set_print_after(std::set<std::string>(options.print_after.begin(), options.print_after.end()));
+        pass_manager.set_remarks(std::set<std::string>(options.remarks.begin(), options.remarks.end()));
+        pass_manager.run(module);
+        result.remarks = pass_manager.get_remarks();
+        if (!passes.empty()) {
+            result.pass_report = pass_manager.format_statistics();
+        }
+        result.ir_dump = pass_manager.get_printed();
+        if (options.dump_ir) {
+            result.ir_dump += to_string(module);
+        }
+        result.buffer = IRGenerator(module).generate_program();
+    } catch (const std::exception& e) {
+        // IRException, or an internal error from one of the containers
+        result.diagnostics.push_back(make_error(CompileStage::Generator, e.what()));
+        return result;
+    }
+    result.success = true;
+    return result;
+}
+
+// lexing, parsing, semantic analysis and code generation. 'stage' follows the stage that's running
+CompileResult generate_asm_stages(const std::string& source, const CompileOptions& options, CompileStage& stage) {
+    CompileResult result;
+    Globals::getInstance().setCurrentFilePath(options.file_path);
+    stage = CompileStage::Lexer;
+    if (check_cancelled(options, CompileStage::Lexer, result)) {
+        return result;
+    }
+
+    Lexer lexer = Lexer(source);
+    std::vector<Token> tokens;
+    try {
+        tokens = lexer.tokenize();
+    } catch (const LexerException& e) {
+        result.diagnostics.push_back(make_diagnostic(DiagnosticSeverity::Error, CompileStage::Lexer, e.get_message(),
+                                                     e.get_line(), e.get_col(), e.what()));
+        return result;
+    }
+
+    stage = CompileStage::Parser;
+    if (check_cancelled(options, CompileStage::Parser, result)) {
+        return result;
+    }
+    Parser parser = Parser(tokens);
+    ASTProgram program;
+    try {
+        program = parser.parse_program();
+    } catch (const ParserException& e) {
+        result.diagnostics.push_back(make_diagnostic(DiagnosticSeverity::Error, CompileStage::Parser, e.get_message(),
+                                                     e.get_line(), e.get_col(), e.what()));
+        return result;
+    }
+
+    stage = CompileStage::SemanticAnalyzer;
+    if (check_cancelled(options, CompileStage::SemanticAnalyzer, result)) {
+        return result;
+    }
+    SemanticAnalyzer analyzer = SemanticAnalyzer(program);
+    // the IR is lowered from the analyzed bodies of all functions, so nothing can be reused
+    bool incremental =
+        !options.incremental_state_path.empty() && dlvc::effective_backend(options) == dlvc::Backend::AST;
+    std::string compiler_id = dlvc::build_fingerprint() + "/" + options.fingerprint();
+    FunctionCache::FunctionRecords previous_records;
+    FunctionCache::Fingerprints fingerprints;
+    if (incremental) {
+        previous_records = FunctionCache::load_records(options.incremental_state_path, compiler_id);
+        fingerprints = FunctionCache::fingerprint_functions(tokens, program);
+        analyzer.set_function_cache(&previous_records, &fingerprints);
+    }
+    std::set<std::string> live_functions;
+    if (options.eliminate_dead_functions) {
+        live_functions = CallGraph(program).get_reachable_functions();
+        analyzer.set_live_functions(&live_functions);
+    }
+    std::optional<SemanticAnalyzerException> analysis_error;
+    try {
+        analyzer.analyze();
+    } catch (const SemanticAnalyzerException& e) {
+        analysis_error.emplace(e);
+    }
+    for (auto& warning : analyzer.get_warnings()) {
+        auto& position = warning.position;
+        std::string formatted = "SEMANTIC WARNING AT " +
+                                Globals::getInstance().getCurrentFilePosition(position.line_num, position.line_pos) +
+                                ": " + warning.message;
+        result.diagnostics.push_back(make_diagnostic(DiagnosticSeverity::Warning, CompileStage::SemanticAnalyzer,
+                                                     warning.message, position.line_num, position.line_pos,
+                                                     formatted));
+    }
+    if (analysis_error.has_value()) {
+        auto& e = analysis_error.value();
+        result.diagnostics.push_back(make_diagnostic(DiagnosticSeverity::Error, CompileStage::SemanticAnalyzer,
+                                                     e.get_message(), e.get_line(), e.get_col(), e.what()));
+        return result;
+    }
+
+    stage = CompileStage::Generator;
+    if (check_cancelled(options, CompileStage::Generator, result)) {
+        return result;
+    }
+    if (options.eliminate_dead_functions) {
+        size_t functions_before = program.functions.size();
+        auto& functions = program.functions;
+        functions.erase(std::remove_if(functions.begin(), functions.end(),
+                                       [&](const std::shared_ptr<ASTStatementFunction>& function) {
+                                           return !live_functions.count(function->name);
+                                       }),
+                        functions.end());
+        result.eliminated_functions = functions_before - functions.size();
+    }
+    if (options.dump_ast) {
+        result.ast_dump = debug_utils::visualize_ast(std::make_shared<ASTProgram>(program));
+    }
+    if (dlvc::effective_backend(options) == dlvc::Backend::IR) {
+        return generate_asm_from_ir(program, options, std::move(result));
+    }
+
+    try {
+        Generator generator(program);
+        std::map<std::string, std::string> reused_asm;
+        for (auto& name : analyzer.get_reused_functions()) {
+            reused_asm[name] = previous_records.at(name).asm_code;
+        }
+        generator.set_reused_functions(std::move(reused_asm));
+        result.buffer = generator.generate_program();
+
+        if (incremental) {
+            FunctionCache::FunctionRecords records = analyzer.get_function_records();
+            for (auto& [name, asm_code] : generator.get_function_asm()) {
+                if (records.count(name)) {
+                    records.at(name).asm_code = asm_code;
+                }
+            }
+            FunctionCache::save_records(options.incremental_state_path, compiler_id, records);
+            result.reused_functions = analyzer.get_reused_functions().size();
+            result.total_functions = program.functions.size();
+        }
+    } catch (const std::exception& e) {
+        // GeneratorException, or an internal error from one of the generator's containers
+        result.diagnostics.push_back(make_error(CompileStage::Generator, e.what()));
+        return result;
+    }
+
+    result.success = true;
+    return result;
+}
+
+// every compilation is a failure boundary- an internal error of one of the stages fails this source alone, and
+// whoever compiles many(batch, the compile server) goes on with the others
+CompileResult generate_asm(const std::string& source, const CompileOptions& options) {
+    CompileStage stage = CompileStage::Lexer;
+    std::string message;
+    try {
+        return generate_asm_stages(source, options, stage);
+    } catch (const std::exception& e) {
+        message = std::string("Internal compiler error- ") + e.what();
+    } catch (...) {
+        message = "Internal compiler error";
+    }
+    CompileResult result;
+    result.diagnostics.push_back(make_error(stage, message));
+    return result;
+}
+
+}  // namespace
+
+dlvc::CompileResult dlvc::assemble_object(const std::string& asm_code, const CompileOptions& options) {
+    CompileResult result;
+    std::string asm_path = create_temp_file(".asm");
+    std::string object_path = create_temp_file(".o");
+    if (asm_path.empty() || object_path.empty() || !write_file(asm_path, asm_code)) {
+        result.diagnostics.push_back(make_error(CompileStage::Assembler, "Could not create temporary files"));
+        remove(asm_path.c_str());
+        remove(object_path.c_str());
+        return result;
+    }
+
+    std::string command = "nasm -f elf64 ";
+    if (options.debug_info) {
+        command += "-g ";
+    }
+    command += "-o " + shell_quote(object_path) + " " + shell_quote(asm_path);
+
+    std::string output;
+    int status = run_command(command, output);
+    auto object_code = try_read_file(object_path);
+    remove(asm_path.c_str());
+    remove(object_path.c_str());
+
+    if (status != 0 || !object_code.has_value()) {
+        result.diagnostics.push_back(make_error(CompileStage::Assembler, "nasm failed: " + output));
+        return result;
+    }
+    if (!output.empty()) {
+        result.diagnostics.push_back(
+            make_diagnostic(DiagnosticSeverity::Warning, CompileStage::Assembler, output, 0, 0, output));
+    }
+    result.buffer = std::move(object_code.value());
+    result.success = true;
+    return result;
+}
+
+dlvc::CompileResult dlvc::link_executable(const std::string& object_code, const std::string& output_path,
+                                          const CompileOptions& options) {
+    CompileResult result;
+    std::string object_path = create_temp_file(".o");
+    if (object_path.empty() || !write_file(object_path, object_code)) {
+        result.diagnostics.push_back(make_error(CompileStage::Linker, "Could not create temporary files"));
+        remove(object_path.c_str());
+        return result;
+    }
+
+    std::string command = "gcc -no-pie ";
+    if (options.debug_info) {
+        command += "-g ";
+    }
+    command += "-o " + shell_quote(output_path) + " " + shell_quote(object_path) + " -e main";
+
+    std::string output;
+    int status = run_command(command, output);
+    remove(object_path.c_str());
+
+    if (status != 0) {
+        result.diagnostics.push_back(make_error(CompileStage::Linker, "gcc failed: " + output));
+        return result;
+    }
+    if (!output.empty()) {
+        result.diagnostics.push_back(
+            make_diagnostic(DiagnosticSeverity::Warning, CompileStage::Linker, output, 0, 0, output));
+    }
+    result.success = true;
+    return result;
+}
+
+namespace {
+
+// with a cache, each stage first looks for its artifact in the cache entry, and adds it on a miss.
+// only the artifact the caller asked for counts as a hit or a miss- the ones preceding it are peeked
+std::optional<std::string> find_cached(const CompileOptions& options, const std::string& key,
+                                       CompileCache::Artifact artifact, bool requested, CompileResult& result) {
+    if (!options.cache) {
+        return std::nullopt;
+    }
+    return requested ? options.cache->lookup(key, artifact, result.diagnostics)
+                     : options.cache->peek(key, artifact, result.diagnostics);
+}
+
+void store_cached(const CompileOptions& options, const std::string& key, CompileCache::Artifact artifact,
+                  const std::string& contents, const CompileResult& result) {
+    if (options.cache && result.success) {
+        options.cache->store(key, artifact, contents, result.diagnostics);
+    }
+}
+
+std::string cached_asm(const CompileOptions& options, const std::string& key) {
+    std::vector<dlvc::Diagnostic> ignored;
+    return options.cache->peek(key, CompileCache::Artifact::Asm, ignored).value_or("");
+}
+
+CompileResult build_asm(const std::string& source, const CompileOptions& options, const std::string& key,
+                        bool requested) {
+    CompileResult result;
+    if (auto asm_code = find_cached(options, key, CompileCache::Artifact::Asm, requested, result)) {
+        result.buffer = std::move(asm_code.value());
+        result.asm_code = result.buffer;
+        result.success = true;
+        return result;
+    }
+    result = generate_asm(source, options);
+    result.asm_code = result.buffer;
+    store_cached(options, key, CompileCache::Artifact::Asm, result.asm_code, result);
+    return result;
+}
+
+CompileResult build_object(const std::string& source, const CompileOptions& options, const std::string& key,
+                           bool requested) {
+    CompileResult result;
+    if (auto object_code = find_cached(options, key, CompileCache::Artifact::Object, requested, result)) {
+        result.buffer = std::move(object_code.value());
+        result.asm_code = cached_asm(options, key);
+        result.success = true;
+        return result;
+    }
+    result = build_asm(source, options, key, false);
+    if (!result.success || check_cancelled(options, CompileStage::Assembler, result)) {
+        return result;
+    }
+    CompileResult object = dlvc::assemble_object(result.buffer, options);
+    append_result(result, object);
+    result.buffer = std::move(object.buffer);
+    store_cached(options, key, CompileCache::Artifact::Object, result.buffer, result);
+    return result;
+}
+
+std::string make_cache_key(const std::string& source, const CompileOptions& options) {
+    return options.cache ? options.cache->make_key(source, options) : "";
+}
+
+}  // namespace
+
+dlvc::CompileResult dlvc::compile_to_asm(const std::string& source, const CompileOptions& options) {
+    return build_asm(source, options, make_cache_key(source, options), true);
+}
+
+dlvc::CompileResult dlvc::compile_to_object(const std::string& source, const CompileOptions& options) {
+    return build_object(source, options, make_cache_key(source, options), true);
+}
+
+dlvc::CompileResult dlvc::compile_to_executable(const std::string& source, const std::string& output_path,
+                                                const CompileOptions& options) {
+    std::string key = make_cache_key(source, options);
+    CompileResult result;
+    if (options.cache && options.cache->restore_executable(key, output_path, result.diagnostics)) {
+        result.asm_code = cached_asm(options, key);
+        result.success = true;
+        return result;
+    }
+
+    result = build_object(source, options, key, false);
+    if (!result.success || check_cancelled(options, CompileStage::Linker, result)) {
+        return result;
+    }
+    CompileResult executable = link_executable(result.buffer, output_path, options);
+    append_result(result, executable);
+    result.buffer.clear();
+    if (options.cache && result.success) {
+        if (auto executable_code = try_read_file(output_path)) {
+            store_cached(options, key, CompileCache::Artifact::Executable, executable_code.value(), result);
+        }
+    }
+    return result;
+}
@@ -1,29 +1,55 @@
 #include "file_util.hpp"
 
+#include <unistd.h>
+
+#include <filesystem>
+#include <sstream>
+
 std::string read_file(const std::string& path) {
-    std::ifstream file = std::ifstream(path.c_str());
+    auto contents = try_read_file(path);
 
-    if (!file.is_open()) {
+    if (!contents.has_value()) {
         std::cerr << "Error opening file "
                   << "'" << path << "'" << std::endl;
         exit(EXIT_FAILURE);
     }
 
-    std::vector<char> buffer;
-    char ch;
-    while (file.get(ch)) {
-        buffer.push_back(ch);
+    return contents.value();
+}
+
+std::optional<std::string> try_read_file(const std::string& path) {
+    std::ifstream file = std::ifstream(path.c_str(), std::ios::binary);
+
+    if (!file.is_open()) {
+        return std::nullopt;
     }
 
+    std::stringstream buffer;
+    buffer << file.rdbuf();
     file.close();
 
-    std::string res = buffer.data();
-
-    return res;
+    return buffer.str();
 }
 
-void write_file(std::string filename, std::string contents) {
-    std::ofstream file = std::ofstream(filename);
+bool write_file(std::string filename, std::string contents) {
+    std::ofstream file = std::ofstream(filename, std::ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
     file << contents;
     file.close();
+    return !file.fail();
+}
+
+std::string create_temp_file(const std::string& suffix) {
+    std::string path_template = (std::filesystem::temp_directory_path() / "dlvc_XXXXXX").string() + suffix;
+    std::vector<char> path(path_template.begin(), path_template.end());
+    path.push_back('\0');
+
+    int fd = mkstemps(path.data(), suffix.size());
+    if (fd == -1) {
+        return "";
+    }
+    close(fd);
+    return std::string(path.data());
 }
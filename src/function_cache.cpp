@@ -0,0 +1,168 @@
+#include "function_cache.hpp"
+
+#include <unistd.h>
+
+#include <filesystem>
+#include <thread>
+
+#include "file_util.hpp"
+#include "hash_util.hpp"
+
+namespace {
+
+void hash_token(ContentHash& hash, const Token& token) {
+    hash.update_field(std::to_string((int)token.type));
+    hash.update_field(token.value.value_or(""));
+}
+
+JsonValue to_json(const FunctionCache::FunctionRecord& record) {
+    JsonValue::Object callees;
+    for (auto& [name, signature] : record.callees) {
+        callees[name] = signature;
+    }
+    JsonValue::Object globals;
+    for (auto& [name, use] : record.globals) {
+        globals[name] = JsonValue(JsonValue::Object{
+            {"type", use.data_type},
+            {"initialized_before", use.initialized_before},
+            {"initialized_after", use.initialized_after},
+        });
+    }
+    JsonValue::Array warnings;
+    for (auto& warning : record.warnings) {
+        warnings.push_back(JsonValue(JsonValue::Object{
+            {"message", warning.message},
+            {"line_offset", warning.line_offset},
+            {"col", warning.col},
+        }));
+    }
+    return JsonValue(JsonValue::Object{
+        {"body", record.fingerprint.body},
+        {"signature", record.fingerprint.signature},
+        {"callees", callees},
+        {"globals", globals},
+        {"warnings", warnings},
+        {"asm", record.asm_code},
+    });
+}
+
+FunctionCache::FunctionRecord record_from_json(const JsonValue& value) {
+    FunctionCache::FunctionRecord record;
+    record.fingerprint.body = value.get_string("body");
+    record.fingerprint.signature = value.get_string("signature");
+    record.asm_code = value.get_string("asm");
+    if (auto callees = value.find("callees"); callees && callees->is_object()) {
+        for (auto& [name, signature] : callees->as_object()) {
+            record.callees[name] = signature.is_string() ? signature.as_string() : "";
+        }
+    }
+    if (auto globals = value.find("globals"); globals && globals->is_object()) {
+        for (auto& [name, use] : globals->as_object()) {
+            record.globals[name] = FunctionCache::GlobalUse{
+                .data_type = use.get_string("type"),
+                .initialized_before = use.get_bool("initialized_before"),
+                .initialized_after = use.get_bool("initialized_after"),
+            };
+        }
+    }
+    if (auto warnings = value.find("warnings"); warnings && warnings->is_array()) {
+        for (auto& warning : warnings->as_array()) {
+            record.warnings.push_back(FunctionCache::RecordedWarning{
+                .message = warning.get_string("message"),
+                .line_offset = (size_t)warning.get_number("line_offset"),
+                .col = (size_t)warning.get_number("col"),
+            });
+        }
+    }
+    return record;
+}
+
+}  // namespace
+
+FunctionCache::Fingerprint FunctionCache::fingerprint_function(const std::vector<Token>& tokens,
+                                                               const ASTStatementFunction& function) {
+    size_t first_line = function.start_token_meta.line_num;
+    ContentHash body;
+    for (size_t i = function.token_begin; i < function.token_end && i < tokens.size(); ++i) {
+        auto& token = tokens[i];
+        if (token.type == TokenType::comment) {
+            continue;
+        }
+        hash_token(body, token);
+        // positions are part of the diagnostics reported for the function
+        body.update_field(std::to_string(token.meta.line_num - first_line));
+        body.update_field(std::to_string(token.meta.line_pos));
+    }
+
+    ContentHash signature;
+    for (auto& token : function.return_data_type_tokens) {
+        hash_token(signature, token);
+    }
+    for (auto& parameter : function.parameters) {
+        signature.update_field(",");
+        for (auto& token : parameter.data_type_tokens) {
+            hash_token(signature, token);
+        }
+    }
+
+    return Fingerprint{
+        .body = body.hex_digest(),
+        .signature = signature.hex_digest(),
+    };
+}
+
+FunctionCache::Fingerprints FunctionCache::fingerprint_functions(const std::vector<Token>& tokens,
+                                                                 const ASTProgram& program) {
+    Fingerprints fingerprints;
+    for (auto& function : program.functions) {
+        fingerprints[function->name] = fingerprint_function(tokens, *function);
+    }
+    return fingerprints;
+}
+
+FunctionCache::FunctionRecords FunctionCache::load_records(const std::string& path, const std::string& compiler_id) {
+    FunctionRecords records;
+    auto contents = try_read_file(path);
+    if (!contents.has_value()) {
+        return records;
+    }
+    try {
+        JsonValue document = JsonValue::parse(contents.value());
+        auto functions = document.find("functions");
+        if (document.get_string("compiler") != compiler_id || !functions || !functions->is_object()) {
+            return records;
+        }
+        for (auto& [name, record] : functions->as_object()) {
+            records[name] = record_from_json(record);
+        }
+    } catch (const JsonException&) {
+        records.clear();
+    }
+    return records;
+}
+
+bool FunctionCache::save_records(const std::string& path, const std::string& compiler_id,
+                                 const FunctionRecords& records) {
+    JsonValue::Object functions;
+    for (auto& [name, record] : records) {
+        functions[name] = to_json(record);
+    }
+    JsonValue document(JsonValue::Object{
+        {"compiler", compiler_id},
+        {"functions", functions},
+    });
+
+    std::error_code error;
+    auto directory = std::filesystem::path(path).parent_path();
+    if (!directory.empty()) {
+        std::filesystem::create_directories(directory, error);
+    }
+    // replaced with a rename, so a concurrent compilation never reads a partially written file
+    std::string temp_path = path + ".tmp." + std::to_string(getpid()) + "." +
+                            std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()));
+    if (!write_file(temp_path, document.dump())) {
+        return false;
+    }
+    std::filesystem::rename(temp_path, path, error);
+    return !error;
+}
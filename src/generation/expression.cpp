@@ -1,269 +1,361 @@
 #include "generator.hpp"
 #include "generator_visitor.hpp"
+#include "strength_reduction.hpp"
 
-// --------- expression generation
+namespace {
+
+// the register an operand kept on the stack is popped back into- it's never evaluated into
+size_t spill_register() { return expression_registers.size() - 1; }
+// the registers expressions are evaluated in
+size_t evaluation_registers() { return expression_registers.size() - 1; }
+
+// evaluating both operands- the heavier first, then the other in the registers left
+size_t combined_need(size_t lhs_need, size_t rhs_need) {
+    return lhs_need == rhs_need ? lhs_need + 1 : std::max(lhs_need, rhs_need);
+}
 
-void Generator::generate_expression(const ASTExpression& expression) {
-    bool type_provided = (expression.data_type != nullptr);
-    assert(type_provided && "Expression found with no data type. expression index- " + expression.expression.index());
+bool is_comparison(BinOperation operation) { return comparison_operation.count(operation) > 0; }
+
+}  // namespace
+
+// --------- expression generation
 
+void Generator::evaluate_expression(const ASTExpression& expression, size_t first) {
     size_t size_bytes = expression.data_type->get_size_bytes();
-    std::visit(Generator::ExpressionVisitor{.generator = *this, .size = size_bytes}, expression.expression);
+    std::visit(Generator::ExpressionVisitor{.generator = *this, .size = size_bytes, .first = first},
+               expression.expression);
+}
+
+size_t Generator::register_need(const ASTExpression& expression) {
+    if (auto atomic = std::get_if<std::shared_ptr<ASTAtomicExpression>>(&expression.expression)) {
+        if (auto parenthesis = std::get_if<ASTParenthesisExpression>(&(*atomic)->value)) {
+            return register_need(*parenthesis->expression);
+        }
+        // calls save the registers in use around them, so they hold no more than their result
+        return 1;
+    }
+    if (auto binary = std::get_if<std::shared_ptr<ASTBinExpression>>(&expression.expression)) {
+        if (auto operand = reduced_operand(**binary)) {
+            return register_need(*operand);
+        }
+        if (immediate_operand(**binary)) {
+            return register_need(*(*binary)->lhs);
+        }
+        return combined_need(register_need(*(*binary)->lhs), register_need(*(*binary)->rhs));
+    }
+    if (auto unary = std::get_if<std::shared_ptr<ASTUnaryExpression>>(&expression.expression)) {
+        return (*unary)->operation == UnaryOperation::dereference ? address_register_need(*(*unary)->expression)
+                                                                  : register_need(*(*unary)->expression);
+    }
+    // an element is loaded from its address
+    return address_register_need(expression);
+}
+
+size_t Generator::address_register_need(const ASTExpression& expression) {
+    if (auto array_index = std::get_if<std::shared_ptr<ASTArrayIndexExpression>>(&expression.expression)) {
+        auto& indexed = *(*array_index)->expression;
+        bool is_array = (bool)dynamic_cast<ArrayType*>(indexed.data_type.get());
+        size_t base_need = is_array ? address_register_need(indexed) : register_need(indexed);
+        if (constant_value(*(*array_index)->index)) {
+            return base_need;
+        }
+        return combined_need(base_need, register_need(*(*array_index)->index));
+    }
+    if (auto unary = std::get_if<std::shared_ptr<ASTUnaryExpression>>(&expression.expression)) {
+        return register_need(*(*unary)->expression);
+    }
+    return 1;
+}
+
+bool Generator::has_call(const ASTExpression& expression) {
+    if (auto atomic = std::get_if<std::shared_ptr<ASTAtomicExpression>>(&expression.expression)) {
+        if (auto parenthesis = std::get_if<ASTParenthesisExpression>(&(*atomic)->value)) {
+            return has_call(*parenthesis->expression);
+        }
+        return std::holds_alternative<ASTFunctionCall>((*atomic)->value);
+    }
+    if (auto binary = std::get_if<std::shared_ptr<ASTBinExpression>>(&expression.expression)) {
+        return has_call(*(*binary)->lhs) || has_call(*(*binary)->rhs);
+    }
+    if (auto unary = std::get_if<std::shared_ptr<ASTUnaryExpression>>(&expression.expression)) {
+        return has_call(*(*unary)->expression);
+    }
+    auto& array_index = std::get<std::shared_ptr<ASTArrayIndexExpression>>(expression.expression);
+    return has_call(*array_index->expression) || has_call(*array_index->index);
 }
 
-void Generator::generate_expression_identifier(const ASTIdentifier& identifier, size_t requested_size_bytes) {
+std::pair<size_t, size_t> Generator::evaluate_operands(const std::function<void(size_t)>& evaluate_lhs,
+                                                       size_t lhs_need,
+                                                       const std::function<void(size_t)>& evaluate_rhs,
+                                                       size_t rhs_need, bool in_order, size_t first) {
+    size_t available = evaluation_registers() - first;
+    if (!in_order && rhs_need > lhs_need) {
+        evaluate_rhs(first);
+        if (lhs_need < available) {
+            evaluate_lhs(first + 1);
+            return {first + 1, first};
+        }
+        // both take every register- the rhs waits on the stack
+        push_stack_register(register_name(first, 8), 8);
+        evaluate_lhs(first);
+        pop_stack_register(register_name(spill_register(), 8), 8, 8);
+        return {first, spill_register()};
+    }
+    evaluate_lhs(first);
+    if (rhs_need < available) {
+        evaluate_rhs(first + 1);
+        return {first, first + 1};
+    }
+    push_stack_register(register_name(first, 8), 8);
+    evaluate_rhs(first);
+    pop_stack_register(register_name(spill_register(), 8), 8, 8);
+    return {spill_register(), first};
+}
+
+void Generator::generate_expression_identifier(const ASTIdentifier& identifier, size_t requested_size_bytes,
+                                               size_t first) {
     auto& variable_name = identifier.value;
     auto variable_data = assert_get_variable_data(variable_name);
 
-    m_generated << ";\tEvaluate Variable " << variable_name << std::endl;
-
     bool is_pointer_type = (bool)dynamic_cast<PointerType*>(variable_data.data_type.get());
     bool is_base_type = (bool)dynamic_cast<BasicType*>(variable_data.data_type.get());
     bool is_complex_type = (!is_base_type && !is_pointer_type);  // complex types are having their pointers copied
 
-    load_memory_address_var(identifier);
-    pop_stack_register("rdx", 8, 8);  // address is always 8 bytes
-
-    size_t data_size = is_complex_type ? 8 : variable_data.size_bytes;  // if complex type, we only assign the address
-
-    // NOTE: assumes that if theres type-changing, it is narrowing
-    // to handle type-widening, we need to first clear the entire a register before writing to it,
-    // and then zero/sign filling it with the data we read from the stack.
-    std::string original_size_keyword = size_bytes_to_size_keyword.at(data_size);
-    std::string original_data_reg = size_bytes_to_register.at(data_size);
-    std::string requested_data_reg = size_bytes_to_register.at(requested_size_bytes);
-
+    std::string address = variable_address(identifier);
     if (is_complex_type) {
         // copy reference- pointer decay
-        m_generated << "\t; RESOLVE ADDRESS OF VARIABLE" << std::endl;
-        m_generated << "\tmov " << original_data_reg << ", " << original_size_keyword << " rdx" << std::endl;
-    } else {
-        m_generated << "\t; RESOLVE VALUE OF VARIABLE" << std::endl;
-        m_generated << "\tmov " << original_data_reg << ", " << original_size_keyword << " [rdx]" << std::endl;
+        m_generated << "\tlea " << register_name(first, 8) << ", " << address << std::endl;
+        return;
+    }
+    load_register(first, variable_data.size_bytes, address);
+    if (requested_size_bytes < variable_data.size_bytes) {
+        truncate_register(first, requested_size_bytes);
     }
-
-    // NOTE: if reading a singular byte, we need to byteswap the read data(little endian shenanigans)
-    // probably just don't support 8-bit variables, lol
-    push_stack_register(requested_data_reg, requested_size_bytes);
-}
-
-void Generator::generate_expression_int_literal(const ASTIntLiteral& literal, size_t size_bytes) {
-    push_stack_literal(literal.value, size_bytes);
 }
 
-void Generator::generate_expression_char_literal(const ASTCharLiteral& literal, size_t size_bytes) {
-    auto ascii_value = std::to_string(literal.value);
-    push_stack_literal(ascii_value, size_bytes);
+void Generator::generate_expression_int_literal(const ASTIntLiteral& literal, size_t size_bytes, size_t first) {
+    load_constant(first, parse_int_literal(literal.value), size_bytes);
 }
 
-void Generator::generate_expression_array_initializer(const ASTArrayInitializer& array_initializer) {
-    // push them in reverse(stack reverses order)
-    for (auto cur = array_initializer.initialize_values.rbegin(); cur != array_initializer.initialize_values.rend();
-         ++cur) {
-        generate_expression(*cur);
-    }
+void Generator::generate_expression_char_literal(const ASTCharLiteral& literal, size_t size_bytes, size_t first) {
+    load_constant(first, (uint64_t)(int64_t)literal.value, size_bytes);
 }
 
-void Generator::generate_expression_binary(const std::shared_ptr<ASTBinExpression>& binary, size_t size_bytes) {
+void Generator::generate_expression_binary(const std::shared_ptr<ASTBinExpression>& binary, size_t size_bytes,
+                                           size_t first) {
     static_assert((int)BinOperation::operationCount - 1 == 10,
                   "Binary Operations enum changed without changing generator");
-    std::string operation;
-    switch (binary->operation) {
+    if (generate_binary_by_constant(*binary, first)) {
+        truncate_register(first, size_bytes);
+        return;
+    }
+    auto& lhsExp = binary->lhs;
+    auto& rhsExp = binary->rhs;
+    std::string target = register_name(first, 8);
+    std::string lhs, rhs;
+    if (auto immediate = immediate_operand(*binary)) {
+        evaluate_expression(*lhsExp, first);
+        lhs = target;
+        rhs = std::to_string(*immediate);
+    } else {
+        auto [lhs_register, rhs_register] = evaluate_operands(
+            [&](size_t index) { evaluate_expression(*lhsExp, index); }, register_need(*lhsExp),
+            [&](size_t index) { evaluate_expression(*rhsExp, index); }, register_need(*rhsExp),
+            has_call(*lhsExp) || has_call(*rhsExp), first);
+        lhs = register_name(lhs_register, 8);
+        rhs = register_name(rhs_register, 8);
+    }
+
+    auto bin_operation = binary->operation;
+    switch (bin_operation) {
         case BinOperation::add:
-            operation = "Addition";
+            m_generated << "\tadd " << lhs << ", " << rhs << std::endl;
             break;
         case BinOperation::subtract:
-            operation = "Subtraction";
+            m_generated << "\tsub " << lhs << ", " << rhs << std::endl;
             break;
         case BinOperation::multiply:
-            operation = "Multiplication";
+            m_generated << "\timul " << lhs << ", " << rhs << std::endl;
             break;
         case BinOperation::divide:
-            operation = "Division";
-            break;
         case BinOperation::modulo:
-            operation = "Modulo";
+            // division is rdx:rax / rhs, the remainder in rdx
+            m_generated << "\tmov rax, " << lhs << std::endl
+                        << "\txor edx, edx" << std::endl
+                        << "\tdiv " << rhs << std::endl
+                        << "\tmov " << target << ", " << (bin_operation == BinOperation::divide ? "rax" : "rdx")
+                        << std::endl;
             break;
         case BinOperation::eq:
-            operation = "Comparison(=)";
-            break;
         case BinOperation::lt:
-            operation = "Comparison(<)";
-            break;
         case BinOperation::le:
-            operation = "Comparison(<=)";
-            break;
         case BinOperation::gt:
-            operation = "Comparison(>)";
-            break;
         case BinOperation::ge:
-            operation = "Comparison(>=)";
-            break;
+            m_generated << "\tcmp " << lhs << ", " << rhs << std::endl
+                        << "\t" << comparison_operation.at(bin_operation) << " " << register_name(first, 1) << std::endl
+                        << "\tmovzx " << register_name(first, 4) << ", " << register_name(first, 1) << std::endl;
+            // 0 or 1, at any size
+            return;
         default:
             // should never reach here. this is to remove warnings
-            std::cerr << "Generation: unknown binary operation" << std::endl;
-            exit(EXIT_FAILURE);
+            throw GeneratorException("Generation: unknown binary operation");
     }
-    m_generated << ";\t" << operation << " Evaluation BEGIN" << std::endl;
-    auto& lhsExp = binary->lhs;
-    auto& rhsExp = binary->rhs;
-    size_t rhs_size_bytes = rhsExp->data_type->get_size_bytes();
-    size_t lhs_size_bytes = lhsExp->data_type->get_size_bytes();
-    generate_expression(*lhsExp);
-    generate_expression(*rhsExp);
-    pop_stack_register("rbx", 8, rhs_size_bytes);  // rbx = rhs
-    pop_stack_register("rax", 8, lhs_size_bytes);  // rax = lhs
+    if (lhs != target && bin_operation != BinOperation::divide && bin_operation != BinOperation::modulo) {
+        m_generated << "\tmov " << target << ", " << lhs << std::endl;
+    }
+    truncate_register(first, size_bytes);
+}
 
-    auto bin_operation = binary->operation;
-    switch (bin_operation) {
-        case BinOperation::add:
-            m_generated << "\tadd rax, rbx; rax += rbx" << std::endl;  // rax = rax + rbx
-            break;
-        case BinOperation::subtract:
-            m_generated << "\tsub rax, rbx; rax -= rbx" << std::endl;  // rax = rax - rbx
-            break;
+bool Generator::generate_binary_by_constant(const ASTBinExpression& binary, size_t first) {
+    // the constant is never evaluated- the other operand is, and the operation applied in rax
+    auto operand = reduced_operand(binary);
+    if (!operand) {
+        return false;
+    }
+    std::string reduced;
+    switch (binary.operation) {
         case BinOperation::multiply:
-            m_generated << "\tmul rbx; rax *= rbx" << std::endl;  // rax = rax * rbx
+            reduced = reduce_multiply(*constant_value(operand == binary.lhs.get() ? *binary.rhs : *binary.lhs));
             break;
         case BinOperation::divide:
-            m_generated << "\txor rdx, rdx; clear rdx" << std::endl;       // clear rdx(division is rdx:rax / rbx)
-            m_generated << "\tdiv rbx; rax = rdx:rax / rbx" << std::endl;  // rax = rax / rbx
+            reduced = *reduce_divide(*constant_value(*binary.rhs));
             break;
-        case BinOperation::modulo:
-            m_generated << "\txor rdx, rdx; clear rdx" << std::endl;       // clear rdx(division is rdx:rax / rbx)
-            m_generated << "\tdiv rbx; rdx = rdx:rax % rbx" << std::endl;  // rdx stores the remainder
-            m_generated << "\tmov rax, rdx; rdx stores the remainder" << std::endl;
-            break;
-        case BinOperation::eq:
-        case BinOperation::lt:
-        case BinOperation::le:
-        case BinOperation::gt:
-        case BinOperation::ge:
-            m_generated << "\tcmp rax, rbx" << std::endl;
-            m_generated << "\t" << comparison_operation.at(bin_operation) << " bl; temporary in bl" << std::endl;
-            m_generated << "\txor rax, rax" << std::endl;
-            m_generated << "\tmov al, bl" << std::endl;  // final result is stored in rax by convention
+        default:
+            reduced = *reduce_modulo(*constant_value(*binary.rhs));
             break;
+    }
+    evaluate_expression(*operand, first);
+    std::string reg = register_name(first, 8);
+    m_generated << "\t; By constant" << std::endl
+                << "\tmov rax, " << reg << std::endl
+                << reduced << "\tmov " << reg << ", rax" << std::endl;
+    return true;
+}
+
+const ASTExpression* Generator::reduced_operand(const ASTBinExpression& binary) {
+    auto rhs = constant_value(*binary.rhs);
+    switch (binary.operation) {
+        case BinOperation::multiply:
+            if (rhs) {
+                return binary.lhs.get();
+            }
+            return constant_value(*binary.lhs) ? binary.rhs.get() : nullptr;
+        case BinOperation::divide:
+        case BinOperation::modulo:
+            // division by zero is left to trap
+            return rhs && *rhs != 0 ? binary.lhs.get() : nullptr;
         default:
-            // should never reach here. this is to remove warnings
-            std::cerr << "Generation: unknown binary operation" << std::endl;
-            exit(EXIT_FAILURE);
+            return nullptr;
     }
-    auto& reg = size_bytes_to_register.at(size_bytes);
-    push_stack_register(reg, size_bytes);
-    m_generated << ";\t" << operation << " Evaluation END" << std::endl << std::endl;
 }
 
-void Generator::generate_expression_unary(const std::shared_ptr<ASTUnaryExpression>& unary, size_t size_bytes) {
+std::optional<uint64_t> Generator::immediate_operand(const ASTBinExpression& binary) {
+    if (binary.operation != BinOperation::add && binary.operation != BinOperation::subtract &&
+        !is_comparison(binary.operation)) {
+        return std::nullopt;
+    }
+    auto rhs = constant_value(*binary.rhs);
+    // immediates of 64 bit instructions are sign-extended 32 bit numbers
+    return rhs && *rhs <= INT32_MAX ? rhs : std::nullopt;
+}
+
+void Generator::generate_expression_unary(const std::shared_ptr<ASTUnaryExpression>& unary, size_t size_bytes,
+                                          size_t first) {
     static_assert((int)UnaryOperation::operationCount - 1 == 3,
                   "Implemented unary operations without updating generator");
 
     auto& operand = *unary->expression;
     auto operation = unary->operation;
-    size_t operand_size_bytes = operand.data_type->get_size_bytes();
 
     switch (operation) {
         case UnaryOperation::negate: {
-            generate_expression(operand);
-            pop_stack_register("rax", 8, operand_size_bytes);
-            m_generated << "\tneg rax; Negate expression" << std::endl;
+            evaluate_expression(operand, first);
+            m_generated << "\tneg " << register_name(first, 8) << "; Negate expression" << std::endl;
+            truncate_register(first, size_bytes);
             break;
         }
         case UnaryOperation::dereference: {
-            load_memory_address_expr(operand);
-            pop_stack_register("rax", 8, 8);  // pointers are always qword
+            load_memory_address_expr(operand, first);
             break;
         }
         case UnaryOperation::reference: {
-            generate_expression(operand);
-            pop_stack_register("rax", 8, operand_size_bytes);
-            m_generated << "\tmov rax, [rax]" << std::endl;
+            evaluate_expression(operand, first);
+            load_register(first, size_bytes, "[" + register_name(first, 8) + "]");
             break;
         }
         default:
             assert(false && "Unknown unary operation");
     }
-    auto& reg = size_bytes_to_register.at(size_bytes);
-    push_stack_register(reg, size_bytes);
 }
 
 void Generator::generate_expression_array_index(const std::shared_ptr<ASTArrayIndexExpression>& array_index,
-                                                size_t requested_size_bytes) {
+                                                size_t requested_size_bytes, size_t first) {
     auto array_type = dynamic_cast<ArrayType*>(array_index->expression->data_type.get());
     auto pointer_type = dynamic_cast<PointerType*>(array_index->expression->data_type.get());
     if (!pointer_type && !array_type) {
-        std::cerr << "Generation: unexpected expression to index" << std::endl;
-        exit(EXIT_FAILURE);
+        throw GeneratorException("Generation: unexpected expression to index");
     }
     auto& inner_element = array_type ? array_type->elementType : pointer_type->baseType;
     auto inner_type_size_bytes = inner_element->get_size_bytes();
 
-    // NOTE: very similar to variable evaluation
-    std::string original_size_keyword = size_bytes_to_size_keyword.at(inner_type_size_bytes);
-    std::string original_data_reg = size_bytes_to_register.at(inner_type_size_bytes);
-    std::string requested_data_reg = size_bytes_to_register.at(requested_size_bytes);
-
-    size_t index_size_bytes = array_index->index->data_type->get_size_bytes();
-
-    if (array_type) {
-        load_memory_address_expr(*array_index->expression);
-    } else {
-        generate_expression(*array_index->expression);
+    load_register(first, inner_type_size_bytes, array_element_address(*array_index, first));
+    if (requested_size_bytes < inner_type_size_bytes) {
+        truncate_register(first, requested_size_bytes);
     }
-
-    generate_expression(*array_index->index);
-
-    pop_stack_register("rax", 8, index_size_bytes);  // index is in rax
-    pop_stack_register("rcx", 8, 8);                 // offset is in rcx
-
-    m_generated << "\tmov rbx, " << inner_type_size_bytes << std::endl << "\tmul rbx" << std::endl;
-    m_generated << "\tadd rcx, rax ; Indexing offset" << std::endl;  // indexing
-
-    m_generated << "\tmov " << original_data_reg << ", " << original_size_keyword << " [rcx]" << std::endl;
-
-    push_stack_register(requested_data_reg, requested_size_bytes);
 }
 
-void Generator::load_memory_address_expr(const ASTExpression& expression) {
-    if (std::holds_alternative<std::shared_ptr<ASTArrayIndexExpression>>(expression.expression)) {
-        m_generated << "\t; Evaluate array index memory address BEGIN" << std::endl;
-        auto array_index = std::get<std::shared_ptr<ASTArrayIndexExpression>>(expression.expression);
-        auto array_type = dynamic_cast<ArrayType*>(array_index->expression->data_type.get());
-        auto inner_type_size_bytes = array_type->elementType->get_size_bytes();
-
-        load_memory_address_expr(*array_index->expression);
-        pop_stack_register("rcx", 8, 8);
+std::string Generator::array_element_address(const ASTArrayIndexExpression& array_index, size_t first) {
+    auto& indexed = *array_index.expression;
+    auto& index = *array_index.index;
+    auto array_type = dynamic_cast<ArrayType*>(indexed.data_type.get());
+    auto pointer_type = dynamic_cast<PointerType*>(indexed.data_type.get());
+    if (!pointer_type && !array_type) {
+        throw GeneratorException("Generation: unexpected expression to index");
+    }
+    size_t element_size = (array_type ? array_type->elementType : pointer_type->baseType)->get_size_bytes();
+    // an array's elements are at its address, a pointer's where it points
+    auto evaluate_base = [&](size_t target) {
+        if (array_type) {
+            load_memory_address_expr(indexed, target);
+        } else {
+            evaluate_expression(indexed, target);
+        }
+    };
+    size_t base_need = array_type ? address_register_need(indexed) : register_need(indexed);
 
-        // indexing
-        m_generated << "\t; Begin Array Index generation" << std::endl;
-        generate_expression(*array_index->index);
-        pop_stack_register("rax", 8, 8);
-        m_generated << "\tmov rbx, " << inner_type_size_bytes << std::endl << "\tmul rbx" << std::endl;
-        m_generated << "\t; End Array Index generation" << std::endl;
+    if (auto constant_index = constant_value(index); constant_index && *constant_index * element_size <= INT32_MAX) {
+        evaluate_base(first);
+        return "[" + register_name(first, 8) + "+" + std::to_string(*constant_index * element_size) + "]";
+    }
+    auto [base, index_register] =
+        evaluate_operands(evaluate_base, base_need, [&](size_t target) { evaluate_expression(index, target); },
+                          register_need(index), has_call(indexed) || has_call(index), first);
+    return indexed_address(register_name(base, 8), register_name(index_register, 8), element_size);
+}
 
-        m_generated << "\tadd rcx, rax ; Indexing offset" << std::endl;  // indexing
-        push_stack_register("rcx", 8);
-        m_generated << "\t; Evaluate array index memory address END" << std::endl;
+void Generator::load_memory_address_expr(const ASTExpression& expression, size_t first) {
+    if (auto array_index = std::get_if<std::shared_ptr<ASTArrayIndexExpression>>(&expression.expression)) {
+        std::string address = array_element_address(**array_index, first);
+        m_generated << "\tlea " << register_name(first, 8) << ", " << address << std::endl;
         return;
     }
     // TODO: extract this 'check if reference' to another method(reuse)
     if (std::holds_alternative<std::shared_ptr<ASTUnaryExpression>>(expression.expression)) {
         auto unary = std::get<std::shared_ptr<ASTUnaryExpression>>(expression.expression);
         if (unary->operation == UnaryOperation::reference) {
-            generate_expression(*unary->expression);  // the address is the operand of *
+            evaluate_expression(*unary->expression, first);  // the address is the operand of *
             return;
         }
     }
 
     // must be atomic expression
     if (!std::holds_alternative<std::shared_ptr<ASTAtomicExpression>>(expression.expression)) {
-        std::cerr << "Generation: unexpected expression to calculate address of" << std::endl;
-        exit(EXIT_FAILURE);
+        throw GeneratorException("Generation: unexpected expression to calculate address of");
     }
     auto atomic = std::get<std::shared_ptr<ASTAtomicExpression>>(expression.expression);
-    if (std::holds_alternative<ASTIdentifier>(atomic->value)) {
-        auto identifier = std::get<ASTIdentifier>(atomic->value);
-        load_memory_address_var(identifier);
-        return;
+    if (!std::holds_alternative<ASTIdentifier>(atomic->value)) {
+        throw GeneratorException("Generation: unexpected expression to calculate address of");
     }
-}
\ No newline at end of file
+    std::string address = variable_address(std::get<ASTIdentifier>(atomic->value));
+    m_generated << "\tlea " << register_name(first, 8) << ", " << address << std::endl;
+}
@@ -0,0 +1,302 @@
+#include "generator.hpp"
+
+namespace {
+
+size_t align_up(size_t value, size_t alignment) { return (value + alignment - 1) / alignment * alignment; }
+
+const std::map<size_t, std::string> size_bytes_to_data_directive = {
+    {1, "db"},
+    {2, "dw"},
+    {4, "dd"},
+    {8, "dq"},
+};
+
+// the type of the innermost elements of an array, or the type itself
+std::shared_ptr<DataType> innermost_type(const std::shared_ptr<DataType>& data_type) {
+    auto array_type = dynamic_cast<ArrayType*>(data_type.get());
+    return array_type ? innermost_type(array_type->elementType) : data_type;
+}
+
+// the identifier an lvalue- possibly indexed or parenthesized- is rooted at
+const ASTIdentifier* lvalue_root(const ASTExpression& expression) {
+    if (auto array_index = std::get_if<std::shared_ptr<ASTArrayIndexExpression>>(&expression.expression)) {
+        return lvalue_root(*(*array_index)->expression);
+    }
+    auto atomic = std::get_if<std::shared_ptr<ASTAtomicExpression>>(&expression.expression);
+    if (!atomic) {
+        return nullptr;
+    }
+    if (auto parenthesis = std::get_if<ASTParenthesisExpression>(&(*atomic)->value)) {
+        return lvalue_root(*parenthesis->expression);
+    }
+    return std::get_if<ASTIdentifier>(&(*atomic)->value);
+}
+
+// names of the variables used other than to read their elements, anywhere in the statement- assigned to, or
+// decaying to a pointer, which could be written through
+struct WrittenNamesVisitor {
+    std::set<std::string>& names;
+
+    void visit(const ASTStatement& statement) { std::visit(*this, statement.statement); }
+
+    void visit(const ASTExpression& expression) {
+        // an element that's an array itself decays to a pointer
+        if (std::holds_alternative<std::shared_ptr<ASTArrayIndexExpression>>(expression.expression) &&
+            dynamic_cast<ArrayType*>(expression.data_type.get())) {
+            add_lvalue_root(expression);
+        }
+        std::visit(*this, expression.expression);
+    }
+
+    void operator()(const std::shared_ptr<ASTStatementExit>& exit) { visit(exit->status_code); }
+    void operator()(const std::shared_ptr<ASTStatementVar>& var) {
+        if (var->value.has_value()) {
+            visit(var->value.value());
+        }
+    }
+    void operator()(const std::shared_ptr<ASTStatementScope>& scope) {
+        for (auto& statement : scope->statements) {
+            visit(*statement);
+        }
+    }
+    void operator()(const std::shared_ptr<ASTStatementIf>& if_statement) {
+        visit(if_statement->expression);
+        visit(*if_statement->success_statement);
+        if (if_statement->fail_statement) {
+            visit(*if_statement->fail_statement);
+        }
+    }
+    void operator()(const std::shared_ptr<ASTStatementAssign>& assign) {
+        add_lvalue_root(*assign->lhs);
+        visit(*assign->lhs);
+        visit(assign->value);
+    }
+    void operator()(const std::shared_ptr<ASTStatementWhile>& while_statement) {
+        visit(while_statement->expression);
+        visit(*while_statement->success_statement);
+    }
+    void operator()(const std::shared_ptr<ASTStatementFunction>& function) { visit(*function->statement); }
+    void operator()(const std::shared_ptr<ASTStatementReturn>& return_statement) {
+        if (return_statement->expression.has_value()) {
+            visit(return_statement->expression.value());
+        }
+    }
+    void operator()(const std::shared_ptr<ASTFunctionCall>& function_call) { (*this)(*function_call); }
+
+    void operator()(const std::shared_ptr<ASTAtomicExpression>& atomic) { std::visit(*this, atomic->value); }
+    void operator()(const ASTIntLiteral&) {}
+    void operator()(const ASTCharLiteral&) {}
+    void operator()(const ASTIdentifier& identifier) { names.insert(identifier.value); }
+    void operator()(const ASTParenthesisExpression& paren) { visit(*paren.expression); }
+    void operator()(const ASTFunctionCall& function_call) {
+        for (auto& parameter : function_call.parameters) {
+            visit(parameter);
+        }
+    }
+    void operator()(const ASTArrayInitializer& initializer) {
+        for (auto& value : initializer.initialize_values) {
+            visit(value);
+        }
+    }
+    void operator()(const std::shared_ptr<ASTBinExpression>& binary) {
+        visit(*binary->lhs);
+        visit(*binary->rhs);
+    }
+    void operator()(const std::shared_ptr<ASTUnaryExpression>& unary) {
+        if (unary->operation == UnaryOperation::dereference) {
+            add_lvalue_root(*unary->expression);
+        }
+        visit(*unary->expression);
+    }
+    void operator()(const std::shared_ptr<ASTArrayIndexExpression>& array_index) {
+        // reading an element of the indexed variable doesn't write it
+        if (!lvalue_root(*array_index->expression)) {
+            visit(*array_index->expression);
+        } else if (auto inner = std::get_if<std::shared_ptr<ASTArrayIndexExpression>>(
+                       &array_index->expression->expression)) {
+            (*this)(*inner);
+        }
+        visit(*array_index->index);
+    }
+
+    void add_lvalue_root(const ASTExpression& expression) {
+        if (auto root = lvalue_root(expression)) {
+            names.insert(root->value);
+        }
+    }
+};
+
+}  // namespace
+
+void Generator::layout_statement(const ASTStatement& statement, size_t& offset, size_t& frame_size) {
+    if (auto var_statement = std::get_if<std::shared_ptr<ASTStatementVar>>(&statement.statement)) {
+        if (is_read_only_array(**var_statement)) {
+            return;
+        }
+        auto& data_type = (*var_statement)->data_type;
+        offset = align_up(offset + data_type->get_size_bytes(), alignment_of(data_type));
+        m_slots[var_statement->get()] = offset;
+        frame_size = std::max(frame_size, offset);
+    } else if (auto scope_statement = std::get_if<std::shared_ptr<ASTStatementScope>>(&statement.statement)) {
+        // the scope's variables go out of scope with it, so the statements after it reuse their slots
+        size_t scope_offset = offset;
+        for (auto& inner : (*scope_statement)->statements) {
+            layout_statement(*inner, scope_offset, frame_size);
+        }
+    } else if (auto if_statement = std::get_if<std::shared_ptr<ASTStatementIf>>(&statement.statement)) {
+        layout_statement(*(*if_statement)->success_statement, offset, frame_size);
+        if ((*if_statement)->fail_statement) {
+            layout_statement(*(*if_statement)->fail_statement, offset, frame_size);
+        }
+    } else if (auto while_statement = std::get_if<std::shared_ptr<ASTStatementWhile>>(&statement.statement)) {
+        layout_statement(*(*while_statement)->success_statement, offset, frame_size);
+    }
+}
+
+void Generator::layout_global_statement(const ASTStatement& statement, size_t& offset, size_t& frame_size,
+                                        std::stringstream& data, std::stringstream& bss) {
+    if (auto var_statement = std::get_if<std::shared_ptr<ASTStatementVar>>(&statement.statement)) {
+        auto& var = **var_statement;
+        m_globals.insert(&var);
+        size_t alignment = alignment_of(var.data_type);
+        auto values = var.value.has_value() ? constant_initializer(var.value.value()) : std::nullopt;
+        if (!values) {
+            bss << "\talignb " << alignment << std::endl
+                << global_symbol(var.name) << ": resb " << var.data_type->get_size_bytes() << std::endl;
+            return;
+        }
+        // never written, so it may as well be read-only
+        write_data(is_read_only_array(var) ? m_rodata : data, global_symbol(var.name), var.data_type, *values);
+    } else if (auto if_statement = std::get_if<std::shared_ptr<ASTStatementIf>>(&statement.statement)) {
+        // a body that isn't a scope declares in the global scope
+        layout_global_statement(*(*if_statement)->success_statement, offset, frame_size, data, bss);
+        if ((*if_statement)->fail_statement) {
+            layout_global_statement(*(*if_statement)->fail_statement, offset, frame_size, data, bss);
+        }
+    } else if (auto while_statement = std::get_if<std::shared_ptr<ASTStatementWhile>>(&statement.statement)) {
+        layout_global_statement(*(*while_statement)->success_statement, offset, frame_size, data, bss);
+    } else {
+        layout_statement(statement, offset, frame_size);
+    }
+}
+
+std::optional<std::vector<uint64_t>> Generator::constant_initializer(const ASTExpression& value) {
+    if (!dynamic_cast<ArrayType*>(value.data_type.get())) {
+        auto constant = constant_value(value);
+        if (!constant) {
+            return std::nullopt;
+        }
+        return std::vector<uint64_t>{*constant};
+    }
+    auto atomic = std::get_if<std::shared_ptr<ASTAtomicExpression>>(&value.expression);
+    auto initializer = atomic ? std::get_if<ASTArrayInitializer>(&(*atomic)->value) : nullptr;
+    if (!initializer) {
+        return std::nullopt;
+    }
+    std::vector<uint64_t> values;
+    for (auto& element : initializer->initialize_values) {
+        auto element_values = constant_initializer(element);
+        if (!element_values) {
+            return std::nullopt;
+        }
+        values.insert(values.end(), element_values->begin(), element_values->end());
+    }
+    return values;
+}
+
+void Generator::collect_written_names(const ASTStatement& statement, std::set<std::string>& names) {
+    WrittenNamesVisitor{names}.visit(statement);
+}
+
+bool Generator::is_read_only_array(const ASTStatementVar& var_statement) const {
+    return dynamic_cast<ArrayType*>(var_statement.data_type.get()) && var_statement.value.has_value() &&
+           !m_written_names.count(var_statement.name) && constant_initializer(var_statement.value.value());
+}
+
+void Generator::write_data(std::ostream& section, const std::string& symbol,
+                           const std::shared_ptr<DataType>& data_type, const std::vector<uint64_t>& values) {
+    size_t element_size = innermost_type(data_type)->get_size_bytes();
+    section << "\talign " << alignment_of(data_type) << ", db 0" << std::endl
+            << symbol << ": " << size_bytes_to_data_directive.at(element_size) << " ";
+    for (size_t i = 0; i < values.size(); ++i) {
+        section << (i > 0 ? ", " : "") << values[i];
+    }
+    section << std::endl;
+}
+
+std::string Generator::rodata_initializer(const ASTStatementVar& var_statement) {
+    // numbered within the function, so its assembly stays independent of the code before it
+    std::string symbol = "initializer." + m_function_name + "." + std::to_string(m_rodata_counter++);
+    write_data(m_rodata, symbol, var_statement.data_type, *constant_initializer(var_statement.value.value()));
+    return symbol;
+}
+
+void Generator::generate_rodata() {
+    if (m_rodata.str().empty()) {
+        return;
+    }
+    m_generated << "section .rodata" << std::endl << m_rodata.str() << "section .text" << std::endl;
+    m_rodata.str("");
+}
+
+void Generator::copy_from_rodata(const std::string& symbol, int64_t frame_offset, size_t size_bytes) {
+    if (size_bytes > 64) {
+        m_generated << "\tlea rsi, [rel " << symbol << "]" << std::endl
+                    << "\tlea rdi, " << memory_address("rbp", frame_offset) << std::endl
+                    << "\tmov ecx, " << size_bytes << std::endl
+                    << "\trep movsb" << std::endl;
+        return;
+    }
+    // short enough to copy by the widest moves that fit
+    for (size_t copied = 0; copied < size_bytes;) {
+        size_t size = 8;
+        while (size > size_bytes - copied) {
+            size /= 2;
+        }
+        std::string keyword = size_bytes_to_size_keyword.at(size);
+        std::string reg = size == 4 ? "eax" : size_bytes_to_register.at(size);
+        m_generated << "\tmov " << reg << ", " << keyword << " " << memory_address("rel " + symbol, copied)
+                    << std::endl
+                    << "\tmov " << keyword << " " << memory_address("rbp", frame_offset + (int64_t)copied) << ", "
+                    << reg << std::endl;
+        copied += size;
+    }
+}
+
+size_t Generator::alignment_of(const std::shared_ptr<DataType>& data_type) {
+    if (auto array_type = dynamic_cast<ArrayType*>(data_type.get())) {
+        return alignment_of(array_type->elementType);
+    }
+    size_t size_bytes = data_type->get_size_bytes();
+    return size_bytes >= 8 ? 8 : std::max<size_t>(size_bytes, 1);
+}
+
+std::string Generator::memory_address(const std::string& base, int64_t offset) {
+    if (offset < 0) {
+        return "[" + base + "-" + std::to_string(-offset) + "]";
+    }
+    if (offset == 0) {
+        return "[" + base + "]";
+    }
+    return "[" + base + "+" + std::to_string(offset) + "]";
+}
+
+void Generator::store_initializer(const std::string& base, int64_t offset, const ASTExpression& value) {
+    auto array_type = dynamic_cast<ArrayType*>(value.data_type.get());
+    if (!array_type) {
+        size_t size_bytes = value.data_type->get_size_bytes();
+        evaluate_expression(value, 0);
+        m_generated << "\tmov " << size_bytes_to_size_keyword.at(size_bytes) << " " << memory_address(base, offset)
+                    << ", " << register_name(0, size_bytes) << std::endl;
+        return;
+    }
+    auto atomic = std::get_if<std::shared_ptr<ASTAtomicExpression>>(&value.expression);
+    auto initializer = atomic ? std::get_if<ASTArrayInitializer>(&(*atomic)->value) : nullptr;
+    if (!initializer) {
+        throw GeneratorException("Generation: arrays can only be initialized with array initializers");
+    }
+    size_t element_size = array_type->elementType->get_size_bytes();
+    for (size_t i = 0; i < initializer->initialize_values.size(); ++i) {
+        store_initializer(base, offset + (int64_t)(i * element_size), initializer->initialize_values[i]);
+    }
+}
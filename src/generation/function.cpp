@@ -1,32 +1,85 @@
 #include "generator.hpp"
 
+namespace {
+
+size_t align_up(size_t value, size_t alignment) { return (value + alignment - 1) / alignment * alignment; }
+
+}  // namespace
+
 void Generator::generate_statement_function(const std::shared_ptr<ASTStatementFunction>& function_statement) {
+    // labels are local to the function, so numbering them from 0 keeps the function's assembly independent of
+    // the code before it
+    m_condition_counter = 0;
+    m_registers_used = 0;
+    m_slots.clear();
+    m_function_name = function_statement->name;
+    m_rodata_counter = 0;
+    m_written_names.clear();
+    collect_written_names(*function_statement->statement, m_written_names);
     m_stack.enterScope();
-    // add function parameters to scope
-    for (auto& func_param : function_statement->parameters) {
+
+    // the parameters passed in registers are stored in the first slots, the rest are used where the caller pushed
+    // them- from the last, right above the return address
+    size_t offset = 0;
+    size_t frame_size = 0;
+    std::stringstream parameters;
+    for (size_t i = 0; i < function_statement->parameters.size(); ++i) {
+        auto& func_param = function_statement->parameters[i];
         size_t size_bytes = func_param.data_type->get_size_bytes();
         Generator::Variable var{
-            .stack_location_bytes = m_stack_size,
+            .frame_offset = 16 + 8 * ((int64_t)i - (int64_t)argument_registers.size()),
+            .symbol = "",
             .size_bytes = size_bytes,
             .data_type = func_param.data_type,
         };
+        if (i < argument_registers.size()) {
+            offset = align_up(offset + size_bytes, alignment_of(func_param.data_type));
+            var.frame_offset = -(int64_t)offset;
+            parameters << "\tmov " << memory_address("rbp", var.frame_offset) << ", "
+                       << argument_registers[i].at(size_bytes) << std::endl;
+        }
         m_stack.insert(func_param.name, var);
-        m_stack_size += size_bytes;
     }
-    m_stack_size += 8;  // return address pushed by 'call'
+    frame_size = offset;
+    layout_statement(*function_statement->statement, offset, frame_size);
+
+    // the body comes first, to find the callee-saved registers it uses. they're kept in slots below the variables'
+    std::stringstream body;
+    m_generated.swap(body);
+    generate_statement(*function_statement->statement);
+    m_generated.swap(body);
 
+    std::vector<std::string> saved;
+    for (size_t i = 0; i < m_registers_used; ++i) {
+        if (callee_saved_registers.count(expression_registers[i].at(8))) {
+            saved.push_back(expression_registers[i].at(8));
+        }
+    }
+    // 'call' pushed the return address, and pushing rbp keeps rsp 16 byte aligned
+    size_t frame_bytes = align_up(frame_size + 8 * saved.size(), 16);
     m_generated << std::endl << "; BEGIN OF FUNCTION '" << function_statement->name << "'" << std::endl;
     m_generated << function_statement->name << ":" << std::endl;
-    push_stack_register("rbp", 8);                 // store the previous stack frame
+    m_generated << "\tpush rbp" << std::endl;      // store the previous stack frame
     m_generated << "\tmov rbp, rsp" << std::endl;  // this is the current stack frame
-    generate_statement(*function_statement->statement);
+    if (frame_bytes > 0) {
+        m_generated << "\tsub rsp, " << frame_bytes << std::endl;
+    }
+    for (size_t i = 0; i < saved.size(); ++i) {
+        m_generated << "\tmov [rbp-" << frame_size + 8 * (i + 1) << "], " << saved[i] << std::endl;
+    }
+    m_generated << parameters.str();
+    m_generated << body.str();
     m_generated << ".return:" << std::endl;
+    for (size_t i = 0; i < saved.size(); ++i) {
+        m_generated << "\tmov " << saved[i] << ", [rbp-" << frame_size + 8 * (i + 1) << "]" << std::endl;
+    }
     m_generated << "\tmov rsp, rbp" << std::endl;  // return the stack to its previous state
-    pop_stack_register("rbp", 8, 8);               // restore the previous stack frame
+    m_generated << "\tpop rbp" << std::endl;       // restore the previous stack frame
     m_generated << "\tret" << std::endl;
-    m_generated << "; END OF FUNCTION '" << function_statement->name << "'" << std::endl << std::endl;
+    m_generated << "; END OF FUNCTION '" << function_statement->name << "'" << std::endl;
+    generate_rodata();
+    m_generated << std::endl;
 
-    m_stack_size -= 8;  // return address popped by 'ret'
     m_stack.exitScope();
 }
 
@@ -34,52 +87,77 @@ void Generator::generate_statement_return(const std::shared_ptr<ASTStatementRetu
     m_generated << "; BEGIN RETURN STATEMENT" << std::endl;
     if (return_statement->expression.has_value()) {
         auto& expression = return_statement->expression.value();
-        generate_expression(expression);
         size_t return_size_bytes = expression.data_type->get_size_bytes();
+        evaluate_expression(expression, 0);
         if (return_size_bytes > 0) {
-            auto& reg = size_bytes_to_register.at(return_size_bytes);
-
             // NOTE: this only works for primitives for now
-            pop_stack_register(reg, return_size_bytes, return_size_bytes);
-            m_generated << "\tmov [rdi], " << reg << std::endl;
+            m_generated << "\tmov rax, " << register_name(0, 8) << std::endl;
         }
     }
     m_generated << "\tjmp .return" << std::endl;
     m_generated << "; END RETURN STATEMENT" << std::endl;
 }
 
-void Generator::generate_expression_function_call(const ASTFunctionCall& function_call_expr, size_t return_size_bytes) {
-    size_t return_type_size = function_call_expr.return_data_type->get_size_bytes();
-    if (return_type_size) {
-        m_generated << "; BEGIN PREPARE RETURN LOCATION INTO RDI" << std::endl;
-        push_stack_register("rdi", 8);
-        m_generated << "\tsub rsp, " << return_type_size << std::endl;  // allocate stack for return param
-        m_generated << "\tlea rdi, [rsp]" << std::endl;                 // return data location
-        m_stack_size += return_type_size;
-        m_generated << "; END PREPARE RETURN LOCATION INTO RDI" << std::endl;
+void Generator::generate_expression_function_call(const ASTFunctionCall& function_call_expr, size_t return_size_bytes,
+                                                  size_t first) {
+    // the registers below 'first' hold operands of the enclosing expression- the callee keeps the callee-saved ones,
+    // and the arguments are evaluated above them
+    std::vector<size_t> saved;
+    for (size_t i = 0; i < first; ++i) {
+        if (!callee_saved_registers.count(expression_registers[i].at(8))) {
+            push_stack_register(register_name(i, 8), 8);
+            saved.push_back(i);
+        }
     }
-    // push parameters to the stack before calling
+
     m_generated << "; BEGIN OF FUNCTION PARAMATERS FOR " << function_call_expr.function_name << std::endl;
-    size_t total_function_params_size = 0;
-    for (auto& func_param : function_call_expr.parameters) {
-        generate_expression(func_param);
-        total_function_params_size += func_param.data_type->get_size_bytes();
-    };
+    auto& parameters = function_call_expr.parameters;
+    size_t register_parameters = std::min(parameters.size(), argument_registers.size());
+    size_t stack_parameters_size = 8 * (parameters.size() - register_parameters);
+    // the frame keeps rsp 16 byte aligned, so an odd number of qwords pushed for the call is evened out
+    size_t padding = (m_pushed_size + stack_parameters_size) % 16;
+    if (stack_parameters_size + padding > 0) {
+        m_generated << "\tsub rsp, " << stack_parameters_size + padding << std::endl;
+        m_pushed_size += stack_parameters_size + padding;
+    }
+    size_t stack_parameters_location = m_pushed_size;
+    // evaluated in order. the register arguments wait on the stack, since evaluating the ones after may take their
+    // registers- all but the last one, when it's the last argument
+    for (size_t i = 0; i < parameters.size(); ++i) {
+        evaluate_expression(parameters[i], first);
+        std::string value = register_name(first, 8);
+        if (i >= register_parameters) {
+            size_t offset = m_pushed_size - stack_parameters_location + 8 * (i - register_parameters);
+            m_generated << "\tmov [rsp+" << offset << "], " << value << std::endl;
+        } else if (i + 1 == parameters.size()) {
+            if (value != argument_registers[i].at(8)) {
+                m_generated << "\tmov " << argument_registers[i].at(8) << ", " << value << std::endl;
+            }
+        } else {
+            push_stack_register(value, 8);
+        }
+    }
+    for (size_t i = register_parameters; i-- > 0;) {
+        if (i + 1 != parameters.size()) {
+            pop_stack_register(argument_registers[i].at(8), 8, 8);
+        }
+    }
     m_generated << "; END OF FUNCTION PARAMATERS FOR " << function_call_expr.function_name << std::endl;
 
     m_generated << "\tcall " << function_call_expr.function_name << std::endl;
-    m_generated << "\tadd rsp, " << total_function_params_size << "; CLEAR FUNCTION PARAMATERS FOR "
-                << function_call_expr.function_name << std::endl;  // clear stack params
-    if (return_type_size) {
-        pop_stack_register("rax", 8, return_type_size);
-        pop_stack_register("rdi", 8, 8);
-        if (return_size_bytes) {
-            // if should store return value on the stack
-            std::string& reg = size_bytes_to_register.at(return_size_bytes);
-            push_stack_register(reg, return_size_bytes);
+    if (stack_parameters_size + padding > 0) {
+        m_generated << "\tadd rsp, " << stack_parameters_size + padding << "; CLEAR FUNCTION PARAMATERS FOR "
+                    << function_call_expr.function_name << std::endl;
+        m_pushed_size -= stack_parameters_size + padding;
+    }
+    size_t return_type_size = function_call_expr.return_data_type->get_size_bytes();
+    if (return_type_size > 0 && return_size_bytes > 0) {
+        m_generated << "\tmov " << register_name(first, 8) << ", rax" << std::endl;
+        if (return_size_bytes < return_type_size) {
+            truncate_register(first, return_size_bytes);
         }
-    } else {
-        pop_stack_register("rdi", 8, 8);
     }
-    m_stack_size -= total_function_params_size;
+    for (auto i = saved.rbegin(); i != saved.rend(); ++i) {
+        pop_stack_register(register_name(*i, 8), 8, 8);
+    }
 }
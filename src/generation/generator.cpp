@@ -1,32 +1,74 @@
 #include "generator.hpp"
 
-std::map<size_t, std::string> size_bytes_to_size_keyword = {
+const std::map<size_t, std::string> size_bytes_to_size_keyword = {
     {1, "BYTE"},
     {2, "WORD"},
+    {4, "DWORD"},
     {8, "QWORD"},
 };
 
-std::map<size_t, std::string> size_bytes_to_register = {
+const std::map<size_t, std::string> size_bytes_to_register = {
     {1, "al"},
     {2, "ax"},
     // {4, "eax"},
     {8, "rax"},
 };
 
-std::map<BinOperation, std::string> comparison_operation = {
+const std::vector<std::map<size_t, std::string>> expression_registers = {
+    {{1, "sil"}, {2, "si"}, {4, "esi"}, {8, "rsi"}},        {{1, "dil"}, {2, "di"}, {4, "edi"}, {8, "rdi"}},
+    {{1, "r8b"}, {2, "r8w"}, {4, "r8d"}, {8, "r8"}},        {{1, "r9b"}, {2, "r9w"}, {4, "r9d"}, {8, "r9"}},
+    {{1, "r10b"}, {2, "r10w"}, {4, "r10d"}, {8, "r10"}},    {{1, "bl"}, {2, "bx"}, {4, "ebx"}, {8, "rbx"}},
+    {{1, "r12b"}, {2, "r12w"}, {4, "r12d"}, {8, "r12"}},    {{1, "r13b"}, {2, "r13w"}, {4, "r13d"}, {8, "r13"}},
+    {{1, "r14b"}, {2, "r14w"}, {4, "r14d"}, {8, "r14"}},    {{1, "r15b"}, {2, "r15w"}, {4, "r15d"}, {8, "r15"}},
+    {{1, "cl"}, {2, "cx"}, {4, "ecx"}, {8, "rcx"}},
+};
+
+const std::vector<std::map<size_t, std::string>> argument_registers = {
+    {{1, "dil"}, {2, "di"}, {4, "edi"}, {8, "rdi"}}, {{1, "sil"}, {2, "si"}, {4, "esi"}, {8, "rsi"}},
+    {{1, "dl"}, {2, "dx"}, {4, "edx"}, {8, "rdx"}},  {{1, "cl"}, {2, "cx"}, {4, "ecx"}, {8, "rcx"}},
+    {{1, "r8b"}, {2, "r8w"}, {4, "r8d"}, {8, "r8"}}, {{1, "r9b"}, {2, "r9w"}, {4, "r9d"}, {8, "r9"}},
+};
+
+const std::set<std::string> callee_saved_registers = {"rbx", "r12", "r13", "r14", "r15"};
+
+const std::map<BinOperation, std::string> comparison_operation = {
     {BinOperation::eq, "sete"}, {BinOperation::lt, "setl"},  {BinOperation::le, "setle"},
     {BinOperation::gt, "setg"}, {BinOperation::ge, "setge"},
 };
 
 std::string Generator::generate_program() {
-    m_generated << "section .bss" << std::endl
-                << "\tglobal_variables_base resq 1" << std::endl
-                << "section .text" << std::endl
+    m_function_name = "main";
+    // globals may be written by any function
+    for (auto& statement : m_prog.statements) {
+        collect_written_names(*statement, m_written_names);
+    }
+    for (auto& function : m_prog.functions) {
+        collect_written_names(*function->statement, m_written_names);
+    }
+    size_t offset = 0;
+    size_t frame_size = 0;
+    std::stringstream data;
+    std::stringstream bss;
+    for (auto& statement : m_prog.statements) {
+        layout_global_statement(*statement, offset, frame_size, data, bss);
+    }
+    if (!data.str().empty()) {
+        m_generated << "section .data" << std::endl << data.str();
+    }
+    if (!bss.str().empty()) {
+        m_generated << "section .bss" << std::endl << bss.str();
+    }
+    m_generated << "section .text" << std::endl
                 << "\tglobal main" << std::endl
                 << "main:" << std::endl
-                << "\tmov rbp, rsp" << std::endl
-                << "\tmov [global_variables_base], rbp" << std::endl
-                << std::endl;
+                << "\tmov rbp, rsp" << std::endl;
+
+    // the process starts with rsp 16 byte aligned, as calls expect it
+    size_t frame_bytes = (frame_size + 15) / 16 * 16;
+    if (frame_bytes > 0) {
+        m_generated << "\tsub rsp, " << frame_bytes << std::endl;
+    }
+    m_generated << std::endl;
 
     m_stack.enterScope();
     // generate all statements
@@ -40,11 +82,25 @@ std::string Generator::generate_program() {
     m_generated << "\tmov rax, 60" << std::endl;
     m_generated << "\tmov rdi, 0; status code 0- OK" << std::endl;
     m_generated << "\tsyscall" << std::endl;
+    generate_rodata();
 
     // generate all functions at the end of the file
     for (size_t i = 0; i < m_prog.functions.size(); ++i) {
         auto& current = m_prog.functions[i];
+        auto reused = m_reused_functions.find(current->name);
+        if (reused != m_reused_functions.end()) {
+            m_function_asm[current->name] = reused->second;
+            m_generated << reused->second;
+            continue;
+        }
+        // generated on its own, so the function's assembly can be reused by later compilations
+        std::stringstream program;
+        m_generated.swap(program);
         generate_statement_function(current);
+        std::string function_asm = m_generated.str();
+        m_generated.swap(program);
+        m_generated << function_asm;
+        m_function_asm[current->name] = std::move(function_asm);
     }
     m_stack.exitScope();
 
@@ -6,32 +6,28 @@ void Generator::generate_statement(const ASTStatement& statement) {
 }
 
 void Generator::generate_statement_exit(const std::shared_ptr<ASTStatementExit>& exit_statement) {
-    generate_expression(exit_statement->status_code);
+    evaluate_expression(exit_statement->status_code, 0);
     m_generated << ";\tExit Statement" << std::endl;
     m_generated << "\tmov rax, 60" << std::endl;
-
-    size_t size = exit_statement->status_code.data_type->get_size_bytes();
-    pop_stack_register("rdi", 8, size);
+    m_generated << "\tmov rdi, " << register_name(0, 8) << std::endl;
     m_generated << "\tsyscall" << std::endl;
 }
 
 void Generator::generate_statement_var_assignment(const std::shared_ptr<ASTStatementAssign>& var_assign_statement) {
     m_generated << ";\tVariable Assigment BEGIN" << std::endl;
 
-    size_t expression_size_bytes = var_assign_statement->value.data_type->get_size_bytes();
-    size_t lhs_size_bytes = var_assign_statement->lhs->data_type->get_size_bytes();
-    std::string& temp_register = size_bytes_to_register.at(lhs_size_bytes);
-
-    generate_expression(var_assign_statement->value);
-    load_memory_address_expr(*var_assign_statement->lhs);
-
-    pop_stack_register("rdx", 8, 8);  // memory address is always 8 bytes
+    auto& lhs = *var_assign_statement->lhs;
+    auto& value = var_assign_statement->value;
+    size_t lhs_size_bytes = lhs.data_type->get_size_bytes();
 
-    // NOTE: assumes 'size_bytes_to_register' holds registers rax, eax, ax, al
-    // popping to the largest register to allow data widening if necessary, up to 8 bytes
-    pop_stack_register("rax", 8, expression_size_bytes);
+    // the value first- around calls, its side effects come before the address's, as in the IR backend
+    auto [value_register, address] = evaluate_operands(
+        [&](size_t index) { evaluate_expression(value, index); }, register_need(value),
+        [&](size_t index) { load_memory_address_expr(lhs, index); }, address_register_need(lhs),
+        has_call(lhs) || has_call(value), 0);
 
-    m_generated << "\tmov [rdx], " << temp_register << std::endl;
+    m_generated << "\tmov [" << register_name(address, 8) << "], " << register_name(value_register, lhs_size_bytes)
+                << std::endl;
     m_generated << ";\tVariable Assigment END" << std::endl << std::endl;
 }
 
@@ -39,27 +35,39 @@ void Generator::generate_statement_var_declare(const std::shared_ptr<ASTStatemen
     // no need to check for duplicate variable names, since it was checked in semantic analysis
     size_t size_bytes = var_statement->data_type->get_size_bytes();
 
+    bool is_global = m_globals.count(var_statement.get()) > 0;
+    bool is_array = (bool)(dynamic_cast<ArrayType*>(var_statement->data_type.get()));
+    bool is_read_only = is_read_only_array(*var_statement);
     Generator::Variable var = {
-        .stack_location_bytes = m_stack_size,
+        .frame_offset = is_global || is_read_only ? 0 : -(int64_t)m_slots.at(var_statement.get()),
+        .symbol = is_global ? global_symbol(var_statement->name) : "",
         .size_bytes = size_bytes,
         .data_type = var_statement->data_type,
     };
+    std::string base = is_global ? "rel " + var.symbol : "rbp";
     m_generated << ";\tVariable Declaration " << var_statement->name << " BEGIN" << std::endl;
+    // NOTE: the value is evaluated before the variable exists
     if (var_statement->value.has_value()) {
-        generate_expression(var_statement->value.value());
+        auto& value = var_statement->value.value();
+        if (is_global && constant_initializer(value)) {
+            // already in .data, or .rodata
+        } else if (is_read_only) {
+            var.symbol = rodata_initializer(*var_statement);
+        } else if (is_array && constant_initializer(value)) {
+            copy_from_rodata(rodata_initializer(*var_statement), var.frame_offset, size_bytes);
+        } else {
+            store_initializer(base, var.frame_offset, value);
+        }
     } else {
-        m_generated << "\tsub rsp, " << size_bytes << std::endl;
-        // allocate stack initializing to 0
-        auto is_array = (bool)(dynamic_cast<ArrayType*>(var_statement->data_type.get()));
-        if (is_array) {
+        // .bss is zeroed already
+        if (is_array && !is_global) {
             // TODO: should probably only do this if the array doesnt get initialized with a value
             m_generated << "\t; Initialize Arrays To 0" << std::endl
                         << "\tmov rcx, " << size_bytes << std::endl
-                        << "\tmov rdi, rsp" << std::endl
-                        << "\tmov rax, 0" << std::endl
+                        << "\tlea rdi, " << memory_address(base, var.frame_offset) << std::endl
+                        << "\txor eax, eax" << std::endl
                         << "\trep stosb" << std::endl;
         }
-        m_stack_size += size_bytes;
     }
 
     m_stack.insert(var_statement->name, var);
@@ -84,10 +92,8 @@ void Generator::generate_statement_if(const std::shared_ptr<ASTStatementIf>& if_
     auto& expression = if_statement->expression;
     auto& success_statement = if_statement->success_statement;
     auto& fail_statement = if_statement->fail_statement;
-    size_t size_bytes = expression.data_type->get_size_bytes();
-    generate_expression(expression);
-    pop_stack_register("rax", 8, size_bytes);  // rax = lhs
-    m_generated << "\ttest rax, rax" << std::endl
+    evaluate_expression(expression, 0);
+    m_generated << "\ttest " << register_name(0, 8) << ", " << register_name(0, 8) << std::endl
                 << "\tjz " << after_if_label.str() << "; if the expression is false-y, skip the 'if' block's statements"
                 << std::endl;
     generate_statement(*success_statement);
@@ -113,12 +119,10 @@ void Generator::generate_statement_while(const std::shared_ptr<ASTStatementWhile
 
     auto& expression = while_statement->expression;
     auto& success_statement = while_statement->success_statement;
-    size_t size_bytes = expression.data_type->get_size_bytes();
 
     m_generated << before_while_label.str() << ":" << std::endl;
-    generate_expression(expression);
-    pop_stack_register("rax", 8, size_bytes);  // rax = lhs
-    m_generated << "\ttest rax, rax" << std::endl
+    evaluate_expression(expression, 0);
+    m_generated << "\ttest " << register_name(0, 8) << ", " << register_name(0, 8) << std::endl
                 << "\tjz " << after_while_label.str()
                 << "; if the expression is false-y, skip the 'while' block's statements" << std::endl;
     generate_statement(*success_statement);
@@ -1,50 +1,114 @@
 #include "generator.hpp"
 
-void Generator::load_memory_address_var(const ASTIdentifier& identifier) {
+#include "strength_reduction.hpp"
+
+std::string Generator::variable_address(const ASTIdentifier& identifier) {
     auto& variable_name = identifier.value;
     auto variable_data = assert_get_variable_data(variable_name);
 
-    bool is_global = m_stack.is_variable_global(variable_name);
+    if (!variable_data.symbol.empty()) {
+        // by symbol, so the code of functions doesn't depend on the layout of the globals
+        return memory_address("rel " + variable_data.symbol, 0);
+    }
+    return memory_address("rbp", variable_data.frame_offset);
+}
 
-    int offset = variable_data.stack_location_bytes + variable_data.size_bytes;
+std::string Generator::register_name(size_t index, size_t size_bytes) {
+    m_registers_used = std::max(m_registers_used, index + 1);
+    return expression_registers.at(index).at(size_bytes);
+}
+
+void Generator::truncate_register(size_t index, size_t size_bytes) {
+    switch (size_bytes) {
+        case 1:
+        case 2:
+            m_generated << "\tmovzx " << register_name(index, 4) << ", " << register_name(index, size_bytes)
+                        << std::endl;
+            break;
+        case 4:
+            // writing a 32 bit register clears the upper half
+            m_generated << "\tmov " << register_name(index, 4) << ", " << register_name(index, 4) << std::endl;
+            break;
+        default:
+            break;
+    }
+}
 
-    m_generated << "\t; Load Memory Address Of " << variable_name << std::endl;
-    if (is_global) {
-        m_generated << "\tmov r11, " << "[global_variables_base]" << std::endl;
-        m_generated << "\tsub r11, " << offset << std::endl;
-        ;
+void Generator::load_register(size_t index, size_t size_bytes, const std::string& address) {
+    std::string size_keyword = size_bytes_to_size_keyword.at(size_bytes);
+    if (size_bytes < 4) {
+        m_generated << "\tmovzx " << register_name(index, 4) << ", " << size_keyword << " " << address << std::endl;
     } else {
-        offset = m_stack_size - offset;
-        m_generated << "\tmov r11, " << "rsp" << std::endl;
-        m_generated << "\tadd r11, " << offset << std::endl;
+        m_generated << "\tmov " << register_name(index, size_bytes) << ", " << size_keyword << " " << address
+                    << std::endl;
     }
-    push_stack_register("r11", 8);
-    m_generated << "\t; End Load Memory Address Of " << variable_name << std::endl;
+}
+
+void Generator::load_constant(size_t index, uint64_t value, size_t size_bytes) {
+    if (size_bytes < 8) {
+        value &= (1ull << (size_bytes * 8)) - 1;
+    }
+    if (value == 0) {
+        m_generated << "\txor " << register_name(index, 4) << ", " << register_name(index, 4) << std::endl;
+    } else {
+        m_generated << "\tmov " << register_name(index, 8) << ", " << value << std::endl;
+    }
+}
+
+std::string Generator::indexed_address(const std::string& base, const std::string& index, size_t element_size) {
+    if (is_address_scale(element_size)) {
+        return "[" + base + "+" + index + "*" + std::to_string(element_size) + "]";
+    }
+    m_generated << "\timul " << index << ", " << index << ", " << element_size << std::endl;
+    return "[" + base + "+" + index + "]";
+}
+
+std::optional<uint64_t> Generator::constant_value(const ASTExpression& expression) {
+    // parentheses around a literal are looked through. only the outermost expression is typed
+    const ASTExpression* inner = &expression;
+    const std::shared_ptr<ASTAtomicExpression>* atomic;
+    while ((atomic = std::get_if<std::shared_ptr<ASTAtomicExpression>>(&inner->expression))) {
+        auto parenthesis = std::get_if<ASTParenthesisExpression>(&(*atomic)->value);
+        if (!parenthesis) {
+            break;
+        }
+        inner = parenthesis->expression.get();
+    }
+    if (!atomic || !expression.data_type) {
+        return std::nullopt;
+    }
+    uint64_t value;
+    if (auto literal = std::get_if<ASTIntLiteral>(&(*atomic)->value)) {
+        value = parse_int_literal(literal->value);
+    } else if (auto literal = std::get_if<ASTCharLiteral>(&(*atomic)->value)) {
+        value = (uint64_t)(int64_t)literal->value;
+    } else {
+        return std::nullopt;
+    }
+    // the literal is pushed at the expression's size, and read back zero-extended
+    size_t size_bytes = expression.data_type->get_size_bytes();
+    return size_bytes >= 8 ? value : value & ((1ull << (size_bytes * 8)) - 1);
+}
+
+std::string Generator::global_symbol(const std::string& variable_name) {
+    return "global_variable." + variable_name;
 }
 
 Generator::Variable Generator::assert_get_variable_data(std::string variable_name) {
     Generator::Variable* variableData = nullptr;
     if (!m_stack.lookup(variable_name, &variableData)) {
-        std::cerr << "Variable '" << variable_name << "' does not exist!" << std::endl;
-        exit(EXIT_FAILURE);
+        throw GeneratorException("Variable '" + variable_name + "' does not exist!");
     }
     return *variableData;
 }
 
 void Generator::enter_scope() { m_stack.enterScope(); }
 void Generator::exit_scope() {
-    std::optional<std::map<std::string, Generator::Variable>> scope = m_stack.exitScope();
-    if (!scope.has_value()) {
+    // the slots of the scope's variables are left for the next ones, nothing is freed
+    if (!m_stack.exitScope().has_value()) {
         // should never happen
-        std::cerr << "exited a non-existing scope" << std::endl;
-        exit(EXIT_FAILURE);
-    }
-    int totalStackSpace = 0;
-    for (auto& pair : scope.value()) {
-        totalStackSpace += pair.second.size_bytes;
+        throw GeneratorException("exited a non-existing scope");
     }
-    m_stack_size -= totalStackSpace;
-    m_generated << "\tadd rsp, " << totalStackSpace << "; END OF SCOPE" << std::endl;
 }
 
 void Generator::push_stack_literal(const std::string& value, size_t size) {
@@ -54,16 +118,18 @@ void Generator::push_stack_literal(const std::string& value, size_t size) {
         std::string size_keyword = size_bytes_to_size_keyword.at(size);
         m_generated << "\tpush " << size_keyword << " " << value << std::endl;
     }
-    m_stack_size += size;
+    m_pushed_size += size;
 }
 
 void Generator::push_stack_register(const std::string& reg, size_t size) {
-    if (size == 1) {
-        m_generated << "\tsub rsp, 1" << std::endl << "\tmov byte [rsp], " << reg << std::endl;
+    // there's no push of a byte or a dword register
+    if (size == 1 || size == 4) {
+        m_generated << "\tsub rsp, " << size << std::endl
+                    << "\tmov " << size_bytes_to_size_keyword.at(size) << " [rsp], " << reg << std::endl;
     } else {
         m_generated << "\tpush " << reg << std::endl;
     }
-    m_stack_size += size;
+    m_pushed_size += size;
 }
 
 void Generator::pop_stack_register(const std::string& reg, size_t register_size, size_t requested_size) {
@@ -78,5 +144,5 @@ void Generator::pop_stack_register(const std::string& reg, size_t register_size,
         m_generated << "\tadd rsp, " << requested_size << std::endl;
         m_generated << ";\tManual POP END" << std::endl;
     }
-    m_stack_size -= requested_size;
+    m_pushed_size -= requested_size;
 }
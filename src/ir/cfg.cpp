@@ -0,0 +1,191 @@
+#include "ir/ir_cfg.hpp"
+
+#include <algorithm>
+#include <optional>
+#include <set>
+
+std::vector<std::vector<IRBlockId>> ir_predecessors(const IRFunction& function) {
+    std::vector<std::vector<IRBlockId>> predecessors(function.next_block_id);
+    for (auto& block : function.blocks) {
+        for (auto successor : block.successors()) {
+            predecessors.at(successor).push_back(block.id);
+        }
+    }
+    return predecessors;
+}
+
+std::vector<IRBlockId> ir_reverse_post_order(const IRFunction& function) {
+    std::vector<IRBlockId> post_order;
+    if (function.blocks.empty()) {
+        return post_order;
+    }
+    std::vector<const IRBasicBlock*> blocks(function.next_block_id, nullptr);
+    for (auto& block : function.blocks) {
+        blocks.at(block.id) = &block;
+    }
+    // iterative depth first search- deep nesting must not overflow the native stack
+    std::vector<bool> visited(function.next_block_id, false);
+    std::vector<std::pair<IRBlockId, std::vector<IRBlockId>>> stack;
+    IRBlockId entry = function.blocks.front().id;
+    visited[entry] = true;
+    stack.push_back({entry, blocks[entry]->successors()});
+    while (!stack.empty()) {
+        auto& [block, successors] = stack.back();
+        if (successors.empty()) {
+            post_order.push_back(block);
+            stack.pop_back();
+            continue;
+        }
+        IRBlockId successor = successors.front();
+        successors.erase(successors.begin());
+        if (!visited.at(successor) && blocks.at(successor)) {
+            visited[successor] = true;
+            stack.push_back({successor, blocks[successor]->successors()});
+        }
+    }
+    std::reverse(post_order.begin(), post_order.end());
+    return post_order;
+}
+
+IRDominatorTree::IRDominatorTree(const IRFunction& function)
+    : m_order_index(function.next_block_id, UNREACHABLE),
+      m_order(ir_reverse_post_order(function)),
+      m_immediate_dominator(function.next_block_id, 0),
+      m_children(function.next_block_id) {
+    // "A Simple, Fast Dominance Algorithm"- Cooper, Harvey and Kennedy
+    for (size_t i = 0; i < m_order.size(); ++i) {
+        m_order_index[m_order[i]] = i;
+    }
+    if (m_order.empty()) {
+        return;
+    }
+    auto predecessors = ir_predecessors(function);
+    std::vector<bool> processed(function.next_block_id, false);
+    IRBlockId entry = m_order.front();
+    m_immediate_dominator[entry] = entry;
+    processed[entry] = true;
+
+    auto intersect = [this](IRBlockId a, IRBlockId b) {
+        while (a != b) {
+            while (m_order_index[a] > m_order_index[b]) {
+                a = m_immediate_dominator[a];
+            }
+            while (m_order_index[b] > m_order_index[a]) {
+                b = m_immediate_dominator[b];
+            }
+        }
+        return a;
+    };
+
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (size_t i = 1; i < m_order.size(); ++i) {
+            IRBlockId block = m_order[i];
+            std::optional<IRBlockId> new_dominator;
+            for (auto predecessor : predecessors[block]) {
+                if (!processed[predecessor]) {
+                    continue;
+                }
+                new_dominator = new_dominator ? intersect(predecessor, *new_dominator) : predecessor;
+            }
+            if (new_dominator && (!processed[block] || m_immediate_dominator[block] != *new_dominator)) {
+                m_immediate_dominator[block] = *new_dominator;
+                processed[block] = true;
+                changed = true;
+            }
+        }
+    }
+    for (size_t i = 1; i < m_order.size(); ++i) {
+        m_children[m_immediate_dominator[m_order[i]]].push_back(m_order[i]);
+    }
+}
+
+bool IRDominatorTree::is_reachable(IRBlockId block) const {
+    return block < m_order_index.size() && m_order_index[block] != UNREACHABLE;
+}
+
+bool IRDominatorTree::dominates(IRBlockId dominator, IRBlockId block) const {
+    if (!is_reachable(dominator) || !is_reachable(block)) {
+        return false;
+    }
+    // dominators come first in reverse post-order, so climbing stops once we pass it
+    while (m_order_index[block] > m_order_index[dominator]) {
+        block = m_immediate_dominator[block];
+    }
+    return block == dominator;
+}
+
+IRBlockId IRDominatorTree::immediate_dominator(IRBlockId block) const { return m_immediate_dominator.at(block); }
+
+const std::vector<IRBlockId>& IRDominatorTree::children(IRBlockId block) const { return m_children.at(block); }
+
+std::map<IRValueId, IRBlockId> ir_definition_blocks(const IRFunction& function) {
+    std::map<IRValueId, IRBlockId> definitions;
+    for (auto& block : function.blocks) {
+        for (auto& instruction : block.instructions) {
+            if (instruction.has_result()) {
+                definitions[instruction.result] = block.id;
+            }
+        }
+    }
+    return definitions;
+}
+
+size_t ir_remove_unreachable_blocks(IRFunction& function) {
+    auto order = ir_reverse_post_order(function);
+    std::set<IRBlockId> reachable(order.begin(), order.end());
+    size_t before = function.blocks.size();
+    function.blocks.erase(std::remove_if(function.blocks.begin(), function.blocks.end(),
+                                         [&](const IRBasicBlock& block) { return !reachable.count(block.id); }),
+                          function.blocks.end());
+    if (function.blocks.size() == before) {
+        return 0;
+    }
+    for (auto& block : function.blocks) {
+        for (auto& instruction : block.instructions) {
+            if (instruction.opcode != IROpcode::Phi) {
+                continue;
+            }
+            for (size_t i = instruction.blocks.size(); i-- > 0;) {
+                if (!reachable.count(instruction.blocks[i])) {
+                    instruction.blocks.erase(instruction.blocks.begin() + i);
+                    instruction.operands.erase(instruction.operands.begin() + i);
+                }
+            }
+        }
+    }
+    return before - function.blocks.size();
+}
+
+void ir_replace_uses(IRFunction& function, IRValueId value, const IROperand& replacement) {
+    for (auto& block : function.blocks) {
+        for (auto& instruction : block.instructions) {
+            for (auto& operand : instruction.operands) {
+                if (operand.is_value() && operand.value == value) {
+                    operand = replacement;
+                }
+            }
+        }
+    }
+}
+
+void ir_replace_uses(IRFunction& function, const std::map<IRValueId, IROperand>& replacements) {
+    if (replacements.empty()) {
+        return;
+    }
+    for (auto& block : function.blocks) {
+        for (auto& instruction : block.instructions) {
+            for (auto& operand : instruction.operands) {
+                // bounded, so a cycle of replacements can't hang the compiler
+                for (size_t depth = 0; operand.is_value() && depth <= replacements.size(); ++depth) {
+                    auto replacement = replacements.find(operand.value);
+                    if (replacement == replacements.end()) {
+                        break;
+                    }
+                    operand = replacement->second;
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,910 @@
+#include "ir/ir_generator.hpp"
+
+#include <algorithm>
+
+#include "ir/ir_memory.hpp"
+#include "strength_reduction.hpp"
+
+namespace {
+
+constexpr IRBlockId NO_BLOCK = (IRBlockId)-1;
+
+const std::map<IROpcode, std::string> comparison_set_instruction = {
+    {IROpcode::CmpEq, "sete"}, {IROpcode::CmpLt, "setl"},  {IROpcode::CmpLe, "setle"},
+    {IROpcode::CmpGt, "setg"}, {IROpcode::CmpGe, "setge"},
+};
+
+// immediates of 64 bit instructions are sign-extended 32 bit numbers
+bool fits_immediate(int64_t value) { return value >= INT32_MIN && value <= INT32_MAX; }
+
+std::string size_keyword(size_t size_bytes) {
+    switch (size_bytes) {
+        case 1:
+            return "BYTE";
+        case 2:
+            return "WORD";
+        case 4:
+            return "DWORD";
+        default:
+            return "QWORD";
+    }
+}
+
+size_t align_up(size_t value, size_t alignment) { return (value + alignment - 1) / alignment * alignment; }
+
+// the SSE2/AVX2 suffix of lanes of the size- paddb, paddw, paddd, paddq
+std::string lane_suffix(int64_t lane_size) {
+    switch (lane_size) {
+        case 1:
+            return "b";
+        case 2:
+            return "w";
+        case 4:
+            return "d";
+        default:
+            return "q";
+    }
+}
+
+}  // namespace
+
+std::string IRGenerator::generate_program() {
+    m_generated << "section .bss" << std::endl;
+    for (auto& global : m_module.globals) {
+        m_generated << global_symbol(global.name) << ": resb " << align_up(std::max<size_t>(global.size_bytes, 1), 8)
+                    << std::endl;
+    }
+    m_generated << "section .text" << std::endl << "\tglobal main" << std::endl;
+
+    // the entry function first, then the rest in order
+    for (auto& function : m_module.functions) {
+        if (function.is_entry) {
+            generate_function(function);
+        }
+    }
+    for (auto& function : m_module.functions) {
+        if (!function.is_entry) {
+            generate_function(function);
+        }
+    }
+    return m_generated.str();
+}
+
+void IRGenerator::layout_frame(const IRFunction& function) {
+    m_slots.clear();
+    m_alloca_offsets.clear();
+    m_saved_offsets.clear();
+    size_t offset = 0;
+    for (auto& block : function.blocks) {
+        for (auto& instruction : block.instructions) {
+            if (instruction.opcode == IROpcode::Alloca) {
+                offset += align_up(instruction.immediate, 8);
+                m_alloca_offsets[instruction.result] = offset;
+            }
+            if (instruction.has_result() && !m_allocation->register_of(instruction.result)) {
+                offset += std::max<size_t>(8, ir_type_size(instruction.type));
+                m_slots[instruction.result] = offset;
+            }
+        }
+    }
+    for (auto reg : m_allocation->used_registers()) {
+        if (ir_is_callee_saved(reg)) {
+            offset += 8;
+            m_saved_offsets[reg] = offset;
+        }
+    }
+    // rsp is 16 byte aligned at calls. a called function starts with it 8 bytes off for the return address, which
+    // pushing rbp makes up for- the entry function starts aligned, as the process does
+    m_frame_size = function.is_entry ? align_up(offset + 8, 16) - 8 : align_up(offset, 16);
+}
+
+void IRGenerator::generate_function(const IRFunction& function) {
+    m_function = &function;
+    m_allocation.emplace(function);
+    layout_frame(function);
+    // a tail call replaces the frame, so nothing may point into it anymore
+    m_tail_calls_allowed = !function.is_entry;
+    IRMemoryObjects objects(function, m_module);
+    for (size_t i = 0; i < objects.size(); ++i) {
+        if (objects.object(i).kind == IRMemoryObject::Kind::Alloca && objects.is_visible(i)) {
+            m_tail_calls_allowed = false;
+        }
+    }
+
+    m_generated << std::endl << "; BEGIN OF FUNCTION '" << function.name << "'" << std::endl;
+    m_generated << function.name << ":" << std::endl;
+    m_generated << "\tpush rbp" << std::endl << "\tmov rbp, rsp" << std::endl;
+    if (m_frame_size > 0) {
+        m_generated << "\tsub rsp, " << m_frame_size << std::endl;
+    }
+    for (auto [reg, offset] : m_saved_offsets) {
+        m_generated << "\tmov [rbp-" << offset << "], " << ir_register_name(reg) << std::endl;
+    }
+    generate_parameters(function);
+    for (size_t i = 0; i < function.blocks.size(); ++i) {
+        auto& block = function.blocks[i];
+        IRBlockId next_block = i + 1 < function.blocks.size() ? function.blocks[i + 1].id : NO_BLOCK;
+        m_generated << block_label(block.id) << ":" << std::endl;
+        for (size_t j = 0; j < block.instructions.size(); ++j) {
+            begin_instruction(block.instructions[j]);
+            if (is_tail_call(block, j)) {
+                generate_tail_call(block.instructions[j]);
+                break;
+            }
+            generate_instruction(block, block.instructions[j], next_block);
+            end_instruction();
+        }
+    }
+    m_generated << "; END OF FUNCTION '" << function.name << "'" << std::endl;
+    m_allocation.reset();
+    m_function = nullptr;
+}
+
+void IRGenerator::generate_instruction(const IRBasicBlock& block, const IRInstruction& instruction,
+                                       IRBlockId next_block) {
+    if (instruction.opcode == IROpcode::Phi || instruction.opcode == IROpcode::Param) {
+        // written by the predecessors, and on entry
+        return;
+    }
+    m_generated << "\t; " << to_string(instruction) << std::endl;
+    if (ir_is_comparison(instruction.opcode)) {
+        generate_comparison(instruction);
+        return;
+    }
+    if (ir_is_binary(instruction.opcode)) {
+        generate_binary(instruction);
+        return;
+    }
+    auto& operands = instruction.operands;
+    switch (instruction.opcode) {
+        case IROpcode::Alloca: {
+            IRRegister result = result_register(instruction);
+            m_generated << "\tlea " << ir_register_name(result) << ", [rbp-"
+                        << m_alloca_offsets.at(instruction.result) << "]" << std::endl;
+            store_result(instruction, result);
+            return;
+        }
+        case IROpcode::GlobalAddr: {
+            IRRegister result = result_register(instruction);
+            m_generated << "\tlea " << ir_register_name(result) << ", [rel " << global_symbol(instruction.symbol)
+                        << "]" << std::endl;
+            store_result(instruction, result);
+            return;
+        }
+        case IROpcode::Load: {
+            // the result's register serves as the address's, when it isn't in one
+            IRRegister result = result_register(instruction);
+            auto address = register_of(operands[0]);
+            if (!address) {
+                load_operand(result, operands[0]);
+                address = result;
+            }
+            std::string from = "[" + ir_register_name(*address) + "]";
+            switch (instruction.type) {
+                case IRType::I8:
+                    m_generated << "\tmovzx " << ir_register_name(result, 4) << ", BYTE " << from << std::endl;
+                    break;
+                case IRType::I16:
+                    m_generated << "\tmovzx " << ir_register_name(result, 4) << ", WORD " << from << std::endl;
+                    break;
+                case IRType::I32:
+                    m_generated << "\tmov " << ir_register_name(result, 4) << ", DWORD " << from << std::endl;
+                    break;
+                default:
+                    m_generated << "\tmov " << ir_register_name(result) << ", QWORD " << from << std::endl;
+                    break;
+            }
+            store_result(instruction, result);
+            return;
+        }
+        case IROpcode::Store:
+            generate_store(instruction);
+            return;
+        case IROpcode::Zero:
+            save_clobbered({IRRegister::RDI, IRRegister::RCX, IRRegister::RAX});
+            load_operand(IRRegister::RDI, operands[0]);
+            m_generated << "\tmov ecx, " << instruction.immediate << std::endl
+                        << "\txor eax, eax" << std::endl
+                        << "\trep stosb" << std::endl;
+            return;
+        case IROpcode::Neg:
+        case IROpcode::ZExt:
+        case IROpcode::Trunc: {
+            IRRegister result = result_register(instruction);
+            load_operand(result, operands[0]);
+            if (instruction.opcode == IROpcode::Neg) {
+                m_generated << "\tneg " << ir_register_name(result) << std::endl;
+            }
+            // values are held zero-extended already
+            if (instruction.opcode != IROpcode::ZExt) {
+                zero_extend(result, instruction.type);
+            }
+            store_result(instruction, result);
+            return;
+        }
+        case IROpcode::Call:
+            generate_call(instruction);
+            return;
+        case IROpcode::Jump:
+            generate_edge(block.id, instruction.blocks[0], next_block);
+            return;
+        case IROpcode::Branch: {
+            IRBlockId on_true = instruction.blocks[0], on_false = instruction.blocks[1];
+            auto& condition = operands[0];
+            if (condition.is_constant()) {
+                generate_edge(block.id, condition.constant != 0 ? on_true : on_false, next_block);
+                return;
+            }
+            auto reg = register_of(condition);
+            if (reg) {
+                m_generated << "\ttest " << ir_register_name(*reg) << ", " << ir_register_name(*reg) << std::endl;
+            } else {
+                m_generated << "\tcmp QWORD " << slot(condition.value) << ", 0" << std::endl;
+            }
+            // an edge copying nothing is a plain jump
+            if (edge_moves(block.id, on_true).empty()) {
+                m_generated << "\tjnz " << block_label(on_true) << std::endl;
+                generate_edge(block.id, on_false, next_block);
+                return;
+            }
+            std::string false_edge = ".edge" + std::to_string(m_edge_counter++);
+            m_generated << "\tjz " << false_edge << std::endl;
+            generate_edge(block.id, on_true, NO_BLOCK);
+            m_generated << false_edge << ":" << std::endl;
+            generate_edge(block.id, on_false, next_block);
+            return;
+        }
+        case IROpcode::Return:
+            if (!operands.empty()) {
+                load_operand(IRRegister::RAX, operands[0]);
+            }
+            generate_return_sequence();
+            m_generated << "\tret" << std::endl;
+            return;
+        case IROpcode::Exit:
+            load_operand(IRRegister::RDI, operands[0]);
+            m_generated << "\tmov rax, 60" << std::endl << "\tsyscall" << std::endl;
+            return;
+        case IROpcode::VectorSplat:
+        case IROpcode::VectorLoad:
+        case IROpcode::VectorStore:
+        case IROpcode::VectorAdd:
+        case IROpcode::VectorSub:
+        case IROpcode::VectorMul:
+        case IROpcode::VectorReduceAdd:
+            generate_vector(instruction);
+            return;
+        default:
+            throw IRException("unexpected instruction '" + to_string(instruction) + "'");
+    }
+}
+
+void IRGenerator::generate_parameters(const IRFunction& function) {
+    auto& arguments = ir_argument_registers();
+    std::vector<std::pair<MoveLocation, MoveLocation>> moves;
+    std::vector<const IRInstruction*> parameters;
+    for (auto& instruction : function.blocks.front().instructions) {
+        if (instruction.opcode != IROpcode::Param) {
+            break;
+        }
+        parameters.push_back(&instruction);
+        if ((size_t)instruction.immediate < arguments.size()) {
+            moves.push_back({instruction.result_operand(), arguments[instruction.immediate]});
+        }
+    }
+    generate_parallel_move(std::move(moves));
+    for (auto parameter : parameters) {
+        auto reg = register_of(parameter->result_operand());
+        std::string to = reg ? ir_register_name(*reg) : "QWORD " + slot(parameter->result);
+        if ((size_t)parameter->immediate >= arguments.size()) {
+            // pushed by the caller from the last, right above the return address
+            std::string from = "[rbp+" + std::to_string(16 + 8 * (parameter->immediate - arguments.size())) + "]";
+            if (reg) {
+                m_generated << "\tmov " << to << ", " << from << std::endl;
+            } else {
+                m_generated << "\tpush QWORD " << from << std::endl << "\tpop " << to << std::endl;
+            }
+        }
+        // values are held zero-extended, while the upper bits of a narrower argument are the caller's to leave
+        // anything in
+        if (reg) {
+            zero_extend(*reg, parameter->type);
+        } else if (ir_type_size(parameter->type) < 4) {
+            m_generated << "\tand " << to << ", " << (1 << 8 * ir_type_size(parameter->type)) - 1 << std::endl;
+        } else if (ir_type_size(parameter->type) == 4) {
+            m_generated << "\tmov DWORD [rbp-" << m_slots.at(parameter->result) - 4 << "], 0" << std::endl;
+        }
+    }
+}
+
+void IRGenerator::generate_return_sequence() {
+    for (auto [reg, offset] : m_saved_offsets) {
+        m_generated << "\tmov " << ir_register_name(reg) << ", [rbp-" << offset << "]" << std::endl;
+    }
+    m_generated << "\tmov rsp, rbp" << std::endl << "\tpop rbp" << std::endl;
+}
+
+void IRGenerator::generate_store(const IRInstruction& instruction) {
+    auto& value = instruction.operands[0];
+    size_t size_bytes = ir_type_size(value.type);
+    std::string to = "[" + ir_register_name(operand_register(instruction.operands[1])) + "]";
+    if (value.is_constant() && (size_bytes < 8 || fits_immediate(value.constant))) {
+        m_generated << "\tmov " << size_keyword(size_bytes) << " " << to << ", " << value.constant << std::endl;
+        return;
+    }
+    std::string from = ir_register_name(operand_register(value), size_bytes);
+    m_generated << "\tmov " << to << ", " << from << std::endl;
+}
+
+void IRGenerator::generate_call(const IRInstruction& call) {
+    std::set<IRRegister> caller_saved;
+    for (auto reg : ir_all_registers()) {
+        if (!ir_is_callee_saved(reg)) {
+            caller_saved.insert(reg);
+        }
+    }
+    save_clobbered(caller_saved);
+    auto& arguments = ir_argument_registers();
+    size_t stack_arguments = call.operands.size() > arguments.size() ? call.operands.size() - arguments.size() : 0;
+    // the frame keeps rsp aligned, so an odd number of qwords pushed for the call is evened out
+    size_t padding = (m_pushed.size() + stack_arguments) % 2 * 8;
+    if (padding > 0) {
+        m_generated << "\tsub rsp, " << padding << std::endl;
+    }
+    for (size_t i = call.operands.size(); i-- > arguments.size();) {
+        push_operand(call.operands[i]);
+    }
+    std::vector<std::pair<MoveLocation, MoveLocation>> moves;
+    for (size_t i = 0; i < call.operands.size() && i < arguments.size(); ++i) {
+        moves.push_back({arguments[i], call.operands[i]});
+    }
+    generate_parallel_move(std::move(moves));
+    m_generated << "\tcall " << call.symbol << std::endl;
+    if (8 * stack_arguments + padding > 0) {
+        m_generated << "\tadd rsp, " << 8 * stack_arguments + padding << std::endl;
+    }
+    if (call.has_result()) {
+        store_result(call, IRRegister::RAX);
+    }
+}
+
+bool IRGenerator::is_tail_call(const IRBasicBlock& block, size_t index) const {
+    auto& call = block.instructions[index];
+    if (!m_tail_calls_allowed || call.opcode != IROpcode::Call || index + 2 != block.instructions.size()) {
+        return false;
+    }
+    auto& return_instruction = block.instructions[index + 1];
+    if (return_instruction.opcode != IROpcode::Return) {
+        return false;
+    }
+    bool returns_result = return_instruction.operands.empty() ||
+                          (call.has_result() && return_instruction.operands[0] == call.result_operand());
+    // the caller pops as many arguments as it pushed for this function, so the callee may take up to as many on the
+    // stack
+    auto stack_arguments = [](size_t count) {
+        size_t registers = ir_argument_registers().size();
+        return count > registers ? count - registers : 0;
+    };
+    return returns_result &&
+           stack_arguments(call.operands.size()) <= stack_arguments(m_function->parameter_types.size());
+}
+
+void IRGenerator::generate_tail_call(const IRInstruction& call) {
+    m_generated << "	; tail " << to_string(call) << std::endl;
+    // the stack arguments overwrite the stack parameters- where the callee expects them, right above the return
+    // address. the parameters were moved out on entry
+    auto& arguments = ir_argument_registers();
+    for (size_t i = arguments.size(); i < call.operands.size(); ++i) {
+        push_operand(call.operands[i]);
+    }
+    for (size_t i = call.operands.size(); i-- > arguments.size();) {
+        m_generated << "\tpop QWORD [rbp+" << 16 + 8 * (i - arguments.size()) << "]" << std::endl;
+    }
+    std::vector<std::pair<MoveLocation, MoveLocation>> moves;
+    for (size_t i = 0; i < call.operands.size() && i < arguments.size(); ++i) {
+        moves.push_back({arguments[i], call.operands[i]});
+    }
+    generate_parallel_move(std::move(moves));
+    generate_return_sequence();
+    m_generated << "	jmp " << call.symbol << std::endl;
+}
+
+void IRGenerator::generate_binary(const IRInstruction& instruction) {
+    if (generate_binary_by_constant(instruction)) {
+        return;
+    }
+    if (instruction.opcode == IROpcode::UDiv || instruction.opcode == IROpcode::URem) {
+        generate_division(instruction);
+        return;
+    }
+    static const std::map<IROpcode, std::string> binary_instruction = {
+        {IROpcode::Add, "add"},
+        {IROpcode::Sub, "sub"},
+        {IROpcode::Mul, "imul"},
+    };
+    auto& lhs = instruction.operands[0];
+    auto& rhs = instruction.operands[1];
+    IRRegister result = result_register(instruction);
+    std::string name = ir_register_name(result);
+    if (register_of(rhs) == result && register_of(lhs) != result) {
+        // the right operand is overwritten by the result- in place, commuted, or negated for a subtraction
+        std::string other = source(lhs);
+        if (instruction.opcode == IROpcode::Sub) {
+            m_generated << "\tneg " << name << std::endl;
+            m_generated << "\tadd " << name << ", " << other << std::endl;
+        } else {
+            m_generated << "\t" << binary_instruction.at(instruction.opcode) << " " << name << ", " << other
+                        << std::endl;
+        }
+    } else {
+        load_operand(result, lhs);
+        std::string other = source(rhs);
+        m_generated << "\t" << binary_instruction.at(instruction.opcode) << " " << name << ", " << other
+                    << std::endl;
+    }
+    zero_extend(result, instruction.type);
+    store_result(instruction, result);
+}
+
+void IRGenerator::generate_comparison(const IRInstruction& instruction) {
+    auto& lhs = instruction.operands[0];
+    auto& rhs = instruction.operands[1];
+    IRRegister result = result_register(instruction);
+    // cmp takes an immediate on the right only, and a single memory operand
+    std::string compared;
+    if (lhs.is_constant() || (!register_of(lhs) && !register_of(rhs))) {
+        IRRegister reg = register_of(rhs) == result ? scratch() : result;
+        load_operand(reg, lhs);
+        compared = ir_register_name(reg);
+    } else {
+        compared = source(lhs);
+    }
+    std::string against = source(rhs);
+    m_generated << "\tcmp " << compared << ", " << against << std::endl
+                << "\t" << comparison_set_instruction.at(instruction.opcode) << " " << ir_register_name(result, 1)
+                << std::endl
+                << "\tmovzx " << ir_register_name(result, 4) << ", " << ir_register_name(result, 1) << std::endl;
+    store_result(instruction, result);
+}
+
+void IRGenerator::generate_division(const IRInstruction& instruction) {
+    auto& lhs = instruction.operands[0];
+    auto& rhs = instruction.operands[1];
+    save_clobbered({IRRegister::RAX, IRRegister::RDX});
+    // the divisor mustn't be in rax or rdx, which the dividend overwrites
+    std::string divisor;
+    auto reg = register_of(rhs);
+    if (rhs.is_constant() || reg == IRRegister::RAX || reg == IRRegister::RDX) {
+        IRRegister copy = scratch();
+        load_operand(copy, rhs);
+        divisor = ir_register_name(copy);
+    } else {
+        divisor = source(rhs);
+    }
+    load_operand(IRRegister::RAX, lhs);
+    m_generated << "\txor edx, edx" << std::endl << "\tdiv " << divisor << std::endl;
+    store_result(instruction, instruction.opcode == IROpcode::UDiv ? IRRegister::RAX : IRRegister::RDX);
+}
+
+bool IRGenerator::generate_binary_by_constant(const IRInstruction& instruction) {
+    auto& lhs = instruction.operands[0];
+    auto& rhs = instruction.operands[1];
+    std::optional<std::string> reduced;
+    const IROperand* operand = &lhs;
+    switch (instruction.opcode) {
+        case IROpcode::Mul:
+            if (rhs.is_constant()) {
+                reduced = reduce_multiply(rhs.constant);
+            } else if (lhs.is_constant()) {
+                reduced = reduce_multiply(lhs.constant);
+                operand = &rhs;
+            }
+            break;
+        case IROpcode::UDiv:
+            reduced = rhs.is_constant() ? reduce_divide(rhs.constant) : std::nullopt;
+            break;
+        case IROpcode::URem:
+            reduced = rhs.is_constant() ? reduce_modulo(rhs.constant) : std::nullopt;
+            break;
+        default:
+            break;
+    }
+    if (!reduced) {
+        return false;
+    }
+    save_clobbered({IRRegister::RAX, IRRegister::RCX, IRRegister::RDX, IRRegister::R11});
+    load_operand(IRRegister::RAX, *operand);
+    m_generated << *reduced;
+    zero_extend(IRRegister::RAX, instruction.type);
+    store_result(instruction, IRRegister::RAX);
+    return true;
+}
+
+void IRGenerator::generate_vector(const IRInstruction& instruction) {
+    auto& operands = instruction.operands;
+    int64_t lane_size = instruction.immediate;
+    std::string suffix = lane_suffix(lane_size);
+    IRType type = instruction.opcode == IROpcode::VectorStore || instruction.opcode == IROpcode::VectorReduceAdd
+                      ? operands[0].type
+                      : instruction.type;
+    // v256 takes AVX2, whose VEX encoded forms also spare the transitions between SSE and AVX code
+    bool avx = type == IRType::V256;
+    std::string v = avx ? "v" : "";
+    std::string reg0 = avx ? "ymm0" : "xmm0", reg1 = avx ? "ymm1" : "xmm1";
+    auto store_vector = [&]() {
+        m_generated << "\t" << v << "movdqu " << slot(instruction.result) << ", " << reg0 << std::endl;
+    };
+    // dst = dst <op> src
+    auto emit = [&](const std::string& op, const std::string& dst, const std::string& src) {
+        m_generated << "\t" << v << op << " " << dst << ", " << (avx ? dst + ", " : "") << src << std::endl;
+    };
+
+    switch (instruction.opcode) {
+        case IROpcode::VectorSplat: {
+            // movq takes no immediate
+            std::string scalar =
+                operands[0].is_constant() ? ir_register_name(operand_register(operands[0])) : source(operands[0]);
+            m_generated << "\t" << v << "movq xmm0, " << scalar << std::endl;
+            if (avx) {
+                m_generated << "\tvpbroadcast" << suffix << " ymm0, xmm0" << std::endl;
+            } else {
+                // doubling the lane up to a dword, then the dword or qword to every position
+                if (lane_size == 1) {
+                    m_generated << "\tpunpcklbw xmm0, xmm0" << std::endl;
+                }
+                if (lane_size <= 2) {
+                    m_generated << "\tpunpcklwd xmm0, xmm0" << std::endl;
+                }
+                m_generated << (lane_size == 8 ? "\tpunpcklqdq xmm0, xmm0" : "\tpshufd xmm0, xmm0, 0") << std::endl;
+            }
+            store_vector();
+            return;
+        }
+        case IROpcode::VectorLoad: {
+            std::string address = ir_register_name(operand_register(operands[0]));
+            m_generated << "\t" << v << "movdqu " << reg0 << ", [" << address << "]" << std::endl;
+            store_vector();
+            return;
+        }
+        case IROpcode::VectorStore: {
+            std::string address = ir_register_name(operand_register(operands[1]));
+            m_generated << "\t" << v << "movdqu " << reg0 << ", " << slot(operands[0].value) << std::endl
+                        << "\t" << v << "movdqu [" << address << "], " << reg0 << std::endl;
+            return;
+        }
+        case IROpcode::VectorReduceAdd:
+            generate_vector_reduce_add(instruction);
+            return;
+        default:
+            break;
+    }
+
+    m_generated << "\t" << v << "movdqu " << reg0 << ", " << slot(operands[0].value) << std::endl
+                << "\t" << v << "movdqu " << reg1 << ", " << slot(operands[1].value) << std::endl;
+    if (instruction.opcode == IROpcode::VectorAdd) {
+        emit("padd" + suffix, reg0, reg1);
+    } else if (instruction.opcode == IROpcode::VectorSub) {
+        emit("psub" + suffix, reg0, reg1);
+    } else if (lane_size == 2) {
+        emit("pmullw", reg0, reg1);
+    } else if (lane_size == 4 && avx) {
+        emit("pmulld", reg0, reg1);
+    } else if (lane_size == 4) {
+        // SSE2 multiplies the even dwords into qwords only- the odd ones are shifted down for a second multiply,
+        // and the low halves of both interleaved
+        m_generated << "\tmovdqa xmm2, xmm0" << std::endl
+                    << "\tpmuludq xmm0, xmm1" << std::endl
+                    << "\tpsrlq xmm2, 32" << std::endl
+                    << "\tpsrlq xmm1, 32" << std::endl
+                    << "\tpmuludq xmm2, xmm1" << std::endl
+                    << "\tpshufd xmm0, xmm0, 8" << std::endl
+                    << "\tpshufd xmm2, xmm2, 8" << std::endl
+                    << "\tpunpckldq xmm0, xmm2" << std::endl;
+    } else {
+        throw IRException("no vector multiplication of " + std::to_string(lane_size) + " byte lanes");
+    }
+    store_vector();
+}
+
+void IRGenerator::generate_vector_reduce_add(const IRInstruction& instruction) {
+    IRType type = instruction.operands[0].type;
+    int64_t lane_size = instruction.immediate;
+    bool avx = type == IRType::V256;
+    std::string v = avx ? "v" : "";
+    auto emit = [&](const std::string& op, const std::string& dst, const std::string& src) {
+        m_generated << "\t" << v << op << " " << dst << ", " << (avx ? dst + ", " : "") << src << std::endl;
+    };
+    // the lanes of an xmm register summed into its two qwords, widening them with the zeros of xmm2 so no sum
+    // overflows- psadbw sums eight bytes at once
+    auto sum_into_qwords = [&](const std::string& reg) {
+        if (lane_size == 1) {
+            emit("psadbw", reg, "xmm2");
+            return;
+        }
+        if (lane_size == 2) {
+            m_generated << "\t" << v << "movdqa xmm3, " << reg << std::endl;
+            emit("punpcklwd", reg, "xmm2");
+            emit("punpckhwd", "xmm3", "xmm2");
+            emit("paddd", reg, "xmm3");
+        }
+        if (lane_size <= 4) {
+            m_generated << "\t" << v << "movdqa xmm3, " << reg << std::endl;
+            emit("punpckldq", reg, "xmm2");
+            emit("punpckhdq", "xmm3", "xmm2");
+            emit("paddq", reg, "xmm3");
+        }
+    };
+
+    m_generated << "\t" << v << "movdqu " << (avx ? "ymm0" : "xmm0") << ", " << slot(instruction.operands[0].value)
+                << std::endl;
+    emit("pxor", "xmm2", "xmm2");
+    if (avx) {
+        // the upper half first- writing xmm0 clears it
+        m_generated << "\tvextracti128 xmm1, ymm0, 1" << std::endl;
+        sum_into_qwords("xmm1");
+    }
+    sum_into_qwords("xmm0");
+    if (avx) {
+        emit("paddq", "xmm0", "xmm1");
+    }
+    m_generated << "\t" << v << "pshufd xmm1, xmm0, 14" << std::endl;
+    emit("paddq", "xmm0", "xmm1");
+    IRRegister result = result_register(instruction);
+    m_generated << "\t" << v << "movq " << ir_register_name(result) << ", xmm0" << std::endl;
+    store_result(instruction, result);
+}
+
+std::vector<std::pair<IROperand, IROperand>> IRGenerator::edge_moves(IRBlockId block, IRBlockId target) const {
+    std::vector<std::pair<IROperand, IROperand>> moves;
+    for (auto& instruction : m_function->find_block(target)->instructions) {
+        if (instruction.opcode != IROpcode::Phi) {
+            continue;
+        }
+        for (size_t i = 0; i < instruction.blocks.size(); ++i) {
+            if (instruction.blocks[i] == block && !same_location(instruction.result_operand(), instruction.operands[i])) {
+                moves.push_back({instruction.result_operand(), instruction.operands[i]});
+                break;
+            }
+        }
+    }
+    return moves;
+}
+
+void IRGenerator::generate_edge(IRBlockId block, IRBlockId target, IRBlockId next_block) {
+    // the phis are written as a parallel move- all incoming values as they were before any phi is written, since a
+    // phi may be the incoming value of another
+    std::vector<std::pair<MoveLocation, MoveLocation>> moves;
+    for (auto& [phi, incoming] : edge_moves(block, target)) {
+        moves.push_back({phi, incoming});
+    }
+    generate_parallel_move(std::move(moves));
+    if (target != next_block) {
+        m_generated << "\tjmp " << block_label(target) << std::endl;
+    }
+}
+
+void IRGenerator::generate_parallel_move(std::vector<std::pair<MoveLocation, MoveLocation>> moves) {
+    // a move goes once no other reads its destination, and a cycle of them is broken by pushing one source, and
+    // popping it into its destination once the rest are done
+    moves.erase(std::remove_if(moves.begin(), moves.end(),
+                               [&](const std::pair<MoveLocation, MoveLocation>& move) {
+                                   return same_location(move.first, move.second);
+                               }),
+                moves.end());
+    std::vector<MoveLocation> popped;
+    while (!moves.empty()) {
+        auto ready = std::find_if(moves.begin(), moves.end(), [&](const std::pair<MoveLocation, MoveLocation>& move) {
+            return std::none_of(moves.begin(), moves.end(), [&](const std::pair<MoveLocation, MoveLocation>& other) {
+                return same_location(other.second, move.first);
+            });
+        });
+        if (ready != moves.end()) {
+            generate_move(ready->first, ready->second);
+        } else {
+            ready = moves.begin();
+            auto reg = register_of(ready->second);
+            if (reg) {
+                m_generated << "\tpush " << ir_register_name(*reg) << std::endl;
+            } else {
+                push_operand(*ready->second.operand);
+            }
+            popped.push_back(ready->first);
+        }
+        moves.erase(ready);
+    }
+    for (auto destination = popped.rbegin(); destination != popped.rend(); ++destination) {
+        auto reg = register_of(*destination);
+        m_generated << "\tpop " << (reg ? ir_register_name(*reg) : "QWORD " + slot(destination->operand->value))
+                    << std::endl;
+    }
+}
+
+void IRGenerator::generate_move(const MoveLocation& destination, const MoveLocation& source_location) {
+    auto reg = register_of(destination);
+    auto from = register_of(source_location);
+    if (reg && from) {
+        if (*reg != *from) {
+            m_generated << "\tmov " << ir_register_name(*reg) << ", " << ir_register_name(*from) << std::endl;
+        }
+        return;
+    }
+    if (reg) {
+        load_operand(*reg, *source_location.operand);
+        return;
+    }
+    auto& source = *source_location.operand;
+    std::string to = "QWORD " + slot(destination.operand->value);
+    if (from) {
+        m_generated << "\tmov " << to << ", " << ir_register_name(*from) << std::endl;
+    } else if (source.is_constant() && fits_immediate(source.constant)) {
+        m_generated << "\tmov " << to << ", " << source.constant << std::endl;
+    } else if (source.is_constant()) {
+        size_t offset = m_slots.at(destination.operand->value);
+        m_generated << "\tmov DWORD [rbp-" << offset << "], " << (uint32_t)source.constant << std::endl
+                    << "\tmov DWORD [rbp-" << offset - 4 << "], " << (uint32_t)((uint64_t)source.constant >> 32)
+                    << std::endl;
+    } else {
+        m_generated << "\tpush QWORD " << slot(source.value) << std::endl << "\tpop " << to << std::endl;
+    }
+}
+
+void IRGenerator::begin_instruction(const IRInstruction& instruction) {
+    m_instruction = &instruction;
+    m_taken = m_allocation->busy(instruction);
+    m_reserved.clear();
+    for (auto& operand : instruction.operands) {
+        if (auto reg = register_of(operand)) {
+            m_reserved.insert(*reg);
+        }
+    }
+    if (instruction.has_result()) {
+        if (auto reg = register_of(instruction.result_operand())) {
+            m_reserved.insert(*reg);
+        }
+    }
+    m_pushed.clear();
+}
+
+void IRGenerator::end_instruction() {
+    for (auto reg = m_pushed.rbegin(); reg != m_pushed.rend(); ++reg) {
+        m_generated << "\tpop " << ir_register_name(*reg) << std::endl;
+    }
+    m_pushed.clear();
+    m_instruction = nullptr;
+}
+
+void IRGenerator::save_clobbered(const std::set<IRRegister>& clobbered) {
+    auto live_across = m_allocation->live_across(*m_instruction);
+    for (auto reg : clobbered) {
+        if (live_across.count(reg)) {
+            m_generated << "\tpush " << ir_register_name(reg) << std::endl;
+            m_pushed.push_back(reg);
+        }
+        m_taken.insert(reg);
+        m_reserved.insert(reg);
+    }
+}
+
+IRRegister IRGenerator::scratch() {
+    // a callee-saved register is free to use only when the prologue saved it- the caller's value is still in any
+    // other one
+    for (auto reg : ir_all_registers()) {
+        if (!m_taken.count(reg) && (!ir_is_callee_saved(reg) || m_saved_offsets.count(reg))) {
+            m_taken.insert(reg);
+            m_reserved.insert(reg);
+            return reg;
+        }
+    }
+    // every register holds a value at this point- one the instruction doesn't read or write is borrowed
+    for (auto reg : ir_all_registers()) {
+        if (!m_reserved.count(reg)) {
+            m_generated << "\tpush " << ir_register_name(reg) << std::endl;
+            m_pushed.push_back(reg);
+            m_reserved.insert(reg);
+            return reg;
+        }
+    }
+    throw IRException("no register left for '" + to_string(*m_instruction) + "'");
+}
+
+IRRegister IRGenerator::result_register(const IRInstruction& instruction) {
+    auto reg = register_of(instruction.result_operand());
+    return reg ? *reg : scratch();
+}
+
+IRRegister IRGenerator::operand_register(const IROperand& operand) {
+    if (auto reg = register_of(operand)) {
+        return *reg;
+    }
+    IRRegister reg = scratch();
+    load_operand(reg, operand);
+    return reg;
+}
+
+std::optional<IRRegister> IRGenerator::register_of(const IROperand& operand) const {
+    if (!operand.is_value()) {
+        return std::nullopt;
+    }
+    return m_allocation->register_of(operand.value);
+}
+
+std::optional<IRRegister> IRGenerator::register_of(const MoveLocation& location) const {
+    return location.reg ? location.reg : register_of(*location.operand);
+}
+
+bool IRGenerator::same_location(const MoveLocation& a, const MoveLocation& b) const {
+    auto reg = register_of(a);
+    if (reg || register_of(b)) {
+        return reg == register_of(b);
+    }
+    return a.operand->is_value() && b.operand->is_value() && a.operand->value == b.operand->value;
+}
+
+std::string IRGenerator::source(const IROperand& operand) {
+    if (operand.is_constant()) {
+        return fits_immediate(operand.constant) ? std::to_string(operand.constant)
+                                                : ir_register_name(operand_register(operand));
+    }
+    auto reg = register_of(operand);
+    return reg ? ir_register_name(*reg) : "QWORD " + slot(operand.value);
+}
+
+void IRGenerator::load_operand(IRRegister reg, const IROperand& operand) {
+    if (operand.is_constant()) {
+        // writing a 32 bit register clears the upper half
+        if (operand.constant == 0) {
+            m_generated << "\txor " << ir_register_name(reg, 4) << ", " << ir_register_name(reg, 4) << std::endl;
+        } else {
+            m_generated << "\tmov " << ir_register_name(reg) << ", " << operand.constant << std::endl;
+        }
+        return;
+    }
+    auto from = register_of(operand);
+    if (from == reg) {
+        return;
+    }
+    m_generated << "\tmov " << ir_register_name(reg) << ", "
+                << (from ? ir_register_name(*from) : "QWORD " + slot(operand.value)) << std::endl;
+}
+
+void IRGenerator::push_operand(const IROperand& operand) {
+    if (operand.is_constant() && !fits_immediate(operand.constant)) {
+        m_generated << "\tsub rsp, 8" << std::endl
+                    << "\tmov DWORD [rsp], " << (uint32_t)operand.constant << std::endl
+                    << "\tmov DWORD [rsp+4], " << (uint32_t)((uint64_t)operand.constant >> 32) << std::endl;
+        return;
+    }
+    m_generated << "\tpush " << (operand.is_constant() ? "QWORD " : "") << source(operand) << std::endl;
+}
+
+void IRGenerator::store_result(const IRInstruction& instruction, IRRegister reg) {
+    auto result = register_of(instruction.result_operand());
+    if (result == reg) {
+        return;
+    }
+    m_generated << "\tmov " << (result ? ir_register_name(*result) : "QWORD " + slot(instruction.result)) << ", "
+                << ir_register_name(reg) << std::endl;
+}
+
+void IRGenerator::zero_extend(IRRegister reg, IRType type) {
+    switch (type) {
+        case IRType::I8:
+            m_generated << "\tmovzx " << ir_register_name(reg, 4) << ", " << ir_register_name(reg, 1) << std::endl;
+            break;
+        case IRType::I16:
+            m_generated << "\tmovzx " << ir_register_name(reg, 4) << ", " << ir_register_name(reg, 2) << std::endl;
+            break;
+        case IRType::I32:
+            // writing a 32 bit register clears the upper half
+            m_generated << "\tmov " << ir_register_name(reg, 4) << ", " << ir_register_name(reg, 4) << std::endl;
+            break;
+        default:
+            break;
+    }
+}
+
+std::string IRGenerator::slot(IRValueId value) const { return "[rbp-" + std::to_string(m_slots.at(value)) + "]"; }
+
+std::string IRGenerator::block_label(IRBlockId block) const { return ".bb" + std::to_string(block); }
+
+std::string IRGenerator::global_symbol(const std::string& name) { return "global_variable." + name; }
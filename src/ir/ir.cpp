@@ -0,0 +1,457 @@
+#include "ir/ir.hpp"
+
+#include <sstream>
+
+size_t ir_type_size(IRType type) {
+    switch (type) {
+        case IRType::Void:
+            return 0;
+        case IRType::I8:
+            return 1;
+        case IRType::I16:
+            return 2;
+        case IRType::I32:
+            return 4;
+        case IRType::I64:
+            return 8;
+        case IRType::V128:
+            return 16;
+        case IRType::V256:
+            return 32;
+    }
+    throw IRException("unknown IR type");
+}
+
+std::string ir_type_name(IRType type) {
+    switch (type) {
+        case IRType::Void:
+            return "void";
+        case IRType::I8:
+            return "i8";
+        case IRType::I16:
+            return "i16";
+        case IRType::I32:
+            return "i32";
+        case IRType::I64:
+            return "i64";
+        case IRType::V128:
+            return "v128";
+        case IRType::V256:
+            return "v256";
+    }
+    throw IRException("unknown IR type");
+}
+
+IRType ir_type_from_size(size_t size_bytes) {
+    switch (size_bytes) {
+        case 0:
+            return IRType::Void;
+        case 1:
+            return IRType::I8;
+        case 2:
+            return IRType::I16;
+        case 4:
+            return IRType::I32;
+        case 8:
+            return IRType::I64;
+    }
+    throw IRException("no IR type of " + std::to_string(size_bytes) + " bytes");
+}
+
+int64_t ir_normalize(int64_t value, IRType type) {
+    size_t size_bytes = ir_type_size(type);
+    if (size_bytes == 0) {
+        return 0;
+    }
+    if (size_bytes >= 8) {
+        return value;
+    }
+    return (int64_t)((uint64_t)value & ((1ull << (size_bytes * 8)) - 1));
+}
+
+IROperand IROperand::make_value(IRValueId value, IRType type) {
+    return IROperand{.kind = Kind::Value, .type = type, .value = value, .constant = 0};
+}
+
+IROperand IROperand::make_constant(int64_t constant, IRType type) {
+    return IROperand{.kind = Kind::Constant, .type = type, .value = 0, .constant = ir_normalize(constant, type)};
+}
+
+bool IROperand::operator==(const IROperand& other) const {
+    if (kind != other.kind || type != other.type) {
+        return false;
+    }
+    return is_value() ? value == other.value : constant == other.constant;
+}
+
+std::string ir_opcode_name(IROpcode opcode) {
+    switch (opcode) {
+        case IROpcode::Param:
+            return "param";
+        case IROpcode::Alloca:
+            return "alloca";
+        case IROpcode::GlobalAddr:
+            return "global_addr";
+        case IROpcode::Load:
+            return "load";
+        case IROpcode::Store:
+            return "store";
+        case IROpcode::Zero:
+            return "zero";
+        case IROpcode::Add:
+            return "add";
+        case IROpcode::Sub:
+            return "sub";
+        case IROpcode::Mul:
+            return "mul";
+        case IROpcode::UDiv:
+            return "udiv";
+        case IROpcode::URem:
+            return "urem";
+        case IROpcode::Neg:
+            return "neg";
+        case IROpcode::CmpEq:
+            return "cmp_eq";
+        case IROpcode::CmpLt:
+            return "cmp_lt";
+        case IROpcode::CmpLe:
+            return "cmp_le";
+        case IROpcode::CmpGt:
+            return "cmp_gt";
+        case IROpcode::CmpGe:
+            return "cmp_ge";
+        case IROpcode::ZExt:
+            return "zext";
+        case IROpcode::Trunc:
+            return "trunc";
+        case IROpcode::Call:
+            return "call";
+        case IROpcode::Phi:
+            return "phi";
+        case IROpcode::VectorSplat:
+            return "vector_splat";
+        case IROpcode::VectorLoad:
+            return "vector_load";
+        case IROpcode::VectorStore:
+            return "vector_store";
+        case IROpcode::VectorAdd:
+            return "vector_add";
+        case IROpcode::VectorSub:
+            return "vector_sub";
+        case IROpcode::VectorMul:
+            return "vector_mul";
+        case IROpcode::VectorReduceAdd:
+            return "vector_reduce_add";
+        case IROpcode::Jump:
+            return "jump";
+        case IROpcode::Branch:
+            return "branch";
+        case IROpcode::Return:
+            return "return";
+        case IROpcode::Exit:
+            return "exit";
+    }
+    throw IRException("unknown IR opcode");
+}
+
+bool ir_is_terminator(IROpcode opcode) {
+    return opcode == IROpcode::Jump || opcode == IROpcode::Branch || opcode == IROpcode::Return ||
+           opcode == IROpcode::Exit;
+}
+
+bool ir_is_binary(IROpcode opcode) {
+    switch (opcode) {
+        case IROpcode::Add:
+        case IROpcode::Sub:
+        case IROpcode::Mul:
+        case IROpcode::UDiv:
+        case IROpcode::URem:
+            return true;
+        default:
+            return ir_is_comparison(opcode);
+    }
+}
+
+bool ir_is_comparison(IROpcode opcode) {
+    switch (opcode) {
+        case IROpcode::CmpEq:
+        case IROpcode::CmpLt:
+        case IROpcode::CmpLe:
+        case IROpcode::CmpGt:
+        case IROpcode::CmpGe:
+            return true;
+        default:
+            return false;
+    }
+}
+
+bool ir_has_side_effects(IROpcode opcode) {
+    // NOTE: division by zero traps as well, see ir_may_trap
+    return opcode == IROpcode::Store || opcode == IROpcode::VectorStore || opcode == IROpcode::Zero ||
+           opcode == IROpcode::Call || ir_is_terminator(opcode);
+}
+
+bool ir_may_trap(const IRInstruction& instruction) {
+    if (instruction.opcode != IROpcode::UDiv && instruction.opcode != IROpcode::URem) {
+        return false;
+    }
+    auto& divisor = instruction.operands[1];
+    return !divisor.is_constant() || divisor.constant == 0;
+}
+
+bool ir_is_foldable(IROpcode opcode) {
+    return ir_is_binary(opcode) || opcode == IROpcode::Neg || opcode == IROpcode::ZExt || opcode == IROpcode::Trunc;
+}
+
+bool ir_is_vector(IRType type) { return type == IRType::V128 || type == IRType::V256; }
+
+std::optional<int64_t> ir_evaluate(IROpcode opcode, IRType type, const std::vector<int64_t>& operands) {
+    // operands are normalized- zero-extended- so they compare and divide as the generator's 64 bit registers do
+    uint64_t lhs = operands.at(0), rhs = operands.size() > 1 ? operands[1] : 0;
+    switch (opcode) {
+        case IROpcode::Add:
+            return ir_normalize((int64_t)(lhs + rhs), type);
+        case IROpcode::Sub:
+            return ir_normalize((int64_t)(lhs - rhs), type);
+        case IROpcode::Mul:
+            return ir_normalize((int64_t)(lhs * rhs), type);
+        case IROpcode::UDiv:
+            if (rhs == 0) {
+                return std::nullopt;
+            }
+            return ir_normalize((int64_t)(lhs / rhs), type);
+        case IROpcode::URem:
+            if (rhs == 0) {
+                return std::nullopt;
+            }
+            return ir_normalize((int64_t)(lhs % rhs), type);
+        case IROpcode::Neg:
+            return ir_normalize((int64_t)(0 - lhs), type);
+        case IROpcode::CmpEq:
+            return (int64_t)lhs == (int64_t)rhs;
+        case IROpcode::CmpLt:
+            return (int64_t)lhs < (int64_t)rhs;
+        case IROpcode::CmpLe:
+            return (int64_t)lhs <= (int64_t)rhs;
+        case IROpcode::CmpGt:
+            return (int64_t)lhs > (int64_t)rhs;
+        case IROpcode::CmpGe:
+            return (int64_t)lhs >= (int64_t)rhs;
+        case IROpcode::ZExt:
+        case IROpcode::Trunc:
+            return ir_normalize((int64_t)lhs, type);
+        default:
+            return std::nullopt;
+    }
+}
+
+std::vector<IRBlockId> IRBasicBlock::successors() const {
+    if (!is_terminated()) {
+        return {};
+    }
+    auto& last = terminator();
+    if (last.opcode == IROpcode::Jump || last.opcode == IROpcode::Branch) {
+        return last.blocks;
+    }
+    return {};
+}
+
+IRBasicBlock& IRFunction::add_block() {
+    blocks.push_back(IRBasicBlock{.id = next_block_id++, .instructions = {}});
+    return blocks.back();
+}
+
+IRBasicBlock* IRFunction::find_block(IRBlockId id) {
+    for (auto& block : blocks) {
+        if (block.id == id) {
+            return &block;
+        }
+    }
+    return nullptr;
+}
+
+const IRBasicBlock* IRFunction::find_block(IRBlockId id) const {
+    return const_cast<IRFunction*>(this)->find_block(id);
+}
+
+size_t IRFunction::instruction_count() const {
+    size_t count = 0;
+    for (auto& block : blocks) {
+        count += block.instructions.size();
+    }
+    return count;
+}
+
+IRFunction* IRModule::find_function(const std::string& name) {
+    for (auto& function : functions) {
+        if (function.name == name) {
+            return &function;
+        }
+    }
+    return nullptr;
+}
+
+const IRFunction* IRModule::find_function(const std::string& name) const {
+    return const_cast<IRModule*>(this)->find_function(name);
+}
+
+size_t IRModule::instruction_count() const {
+    size_t count = 0;
+    for (auto& function : functions) {
+        count += function.instruction_count();
+    }
+    return count;
+}
+
+// ---- printing
+
+std::string to_string(const IROperand& operand) {
+    if (operand.is_constant()) {
+        return std::to_string(operand.constant);
+    }
+    return "%" + std::to_string(operand.value);
+}
+
+namespace {
+
+std::string block_name(IRBlockId id) { return "bb" + std::to_string(id); }
+
+std::string typed_operand(const IROperand& operand) {
+    return ir_type_name(operand.type) + " " + to_string(operand);
+}
+
+// <16 x i8>
+std::string vector_type_name(IRType type, int64_t lane_size) {
+    return "<" + std::to_string(ir_type_size(type) / lane_size) + " x " + ir_type_name(ir_type_from_size(lane_size)) +
+           ">";
+}
+
+}  // namespace
+
+std::string to_string(const IRInstruction& instruction) {
+    std::stringstream out;
+    if (instruction.has_result()) {
+        out << "%" << instruction.result << " = ";
+    }
+    out << ir_opcode_name(instruction.opcode);
+    auto& operands = instruction.operands;
+    switch (instruction.opcode) {
+        case IROpcode::Param:
+            out << " " << ir_type_name(instruction.type) << " " << instruction.immediate;
+            break;
+        case IROpcode::Alloca:
+            out << " " << instruction.immediate;
+            break;
+        case IROpcode::GlobalAddr:
+            out << " @" << instruction.symbol;
+            break;
+        case IROpcode::Load:
+            out << " " << ir_type_name(instruction.type) << " " << to_string(operands.at(0));
+            break;
+        case IROpcode::Store:
+            out << " " << typed_operand(operands.at(0)) << ", " << to_string(operands.at(1));
+            break;
+        case IROpcode::Zero:
+            out << " " << to_string(operands.at(0)) << ", " << instruction.immediate;
+            break;
+        case IROpcode::ZExt:
+        case IROpcode::Trunc:
+            out << " " << typed_operand(operands.at(0)) << " -> " << ir_type_name(instruction.type);
+            break;
+        case IROpcode::Call: {
+            out << " " << ir_type_name(instruction.type) << " @" << instruction.symbol << "(";
+            for (size_t i = 0; i < operands.size(); ++i) {
+                out << (i ? ", " : "") << typed_operand(operands[i]);
+            }
+            out << ")";
+            break;
+        }
+        case IROpcode::Phi: {
+            out << " " << ir_type_name(instruction.type);
+            for (size_t i = 0; i < operands.size(); ++i) {
+                out << (i ? ", " : " ") << "[" << to_string(operands[i]) << ", " << block_name(instruction.blocks[i])
+                    << "]";
+            }
+            break;
+        }
+        case IROpcode::VectorSplat:
+            out << " " << vector_type_name(instruction.type, instruction.immediate) << " "
+                << typed_operand(operands.at(0));
+            break;
+        case IROpcode::VectorStore:
+            out << " " << vector_type_name(operands.at(0).type, instruction.immediate) << " "
+                << to_string(operands.at(0)) << ", " << to_string(operands.at(1));
+            break;
+        case IROpcode::VectorReduceAdd:
+            out << " " << vector_type_name(operands.at(0).type, instruction.immediate) << " "
+                << to_string(operands.at(0)) << " -> " << ir_type_name(instruction.type);
+            break;
+        case IROpcode::VectorLoad:
+        case IROpcode::VectorAdd:
+        case IROpcode::VectorSub:
+        case IROpcode::VectorMul:
+            out << " " << vector_type_name(instruction.type, instruction.immediate);
+            for (size_t i = 0; i < operands.size(); ++i) {
+                out << (i ? ", " : " ") << to_string(operands[i]);
+            }
+            break;
+        case IROpcode::Jump:
+            out << " " << block_name(instruction.blocks.at(0));
+            break;
+        case IROpcode::Branch:
+            out << " " << typed_operand(operands.at(0)) << ", " << block_name(instruction.blocks.at(0)) << ", "
+                << block_name(instruction.blocks.at(1));
+            break;
+        case IROpcode::Return:
+        case IROpcode::Exit:
+            if (!operands.empty()) {
+                out << " " << typed_operand(operands.at(0));
+            }
+            break;
+        default:
+            if (ir_is_comparison(instruction.opcode)) {
+                out << " " << typed_operand(operands.at(0)) << ", " << to_string(operands.at(1)) << " -> "
+                    << ir_type_name(instruction.type);
+                break;
+            }
+            // arithmetic- the operands share the result's type
+            out << " " << ir_type_name(instruction.type);
+            for (size_t i = 0; i < operands.size(); ++i) {
+                out << (i ? ", " : " ") << to_string(operands[i]);
+            }
+    }
+    return out.str();
+}
+
+std::string to_string(const IRFunction& function) {
+    std::stringstream out;
+    out << (function.is_entry ? "entry " : "func ") << ir_type_name(function.return_type) << " @" << function.name
+        << "(";
+    for (size_t i = 0; i < function.parameter_types.size(); ++i) {
+        out << (i ? ", " : "") << ir_type_name(function.parameter_types[i]);
+    }
+    out << ")";
+    if (function.inline_hint != IRInlineHint::None) {
+        out << (function.inline_hint == IRInlineHint::Always ? " inline" : " noinline");
+    }
+    out << " {" << std::endl;
+    for (auto& block : function.blocks) {
+        out << block_name(block.id) << ":" << std::endl;
+        for (auto& instruction : block.instructions) {
+            out << "    " << to_string(instruction) << std::endl;
+        }
+    }
+    out << "}" << std::endl;
+    return out.str();
+}
+
+std::string to_string(const IRModule& module) {
+    std::stringstream out;
+    for (auto& global : module.globals) {
+        out << "global @" << global.name << ", " << global.size_bytes << std::endl;
+    }
+    for (auto& function : module.functions) {
+        out << std::endl << to_string(function);
+    }
+    return out.str();
+}
@@ -0,0 +1,266 @@
+#include "ir/ir_loops.hpp"
+
+#include <algorithm>
+#include <map>
+
+#include "ir/ir_cfg.hpp"
+
+namespace {
+
+// retargets the edges from 'block' to 'from' at 'to'
+void retarget(IRBasicBlock& block, IRBlockId from, IRBlockId to) {
+    auto& targets = block.terminator().blocks;
+    std::replace(targets.begin(), targets.end(), from, to);
+}
+
+}  // namespace
+
+std::vector<IRLoop> ir_find_loops(const IRFunction& function) {
+    IRDominatorTree dominators(function);
+    auto predecessors = ir_predecessors(function);
+    std::map<IRBlockId, IRLoop> loops;
+    for (auto block_id : dominators.get_order()) {
+        for (auto successor : function.find_block(block_id)->successors()) {
+            if (dominators.dominates(successor, block_id)) {
+                auto& loop = loops[successor];
+                loop.header = successor;
+                loop.latches.push_back(block_id);
+            }
+        }
+    }
+
+    std::vector<IRLoop> result;
+    for (auto& [header, loop] : loops) {
+        // backwards from the latches, stopping at the header
+        loop.blocks.insert(header);
+        std::vector<IRBlockId> worklist(loop.latches.begin(), loop.latches.end());
+        while (!worklist.empty()) {
+            IRBlockId block = worklist.back();
+            worklist.pop_back();
+            if (!dominators.is_reachable(block) || !loop.blocks.insert(block).second) {
+                continue;
+            }
+            for (auto predecessor : predecessors[block]) {
+                worklist.push_back(predecessor);
+            }
+        }
+        result.push_back(std::move(loop));
+    }
+    // a loop nested in another is smaller than it
+    std::stable_sort(result.begin(), result.end(),
+                     [](const IRLoop& a, const IRLoop& b) { return a.blocks.size() < b.blocks.size(); });
+    return result;
+}
+
+std::vector<std::pair<IRBlockId, IRBlockId>> ir_loop_exits(const IRFunction& function, const IRLoop& loop) {
+    std::vector<std::pair<IRBlockId, IRBlockId>> exits;
+    for (auto block : loop.blocks) {
+        for (auto successor : function.find_block(block)->successors()) {
+            if (!loop.contains(successor)) {
+                exits.push_back({block, successor});
+            }
+        }
+    }
+    return exits;
+}
+
+IRBlockId ir_ensure_preheader(IRFunction& function, const IRLoop& loop) {
+    auto predecessors = ir_predecessors(function);
+    std::vector<IRBlockId> outside;
+    for (auto predecessor : predecessors[loop.header]) {
+        if (!loop.contains(predecessor)) {
+            outside.push_back(predecessor);
+        }
+    }
+    if (outside.size() == 1 && function.find_block(outside.front())->successors().size() == 1) {
+        return outside.front();
+    }
+
+    IRBasicBlock preheader{.id = function.next_block_id++, .instructions = {}};
+    for (auto predecessor : outside) {
+        retarget(*function.find_block(predecessor), loop.header, preheader.id);
+    }
+    // the values flowing in from outside merge in the preheader
+    for (auto& phi : function.find_block(loop.header)->instructions) {
+        if (phi.opcode != IROpcode::Phi) {
+            break;
+        }
+        IRInstruction merged{.opcode = IROpcode::Phi, .type = phi.type};
+        for (size_t i = phi.blocks.size(); i-- > 0;) {
+            if (!loop.contains(phi.blocks[i])) {
+                merged.operands.insert(merged.operands.begin(), phi.operands[i]);
+                merged.blocks.insert(merged.blocks.begin(), phi.blocks[i]);
+                phi.operands.erase(phi.operands.begin() + i);
+                phi.blocks.erase(phi.blocks.begin() + i);
+            }
+        }
+        IROperand incoming = merged.operands.front();
+        if (std::any_of(merged.operands.begin(), merged.operands.end(),
+                        [&](const IROperand& operand) { return operand != incoming; })) {
+            merged.result = function.new_value();
+            incoming = merged.result_operand();
+            preheader.instructions.push_back(std::move(merged));
+        }
+        phi.operands.push_back(incoming);
+        phi.blocks.push_back(preheader.id);
+    }
+    preheader.instructions.push_back(IRInstruction{.opcode = IROpcode::Jump, .blocks = {loop.header}});
+
+    // right before the header, so it falls through into it
+    IRBlockId id = preheader.id;
+    auto header = std::find_if(function.blocks.begin(), function.blocks.end(),
+                               [&](const IRBasicBlock& block) { return block.id == loop.header; });
+    function.blocks.insert(header, std::move(preheader));
+    return id;
+}
+
+IRBlockId ir_split_edge(IRFunction& function, IRBlockId from, IRBlockId to) {
+    IRBasicBlock split{.id = function.next_block_id++, .instructions = {}};
+    split.instructions.push_back(IRInstruction{.opcode = IROpcode::Jump, .blocks = {to}});
+    retarget(*function.find_block(from), to, split.id);
+    for (auto& phi : function.find_block(to)->instructions) {
+        if (phi.opcode != IROpcode::Phi) {
+            break;
+        }
+        std::replace(phi.blocks.begin(), phi.blocks.end(), from, split.id);
+    }
+
+    IRBlockId id = split.id;
+    auto after = std::find_if(function.blocks.begin(), function.blocks.end(),
+                              [&](const IRBasicBlock& block) { return block.id == from; });
+    function.blocks.insert(after + 1, std::move(split));
+    return id;
+}
+
+std::vector<IRInductionVariable> ir_induction_variables(const IRFunction& function, const IRLoop& loop) {
+    std::vector<IRInductionVariable> induction_variables;
+    if (loop.latches.size() != 1) {
+        return induction_variables;
+    }
+    auto definitions = ir_definition_blocks(function);
+    auto is_invariant = [&](const IROperand& operand) {
+        return operand.is_constant() || !loop.contains(definitions.at(operand.value));
+    };
+    IRBlockId latch = loop.latches.front();
+    for (auto& phi : function.find_block(loop.header)->instructions) {
+        if (phi.opcode != IROpcode::Phi) {
+            break;
+        }
+        if (phi.blocks.size() != 2 || std::count(phi.blocks.begin(), phi.blocks.end(), latch) != 1) {
+            continue;
+        }
+        size_t latch_index = phi.blocks[0] == latch ? 0 : 1;
+        auto& next = phi.operands[latch_index];
+        if (!next.is_value() || !loop.contains(definitions.at(next.value))) {
+            continue;
+        }
+        auto& instructions = function.find_block(definitions.at(next.value))->instructions;
+        auto increment = std::find_if(instructions.begin(), instructions.end(),
+                                      [&](const IRInstruction& instruction) { return instruction.result == next.value; });
+        if ((increment->opcode != IROpcode::Add && increment->opcode != IROpcode::Sub) ||
+            increment->type != phi.type) {
+            continue;
+        }
+        auto phi_operand = phi.result_operand();
+        // step + phi adds just as well, phi - step is the only subtraction
+        size_t step_index = increment->operands[0] == phi_operand ? 1 : 0;
+        bool is_step = increment->operands[1 - step_index] == phi_operand &&
+                       (increment->opcode == IROpcode::Add || step_index == 1) &&
+                       is_invariant(increment->operands[step_index]);
+        if (is_step) {
+            induction_variables.push_back(IRInductionVariable{.phi = phi.result,
+                                                              .type = phi.type,
+                                                              .init = phi.operands[1 - latch_index],
+                                                              .step = increment->operands[step_index],
+                                                              .direction = increment->opcode,
+                                                              .next = next.value});
+        }
+    }
+    return induction_variables;
+}
+
+namespace {
+
+IROpcode swapped_comparison(IROpcode opcode) {
+    switch (opcode) {
+        case IROpcode::CmpLt:
+            return IROpcode::CmpGt;
+        case IROpcode::CmpLe:
+            return IROpcode::CmpGe;
+        case IROpcode::CmpGt:
+            return IROpcode::CmpLt;
+        default:
+            return IROpcode::CmpLe;
+    }
+}
+
+IROpcode negated_comparison(IROpcode opcode) {
+    switch (opcode) {
+        case IROpcode::CmpLt:
+            return IROpcode::CmpGe;
+        case IROpcode::CmpLe:
+            return IROpcode::CmpGt;
+        case IROpcode::CmpGt:
+            return IROpcode::CmpLe;
+        default:
+            return IROpcode::CmpLt;
+    }
+}
+
+}  // namespace
+
+std::optional<IRCountedLoop> ir_counted_loop(const IRFunction& function, const IRLoop& loop) {
+    auto exits = ir_loop_exits(function, loop);
+    if (loop.latches.size() != 1 || exits.size() != 1 || exits.front().first != loop.header) {
+        return std::nullopt;
+    }
+    auto& header = *function.find_block(loop.header);
+    auto& branch = header.terminator();
+    if (branch.opcode != IROpcode::Branch || !branch.operands[0].is_value()) {
+        return std::nullopt;
+    }
+    auto condition = std::find_if(header.instructions.begin(), header.instructions.end(),
+                                  [&](const IRInstruction& i) { return i.result == branch.operands[0].value; });
+    if (condition == header.instructions.end() ||
+        (condition->opcode != IROpcode::CmpLt && condition->opcode != IROpcode::CmpLe &&
+         condition->opcode != IROpcode::CmpGt && condition->opcode != IROpcode::CmpGe)) {
+        return std::nullopt;
+    }
+
+    auto definitions = ir_definition_blocks(function);
+    for (auto& counter : ir_induction_variables(function, loop)) {
+        if (!counter.step.is_constant()) {
+            continue;
+        }
+        auto counter_operand = IROperand::make_value(counter.phi, counter.type);
+        size_t counter_index = condition->operands[0] == counter_operand ? 0 : 1;
+        auto& bound = condition->operands[1 - counter_index];
+        bool is_invariant = bound.is_constant() || !loop.contains(definitions.at(bound.value));
+        if (condition->operands[counter_index] != counter_operand || !is_invariant) {
+            continue;
+        }
+        IROpcode comparison = counter_index == 0 ? condition->opcode : swapped_comparison(condition->opcode);
+        bool continues_on_true = loop.contains(branch.blocks[0]);
+        if (!continues_on_true) {
+            comparison = negated_comparison(comparison);
+        }
+
+        // narrower counters step by less than half their range, so the step's sign is clear
+        int64_t step = counter.step.constant;
+        if (counter.type != IRType::I64 && (uint64_t)step >= (uint64_t)1 << (ir_type_size(counter.type) * 8 - 1)) {
+            continue;
+        }
+        step = counter.direction == IROpcode::Add ? step : -step;
+        bool counts_up = comparison == IROpcode::CmpLt || comparison == IROpcode::CmpLe;
+        if (step == 0 || (step > 0) != counts_up) {
+            continue;
+        }
+        return IRCountedLoop{.counter = counter,
+                             .comparison = comparison,
+                             .bound = bound,
+                             .step = step,
+                             .body = continues_on_true ? branch.blocks[0] : branch.blocks[1],
+                             .exit = exits.front().second};
+    }
+    return std::nullopt;
+}
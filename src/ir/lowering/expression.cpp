@@ -0,0 +1,242 @@
+#include "ir/ir_lowering.hpp"
+
+namespace {
+
+IRType wider(IRType a, IRType b) { return ir_type_size(a) >= ir_type_size(b) ? a : b; }
+
+// type of the element that indexing into 'data_type' yields
+std::shared_ptr<DataType> indexed_element_type(const std::shared_ptr<DataType>& data_type) {
+    if (auto array_type = dynamic_cast<ArrayType*>(data_type.get())) {
+        return array_type->elementType;
+    }
+    if (auto pointer_type = dynamic_cast<PointerType*>(data_type.get())) {
+        return pointer_type->baseType;
+    }
+    throw IRException("unexpected expression to index");
+}
+
+}  // namespace
+
+struct IRLowering::ExpressionVisitor {
+    IRLowering& lowering;
+    IRType type;
+
+    IROperand operator()(const ASTIdentifier& identifier) const {
+        return lowering.lower_expression_identifier(identifier, type);
+    }
+    IROperand operator()(const ASTIntLiteral& literal) const {
+        return IROperand::make_constant((int64_t)parse_int_literal(literal.value), type);
+    }
+    IROperand operator()(const ASTCharLiteral& literal) const { return IROperand::make_constant(literal.value, type); }
+    IROperand operator()(const ASTArrayInitializer&) const {
+        throw IRException("array initializer outside of a variable declaration");
+    }
+    IROperand operator()(const std::shared_ptr<ASTBinExpression>& binary) const {
+        return lowering.lower_expression_binary(*binary, type);
+    }
+    IROperand operator()(const std::shared_ptr<ASTAtomicExpression>& atomic) const {
+        return std::visit(*this, atomic->value);
+    }
+    IROperand operator()(const std::shared_ptr<ASTUnaryExpression>& unary) const {
+        return lowering.lower_expression_unary(*unary, type);
+    }
+    IROperand operator()(const ASTParenthesisExpression& paren_expr) const {
+        // NOTE: the inner expression has no data type of its own
+        return std::visit(*this, paren_expr.expression->expression);
+    }
+    IROperand operator()(const ASTFunctionCall& function_call_expr) const {
+        return lowering.lower_expression_function_call(function_call_expr, type);
+    }
+    IROperand operator()(const std::shared_ptr<ASTArrayIndexExpression>& array_index) const {
+        return lowering.lower_expression_array_index(*array_index, type);
+    }
+};
+
+IROperand IRLowering::lower_expression(const ASTExpression& expression) {
+    return std::visit(IRLowering::ExpressionVisitor{*this, ir_type_of(expression.data_type)}, expression.expression);
+}
+
+IROperand IRLowering::lower_expression_identifier(const ASTIdentifier& identifier, IRType requested_type) {
+    auto& variable = assert_get_variable(identifier.value);
+    if (DataTypeUtils::is_array_type(variable.data_type)) {
+        // pointer decay
+        return convert(emit_address_of(variable), requested_type);
+    }
+    if (variable.in_memory) {
+        return convert(emit(IROpcode::Load, variable.type, {emit_address_of(variable)}), requested_type);
+    }
+    return convert(read_variable(variable.ssa_index, m_current_block), requested_type);
+}
+
+IROperand IRLowering::lower_expression_binary(const ASTBinExpression& binary, IRType requested_type) {
+    static_assert((int)BinOperation::operationCount - 1 == 10,
+                  "Binary Operations enum changed without changing the IR lowering");
+    IRType lhs_type = ir_type_of(binary.lhs->data_type);
+    IRType rhs_type = ir_type_of(binary.rhs->data_type);
+    IROperand lhs = lower_expression(*binary.lhs);
+    IROperand rhs = lower_expression(*binary.rhs);
+
+    // the generator computes in 64 bits on zero-extended operands and keeps the requested width of the result.
+    // wrapping operations can compute at the requested width directly, the others need the operands' full width
+    IROpcode opcode;
+    switch (binary.operation) {
+        case BinOperation::add:
+            return emit(IROpcode::Add, requested_type, {convert(lhs, requested_type), convert(rhs, requested_type)});
+        case BinOperation::subtract:
+            return emit(IROpcode::Sub, requested_type, {convert(lhs, requested_type), convert(rhs, requested_type)});
+        case BinOperation::multiply:
+            return emit(IROpcode::Mul, requested_type, {convert(lhs, requested_type), convert(rhs, requested_type)});
+        case BinOperation::divide:
+            opcode = IROpcode::UDiv;
+            break;
+        case BinOperation::modulo:
+            opcode = IROpcode::URem;
+            break;
+        case BinOperation::eq:
+            opcode = IROpcode::CmpEq;
+            break;
+        case BinOperation::lt:
+            opcode = IROpcode::CmpLt;
+            break;
+        case BinOperation::le:
+            opcode = IROpcode::CmpLe;
+            break;
+        case BinOperation::gt:
+            opcode = IROpcode::CmpGt;
+            break;
+        case BinOperation::ge:
+            opcode = IROpcode::CmpGe;
+            break;
+        default:
+            throw IRException("unknown binary operation");
+    }
+    IRType width = wider(wider(lhs_type, rhs_type), requested_type);
+    std::vector<IROperand> operands = {convert(lhs, width), convert(rhs, width)};
+    if (ir_is_comparison(opcode)) {
+        return emit(opcode, requested_type, operands);
+    }
+    return convert(emit(opcode, width, operands), requested_type);
+}
+
+IROperand IRLowering::lower_expression_unary(const ASTUnaryExpression& unary, IRType requested_type) {
+    static_assert((int)UnaryOperation::operationCount - 1 == 3,
+                  "Implemented unary operations without updating the IR lowering");
+    auto& operand = *unary.expression;
+    switch (unary.operation) {
+        case UnaryOperation::negate:
+            return emit(IROpcode::Neg, requested_type, {convert(lower_expression(operand), requested_type)});
+        case UnaryOperation::dereference:
+            // &x
+            return convert(lower_address(operand), requested_type);
+        case UnaryOperation::reference: {
+            // *x
+            auto pointer_type = dynamic_cast<PointerType*>(operand.data_type.get());
+            if (!pointer_type) {
+                throw IRException("dereference of a non-pointer expression");
+            }
+            IROperand address = convert(lower_expression(operand), IRType::I64);
+            return convert(emit(IROpcode::Load, ir_type_of(pointer_type->baseType), {address}), requested_type);
+        }
+        default:
+            throw IRException("unknown unary operation");
+    }
+}
+
+IROperand IRLowering::lower_expression_array_index(const ASTArrayIndexExpression& array_index,
+                                                   IRType requested_type) {
+    auto element_type = indexed_element_type(array_index.expression->data_type);
+    IROperand address = lower_element_address(array_index);
+    if (DataTypeUtils::is_array_type(element_type)) {
+        // indexing a nested array yields the inner array, which decays to its address
+        return convert(address, requested_type);
+    }
+    return convert(emit(IROpcode::Load, ir_type_of(element_type), {address}), requested_type);
+}
+
+IROperand IRLowering::lower_expression_function_call(const ASTFunctionCall& function_call, IRType requested_type) {
+    const ASTStatementFunction* callee = nullptr;
+    for (auto& function : m_prog.functions) {
+        if (function->name == function_call.function_name) {
+            callee = function.get();
+        }
+    }
+    if (!callee || callee->parameters.size() != function_call.parameters.size()) {
+        throw IRException("call of unknown function '" + function_call.function_name + "'");
+    }
+    IRInstruction call{.opcode = IROpcode::Call, .type = ir_type_of(callee->return_data_type)};
+    call.symbol = callee->name;
+    for (size_t i = 0; i < function_call.parameters.size(); ++i) {
+        IROperand argument = lower_expression(function_call.parameters[i]);
+        call.operands.push_back(convert(argument, ir_type_of(callee->parameters[i].data_type)));
+    }
+    ensure_open_block();
+    if (call.type == IRType::Void) {
+        current_block().instructions.push_back(call);
+        if (requested_type != IRType::Void) {
+            throw IRException("use of the result of void function '" + callee->name + "'");
+        }
+        return IROperand::make_constant(0, IRType::I64);
+    }
+    call.result = m_function->new_value();
+    current_block().instructions.push_back(call);
+    return convert(call.result_operand(), requested_type);
+}
+
+IROperand IRLowering::lower_address(const ASTExpression& expression) {
+    if (std::holds_alternative<std::shared_ptr<ASTArrayIndexExpression>>(expression.expression)) {
+        return lower_element_address(*std::get<std::shared_ptr<ASTArrayIndexExpression>>(expression.expression));
+    }
+    if (std::holds_alternative<std::shared_ptr<ASTUnaryExpression>>(expression.expression)) {
+        auto& unary = std::get<std::shared_ptr<ASTUnaryExpression>>(expression.expression);
+        if (unary->operation == UnaryOperation::reference) {
+            // the address is the operand of *
+            return convert(lower_expression(*unary->expression), IRType::I64);
+        }
+    }
+    if (std::holds_alternative<std::shared_ptr<ASTAtomicExpression>>(expression.expression)) {
+        auto& atomic = std::get<std::shared_ptr<ASTAtomicExpression>>(expression.expression);
+        if (std::holds_alternative<ASTIdentifier>(atomic->value)) {
+            return emit_address_of(assert_get_variable(std::get<ASTIdentifier>(atomic->value).value));
+        }
+        if (std::holds_alternative<ASTParenthesisExpression>(atomic->value)) {
+            return lower_address(*std::get<ASTParenthesisExpression>(atomic->value).expression);
+        }
+    }
+    throw IRException("unexpected expression to calculate the address of");
+}
+
+IROperand IRLowering::lower_element_address(const ASTArrayIndexExpression& array_index) {
+    auto& indexed = *array_index.expression;
+    auto element_type = indexed_element_type(indexed.data_type);
+    // arrays are indexed in place, pointers by their value
+    IROperand base = DataTypeUtils::is_array_type(indexed.data_type) ? lower_address(indexed)
+                                                                      : convert(lower_expression(indexed), IRType::I64);
+    IROperand index = convert(lower_expression(*array_index.index), IRType::I64);
+    IROperand size = IROperand::make_constant((int64_t)element_type->get_size_bytes(), IRType::I64);
+    IROperand offset = emit(IROpcode::Mul, IRType::I64, {index, size});
+    return emit(IROpcode::Add, IRType::I64, {base, offset});
+}
+
+void IRLowering::store_initializer(const IROperand& address, size_t offset, const ASTExpression& value) {
+    auto array_type = dynamic_cast<ArrayType*>(value.data_type.get());
+    if (!array_type) {
+        IROperand element_address = address;
+        if (offset > 0) {
+            IROperand offset_operand = IROperand::make_constant((int64_t)offset, IRType::I64);
+            element_address = emit(IROpcode::Add, IRType::I64, {address, offset_operand});
+        }
+        emit_void(IROpcode::Store, {lower_expression(value), element_address});
+        return;
+    }
+    auto atomic = std::holds_alternative<std::shared_ptr<ASTAtomicExpression>>(value.expression)
+                      ? std::get<std::shared_ptr<ASTAtomicExpression>>(value.expression)
+                      : nullptr;
+    if (!atomic || !std::holds_alternative<ASTArrayInitializer>(atomic->value)) {
+        throw IRException("arrays can only be initialized with array initializers");
+    }
+    auto& initializer = std::get<ASTArrayInitializer>(atomic->value);
+    size_t element_size = array_type->elementType->get_size_bytes();
+    for (size_t i = 0; i < initializer.initialize_values.size(); ++i) {
+        store_initializer(address, offset + i * element_size, initializer.initialize_values[i]);
+    }
+}
@@ -0,0 +1,463 @@
+#include "ir/ir_cfg.hpp"
+#include "ir/ir_lowering.hpp"
+
+namespace {
+
+// names of the variables whose address is taken with '&', anywhere in the statement
+struct AddressTakenVisitor {
+    std::set<std::string>& names;
+
+    void visit(const ASTStatement& statement) { std::visit(*this, statement.statement); }
+
+    void visit(const ASTExpression& expression) { std::visit(*this, expression.expression); }
+
+    void operator()(const std::shared_ptr<ASTStatementExit>& exit) { visit(exit->status_code); }
+    void operator()(const std::shared_ptr<ASTStatementVar>& var) {
+        if (var->value.has_value()) {
+            visit(var->value.value());
+        }
+    }
+    void operator()(const std::shared_ptr<ASTStatementScope>& scope) {
+        for (auto& statement : scope->statements) {
+            visit(*statement);
+        }
+    }
+    void operator()(const std::shared_ptr<ASTStatementIf>& if_statement) {
+        visit(if_statement->expression);
+        visit(*if_statement->success_statement);
+        if (if_statement->fail_statement) {
+            visit(*if_statement->fail_statement);
+        }
+    }
+    void operator()(const std::shared_ptr<ASTStatementAssign>& assign) {
+        visit(*assign->lhs);
+        visit(assign->value);
+    }
+    void operator()(const std::shared_ptr<ASTStatementWhile>& while_statement) {
+        visit(while_statement->expression);
+        visit(*while_statement->success_statement);
+    }
+    void operator()(const std::shared_ptr<ASTStatementFunction>& function) { visit(*function->statement); }
+    void operator()(const std::shared_ptr<ASTStatementReturn>& return_statement) {
+        if (return_statement->expression.has_value()) {
+            visit(return_statement->expression.value());
+        }
+    }
+    void operator()(const std::shared_ptr<ASTFunctionCall>& function_call) { (*this)(*function_call); }
+
+    void operator()(const std::shared_ptr<ASTAtomicExpression>& atomic) { std::visit(*this, atomic->value); }
+    void operator()(const ASTIntLiteral&) {}
+    void operator()(const ASTCharLiteral&) {}
+    void operator()(const ASTIdentifier&) {}
+    void operator()(const ASTParenthesisExpression& paren) { visit(*paren.expression); }
+    void operator()(const ASTFunctionCall& function_call) {
+        for (auto& parameter : function_call.parameters) {
+            visit(parameter);
+        }
+    }
+    void operator()(const ASTArrayInitializer& initializer) {
+        for (auto& value : initializer.initialize_values) {
+            visit(value);
+        }
+    }
+    void operator()(const std::shared_ptr<ASTBinExpression>& binary) {
+        visit(*binary->lhs);
+        visit(*binary->rhs);
+    }
+    void operator()(const std::shared_ptr<ASTUnaryExpression>& unary) {
+        if (unary->operation == UnaryOperation::dereference) {
+            add_lvalue_root(*unary->expression);
+        }
+        visit(*unary->expression);
+    }
+    void operator()(const std::shared_ptr<ASTArrayIndexExpression>& array_index) {
+        visit(*array_index->expression);
+        visit(*array_index->index);
+    }
+
+    // '&x'- x has to live in memory
+    void add_lvalue_root(const ASTExpression& expression) {
+        if (!std::holds_alternative<std::shared_ptr<ASTAtomicExpression>>(expression.expression)) {
+            return;
+        }
+        auto& atomic = std::get<std::shared_ptr<ASTAtomicExpression>>(expression.expression);
+        if (std::holds_alternative<ASTIdentifier>(atomic->value)) {
+            names.insert(std::get<ASTIdentifier>(atomic->value).value);
+        } else if (std::holds_alternative<ASTParenthesisExpression>(atomic->value)) {
+            add_lvalue_root(*std::get<ASTParenthesisExpression>(atomic->value).expression);
+        }
+    }
+};
+
+}  // namespace
+
+IRType ir_type_of(const std::shared_ptr<DataType>& data_type) {
+    if (!data_type) {
+        throw IRException("expression without a data type");
+    }
+    if (dynamic_cast<PointerType*>(data_type.get()) || dynamic_cast<ArrayType*>(data_type.get())) {
+        return IRType::I64;
+    }
+    if (!dynamic_cast<BasicType*>(data_type.get())) {
+        throw IRException("type '" + data_type->toString() + "' isn't supported by the IR");
+    }
+    return ir_type_from_size(data_type->get_size_bytes());
+}
+
+IRModule IRLowering::lower() {
+    m_scopes.enterScope();  // globals
+    lower_entry_function();
+    for (auto& function : m_prog.functions) {
+        lower_function(*function);
+    }
+    m_scopes.exitScope();
+    return std::move(m_module);
+}
+
+void IRLowering::lower_entry_function() {
+    IRFunction function;
+    function.name = "main";
+    function.is_entry = true;
+    std::set<std::string> address_taken;
+    AddressTakenVisitor visitor{address_taken};
+    for (auto& statement : m_prog.statements) {
+        visitor.visit(*statement);
+    }
+    m_module.functions.push_back(std::move(function));
+    begin_function(m_module.functions.back(), address_taken);
+    for (auto& statement : m_prog.statements) {
+        lower_statement(*statement);
+    }
+    // default exit statement
+    if (!current_block().is_terminated()) {
+        terminate(IRInstruction{.opcode = IROpcode::Exit, .operands = {IROperand::make_constant(0, IRType::I8)}});
+    }
+    finish_function();
+}
+
+void IRLowering::lower_function(const ASTStatementFunction& function_statement) {
+    IRFunction function;
+    function.name = function_statement.name;
+    function.return_type = ir_type_of(function_statement.return_data_type);
+    if (function_statement.inline_hint != InlineHint::NONE) {
+        function.inline_hint =
+            function_statement.inline_hint == InlineHint::always ? IRInlineHint::Always : IRInlineHint::Never;
+    }
+    for (auto& parameter : function_statement.parameters) {
+        function.parameter_types.push_back(ir_type_of(parameter.data_type));
+    }
+    std::set<std::string> address_taken;
+    AddressTakenVisitor{address_taken}.visit(*function_statement.statement);
+    m_module.functions.push_back(std::move(function));
+    begin_function(m_module.functions.back(), address_taken);
+
+    m_scopes.enterScope();
+    // the parameters come first, all of them read before anything else runs
+    std::vector<IROperand> values;
+    for (size_t i = 0; i < function_statement.parameters.size(); ++i) {
+        IRType type = ir_type_of(function_statement.parameters[i].data_type);
+        IRInstruction param{.opcode = IROpcode::Param, .type = type, .immediate = (int64_t)i};
+        values.push_back(IROperand::make_value(m_function->new_value(), type));
+        param.result = values.back().value;
+        current_block().instructions.push_back(param);
+    }
+    for (size_t i = 0; i < function_statement.parameters.size(); ++i) {
+        auto& parameter = function_statement.parameters[i];
+        auto& value = values[i];
+        bool in_memory = m_address_taken.count(parameter.name) > 0;
+        declare_variable(parameter.name, parameter.data_type, in_memory, "");
+        auto& variable = assert_get_variable(parameter.name);
+        if (in_memory) {
+            emit_void(IROpcode::Store, {value, variable.address});
+        } else {
+            write_variable(variable.ssa_index, m_current_block, value);
+        }
+    }
+    lower_statement(*function_statement.statement);
+    m_scopes.exitScope();
+
+    // falling off the end of a function returns 0
+    if (!current_block().is_terminated()) {
+        IRInstruction return_instruction{.opcode = IROpcode::Return};
+        if (m_function->return_type != IRType::Void) {
+            return_instruction.operands.push_back(IROperand::make_constant(0, m_function->return_type));
+        }
+        terminate(return_instruction);
+    }
+    finish_function();
+}
+
+void IRLowering::begin_function(IRFunction& function, const std::set<std::string>& address_taken) {
+    m_function = &function;
+    m_address_taken = address_taken;
+    m_scope_depth = function.is_entry ? 0 : 1;
+    m_allocas.clear();
+    m_ssa_types.clear();
+    m_definitions.clear();
+    m_predecessors.clear();
+    m_sealed.clear();
+    m_incomplete_phis.clear();
+    IRBlockId entry = new_block();
+    seal_block(entry);
+    set_current_block(entry);
+}
+
+void IRLowering::finish_function() {
+    auto& entry = m_function->blocks.front().instructions;
+    size_t first_non_param = 0;
+    while (first_non_param < entry.size() && entry[first_non_param].opcode == IROpcode::Param) {
+        ++first_non_param;
+    }
+    entry.insert(entry.begin() + first_non_param, m_allocas.begin(), m_allocas.end());
+    m_allocas.clear();
+
+    ir_remove_unreachable_blocks(*m_function);
+    remove_trivial_phis();
+    m_function = nullptr;
+}
+
+// ---- emission
+
+IROperand IRLowering::emit(IROpcode opcode, IRType type, std::vector<IROperand> operands) {
+    ensure_open_block();
+    IRInstruction instruction{.opcode = opcode, .type = type, .operands = std::move(operands)};
+    instruction.result = m_function->new_value();
+    current_block().instructions.push_back(instruction);
+    return instruction.result_operand();
+}
+
+void IRLowering::emit_void(IROpcode opcode, std::vector<IROperand> operands) {
+    ensure_open_block();
+    current_block().instructions.push_back(IRInstruction{.opcode = opcode, .operands = std::move(operands)});
+}
+
+IROperand IRLowering::emit_address_of(const Variable& variable) {
+    if (!variable.in_memory) {
+        throw IRException("address of a variable that isn't in memory");
+    }
+    if (variable.global_name.empty()) {
+        return variable.address;
+    }
+    ensure_open_block();
+    IRInstruction instruction{.opcode = IROpcode::GlobalAddr, .type = IRType::I64, .symbol = variable.global_name};
+    instruction.result = m_function->new_value();
+    current_block().instructions.push_back(instruction);
+    return instruction.result_operand();
+}
+
+IROperand IRLowering::convert(const IROperand& value, IRType type) {
+    if (value.type == type || type == IRType::Void) {
+        return value;
+    }
+    if (value.type == IRType::Void) {
+        throw IRException("use of a void value");
+    }
+    if (value.is_constant()) {
+        return IROperand::make_constant(value.constant, type);
+    }
+    bool widening = ir_type_size(type) > ir_type_size(value.type);
+    return emit(widening ? IROpcode::ZExt : IROpcode::Trunc, type, {value});
+}
+
+IRBlockId IRLowering::new_block() {
+    IRBlockId id = m_function->add_block().id;
+    m_predecessors.emplace_back();
+    m_sealed.push_back(false);
+    return id;
+}
+
+void IRLowering::set_current_block(IRBlockId block) { m_current_block = block; }
+
+void IRLowering::jump(IRBlockId target) {
+    terminate(IRInstruction{.opcode = IROpcode::Jump, .blocks = {target}});
+}
+
+void IRLowering::branch(const IROperand& condition, IRBlockId on_true, IRBlockId on_false) {
+    terminate(IRInstruction{.opcode = IROpcode::Branch, .operands = {condition}, .blocks = {on_true, on_false}});
+}
+
+void IRLowering::terminate(IRInstruction terminator) {
+    ensure_open_block();
+    for (auto target : terminator.blocks) {
+        m_predecessors.at(target).push_back(m_current_block);
+    }
+    current_block().instructions.push_back(std::move(terminator));
+}
+
+void IRLowering::ensure_open_block() {
+    if (!current_block().is_terminated()) {
+        return;
+    }
+    IRBlockId unreachable = new_block();
+    seal_block(unreachable);
+    set_current_block(unreachable);
+}
+
+// ---- variables
+
+void IRLowering::declare_variable(const std::string& name, const std::shared_ptr<DataType>& data_type,
+                                  bool in_memory, const std::string& global_name) {
+    Variable variable{
+        .data_type = data_type,
+        .type = ir_type_of(data_type),
+        .in_memory = in_memory,
+        .ssa_index = 0,
+        .address = IROperand::make_constant(0, IRType::I64),
+        .global_name = global_name,
+    };
+    if (!global_name.empty()) {
+        m_module.globals.push_back(IRGlobal{.name = global_name, .size_bytes = data_type->get_size_bytes()});
+    } else if (in_memory) {
+        size_t size_bytes = data_type->get_size_bytes();
+        if (size_bytes == 0) {
+            throw IRException("variable '" + name + "' has no size");
+        }
+        IRInstruction alloca{.opcode = IROpcode::Alloca, .type = IRType::I64, .immediate = (int64_t)size_bytes};
+        alloca.result = m_function->new_value();
+        variable.address = alloca.result_operand();
+        m_allocas.push_back(alloca);
+    } else {
+        variable.ssa_index = m_ssa_types.size();
+        m_ssa_types.push_back(variable.type);
+        m_definitions.emplace_back();
+    }
+    m_scopes.insert(name, variable);
+}
+
+IRLowering::Variable& IRLowering::assert_get_variable(const std::string& name) {
+    Variable* variable = nullptr;
+    if (!m_scopes.lookup(name, &variable)) {
+        throw IRException("Variable '" + name + "' does not exist!");
+    }
+    return *variable;
+}
+
+// ---- SSA construction
+
+void IRLowering::write_variable(size_t variable, IRBlockId block, const IROperand& value) {
+    m_definitions.at(variable)[block] = value;
+}
+
+IROperand IRLowering::read_variable(size_t variable, IRBlockId block) {
+    auto& definitions = m_definitions.at(variable);
+    auto definition = definitions.find(block);
+    if (definition != definitions.end()) {
+        return definition->second;
+    }
+    return read_variable_recursive(variable, block);
+}
+
+IROperand IRLowering::read_variable_recursive(size_t variable, IRBlockId block) {
+    IROperand value;
+    auto& predecessors = m_predecessors.at(block);
+    if (!m_sealed.at(block)) {
+        // not all predecessors are known yet- filled in once the block is sealed
+        IRValueId phi = new_phi(block, m_ssa_types.at(variable));
+        m_incomplete_phis[block].push_back({variable, phi});
+        value = IROperand::make_value(phi, m_ssa_types.at(variable));
+    } else if (predecessors.empty()) {
+        // read before any write(or in unreachable code)
+        value = IROperand::make_constant(0, m_ssa_types.at(variable));
+    } else if (predecessors.size() == 1) {
+        value = read_variable(variable, predecessors.front());
+    } else {
+        // the phi breaks cycles through loops
+        IRValueId phi = new_phi(block, m_ssa_types.at(variable));
+        write_variable(variable, block, IROperand::make_value(phi, m_ssa_types.at(variable)));
+        value = add_phi_operands(variable, phi, block);
+    }
+    write_variable(variable, block, value);
+    return value;
+}
+
+IROperand IRLowering::add_phi_operands(size_t variable, IRValueId phi, IRBlockId block) {
+    std::vector<IROperand> operands;
+    auto predecessors = m_predecessors.at(block);
+    for (auto predecessor : predecessors) {
+        operands.push_back(read_variable(variable, predecessor));
+    }
+    for (auto& instruction : m_function->blocks.at(block).instructions) {
+        if (instruction.opcode == IROpcode::Phi && instruction.result == phi) {
+            instruction.operands = std::move(operands);
+            instruction.blocks = predecessors;
+            break;
+        }
+    }
+    return IROperand::make_value(phi, m_ssa_types.at(variable));
+}
+
+IRValueId IRLowering::new_phi(IRBlockId block, IRType type) {
+    IRInstruction phi{.opcode = IROpcode::Phi, .type = type};
+    phi.result = m_function->new_value();
+    auto& instructions = m_function->blocks.at(block).instructions;
+    instructions.insert(instructions.begin(), phi);
+    return phi.result;
+}
+
+void IRLowering::seal_block(IRBlockId block) {
+    auto incomplete = m_incomplete_phis.find(block);
+    if (incomplete != m_incomplete_phis.end()) {
+        auto phis = std::move(incomplete->second);
+        m_incomplete_phis.erase(incomplete);
+        for (auto& [variable, phi] : phis) {
+            add_phi_operands(variable, phi, block);
+        }
+    }
+    m_sealed.at(block) = true;
+}
+
+void IRLowering::remove_trivial_phis() {
+    std::map<IRValueId, IROperand> replacements;
+    auto resolve = [&](IROperand operand) {
+        for (size_t depth = 0; operand.is_value() && depth <= replacements.size(); ++depth) {
+            auto replacement = replacements.find(operand.value);
+            if (replacement == replacements.end()) {
+                break;
+            }
+            operand = replacement->second;
+        }
+        return operand;
+    };
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (auto& block : m_function->blocks) {
+            for (auto& instruction : block.instructions) {
+                if (instruction.opcode != IROpcode::Phi || replacements.count(instruction.result)) {
+                    continue;
+                }
+                std::optional<IROperand> same;
+                bool trivial = true;
+                for (auto& operand : instruction.operands) {
+                    IROperand resolved = resolve(operand);
+                    if ((resolved.is_value() && resolved.value == instruction.result) || (same && *same == resolved)) {
+                        continue;
+                    }
+                    if (same) {
+                        trivial = false;
+                        break;
+                    }
+                    same = resolved;
+                }
+                if (trivial) {
+                    // a phi that only references itself is never initialized
+                    replacements[instruction.result] = same.value_or(IROperand::make_constant(0, instruction.type));
+                    changed = true;
+                }
+            }
+        }
+    }
+    if (replacements.empty()) {
+        return;
+    }
+    for (auto& block : m_function->blocks) {
+        auto& instructions = block.instructions;
+        instructions.erase(std::remove_if(instructions.begin(), instructions.end(),
+                                          [&](const IRInstruction& instruction) {
+                                              return instruction.opcode == IROpcode::Phi &&
+                                                     replacements.count(instruction.result);
+                                          }),
+                           instructions.end());
+    }
+    ir_replace_uses(*m_function, replacements);
+}
@@ -0,0 +1,170 @@
+#include "ir/ir_lowering.hpp"
+
+struct IRLowering::StatementVisitor {
+    IRLowering& lowering;
+
+    void operator()(const std::shared_ptr<ASTStatementExit>& exit) const { lowering.lower_statement_exit(*exit); }
+    void operator()(const std::shared_ptr<ASTStatementVar>& var_declare) const {
+        lowering.lower_statement_var_declare(*var_declare);
+    }
+    void operator()(const std::shared_ptr<ASTStatementAssign>& var_assign) const {
+        lowering.lower_statement_var_assignment(*var_assign);
+    }
+    void operator()(const std::shared_ptr<ASTStatementScope>& scope) const { lowering.lower_statement_scope(*scope); }
+    void operator()(const std::shared_ptr<ASTStatementIf>& if_statement) const {
+        lowering.lower_statement_if(*if_statement);
+    }
+    void operator()(const std::shared_ptr<ASTStatementWhile>& while_statement) const {
+        lowering.lower_statement_while(*while_statement);
+    }
+    void operator()(const std::shared_ptr<ASTStatementFunction>& function_statement) const {
+        throw IRException("function '" + function_statement->name + "' declared inside a statement");
+    }
+    void operator()(const std::shared_ptr<ASTStatementReturn>& return_statement) const {
+        lowering.lower_statement_return(*return_statement);
+    }
+    void operator()(const std::shared_ptr<ASTFunctionCall>& function_call_statement) const {
+        lowering.lower_expression_function_call(*function_call_statement, IRType::Void);
+    }
+};
+
+void IRLowering::lower_statement(const ASTStatement& statement) {
+    std::visit(IRLowering::StatementVisitor{*this}, statement.statement);
+}
+
+void IRLowering::lower_statement_exit(const ASTStatementExit& exit_statement) {
+    IROperand status_code = convert(lower_expression(exit_statement.status_code), IRType::I8);
+    terminate(IRInstruction{.opcode = IROpcode::Exit, .operands = {status_code}});
+}
+
+void IRLowering::lower_statement_var_declare(const ASTStatementVar& var_statement) {
+    auto& data_type = var_statement.data_type;
+    bool is_array = DataTypeUtils::is_array_type(data_type);
+    bool is_global = m_function->is_entry && m_scope_depth == 0;
+
+    // NOTE: the value is evaluated before the variable exists, like in the generator
+    std::optional<IROperand> value;
+    if (var_statement.value.has_value() && !is_array) {
+        value = convert(lower_expression(var_statement.value.value()), ir_type_of(data_type));
+    }
+
+    bool in_memory = is_array || is_global || m_address_taken.count(var_statement.name) > 0;
+    declare_variable(var_statement.name, data_type, in_memory, is_global ? var_statement.name : "");
+    auto& variable = assert_get_variable(var_statement.name);
+
+    if (is_array) {
+        IROperand address = emit_address_of(variable);
+        if (var_statement.value.has_value()) {
+            store_initializer(address, 0, var_statement.value.value());
+        } else if (!is_global) {
+            // globals start zeroed
+            IRInstruction zero{.opcode = IROpcode::Zero,
+                               .operands = {address},
+                               .immediate = (int64_t)data_type->get_size_bytes()};
+            ensure_open_block();
+            current_block().instructions.push_back(zero);
+        }
+        return;
+    }
+    if (!value.has_value()) {
+        if (is_global) {
+            return;
+        }
+        // uninitialized scalars start at 0, so reads are deterministic
+        value = IROperand::make_constant(0, variable.type);
+    }
+    if (variable.in_memory) {
+        emit_void(IROpcode::Store, {value.value(), emit_address_of(variable)});
+    } else {
+        write_variable(variable.ssa_index, m_current_block, value.value());
+    }
+}
+
+void IRLowering::lower_statement_var_assignment(const ASTStatementAssign& var_assign_statement) {
+    auto& lhs = *var_assign_statement.lhs;
+    IROperand value = convert(lower_expression(var_assign_statement.value), ir_type_of(lhs.data_type));
+
+    if (std::holds_alternative<std::shared_ptr<ASTAtomicExpression>>(lhs.expression)) {
+        auto& atomic = std::get<std::shared_ptr<ASTAtomicExpression>>(lhs.expression);
+        if (std::holds_alternative<ASTIdentifier>(atomic->value)) {
+            auto& variable = assert_get_variable(std::get<ASTIdentifier>(atomic->value).value);
+            if (!variable.in_memory) {
+                write_variable(variable.ssa_index, m_current_block, convert(value, variable.type));
+                return;
+            }
+        }
+    }
+    emit_void(IROpcode::Store, {value, lower_address(lhs)});
+}
+
+void IRLowering::lower_statement_scope(const ASTStatementScope& scope_statement) {
+    m_scopes.enterScope();
+    ++m_scope_depth;
+    for (auto& statement : scope_statement.statements) {
+        lower_statement(*statement);
+    }
+    --m_scope_depth;
+    m_scopes.exitScope();
+}
+
+void IRLowering::lower_statement_if(const ASTStatementIf& if_statement) {
+    IROperand condition = lower_expression(if_statement.expression);
+    IRBlockId success_block = new_block();
+    IRBlockId fail_block = if_statement.fail_statement ? new_block() : 0;
+    IRBlockId after_block = new_block();
+    if (!if_statement.fail_statement) {
+        fail_block = after_block;
+    }
+    branch(condition, success_block, fail_block);
+    seal_block(success_block);
+
+    set_current_block(success_block);
+    lower_statement(*if_statement.success_statement);
+    jump(after_block);
+
+    if (if_statement.fail_statement) {
+        seal_block(fail_block);
+        set_current_block(fail_block);
+        lower_statement(*if_statement.fail_statement);
+        jump(after_block);
+    }
+    seal_block(after_block);
+    set_current_block(after_block);
+}
+
+void IRLowering::lower_statement_while(const ASTStatementWhile& while_statement) {
+    // the condition block isn't sealed until the back edge from the body exists
+    IRBlockId condition_block = new_block();
+    jump(condition_block);
+    set_current_block(condition_block);
+    IROperand condition = lower_expression(while_statement.expression);
+
+    IRBlockId body_block = new_block();
+    IRBlockId after_block = new_block();
+    branch(condition, body_block, after_block);
+    seal_block(body_block);
+
+    set_current_block(body_block);
+    lower_statement(*while_statement.success_statement);
+    jump(condition_block);
+    seal_block(condition_block);
+    seal_block(after_block);
+    set_current_block(after_block);
+}
+
+void IRLowering::lower_statement_return(const ASTStatementReturn& return_statement) {
+    if (m_function->is_entry) {
+        throw IRException("return statement outside of a function");
+    }
+    IRInstruction return_instruction{.opcode = IROpcode::Return};
+    if (m_function->return_type != IRType::Void) {
+        IROperand value = IROperand::make_constant(0, m_function->return_type);
+        if (return_statement.expression.has_value()) {
+            value = convert(lower_expression(return_statement.expression.value()), m_function->return_type);
+        }
+        return_instruction.operands.push_back(value);
+    } else if (return_statement.expression.has_value()) {
+        lower_expression(return_statement.expression.value());
+    }
+    terminate(return_instruction);
+}
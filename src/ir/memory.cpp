@@ -0,0 +1,233 @@
+#include "ir/ir_memory.hpp"
+
+#include "ir/ir_cfg.hpp"
+
+namespace {
+
+// accesses of scalars of different sizes, which the pointers the analysis can't follow never mix
+bool are_distinct_types(IRType a, IRType b) {
+    auto is_scalar = [](IRType type) { return type != IRType::Void && !ir_is_vector(type); };
+    return is_scalar(a) && is_scalar(b) && ir_type_size(a) != ir_type_size(b);
+}
+
+}  // namespace
+
+IRMemoryObjects::IRMemoryObjects(const IRFunction& function, const IRModule& module) {
+    std::map<std::string, size_t> globals;
+    for (auto& global : module.globals) {
+        globals[global.name] = m_objects.size();
+        m_objects.push_back(
+            IRMemoryObject{.kind = IRMemoryObject::Kind::Global, .global = global.name, .size_bytes = global.size_bytes});
+    }
+    // a call may reach the globals any callable function uses- the entry function is never called
+    std::set<size_t> called_globals;
+    for (auto& other : module.functions) {
+        if (other.is_entry) {
+            continue;
+        }
+        for (auto& block : other.blocks) {
+            for (auto& instruction : block.instructions) {
+                if (instruction.opcode == IROpcode::GlobalAddr && globals.count(instruction.symbol)) {
+                    called_globals.insert(globals.at(instruction.symbol));
+                }
+            }
+        }
+    }
+
+    auto order = ir_reverse_post_order(function);
+    for (auto block_id : order) {
+        for (auto& instruction : function.find_block(block_id)->instructions) {
+            if (instruction.opcode == IROpcode::Alloca) {
+                m_points_to[instruction.result] = IRPointsTo{.objects = {m_objects.size()}};
+                m_exact[instruction.result] = true;
+                m_objects.push_back(IRMemoryObject{.kind = IRMemoryObject::Kind::Alloca,
+                                                   .alloca = instruction.result,
+                                                   .size_bytes = (size_t)instruction.immediate});
+            } else if (instruction.opcode == IROpcode::GlobalAddr && globals.count(instruction.symbol)) {
+                m_points_to[instruction.result] = IRPointsTo{.objects = {globals.at(instruction.symbol)}};
+                m_exact[instruction.result] = true;
+            }
+        }
+    }
+    m_contents.resize(m_objects.size());
+    for (auto object : called_globals) {
+        escape(object);
+    }
+
+    // every pass over the function only adds to the sets, until nothing changes
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (auto block_id : order) {
+            for (auto& instruction : function.find_block(block_id)->instructions) {
+                changed = update(instruction) || changed;
+            }
+        }
+    }
+}
+
+bool IRMemoryObjects::merge(IRPointsTo& into, const IRPointsTo& from) {
+    size_t size = into.objects.size();
+    into.objects.insert(from.objects.begin(), from.objects.end());
+    bool changed = into.objects.size() != size || (from.unknown && !into.unknown);
+    into.unknown = into.unknown || from.unknown;
+    return changed;
+}
+
+bool IRMemoryObjects::escape(size_t object) {
+    if (m_objects[object].escaped) {
+        return false;
+    }
+    m_objects[object].escaped = true;
+    // a call may store any pointer there, and read the ones already stored
+    m_contents[object].unknown = true;
+    escape(m_contents[object]);
+    return true;
+}
+
+bool IRMemoryObjects::escape(const IRPointsTo& points_to) {
+    bool changed = false;
+    for (auto object : std::set<size_t>(points_to.objects)) {
+        changed = escape(object) || changed;
+    }
+    return changed;
+}
+
+bool IRMemoryObjects::reaches_visible(const IRPointsTo& points_to) const {
+    if (points_to.unknown) {
+        return true;
+    }
+    for (auto object : points_to.objects) {
+        if (m_objects[object].escaped) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// adds what the instruction's result may point to, and the objects it lets escape
+bool IRMemoryObjects::update(const IRInstruction& instruction) {
+    auto operand = [&](size_t index) {
+        auto& value = instruction.operands[index];
+        if (value.is_constant()) {
+            return IRPointsTo{.unknown = true};
+        }
+        auto points_to = m_points_to.find(value.value);
+        return points_to == m_points_to.end() ? IRPointsTo{} : points_to->second;
+    };
+    bool changed = false;
+    auto define = [&](const IRPointsTo& points_to) {
+        changed = merge(m_points_to[instruction.result], points_to) || changed;
+    };
+    switch (instruction.opcode) {
+        case IROpcode::Alloca:
+        case IROpcode::GlobalAddr:
+            if (!m_points_to.count(instruction.result)) {
+                define(IRPointsTo{.unknown = true});
+            }
+            break;
+        case IROpcode::Add: {
+            // an offset from an address stays in the address' object
+            auto lhs = operand(0);
+            auto rhs = operand(1);
+            if (lhs.objects.empty() == rhs.objects.empty()) {
+                merge(lhs, rhs);
+                define(lhs);
+            } else {
+                define(lhs.objects.empty() ? rhs : lhs);
+            }
+            break;
+        }
+        case IROpcode::Sub: {
+            auto lhs = operand(0);
+            changed = escape(operand(1)) || changed;
+            define(lhs.objects.empty() ? IRPointsTo{.unknown = true} : lhs);
+            break;
+        }
+        case IROpcode::Phi:
+            for (size_t i = 0; i < instruction.operands.size(); ++i) {
+                define(operand(i));
+            }
+            break;
+        case IROpcode::Load: {
+            auto address = operand(0);
+            IRPointsTo loaded{.unknown = address.unknown};
+            for (auto object : address.objects) {
+                merge(loaded, m_contents[object]);
+            }
+            define(loaded);
+            break;
+        }
+        case IROpcode::Store: {
+            auto value = operand(0);
+            auto address = operand(1);
+            for (auto object : address.objects) {
+                changed = merge(m_contents[object], value) || changed;
+            }
+            if (reaches_visible(address)) {
+                changed = escape(value) || changed;
+            }
+            break;
+        }
+        case IROpcode::VectorLoad:
+            define(IRPointsTo{.unknown = true});
+            break;
+        case IROpcode::VectorStore:
+            changed = escape(operand(0)) || changed;
+            break;
+        case IROpcode::Zero:
+            break;
+        default:
+            // anything else- calls, returns, conversions, arithmetic- is beyond the analysis
+            for (size_t i = 0; i < instruction.operands.size(); ++i) {
+                changed = escape(operand(i)) || changed;
+            }
+            if (instruction.has_result()) {
+                define(IRPointsTo{.unknown = true});
+            }
+            break;
+    }
+    return changed;
+}
+
+IRPointsTo IRMemoryObjects::points_to(const IROperand& address) const {
+    if (address.is_value()) {
+        auto points_to = m_points_to.find(address.value);
+        // nothing at all only in code that never runs, or from memory never written
+        if (points_to != m_points_to.end() && (!points_to->second.objects.empty() || points_to->second.unknown)) {
+            return points_to->second;
+        }
+    }
+    return IRPointsTo{.unknown = true};
+}
+
+std::optional<size_t> IRMemoryObjects::base_object(const IROperand& address) const {
+    auto points_to = this->points_to(address);
+    if (points_to.unknown || points_to.objects.size() != 1) {
+        return std::nullopt;
+    }
+    return *points_to.objects.begin();
+}
+
+bool IRMemoryObjects::is_exact(const IROperand& address) const {
+    return address.is_value() && m_exact.count(address.value) && m_exact.at(address.value);
+}
+
+bool IRMemoryObjects::may_alias(const IROperand& a, IRType a_type, const IROperand& b, IRType b_type) const {
+    return may_alias(points_to(a), a_type, points_to(b), b_type);
+}
+
+bool IRMemoryObjects::may_alias(const IRPointsTo& a, IRType a_type, const IRPointsTo& b, IRType b_type) const {
+    for (auto object : a.objects) {
+        if (b.objects.count(object)) {
+            return true;
+        }
+    }
+    // what's left meets only through an address the analysis couldn't follow, which honours the types
+    bool meet = (a.unknown && reaches_visible(b)) || (b.unknown && reaches_visible(a));
+    return meet && !are_distinct_types(a_type, b_type);
+}
+
+bool IRMemoryObjects::is_visible_to_calls(const IROperand& address) const {
+    return reaches_visible(points_to(address));
+}
@@ -0,0 +1,172 @@
+#include "ir/ir_pass.hpp"
+
+#include <chrono>
+#include <functional>
+#include <iomanip>
+#include <sstream>
+
+#include "ir/ir_passes.hpp"
+#include "ir/ir_verifier.hpp"
+
+namespace {
+
+using PassFactory = std::function<std::unique_ptr<IRPass>(const IRPassOptions&)>;
+
+const std::map<std::string, PassFactory> pass_factories = {
+    {"simplify-cfg", [](const IRPassOptions&) { return std::make_unique<IRSimplifyCFGPass>(); }},
+    {"sccp", [](const IRPassOptions&) { return std::make_unique<IRConstantPropagationPass>(); }},
+    {"dse", [](const IRPassOptions&) { return std::make_unique<IRDeadStoreEliminationPass>(); }},
+    {"dce", [](const IRPassOptions&) { return std::make_unique<IRDeadCodeEliminationPass>(); }},
+    {"dead-functions", [](const IRPassOptions&) { return std::make_unique<IRDeadFunctionEliminationPass>(); }},
+    {"inline",
+     [](const IRPassOptions& options) { return std::make_unique<IRInlinerPass>(options.inline_threshold); }},
+    {"tail-recursion", [](const IRPassOptions&) { return std::make_unique<IRTailRecursionPass>(); }},
+    {"mem2reg", [](const IRPassOptions&) { return std::make_unique<IRPromoteMemoryPass>(); }},
+    {"gvn", [](const IRPassOptions&) { return std::make_unique<IRGlobalValueNumberingPass>(); }},
+    {"licm", [](const IRPassOptions&) { return std::make_unique<IRLoopInvariantCodeMotionPass>(); }},
+    {"loop-strength-reduce", [](const IRPassOptions&) { return std::make_unique<IRLoopStrengthReductionPass>(); }},
+    {"loop-vectorize", [](const IRPassOptions& options) { return std::make_unique<IRLoopVectorizePass>(options); }},
+    {"loop-unroll", [](const IRPassOptions& options) { return std::make_unique<IRLoopUnrollPass>(options); }},
+};
+
+const std::map<int, std::vector<std::string>> pipelines = {
+    {0, {}},
+    {1, {"inline", "tail-recursion", "mem2reg", "sccp", "simplify-cfg", "gvn", "licm", "loop-strength-reduce", "dse",
+         "dce", "simplify-cfg", "dead-functions"}},
+    {2, {"inline", "tail-recursion", "mem2reg", "sccp", "simplify-cfg", "gvn", "licm", "loop-vectorize",
+         "loop-strength-reduce", "loop-unroll", "sccp", "gvn", "dse", "dce", "simplify-cfg", "dead-functions"}},
+};
+
+// -O2 trades more code size for fewer calls
+const std::map<int, IRPassOptions> level_options = {
+    {0, IRPassOptions{.inline_threshold = 0}},
+    {1, IRPassOptions{.inline_threshold = 12}},
+    {2, IRPassOptions{.inline_threshold = 40}},
+};
+
+size_t block_count(const IRModule& module) {
+    size_t count = 0;
+    for (auto& function : module.functions) {
+        count += function.blocks.size();
+    }
+    return count;
+}
+
+}  // namespace
+
+bool IRFunctionPass::run(IRModule& module, IRPassStatistics& statistics) {
+    bool changed = false;
+    for (auto& function : module.functions) {
+        changed = run_on_function(function, module, statistics) || changed;
+    }
+    return changed;
+}
+
+std::unique_ptr<IRPass> ir_create_pass(const std::string& name, const IRPassOptions& options) {
+    auto factory = pass_factories.find(name);
+    if (factory == pass_factories.end()) {
+        throw IRException("unknown pass '" + name + "'");
+    }
+    return factory->second(options);
+}
+
+std::vector<std::string> ir_pass_names() {
+    std::vector<std::string> names;
+    for (auto& [name, factory] : pass_factories) {
+        names.push_back(name);
+    }
+    return names;
+}
+
+std::vector<std::string> ir_pipeline(int optimization_level) {
+    auto pipeline = pipelines.find(optimization_level);
+    if (pipeline == pipelines.end()) {
+        throw IRException("unknown optimization level " + std::to_string(optimization_level));
+    }
+    return pipeline->second;
+}
+
+IRPassOptions ir_pass_options(int optimization_level) {
+    auto options = level_options.find(optimization_level);
+    if (options == level_options.end()) {
+        throw IRException("unknown optimization level " + std::to_string(optimization_level));
+    }
+    return options->second;
+}
+
+void IRPassManager::add_pass(const std::string& name) { m_passes.push_back(ir_create_pass(name, m_options)); }
+
+void IRPassManager::add_pass(std::unique_ptr<IRPass> pass) { m_passes.push_back(std::move(pass)); }
+
+void IRPassManager::run(IRModule& module) {
+    for (auto& pass : m_passes) {
+        IRPassStatistics statistics;
+        statistics.pass = pass->name();
+        size_t instructions_before = module.instruction_count();
+        size_t blocks_before = block_count(module);
+        std::map<std::string, size_t> function_instructions_before;
+        for (auto& function : module.functions) {
+            function_instructions_before[function.name] = function.instruction_count();
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        pass->run(module, statistics);
+        statistics.elapsed_ms =
+            std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        size_t instructions_after = module.instruction_count();
+        size_t blocks_after = block_count(module);
+        statistics.instructions_removed =
+            instructions_before > instructions_after ? instructions_before - instructions_after : 0;
+        statistics.instructions_added =
+            instructions_after > instructions_before ? instructions_after - instructions_before : 0;
+        statistics.blocks_removed = blocks_before > blocks_after ? blocks_before - blocks_after : 0;
+        for (auto& function : module.functions) {
+            size_t before = function_instructions_before[function.name];
+            if (before > function.instruction_count()) {
+                statistics.function_instructions_removed[function.name] = before - function.instruction_count();
+            }
+        }
+        m_statistics.push_back(statistics);
+
+        if (m_remark_passes.count("all") || m_remark_passes.count(pass->name())) {
+            for (auto& remark : statistics.remarks) {
+                m_remarks += "remark: " + pass->name() + ": " + remark + "\n";
+            }
+        }
+        ir_assert_valid(module, "pass '" + pass->name() + "'");
+        if (m_print_after.count("all") || m_print_after.count(pass->name())) {
+            m_printed += "; IR after " + pass->name() + "\n" + to_string(module) + "\n";
+        }
+    }
+}
+
+std::string IRPassManager::format_statistics() const {
+    std::stringstream report;
+    report << std::left << std::setw(24) << "pass" << std::right << std::setw(12) << "time(ms)" << std::setw(12)
+           << "instrs -" << std::setw(12) << "instrs +" << std::setw(12) << "blocks -" << std::setw(12)
+           << "merged" << std::endl;
+    IRPassStatistics total;
+    for (auto& statistics : m_statistics) {
+        report << std::left << std::setw(24) << statistics.pass << std::right << std::fixed << std::setprecision(3)
+               << std::setw(12) << statistics.elapsed_ms << std::setw(12) << statistics.instructions_removed
+               << std::setw(12) << statistics.instructions_added << std::setw(12) << statistics.blocks_removed
+               << std::setw(12) << statistics.blocks_merged << std::endl;
+        for (auto& [counter, value] : statistics.counters) {
+            report << "    " << counter << ": " << value << std::endl;
+        }
+        for (auto& [function, removed] : statistics.function_instructions_removed) {
+            report << "    @" << function << " instructions removed: " << removed << std::endl;
+        }
+        total.elapsed_ms += statistics.elapsed_ms;
+        total.instructions_removed += statistics.instructions_removed;
+        total.instructions_added += statistics.instructions_added;
+        total.blocks_removed += statistics.blocks_removed;
+        total.blocks_merged += statistics.blocks_merged;
+    }
+    report << std::left << std::setw(24) << "total" << std::right << std::fixed << std::setprecision(3)
+           << std::setw(12) << total.elapsed_ms << std::setw(12) << total.instructions_removed << std::setw(12)
+           << total.instructions_added << std::setw(12) << total.blocks_removed << std::setw(12)
+           << total.blocks_merged << std::endl;
+    return report.str();
+}
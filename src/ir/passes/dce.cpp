@@ -0,0 +1,59 @@
+#include <map>
+#include <set>
+
+#include "ir/ir_cfg.hpp"
+#include "ir/ir_passes.hpp"
+
+bool IRDeadCodeEliminationPass::run_on_function(IRFunction& function, IRModule&, IRPassStatistics& statistics) {
+    size_t unreachable = ir_remove_unreachable_blocks(function);
+
+    // everything with side effects is live, so is a division that may trap, and whatever a live instruction uses.
+    // starting from the roots instead of counting uses also removes cycles of dead phis
+    std::map<IRValueId, const IRInstruction*> definitions;
+    std::vector<const IRInstruction*> worklist;
+    for (auto& block : function.blocks) {
+        for (auto& instruction : block.instructions) {
+            if (instruction.has_result()) {
+                definitions[instruction.result] = &instruction;
+            }
+            if (ir_has_side_effects(instruction.opcode) || ir_may_trap(instruction)) {
+                worklist.push_back(&instruction);
+            }
+        }
+    }
+    std::set<const IRInstruction*> live(worklist.begin(), worklist.end());
+    while (!worklist.empty()) {
+        const IRInstruction* instruction = worklist.back();
+        worklist.pop_back();
+        for (auto& operand : instruction->operands) {
+            if (!operand.is_value()) {
+                continue;
+            }
+            auto definition = definitions.find(operand.value);
+            if (definition != definitions.end() && live.insert(definition->second).second) {
+                worklist.push_back(definition->second);
+            }
+        }
+    }
+
+    size_t dead = 0;
+    for (auto& block : function.blocks) {
+        std::vector<IRInstruction> kept;
+        for (auto& instruction : block.instructions) {
+            if (live.count(&instruction)) {
+                kept.push_back(std::move(instruction));
+            } else {
+                ++dead;
+            }
+        }
+        block.instructions = std::move(kept);
+    }
+
+    if (unreachable > 0) {
+        statistics.counters["unreachable blocks"] += unreachable;
+    }
+    if (dead > 0) {
+        statistics.counters["dead instructions"] += dead;
+    }
+    return unreachable + dead > 0;
+}
@@ -0,0 +1,40 @@
+#include <algorithm>
+#include <set>
+
+#include "ir/ir_passes.hpp"
+
+bool IRDeadFunctionEliminationPass::run(IRModule& module, IRPassStatistics& statistics) {
+    std::set<std::string> reachable;
+    std::vector<const IRFunction*> worklist;
+    for (auto& function : module.functions) {
+        if (function.is_entry) {
+            reachable.insert(function.name);
+            worklist.push_back(&function);
+        }
+    }
+    while (!worklist.empty()) {
+        const IRFunction* function = worklist.back();
+        worklist.pop_back();
+        for (auto& block : function->blocks) {
+            for (auto& instruction : block.instructions) {
+                if (instruction.opcode != IROpcode::Call || reachable.count(instruction.symbol)) {
+                    continue;
+                }
+                reachable.insert(instruction.symbol);
+                if (auto* callee = module.find_function(instruction.symbol)) {
+                    worklist.push_back(callee);
+                }
+            }
+        }
+    }
+
+    size_t before = module.functions.size();
+    module.functions.erase(std::remove_if(module.functions.begin(), module.functions.end(),
+                                          [&](const IRFunction& function) { return !reachable.count(function.name); }),
+                           module.functions.end());
+    size_t removed = before - module.functions.size();
+    if (removed > 0) {
+        statistics.counters["dead functions"] += removed;
+    }
+    return removed > 0;
+}
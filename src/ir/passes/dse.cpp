@@ -0,0 +1,151 @@
+#include <set>
+
+#include "ir/ir_cfg.hpp"
+#include "ir/ir_memory.hpp"
+#include "ir/ir_passes.hpp"
+
+namespace {
+
+using LiveObjects = std::vector<bool>;
+
+// backwards liveness of memory objects- an object is live while a later load, call or return may read it
+class MemoryLiveness {
+   public:
+    MemoryLiveness(const IRFunction& function, const IRMemoryObjects& objects)
+        : m_function(function), m_objects(objects), m_live_in(function.next_block_id, LiveObjects(objects.size())) {}
+
+    void solve() {
+        auto order = ir_reverse_post_order(m_function);
+        bool changed = true;
+        while (changed) {
+            changed = false;
+            for (auto block = order.rbegin(); block != order.rend(); ++block) {
+                LiveObjects live = live_out(*m_function.find_block(*block));
+                auto& instructions = m_function.find_block(*block)->instructions;
+                for (auto instruction = instructions.rbegin(); instruction != instructions.rend(); ++instruction) {
+                    transfer(*instruction, live);
+                }
+                if (live != m_live_in[*block]) {
+                    m_live_in[*block] = live;
+                    changed = true;
+                }
+            }
+        }
+    }
+
+    // the stores and zeros writing to objects nobody reads afterwards
+    std::set<const IRInstruction*> dead_stores() const {
+        std::set<const IRInstruction*> dead;
+        for (auto& block : m_function.blocks) {
+            LiveObjects live = live_out(block);
+            for (auto instruction = block.instructions.rbegin(); instruction != block.instructions.rend();
+                 ++instruction) {
+                if (is_write(*instruction)) {
+                    auto object = m_objects.base_object(write_address(*instruction));
+                    if (object && !live[*object]) {
+                        dead.insert(&*instruction);
+                        continue;
+                    }
+                }
+                transfer(*instruction, live);
+            }
+        }
+        return dead;
+    }
+
+   private:
+    const IRFunction& m_function;
+    const IRMemoryObjects& m_objects;
+    std::vector<LiveObjects> m_live_in;
+
+    static bool is_write(const IRInstruction& instruction) {
+        return instruction.opcode == IROpcode::Store || instruction.opcode == IROpcode::VectorStore ||
+               instruction.opcode == IROpcode::Zero;
+    }
+
+    static const IROperand& write_address(const IRInstruction& instruction) {
+        return instruction.opcode == IROpcode::Zero ? instruction.operands[0] : instruction.operands[1];
+    }
+
+    LiveObjects live_out(const IRBasicBlock& block) const {
+        LiveObjects live(m_objects.size());
+        auto& terminator = block.terminator();
+        if (terminator.opcode == IROpcode::Return) {
+            // the caller may read the globals, while the allocas die with the frame
+            for (size_t object = 0; object < m_objects.size(); ++object) {
+                live[object] = m_objects.object(object).kind == IRMemoryObject::Kind::Global;
+            }
+        }
+        // nothing is read after an exit
+        for (auto successor : block.successors()) {
+            for (size_t object = 0; object < m_objects.size(); ++object) {
+                live[object] = live[object] || m_live_in[successor][object];
+            }
+        }
+        return live;
+    }
+
+    void read_visible(LiveObjects& live) const {
+        for (size_t object = 0; object < m_objects.size(); ++object) {
+            live[object] = live[object] || m_objects.is_visible(object);
+        }
+    }
+
+    void transfer(const IRInstruction& instruction, LiveObjects& live) const {
+        switch (instruction.opcode) {
+            case IROpcode::Load:
+            case IROpcode::VectorLoad: {
+                auto points_to = m_objects.points_to(instruction.operands[0]);
+                for (auto object : points_to.objects) {
+                    live[object] = true;
+                }
+                if (points_to.unknown) {
+                    read_visible(live);
+                }
+                return;
+            }
+            case IROpcode::Call:
+                read_visible(live);
+                return;
+            case IROpcode::Store:
+            case IROpcode::VectorStore:
+            case IROpcode::Zero: {
+                // only a write covering the whole object hides what was stored before
+                auto& address = write_address(instruction);
+                auto object = m_objects.base_object(address);
+                size_t size_bytes = instruction.opcode == IROpcode::Zero ? (size_t)instruction.immediate
+                                                                         : ir_type_size(instruction.operands[0].type);
+                if (object && m_objects.is_exact(address) && size_bytes >= m_objects.object(*object).size_bytes) {
+                    live[*object] = false;
+                }
+                return;
+            }
+            default:
+                return;
+        }
+    }
+};
+
+}  // namespace
+
+bool IRDeadStoreEliminationPass::run_on_function(IRFunction& function, IRModule& module,
+                                                 IRPassStatistics& statistics) {
+    IRMemoryObjects objects(function, module);
+    MemoryLiveness liveness(function, objects);
+    liveness.solve();
+    auto dead = liveness.dead_stores();
+    if (dead.empty()) {
+        return false;
+    }
+    for (auto& block : function.blocks) {
+        std::vector<IRInstruction> kept;
+        for (auto& instruction : block.instructions) {
+            if (!dead.count(&instruction)) {
+                kept.push_back(std::move(instruction));
+            }
+        }
+        block.instructions = std::move(kept);
+    }
+    statistics.counters["dead stores"] += dead.size();
+    return true;
+}
@@ -0,0 +1,236 @@
+#include <algorithm>
+#include <set>
+#include <tuple>
+
+#include "ir/ir_cfg.hpp"
+#include "ir/ir_memory.hpp"
+#include "ir/ir_passes.hpp"
+
+namespace {
+
+// an operand by what it is, regardless of which instruction it belongs to
+using OperandKey = std::tuple<bool, int64_t, IRType>;
+
+OperandKey operand_key(const IROperand& operand) {
+    return {operand.is_constant(), operand.is_constant() ? operand.constant : (int64_t)operand.value, operand.type};
+}
+
+// what an instruction computes- two instructions of the same key compute the same value
+struct ExpressionKey {
+    IROpcode opcode;
+    IRType type;
+    std::vector<OperandKey> operands;
+    std::string symbol;
+    int64_t immediate;
+
+    bool operator<(const ExpressionKey& other) const {
+        return std::tie(opcode, type, operands, symbol, immediate) <
+               std::tie(other.opcode, other.type, other.operands, other.symbol, other.immediate);
+    }
+};
+
+bool is_commutative(IROpcode opcode) {
+    return opcode == IROpcode::Add || opcode == IROpcode::Mul || opcode == IROpcode::CmpEq ||
+           opcode == IROpcode::VectorAdd || opcode == IROpcode::VectorMul;
+}
+
+// the result depends on the operands alone- the same operands give the same result anywhere the operands are
+bool is_pure(IROpcode opcode) {
+    switch (opcode) {
+        case IROpcode::GlobalAddr:
+        case IROpcode::VectorSplat:
+        case IROpcode::VectorAdd:
+        case IROpcode::VectorSub:
+        case IROpcode::VectorMul:
+        case IROpcode::VectorReduceAdd:
+            return true;
+        default:
+            return ir_is_foldable(opcode);
+    }
+}
+
+ExpressionKey expression_key(const IRInstruction& instruction) {
+    ExpressionKey key{.opcode = instruction.opcode,
+                      .type = instruction.type,
+                      .operands = {},
+                      .symbol = instruction.symbol,
+                      .immediate = instruction.immediate};
+    for (auto& operand : instruction.operands) {
+        key.operands.push_back(operand_key(operand));
+    }
+    if (is_commutative(instruction.opcode)) {
+        std::sort(key.operands.begin(), key.operands.end());
+    }
+    return key;
+}
+
+// the memory contents known at a point- the value each address holds, read by a load or written by a store
+struct KnownValue {
+    IROperand address;
+    IROperand value;
+};
+using MemoryState = std::map<std::pair<OperandKey, IRType>, KnownValue>;
+
+class ValueNumbering {
+   public:
+    ValueNumbering(IRFunction& function, IRModule& module, IRPassStatistics& statistics)
+        : m_function(function),
+          m_objects(function, module),
+          m_dominators(function),
+          m_predecessors(ir_predecessors(function)),
+          m_statistics(statistics) {}
+
+    bool run() {
+        IRBlockId entry = m_function.blocks.front().id;
+        visit(entry, {}, {});
+        if (m_removed.empty()) {
+            return false;
+        }
+        for (auto& block : m_function.blocks) {
+            std::vector<IRInstruction> kept;
+            for (auto& instruction : block.instructions) {
+                if (!m_removed.count(instruction.result)) {
+                    kept.push_back(std::move(instruction));
+                }
+            }
+            block.instructions = std::move(kept);
+        }
+        ir_replace_uses(m_function, m_replacements);
+        if (m_expressions_eliminated > 0) {
+            m_statistics.counters["expressions eliminated"] += m_expressions_eliminated;
+        }
+        if (m_loads_eliminated > 0) {
+            m_statistics.counters["loads eliminated"] += m_loads_eliminated;
+        }
+        return true;
+    }
+
+   private:
+    IRFunction& m_function;
+    IRMemoryObjects m_objects;
+    IRDominatorTree m_dominators;
+    std::vector<std::vector<IRBlockId>> m_predecessors;
+    IRPassStatistics& m_statistics;
+    std::map<IRValueId, IROperand> m_replacements;
+    std::set<IRValueId> m_removed;
+    size_t m_expressions_eliminated = 0;
+    size_t m_loads_eliminated = 0;
+
+    IROperand replaced(const IROperand& operand) const {
+        IROperand result = operand;
+        while (result.is_value() && m_replacements.count(result.value)) {
+            result = m_replacements.at(result.value);
+        }
+        return result;
+    }
+
+    void eliminate(const IRInstruction& instruction, const IROperand& replacement) {
+        m_replacements[instruction.result] = replacement;
+        m_removed.insert(instruction.result);
+    }
+
+    // forgets what memory the instruction may change
+    void clobber(const IRInstruction& instruction, MemoryState& memory) const {
+        auto forget_if = [&](auto may_change) {
+            for (auto known = memory.begin(); known != memory.end();) {
+                known = may_change(known->second.address, known->first.second) ? memory.erase(known) : std::next(known);
+            }
+        };
+        switch (instruction.opcode) {
+            case IROpcode::Store:
+            case IROpcode::VectorStore:
+            case IROpcode::Zero: {
+                bool is_zero = instruction.opcode == IROpcode::Zero;
+                IROperand written = replaced(is_zero ? instruction.operands[0] : instruction.operands[1]);
+                IRType written_type = is_zero ? IRType::Void : instruction.operands[0].type;
+                forget_if([&](const IROperand& address, IRType type) {
+                    return m_objects.may_alias(address, type, written, written_type);
+                });
+                return;
+            }
+            case IROpcode::Call:
+                forget_if([&](const IROperand& address, IRType) { return m_objects.is_visible_to_calls(address); });
+                return;
+            default:
+                return;
+        }
+    }
+
+    // the memory state on entry to 'block', from the state at the end of its immediate dominator- less what
+    // the blocks on the paths between the two may change
+    MemoryState entry_memory(IRBlockId block, IRBlockId dominator, MemoryState memory) const {
+        auto& predecessors = m_predecessors[block];
+        if (predecessors.size() == 1 && predecessors.front() == dominator) {
+            return memory;
+        }
+        std::set<IRBlockId> between;
+        std::vector<IRBlockId> worklist(predecessors.begin(), predecessors.end());
+        while (!worklist.empty() && !memory.empty()) {
+            IRBlockId current = worklist.back();
+            worklist.pop_back();
+            if (current == dominator || !m_dominators.is_reachable(current) || !between.insert(current).second) {
+                continue;
+            }
+            for (auto& instruction : m_function.find_block(current)->instructions) {
+                clobber(instruction, memory);
+            }
+            worklist.insert(worklist.end(), m_predecessors[current].begin(), m_predecessors[current].end());
+        }
+        return memory;
+    }
+
+    // the dominator tree depth first- the expressions of a block are available in the blocks it dominates
+    void visit(IRBlockId block_id, std::map<ExpressionKey, IROperand> expressions, MemoryState memory) {
+        for (auto& instruction : m_function.find_block(block_id)->instructions) {
+            if (instruction.opcode == IROpcode::Phi) {
+                continue;
+            }
+            for (auto& operand : instruction.operands) {
+                operand = replaced(operand);
+            }
+            if (is_pure(instruction.opcode)) {
+                auto [existing, inserted] = expressions.insert({expression_key(instruction), instruction.result_operand()});
+                if (!inserted) {
+                    eliminate(instruction, existing->second);
+                    ++m_expressions_eliminated;
+                }
+                continue;
+            }
+            switch (instruction.opcode) {
+                case IROpcode::Load:
+                case IROpcode::VectorLoad: {
+                    std::pair<OperandKey, IRType> key{operand_key(instruction.operands[0]), instruction.type};
+                    auto known = memory.find(key);
+                    if (known != memory.end()) {
+                        eliminate(instruction, known->second.value);
+                        ++m_loads_eliminated;
+                    } else {
+                        memory[key] = KnownValue{instruction.operands[0], instruction.result_operand()};
+                    }
+                    break;
+                }
+                case IROpcode::Store:
+                case IROpcode::VectorStore: {
+                    clobber(instruction, memory);
+                    auto& value = instruction.operands[0];
+                    auto& address = instruction.operands[1];
+                    memory[{operand_key(address), value.type}] = KnownValue{address, value};
+                    break;
+                }
+                default:
+                    clobber(instruction, memory);
+                    break;
+            }
+        }
+        for (auto child : m_dominators.children(block_id)) {
+            visit(child, expressions, entry_memory(child, block_id, memory));
+        }
+    }
+};
+
+}  // namespace
+
+bool IRGlobalValueNumberingPass::run_on_function(IRFunction& function, IRModule& module,
+                                                 IRPassStatistics& statistics) {
+    return ValueNumbering(function, module, statistics).run();
+}
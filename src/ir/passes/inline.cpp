@@ -0,0 +1,281 @@
+#include <algorithm>
+#include <functional>
+#include <map>
+#include <set>
+
+#include "ir/ir_cfg.hpp"
+#include "ir/ir_passes.hpp"
+
+namespace {
+
+// a caller growing past this stops taking callees in, other than the annotated ones
+constexpr size_t MAX_CALLER_SIZE = 4000;
+
+struct CallGraph {
+    std::map<std::string, std::set<std::string>> callees;
+    // callee -> number of calls to it in the module
+    std::map<std::string, size_t> call_sites;
+    std::set<std::string> recursive;
+    // callees before their callers
+    std::vector<std::string> bottom_up;
+};
+
+void collect_calls(const IRFunction& function, const std::function<void(const IRInstruction&)>& on_call) {
+    for (auto& block : function.blocks) {
+        for (auto& instruction : block.instructions) {
+            if (instruction.opcode == IROpcode::Call) {
+                on_call(instruction);
+            }
+        }
+    }
+}
+
+CallGraph build_call_graph(const IRModule& module) {
+    CallGraph graph;
+    for (auto& function : module.functions) {
+        auto& callees = graph.callees[function.name];
+        collect_calls(function, [&](const IRInstruction& call) {
+            callees.insert(call.symbol);
+            ++graph.call_sites[call.symbol];
+        });
+    }
+
+    // a function is recursive when it reaches itself
+    for (auto& function : module.functions) {
+        std::set<std::string> visited;
+        std::vector<std::string> worklist(graph.callees[function.name].begin(), graph.callees[function.name].end());
+        while (!worklist.empty()) {
+            std::string callee = worklist.back();
+            worklist.pop_back();
+            if (callee == function.name) {
+                graph.recursive.insert(function.name);
+                break;
+            }
+            if (!visited.insert(callee).second) {
+                continue;
+            }
+            for (auto& next : graph.callees[callee]) {
+                worklist.push_back(next);
+            }
+        }
+    }
+
+    // post-order of a depth first search from every function
+    std::set<std::string> visited;
+    std::function<void(const std::string&)> visit = [&](const std::string& name) {
+        if (!visited.insert(name).second || !module.find_function(name)) {
+            return;
+        }
+        for (auto& callee : graph.callees[name]) {
+            visit(callee);
+        }
+        graph.bottom_up.push_back(name);
+    };
+    for (auto& function : module.functions) {
+        visit(function.name);
+    }
+    return graph;
+}
+
+// the instructions the body would add to a caller
+size_t body_size(const IRFunction& function) {
+    size_t size = 0;
+    for (auto& block : function.blocks) {
+        for (auto& instruction : block.instructions) {
+            if (instruction.opcode != IROpcode::Param && instruction.opcode != IROpcode::Alloca) {
+                ++size;
+            }
+        }
+    }
+    return size;
+}
+
+class Inliner {
+   public:
+    Inliner(IRModule& module, int threshold, IRPassStatistics& statistics)
+        : m_module(module), m_threshold(threshold), m_statistics(statistics), m_graph(build_call_graph(module)) {}
+
+    bool run() {
+        bool changed = false;
+        for (auto& name : m_graph.bottom_up) {
+            changed = inline_calls(*m_module.find_function(name)) || changed;
+        }
+        return changed;
+    }
+
+   private:
+    IRModule& m_module;
+    int m_threshold;
+    IRPassStatistics& m_statistics;
+    CallGraph m_graph;
+
+    bool inline_calls(IRFunction& caller) {
+        bool changed = false;
+        // inlined bodies are placed right after the call's block, so the scan goes through them as well
+        for (size_t block_index = 0; block_index < caller.blocks.size(); ++block_index) {
+            auto& instructions = caller.blocks[block_index].instructions;
+            for (size_t index = 0; index < instructions.size(); ++index) {
+                if (instructions[index].opcode != IROpcode::Call) {
+                    continue;
+                }
+                const IRFunction* callee = m_module.find_function(instructions[index].symbol);
+                if (!callee || !should_inline(caller, *callee, instructions[index])) {
+                    continue;
+                }
+                inline_call(caller, block_index, index, *callee);
+                changed = true;
+                break;
+            }
+        }
+        return changed;
+    }
+
+    bool should_inline(const IRFunction& caller, const IRFunction& callee, const IRInstruction& call) {
+        std::string names = "'" + callee.name + "' into '" + caller.name + "'";
+        auto decline = [&](const std::string& reason) {
+            m_statistics.remarks.push_back("not inlined " + names + ": " + reason);
+            return false;
+        };
+        auto accept = [&](const std::string& reason) {
+            m_statistics.remarks.push_back("inlined " + names + ": " + reason);
+            return true;
+        };
+
+        if (callee.is_entry || callee.blocks.empty()) {
+            return false;
+        }
+        if (callee.name == caller.name || m_graph.recursive.count(callee.name)) {
+            return decline("recursive");
+        }
+        if (callee.inline_hint == IRInlineHint::Never) {
+            return decline("'noinline' annotation");
+        }
+        if (callee.inline_hint == IRInlineHint::Always) {
+            return accept("'inline' annotation");
+        }
+        size_t size = body_size(callee);
+        if (caller.instruction_count() + size > MAX_CALLER_SIZE) {
+            return decline("caller too large");
+        }
+        if (m_graph.call_sites[callee.name] == 1) {
+            return accept("single call site");
+        }
+        // the call, its arguments and the return are saved, and constant arguments usually fold the body further
+        int cost = (int)size - 2 - (int)call.operands.size();
+        for (auto& argument : call.operands) {
+            cost -= argument.is_constant() ? 2 : 0;
+        }
+        std::string cost_description = "cost " + std::to_string(cost);
+        if (cost > m_threshold) {
+            return decline(cost_description + " over threshold " + std::to_string(m_threshold));
+        }
+        return accept(cost_description + " within threshold " + std::to_string(m_threshold));
+    }
+
+    // splits the call's block in two, and places a copy of the callee's blocks between the halves
+    void inline_call(IRFunction& caller, size_t block_index, size_t call_index, const IRFunction& callee) {
+        IRInstruction call = caller.blocks[block_index].instructions[call_index];
+        IRBlockId head_id = caller.blocks[block_index].id;
+
+        IRBasicBlock tail{.id = caller.next_block_id++, .instructions = {}};
+        auto& head_instructions = caller.blocks[block_index].instructions;
+        tail.instructions.assign(std::make_move_iterator(head_instructions.begin() + call_index + 1),
+                                 std::make_move_iterator(head_instructions.end()));
+        head_instructions.resize(call_index);
+        for (auto successor : tail.successors()) {
+            for (auto& instruction : caller.find_block(successor)->instructions) {
+                if (instruction.opcode != IROpcode::Phi) {
+                    break;
+                }
+                std::replace(instruction.blocks.begin(), instruction.blocks.end(), head_id, tail.id);
+            }
+        }
+
+        // callee value -> caller operand, callee block -> caller block
+        std::map<IRValueId, IROperand> values;
+        std::map<IRBlockId, IRBlockId> blocks;
+        for (auto& block : callee.blocks) {
+            blocks[block.id] = caller.next_block_id++;
+            for (auto& instruction : block.instructions) {
+                if (instruction.opcode == IROpcode::Param) {
+                    values[instruction.result] = call.operands.at(instruction.immediate);
+                } else if (instruction.has_result()) {
+                    values[instruction.result] = IROperand::make_value(caller.new_value(), instruction.type);
+                }
+            }
+        }
+
+        std::vector<IRBasicBlock> body;
+        std::vector<IRInstruction> allocas;
+        IRInstruction result_phi{.opcode = IROpcode::Phi, .type = call.type};
+        for (auto& block : callee.blocks) {
+            IRBasicBlock copy{.id = blocks.at(block.id), .instructions = {}};
+            for (auto& instruction : block.instructions) {
+                if (instruction.opcode == IROpcode::Param) {
+                    continue;
+                }
+                IRInstruction cloned = instruction;
+                if (cloned.has_result()) {
+                    cloned.result = values.at(instruction.result).value;
+                }
+                for (auto& operand : cloned.operands) {
+                    if (operand.is_value()) {
+                        operand = values.at(operand.value);
+                    }
+                }
+                for (auto& target : cloned.blocks) {
+                    target = blocks.at(target);
+                }
+                if (cloned.opcode == IROpcode::Return) {
+                    if (call.has_result()) {
+                        result_phi.operands.push_back(cloned.operands.at(0));
+                        result_phi.blocks.push_back(copy.id);
+                    }
+                    cloned = IRInstruction{.opcode = IROpcode::Jump, .blocks = {tail.id}};
+                }
+                if (cloned.opcode == IROpcode::Alloca) {
+                    allocas.push_back(std::move(cloned));
+                } else {
+                    copy.instructions.push_back(std::move(cloned));
+                }
+            }
+            body.push_back(std::move(copy));
+        }
+        head_instructions.push_back(
+            IRInstruction{.opcode = IROpcode::Jump, .blocks = {blocks.at(callee.blocks.front().id)}});
+
+        // a callee that never returns- it always exits- leaves the result unused
+        IROperand result = IROperand::make_constant(0, call.type);
+        if (result_phi.operands.size() == 1) {
+            result = result_phi.operands.front();
+        } else if (result_phi.operands.size() > 1) {
+            result_phi.result = caller.new_value();
+            result = result_phi.result_operand();
+            tail.instructions.insert(tail.instructions.begin(), std::move(result_phi));
+        }
+
+        body.push_back(std::move(tail));
+        caller.blocks.insert(caller.blocks.begin() + block_index + 1, std::make_move_iterator(body.begin()),
+                             std::make_move_iterator(body.end()));
+        if (call.has_result()) {
+            ir_replace_uses(caller, call.result, result);
+        }
+        // the frame is laid out from the allocas wherever they are, but keeping them with the caller's own
+        // allocas keeps them out of loops
+        auto& entry = caller.blocks.front().instructions;
+        auto first_non_param = std::find_if(entry.begin(), entry.end(), [](const IRInstruction& instruction) {
+            return instruction.opcode != IROpcode::Param;
+        });
+        entry.insert(first_non_param, std::make_move_iterator(allocas.begin()), std::make_move_iterator(allocas.end()));
+
+        --m_graph.call_sites[callee.name];
+        collect_calls(callee, [&](const IRInstruction& inlined_call) { ++m_graph.call_sites[inlined_call.symbol]; });
+        m_statistics.counters["calls inlined"] += 1;
+    }
+};
+
+}  // namespace
+
+bool IRInlinerPass::run(IRModule& module, IRPassStatistics& statistics) {
+    return Inliner(module, m_threshold, statistics).run();
+}
@@ -0,0 +1,285 @@
+#include <algorithm>
+#include <set>
+
+#include "ir/ir_cfg.hpp"
+#include "ir/ir_loops.hpp"
+#include "ir/ir_memory.hpp"
+#include "ir/ir_passes.hpp"
+
+namespace {
+
+const IROperand* access_address(const IRInstruction& instruction) {
+    switch (instruction.opcode) {
+        case IROpcode::Load:
+        case IROpcode::VectorLoad:
+        case IROpcode::Zero:
+            return &instruction.operands[0];
+        case IROpcode::Store:
+        case IROpcode::VectorStore:
+            return &instruction.operands[1];
+        default:
+            return nullptr;
+    }
+}
+
+// the same result wherever it's computed, and nothing else happens- division traps on zero
+bool is_hoistable(const IRInstruction& instruction) {
+    if (instruction.opcode == IROpcode::GlobalAddr) {
+        return true;
+    }
+    return ir_is_foldable(instruction.opcode) && !ir_may_trap(instruction);
+}
+
+class LoopOptimizer {
+   public:
+    LoopOptimizer(IRFunction& function, IRModule& module, const IRLoop& loop, IRPassStatistics& statistics)
+        : m_function(function), m_module(module), m_loop(loop), m_statistics(statistics) {}
+
+    bool run() {
+        m_preheader = ir_ensure_preheader(m_function, m_loop);
+        bool changed = promote_objects();
+        return hoist_invariants() || changed;
+    }
+
+   private:
+    IRFunction& m_function;
+    IRModule& m_module;
+    const IRLoop& m_loop;
+    IRPassStatistics& m_statistics;
+    IRBlockId m_preheader = 0;
+
+    // the loop's blocks, every dominator before the blocks it dominates
+    std::vector<IRBlockId> loop_order() const {
+        std::vector<IRBlockId> order;
+        for (auto block : ir_reverse_post_order(m_function)) {
+            if (m_loop.contains(block)) {
+                order.push_back(block);
+            }
+        }
+        return order;
+    }
+
+    void insert_in_preheader(IRInstruction instruction) {
+        auto& instructions = m_function.find_block(m_preheader)->instructions;
+        instructions.insert(instructions.end() - 1, std::move(instruction));
+    }
+
+    // moves the instructions whose operands don't change in the loop to the end of the preheader
+    bool hoist_invariants() {
+        auto definitions = ir_definition_blocks(m_function);
+        auto is_invariant = [&](const IROperand& operand) {
+            return operand.is_constant() || !m_loop.contains(definitions.at(operand.value));
+        };
+        size_t hoisted = 0;
+        for (auto block_id : loop_order()) {
+            auto& instructions = m_function.find_block(block_id)->instructions;
+            for (size_t i = 0; i < instructions.size();) {
+                auto& instruction = instructions[i];
+                if (!is_hoistable(instruction) ||
+                    !std::all_of(instruction.operands.begin(), instruction.operands.end(), is_invariant)) {
+                    ++i;
+                    continue;
+                }
+                definitions[instruction.result] = m_preheader;
+                insert_in_preheader(std::move(instruction));
+                // the preheader is outside the loop, so the insertion left this block alone
+                auto& block = m_function.find_block(block_id)->instructions;
+                block.erase(block.begin() + i);
+                ++hoisted;
+            }
+        }
+        m_statistics.counters["instructions hoisted"] += hoisted;
+        return hoisted > 0;
+    }
+
+    // keeps the memory objects the loop accesses as a whole in values instead, loaded in the preheader and stored
+    // back on the way out
+    bool promote_objects() {
+        IRMemoryObjects objects(m_function, m_module);
+        bool has_calls = false;
+        // the accesses through addresses that may point into more than one object, (points-to, type)
+        std::vector<std::pair<IRPointsTo, IRType>> unknown_accesses;
+        // object -> the type of every access, or Void once it can't be promoted
+        std::map<size_t, IRType> access_types;
+        std::set<size_t> written;
+        for (auto block : m_loop.blocks) {
+            for (auto& instruction : m_function.find_block(block)->instructions) {
+                has_calls = has_calls || instruction.opcode == IROpcode::Call;
+                auto address = access_address(instruction);
+                if (!address) {
+                    continue;
+                }
+                // vectors are never promoted, the accesses of their lanes are left as they are
+                IRType type = instruction.opcode == IROpcode::Load    ? instruction.type
+                              : instruction.opcode == IROpcode::Store ? instruction.operands[0].type
+                                                                      : IRType::Void;
+                auto object = objects.base_object(*address);
+                if (!object) {
+                    auto points_to = objects.points_to(*address);
+                    for (auto other : points_to.objects) {
+                        access_types[other] = IRType::Void;
+                    }
+                    unknown_accesses.push_back({points_to, type});
+                    continue;
+                }
+                bool whole = objects.is_exact(*address) && type != IRType::Void &&
+                             ir_type_size(type) == objects.object(*object).size_bytes;
+                auto known = access_types.find(*object);
+                if (!whole || (known != access_types.end() && known->second != type)) {
+                    access_types[*object] = IRType::Void;
+                } else {
+                    access_types.insert({*object, type});
+                }
+                if (ir_has_side_effects(instruction.opcode)) {
+                    written.insert(*object);
+                }
+            }
+        }
+
+        size_t promoted = 0;
+        for (auto [object, type] : access_types) {
+            IRPointsTo whole{.objects = {object}};
+            bool is_reached = std::any_of(unknown_accesses.begin(), unknown_accesses.end(), [&](const auto& access) {
+                return objects.may_alias(whole, type, access.first, access.second);
+            });
+            if (type == IRType::Void || (objects.is_visible(object) && has_calls) || is_reached) {
+                continue;
+            }
+            promote(objects, object, type, written.count(object) > 0);
+            ++promoted;
+        }
+        m_statistics.counters["objects promoted"] += promoted;
+        return promoted > 0;
+    }
+
+    void promote(const IRMemoryObjects& objects, size_t object, IRType type, bool is_written) {
+        auto& memory_object = objects.object(object);
+        IROperand address = IROperand::make_value(memory_object.alloca, IRType::I64);
+        if (memory_object.kind == IRMemoryObject::Kind::Global) {
+            IRInstruction global_address{.opcode = IROpcode::GlobalAddr,
+                                         .type = IRType::I64,
+                                         .result = m_function.new_value(),
+                                         .symbol = memory_object.global};
+            address = global_address.result_operand();
+            insert_in_preheader(std::move(global_address));
+        }
+        IRInstruction initial{
+            .opcode = IROpcode::Load, .type = type, .result = m_function.new_value(), .operands = {address}};
+        IROperand initial_value = initial.result_operand();
+        insert_in_preheader(std::move(initial));
+
+        // the object's value at the end of every block, merged by phis where blocks join
+        auto predecessors = ir_predecessors(m_function);
+        std::map<IRBlockId, IROperand> end_values;
+        std::vector<std::pair<IRBlockId, IRValueId>> phis;
+        std::map<IRValueId, IROperand> replacements;
+        for (auto block_id : loop_order()) {
+            auto& instructions = m_function.find_block(block_id)->instructions;
+            IROperand current;
+            if (block_id == m_loop.header || predecessors[block_id].size() > 1) {
+                IRInstruction phi{.opcode = IROpcode::Phi, .type = type, .result = m_function.new_value()};
+                current = phi.result_operand();
+                phis.push_back({block_id, phi.result});
+                instructions.insert(instructions.begin(), std::move(phi));
+            } else {
+                current = end_values.at(predecessors[block_id].front());
+            }
+            for (size_t i = 0; i < instructions.size();) {
+                auto& instruction = instructions[i];
+                auto address_operand = access_address(instruction);
+                if (!address_operand || objects.base_object(*address_operand) != object) {
+                    ++i;
+                    continue;
+                }
+                if (instruction.opcode == IROpcode::Load) {
+                    replacements[instruction.result] = current;
+                } else {
+                    current = instruction.operands[0];
+                }
+                instructions.erase(instructions.begin() + i);
+            }
+            end_values[block_id] = current;
+        }
+        for (auto [block_id, value] : phis) {
+            auto& block = *m_function.find_block(block_id);
+            auto phi = std::find_if(block.instructions.begin(), block.instructions.end(),
+                                    [&](const IRInstruction& instruction) { return instruction.result == value; });
+            for (auto predecessor : predecessors[block_id]) {
+                phi->operands.push_back(m_loop.contains(predecessor) ? end_values.at(predecessor) : initial_value);
+                phi->blocks.push_back(predecessor);
+            }
+        }
+
+        if (is_written) {
+            auto exits = ir_loop_exits(m_function, m_loop);
+            std::sort(exits.begin(), exits.end());
+            exits.erase(std::unique(exits.begin(), exits.end()), exits.end());
+            for (auto [from, to] : exits) {
+                // a target reached from elsewhere too gets a block of its own on the edge
+                IRBlockId target = predecessors[to].size() == 1 ? to : ir_split_edge(m_function, from, to);
+                auto& instructions = m_function.find_block(target)->instructions;
+                auto position = std::find_if(instructions.begin(), instructions.end(), [](const IRInstruction& i) {
+                    return i.opcode != IROpcode::Phi;
+                });
+                instructions.insert(position, IRInstruction{.opcode = IROpcode::Store,
+                                                            .operands = {end_values.at(from), address}});
+            }
+        }
+
+        ir_replace_uses(m_function, replacements);
+        remove_trivial_phis(phis);
+    }
+
+    // the phis merging the same value from every side, or themselves around the loop
+    void remove_trivial_phis(const std::vector<std::pair<IRBlockId, IRValueId>>& phis) {
+        bool changed = true;
+        std::set<IRValueId> removed;
+        while (changed) {
+            changed = false;
+            for (auto [block_id, value] : phis) {
+                if (removed.count(value)) {
+                    continue;
+                }
+                auto& instructions = m_function.find_block(block_id)->instructions;
+                auto phi = std::find_if(instructions.begin(), instructions.end(),
+                                        [&](const IRInstruction& instruction) { return instruction.result == value; });
+                std::optional<IROperand> incoming;
+                bool trivial = true;
+                for (auto& operand : phi->operands) {
+                    if (operand == phi->result_operand() || (incoming && operand == *incoming)) {
+                        continue;
+                    }
+                    trivial = trivial && !incoming;
+                    incoming = operand;
+                }
+                if (!trivial || !incoming) {
+                    continue;
+                }
+                instructions.erase(phi);
+                ir_replace_uses(m_function, value, *incoming);
+                removed.insert(value);
+                changed = true;
+            }
+        }
+    }
+};
+
+}  // namespace
+
+bool IRLoopInvariantCodeMotionPass::run_on_function(IRFunction& function, IRModule& module,
+                                                    IRPassStatistics& statistics) {
+    bool changed = false;
+    // every change reshapes the loops, which are found again- by their headers, inner loops first
+    std::set<IRBlockId> done;
+    while (true) {
+        auto loops = ir_find_loops(function);
+        auto loop = std::find_if(loops.begin(), loops.end(), [&](const IRLoop& loop) {
+            return !done.count(loop.header) && loop.header != function.blocks.front().id;
+        });
+        if (loop == loops.end()) {
+            return changed;
+        }
+        done.insert(loop->header);
+        changed = LoopOptimizer(function, module, *loop, statistics).run() || changed;
+    }
+}
@@ -0,0 +1,230 @@
+#include <algorithm>
+#include <set>
+
+#include "ir/ir_cfg.hpp"
+#include "ir/ir_loops.hpp"
+#include "ir/ir_passes.hpp"
+
+namespace {
+
+// scale * iv + the sum of the invariant terms + offset, wrapping at the width of the induction variable's type
+struct AffineValue {
+    IRValueId induction_variable;
+    int64_t scale = 1;
+    // invariant value, its factor
+    std::vector<std::pair<IROperand, int64_t>> terms = {};
+    int64_t offset = 0;
+    // computed through a multiplication, which an addition per iteration can replace
+    bool multiplies = false;
+};
+
+int64_t wrapping_add(int64_t lhs, int64_t rhs) { return (int64_t)((uint64_t)lhs + (uint64_t)rhs); }
+
+int64_t wrapping_multiply(int64_t lhs, int64_t rhs) { return (int64_t)((uint64_t)lhs * (uint64_t)rhs); }
+
+class LoopStrengthReducer {
+   public:
+    LoopStrengthReducer(IRFunction& function, const IRLoop& loop, IRPassStatistics& statistics)
+        : m_function(function), m_loop(loop), m_statistics(statistics) {}
+
+    bool run() {
+        if (m_loop.latches.size() != 1) {
+            return false;
+        }
+        m_preheader = ir_ensure_preheader(m_function, m_loop);
+        m_definitions = ir_definition_blocks(m_function);
+        for (auto& induction_variable : ir_induction_variables(m_function, m_loop)) {
+            m_induction_variables[induction_variable.phi] = induction_variable;
+        }
+        if (m_induction_variables.empty()) {
+            return false;
+        }
+        find_affine_values();
+
+        std::map<IRValueId, IROperand> replacements;
+        for (auto& [value, affine] : m_affine_values) {
+            if (affine.multiplies && affine.scale != 0 && is_used_outside_affine_values(value)) {
+                replacements[value] = reduce(affine);
+            }
+        }
+        if (replacements.empty()) {
+            return false;
+        }
+        ir_replace_uses(m_function, replacements);
+        m_statistics.counters["expressions strength-reduced"] += replacements.size();
+        return true;
+    }
+
+   private:
+    IRFunction& m_function;
+    const IRLoop& m_loop;
+    IRPassStatistics& m_statistics;
+    IRBlockId m_preheader = 0;
+    std::map<IRValueId, IRBlockId> m_definitions;
+    std::map<IRValueId, IRInductionVariable> m_induction_variables;
+    std::map<IRValueId, AffineValue> m_affine_values;
+
+    bool is_invariant(const IROperand& operand) const {
+        return operand.is_constant() || !m_loop.contains(m_definitions.at(operand.value));
+    }
+
+    std::optional<AffineValue> affine_value(const IROperand& operand) const {
+        if (!operand.is_value()) {
+            return std::nullopt;
+        }
+        auto affine = m_affine_values.find(operand.value);
+        if (affine == m_affine_values.end()) {
+            return std::nullopt;
+        }
+        return affine->second;
+    }
+
+    // the additions of invariants to, and multiplications by constants of, the induction variables- of the same
+    // type as the variable
+    void find_affine_values() {
+        for (auto& [phi, induction_variable] : m_induction_variables) {
+            m_affine_values[phi] = AffineValue{.induction_variable = phi};
+        }
+        for (auto block : ir_reverse_post_order(m_function)) {
+            if (!m_loop.contains(block)) {
+                continue;
+            }
+            for (auto& instruction : m_function.find_block(block)->instructions) {
+                if (instruction.operands.size() != 2 || instruction.opcode == IROpcode::Phi) {
+                    continue;
+                }
+                auto lhs = affine_value(instruction.operands[0]);
+                auto rhs = affine_value(instruction.operands[1]);
+                if (lhs.has_value() == rhs.has_value()) {
+                    continue;
+                }
+                AffineValue affine = lhs ? *lhs : *rhs;
+                auto& other = lhs ? instruction.operands[1] : instruction.operands[0];
+                if (instruction.type != m_induction_variables.at(affine.induction_variable).type ||
+                    !is_invariant(other)) {
+                    continue;
+                }
+                switch (instruction.opcode) {
+                    case IROpcode::Add:
+                        if (other.is_constant()) {
+                            affine.offset = wrapping_add(affine.offset, other.constant);
+                        } else {
+                            affine.terms.push_back({other, 1});
+                        }
+                        break;
+                    case IROpcode::Sub:
+                        if (!lhs || !other.is_constant()) {
+                            continue;
+                        }
+                        affine.offset = wrapping_add(affine.offset, wrapping_multiply(other.constant, -1));
+                        break;
+                    case IROpcode::Mul:
+                        if (!other.is_constant()) {
+                            continue;
+                        }
+                        affine.scale = wrapping_multiply(affine.scale, other.constant);
+                        affine.offset = wrapping_multiply(affine.offset, other.constant);
+                        for (auto& term : affine.terms) {
+                            term.second = wrapping_multiply(term.second, other.constant);
+                        }
+                        affine.multiplies = true;
+                        break;
+                    default:
+                        continue;
+                }
+                m_affine_values[instruction.result] = affine;
+            }
+        }
+    }
+
+    // only the values whose results leave the chain of affine values are worth a variable of their own
+    bool is_used_outside_affine_values(IRValueId value) const {
+        for (auto& block : m_function.blocks) {
+            for (auto& instruction : block.instructions) {
+                bool uses = std::any_of(instruction.operands.begin(), instruction.operands.end(),
+                                        [&](const IROperand& operand) { return operand.is_value() && operand.value == value; });
+                if (uses && (!instruction.has_result() || !m_affine_values.count(instruction.result))) {
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    // the result of the operation in the preheader, folded when possible
+    IROperand emit_in_preheader(IROpcode opcode, const IROperand& lhs, const IROperand& rhs) {
+        if (lhs.is_constant() && rhs.is_constant()) {
+            auto folded = ir_evaluate(opcode, lhs.type, {lhs.constant, rhs.constant});
+            if (folded) {
+                return IROperand::make_constant(*folded, lhs.type);
+            }
+        }
+        if (opcode == IROpcode::Mul && rhs.is_constant() && rhs.constant == 1) {
+            return lhs;
+        }
+        if (opcode == IROpcode::Add && rhs.is_constant() && rhs.constant == 0) {
+            return lhs;
+        }
+        IRInstruction instruction{
+            .opcode = opcode, .type = lhs.type, .result = m_function.new_value(), .operands = {lhs, rhs}};
+        IROperand result = instruction.result_operand();
+        auto& instructions = m_function.find_block(m_preheader)->instructions;
+        instructions.insert(instructions.end() - 1, std::move(instruction));
+        return result;
+    }
+
+    // a new induction variable of its own, stepping by scale * step
+    IROperand reduce(const AffineValue& affine) {
+        auto& induction_variable = m_induction_variables.at(affine.induction_variable);
+        IRType type = induction_variable.type;
+        IROperand start =
+            emit_in_preheader(IROpcode::Mul, induction_variable.init, IROperand::make_constant(affine.scale, type));
+        for (auto& [term, factor] : affine.terms) {
+            IROperand scaled = emit_in_preheader(IROpcode::Mul, term, IROperand::make_constant(factor, type));
+            start = emit_in_preheader(IROpcode::Add, start, scaled);
+        }
+        start = emit_in_preheader(IROpcode::Add, start, IROperand::make_constant(affine.offset, type));
+        IROperand step =
+            emit_in_preheader(IROpcode::Mul, induction_variable.step, IROperand::make_constant(affine.scale, type));
+
+        IRInstruction phi{.opcode = IROpcode::Phi, .type = type, .result = m_function.new_value()};
+        IRInstruction next{.opcode = induction_variable.direction,
+                           .type = type,
+                           .result = m_function.new_value(),
+                           .operands = {phi.result_operand(), step}};
+        auto predecessors = ir_predecessors(m_function);
+        for (auto predecessor : predecessors[m_loop.header]) {
+            phi.operands.push_back(predecessor == m_preheader ? start : next.result_operand());
+            phi.blocks.push_back(predecessor);
+        }
+        IROperand reduced = phi.result_operand();
+
+        // right after the original step, which dominates the latch
+        auto& increment_block = m_function.find_block(m_definitions.at(induction_variable.next))->instructions;
+        auto increment = std::find_if(increment_block.begin(), increment_block.end(), [&](const IRInstruction& i) {
+            return i.result == induction_variable.next;
+        });
+        increment_block.insert(increment + 1, std::move(next));
+        auto& header = m_function.find_block(m_loop.header)->instructions;
+        header.insert(header.begin(), std::move(phi));
+        return reduced;
+    }
+};
+
+}  // namespace
+
+bool IRLoopStrengthReductionPass::run_on_function(IRFunction& function, IRModule&, IRPassStatistics& statistics) {
+    bool changed = false;
+    std::set<IRBlockId> done;
+    while (true) {
+        auto loops = ir_find_loops(function);
+        auto loop = std::find_if(loops.begin(), loops.end(), [&](const IRLoop& loop) {
+            return !done.count(loop.header) && loop.header != function.blocks.front().id;
+        });
+        if (loop == loops.end()) {
+            return changed;
+        }
+        done.insert(loop->header);
+        changed = LoopStrengthReducer(function, *loop, statistics).run() || changed;
+    }
+}
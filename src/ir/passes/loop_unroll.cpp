@@ -0,0 +1,364 @@
+#include <algorithm>
+#include <set>
+
+#include "ir/ir_cfg.hpp"
+#include "ir/ir_loops.hpp"
+#include "ir/ir_passes.hpp"
+
+namespace {
+
+class LoopUnroller {
+   public:
+    LoopUnroller(IRFunction& function, const IRLoop& loop, const IRPassOptions& options, IRPassStatistics& statistics)
+        : m_function(function), m_loop(loop), m_options(options), m_statistics(statistics) {}
+
+    // adds the header of the new loop the iterations were unrolled into to 'unrolled'
+    bool run(std::set<IRBlockId>& unrolled) {
+        auto counted = find_counted_loop();
+        if (!counted) {
+            return false;
+        }
+        size_t size = 0;
+        for (auto block : m_loop.blocks) {
+            size += m_function.find_block(block)->instructions.size();
+        }
+
+        auto trip_count = constant_trip_count(*counted, m_options.unroll_size_budget / size);
+        std::string location = "loop at bb" + std::to_string(m_loop.header) + " in '" + m_function.name + "'";
+        if (trip_count == 0u) {
+            return false;
+        }
+        if (trip_count) {
+            unroll_fully(*counted, *trip_count);
+            m_statistics.counters["loops fully unrolled"]++;
+            m_statistics.remarks.push_back("fully unrolled " + location + ": " + std::to_string(*trip_count) +
+                                           " iterations");
+            return true;
+        }
+        size_t factor = std::min((size_t)m_options.unroll_factor, m_options.unroll_size_budget / size);
+        if (factor < 2) {
+            m_statistics.remarks.push_back("not unrolled " + location + ": " + std::to_string(size) +
+                                           " instructions exceed the size budget");
+            return false;
+        }
+        unrolled.insert(unroll(*counted, factor));
+        m_statistics.counters["loops unrolled"]++;
+        m_statistics.remarks.push_back("unrolled " + location + " by " + std::to_string(factor));
+        return true;
+    }
+
+   private:
+    IRFunction& m_function;
+    const IRLoop& m_loop;
+    const IRPassOptions& m_options;
+    IRPassStatistics& m_statistics;
+    IRBlockId m_preheader = 0;
+
+    std::optional<IRCountedLoop> find_counted_loop() {
+        auto exits = ir_loop_exits(m_function, m_loop);
+        if (m_loop.latches.size() != 1 || exits.size() != 1 || exits.front().first != m_loop.header) {
+            return std::nullopt;
+        }
+        m_preheader = ir_ensure_preheader(m_function, m_loop);
+        return ir_counted_loop(m_function, m_loop);
+    }
+
+    // the iterations of a loop from a constant start to a constant bound, nothing above the limit
+    static std::optional<size_t> constant_trip_count(const IRCountedLoop& loop, size_t limit) {
+        if (!loop.counter.init.is_constant() || !loop.bound.is_constant()) {
+            return std::nullopt;
+        }
+        IRType type = loop.counter.type;
+        int64_t counter = loop.counter.init.constant;
+        for (size_t trip_count = 0; trip_count <= limit; ++trip_count) {
+            if (*ir_evaluate(loop.comparison, type, {counter, loop.bound.constant}) == 0) {
+                return trip_count;
+            }
+            counter = *ir_evaluate(loop.counter.direction, type, {counter, loop.counter.step.constant});
+        }
+        return std::nullopt;
+    }
+
+    // copies the loop's blocks for one iteration, which goes on to 'continuation' instead of the header. the
+    // header's branch becomes a jump into the body. 'values' maps the header's phis to their values in this
+    // iteration, and is updated to the values of the next
+    std::vector<IRBasicBlock> copy_iteration(const std::map<IRBlockId, IRBlockId>& block_ids,
+                                             IRBlockId continuation, std::map<IRValueId, IROperand>& values,
+                                             IRBlockId body) {
+        std::vector<IRBasicBlock> copies;
+        for (auto& block : m_function.blocks) {
+            if (!m_loop.contains(block.id)) {
+                continue;
+            }
+            IRBasicBlock copy{.id = block_ids.at(block.id), .instructions = {}};
+            for (auto& instruction : block.instructions) {
+                if (block.id == m_loop.header && instruction.opcode == IROpcode::Phi) {
+                    continue;
+                }
+                IRInstruction copied = instruction;
+                if (copied.has_result()) {
+                    copied.result = m_function.new_value();
+                    values[instruction.result] = copied.result_operand();
+                }
+                if (block.id == m_loop.header && copied.opcode == IROpcode::Branch) {
+                    copied = IRInstruction{.opcode = IROpcode::Jump, .blocks = {body}};
+                }
+                copy.instructions.push_back(std::move(copied));
+            }
+            copies.push_back(std::move(copy));
+        }
+
+        // every result has its copy by now- a block may use values of blocks after it
+        auto map_block = [&](IRBlockId block) { return block == m_loop.header ? continuation : block_ids.at(block); };
+        for (auto& copy : copies) {
+            for (auto& instruction : copy.instructions) {
+                for (auto& operand : instruction.operands) {
+                    if (operand.is_value() && values.count(operand.value)) {
+                        operand = values.at(operand.value);
+                    }
+                }
+                if (instruction.opcode == IROpcode::Phi) {
+                    // the header's copy is never the continuation
+                    for (auto& block : instruction.blocks) {
+                        block = block_ids.at(block);
+                    }
+                } else {
+                    std::transform(instruction.blocks.begin(), instruction.blocks.end(), instruction.blocks.begin(),
+                                   map_block);
+                }
+            }
+        }
+
+        std::map<IRValueId, IROperand> next;
+        for (auto& phi : m_function.find_block(m_loop.header)->instructions) {
+            if (phi.opcode != IROpcode::Phi) {
+                break;
+            }
+            auto& latch_value = phi.operands[phi_index(phi, m_loop.latches.front())];
+            next[phi.result] =
+                latch_value.is_value() && values.count(latch_value.value) ? values.at(latch_value.value) : latch_value;
+        }
+        for (auto& [phi, value] : next) {
+            values[phi] = value;
+        }
+        return copies;
+    }
+
+    static size_t phi_index(const IRInstruction& phi, IRBlockId block) {
+        return std::find(phi.blocks.begin(), phi.blocks.end(), block) - phi.blocks.begin();
+    }
+
+    std::map<IRBlockId, IRBlockId> new_block_ids() {
+        std::map<IRBlockId, IRBlockId> block_ids;
+        for (auto block : m_loop.blocks) {
+            block_ids[block] = m_function.next_block_id++;
+        }
+        return block_ids;
+    }
+
+    // the values the header's phis start with
+    std::map<IRValueId, IROperand> initial_values() {
+        std::map<IRValueId, IROperand> values;
+        for (auto& phi : m_function.find_block(m_loop.header)->instructions) {
+            if (phi.opcode != IROpcode::Phi) {
+                break;
+            }
+            values[phi.result] = phi.operands[phi_index(phi, m_preheader)];
+        }
+        return values;
+    }
+
+    // the header's phis take their values from 'entry' instead of the preheader
+    void enter_header_from(IRBlockId entry, const std::map<IRValueId, IROperand>& values) {
+        for (auto& phi : m_function.find_block(m_loop.header)->instructions) {
+            if (phi.opcode != IROpcode::Phi) {
+                break;
+            }
+            size_t index = phi_index(phi, m_preheader);
+            phi.operands[index] = values.at(phi.result);
+            phi.blocks[index] = entry;
+        }
+    }
+
+    void insert_before_header(std::vector<IRBasicBlock> blocks) {
+        auto header = std::find_if(m_function.blocks.begin(), m_function.blocks.end(),
+                                   [&](const IRBasicBlock& block) { return block.id == m_loop.header; });
+        m_function.blocks.insert(header, std::make_move_iterator(blocks.begin()),
+                                 std::make_move_iterator(blocks.end()));
+    }
+
+    // every iteration in a row, then the header once more to leave- in place of the loop
+    void unroll_fully(const IRCountedLoop& loop, size_t trip_count) {
+        std::vector<std::map<IRBlockId, IRBlockId>> iterations;
+        for (size_t i = 0; i < trip_count; ++i) {
+            iterations.push_back(new_block_ids());
+        }
+        IRBasicBlock leave{.id = m_function.next_block_id++, .instructions = {}};
+        auto values = initial_values();
+        std::vector<IRBasicBlock> blocks;
+        for (size_t i = 0; i < trip_count; ++i) {
+            IRBlockId continuation = i + 1 < trip_count ? iterations[i + 1].at(m_loop.header) : leave.id;
+            auto copies = copy_iteration(iterations[i], continuation, values, loop.body);
+            std::move(copies.begin(), copies.end(), std::back_inserter(blocks));
+        }
+
+        // the header's values outside the loop are the ones of the last time through it
+        for (auto& instruction : m_function.find_block(m_loop.header)->instructions) {
+            if (instruction.opcode == IROpcode::Phi) {
+                continue;
+            }
+            IRInstruction copied = instruction;
+            if (copied.opcode == IROpcode::Branch) {
+                copied = IRInstruction{.opcode = IROpcode::Jump, .blocks = {loop.exit}};
+            }
+            for (auto& operand : copied.operands) {
+                if (operand.is_value() && values.count(operand.value)) {
+                    operand = values.at(operand.value);
+                }
+            }
+            if (copied.has_result()) {
+                copied.result = m_function.new_value();
+                values[instruction.result] = copied.result_operand();
+            }
+            leave.instructions.push_back(std::move(copied));
+        }
+        for (auto& phi : m_function.find_block(loop.exit)->instructions) {
+            if (phi.opcode != IROpcode::Phi) {
+                break;
+            }
+            std::replace(phi.blocks.begin(), phi.blocks.end(), m_loop.header, leave.id);
+        }
+        blocks.push_back(std::move(leave));
+
+        auto& preheader = m_function.find_block(m_preheader)->terminator();
+        std::replace(preheader.blocks.begin(), preheader.blocks.end(), m_loop.header,
+                     iterations.front().at(m_loop.header));
+        insert_before_header(std::move(blocks));
+        ir_remove_unreachable_blocks(m_function);
+        ir_replace_uses(m_function, values);
+    }
+
+    // a new loop running 'factor' iterations per trip while the counter stays within the bound for all of them,
+    // ahead of the original loop, which runs the remaining iterations
+    IRBlockId unroll(const IRCountedLoop& loop, size_t factor) {
+        IRBasicBlock header{.id = m_function.next_block_id++, .instructions = {}};
+        IRBasicBlock remainder{.id = m_function.next_block_id++, .instructions = {}};
+        std::vector<std::map<IRBlockId, IRBlockId>> iterations;
+        for (size_t i = 0; i < factor; ++i) {
+            iterations.push_back(new_block_ids());
+        }
+
+        // the original phi, its copy in the new header
+        std::vector<std::pair<IRValueId, IRInstruction>> phis;
+        std::map<IRValueId, IROperand> values;
+        for (auto& phi : m_function.find_block(m_loop.header)->instructions) {
+            if (phi.opcode != IROpcode::Phi) {
+                break;
+            }
+            IRInstruction copy{.opcode = IROpcode::Phi, .type = phi.type, .result = m_function.new_value()};
+            values[phi.result] = copy.result_operand();
+            phis.push_back({phi.result, std::move(copy)});
+        }
+        auto header_values = values;
+        IROperand counter = values.at(loop.counter.phi);
+
+        std::vector<IRBasicBlock> blocks;
+        for (size_t i = 0; i < factor; ++i) {
+            IRBlockId continuation = i + 1 < factor ? iterations[i + 1].at(m_loop.header) : header.id;
+            auto copies = copy_iteration(iterations[i], continuation, values, loop.body);
+            std::move(copies.begin(), copies.end(), std::back_inserter(blocks));
+        }
+        IRBlockId latch = iterations.back().at(m_loop.latches.front());
+        auto initial = initial_values();
+        for (auto& [original, phi] : phis) {
+            phi.operands = {initial.at(original), values.at(original)};
+            phi.blocks = {m_preheader, latch};
+            header.instructions.push_back(std::move(phi));
+        }
+
+        // the counter of the last iteration within the bound as well, computed where it can't wrap- narrower
+        // counters in 64 bits, 64 bit counters checked for not passing the counter
+        IRBasicBlock no_wrap{.id = m_function.next_block_id++, .instructions = {}};
+        IRBlockId first = iterations.front().at(m_loop.header);
+        auto emit = [&](IRBasicBlock& block, IRInstruction instruction) {
+            instruction.result = m_function.new_value();
+            IROperand result = instruction.result_operand();
+            block.instructions.push_back(std::move(instruction));
+            return result;
+        };
+        int64_t last_offset = (int64_t)((uint64_t)loop.step * (factor - 1));
+        if (loop.counter.type == IRType::I64) {
+            IROperand last = emit(header, IRInstruction{.opcode = IROpcode::Add,
+                                                        .type = IRType::I64,
+                                                        .operands = {counter, IROperand::make_constant(last_offset, IRType::I64)}});
+            IROperand within = emit(
+                header, IRInstruction{.opcode = loop.comparison, .type = IRType::I64, .operands = {last, loop.bound}});
+            header.instructions.push_back(
+                IRInstruction{.opcode = IROpcode::Branch, .operands = {within}, .blocks = {no_wrap.id, remainder.id}});
+            IROpcode beyond = loop.step > 0 ? IROpcode::CmpGt : IROpcode::CmpLt;
+            IROperand wraps_not =
+                emit(no_wrap, IRInstruction{.opcode = beyond, .type = IRType::I64, .operands = {last, counter}});
+            no_wrap.instructions.push_back(
+                IRInstruction{.opcode = IROpcode::Branch, .operands = {wraps_not}, .blocks = {first, remainder.id}});
+        } else {
+            IROperand wide = emit(header, IRInstruction{.opcode = IROpcode::ZExt, .type = IRType::I64, .operands = {counter}});
+            IROperand last = emit(header, IRInstruction{.opcode = IROpcode::Add,
+                                                        .type = IRType::I64,
+                                                        .operands = {wide, IROperand::make_constant(last_offset, IRType::I64)}});
+            IROperand bound = loop.bound.is_constant()
+                                  ? IROperand::make_constant(loop.bound.constant, IRType::I64)
+                                  : emit(header, IRInstruction{.opcode = IROpcode::ZExt,
+                                                               .type = IRType::I64,
+                                                               .operands = {loop.bound}});
+            IROperand within = emit(
+                header, IRInstruction{.opcode = loop.comparison, .type = IRType::I64, .operands = {last, bound}});
+            header.instructions.push_back(
+                IRInstruction{.opcode = IROpcode::Branch, .operands = {within}, .blocks = {first, remainder.id}});
+        }
+        remainder.instructions.push_back(IRInstruction{.opcode = IROpcode::Jump, .blocks = {m_loop.header}});
+
+        auto& preheader = m_function.find_block(m_preheader)->terminator();
+        std::replace(preheader.blocks.begin(), preheader.blocks.end(), m_loop.header, header.id);
+        enter_header_from(remainder.id, header_values);
+
+        IRBlockId header_id = header.id;
+        std::vector<IRBasicBlock> unrolled;
+        unrolled.push_back(std::move(header));
+        if (!no_wrap.instructions.empty()) {
+            unrolled.push_back(std::move(no_wrap));
+        }
+        std::move(blocks.begin(), blocks.end(), std::back_inserter(unrolled));
+        unrolled.push_back(std::move(remainder));
+        insert_before_header(std::move(unrolled));
+        return header_id;
+    }
+};
+
+// a loop with no other loop inside it
+bool is_innermost(const IRLoop& loop, const std::vector<IRLoop>& loops) {
+    return std::none_of(loops.begin(), loops.end(), [&](const IRLoop& other) {
+        return other.header != loop.header && loop.contains(other.header);
+    });
+}
+
+}  // namespace
+
+bool IRLoopUnrollPass::run_on_function(IRFunction& function, IRModule&, IRPassStatistics& statistics) {
+    if (m_options.unroll_factor < 2) {
+        return false;
+    }
+    bool changed = false;
+    // the unrolled loops and what's left of the original ones are never unrolled again
+    std::set<IRBlockId> done;
+    while (true) {
+        auto loops = ir_find_loops(function);
+        auto loop = std::find_if(loops.begin(), loops.end(), [&](const IRLoop& loop) {
+            return !done.count(loop.header) && loop.header != function.blocks.front().id && is_innermost(loop, loops);
+        });
+        if (loop == loops.end()) {
+            return changed;
+        }
+        done.insert(loop->header);
+        changed = LoopUnroller(function, *loop, m_options, statistics).run(done) || changed;
+    }
+}
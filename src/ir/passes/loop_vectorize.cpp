@@ -0,0 +1,482 @@
+#include <algorithm>
+#include <set>
+
+#include "ir/ir_cfg.hpp"
+#include "ir/ir_loops.hpp"
+#include "ir/ir_memory.hpp"
+#include "ir/ir_passes.hpp"
+
+namespace {
+
+// an accumulator of the loop- acc = acc + x every iteration, with x the value of a lane, or one zero-extended
+struct Reduction {
+    IRValueId phi;
+    IRType type;
+    IROperand init;
+    // the addition, and the x it adds
+    IRValueId next;
+    IROperand addend;
+};
+
+// base + counter * scale, the address of the counter's element of an object
+struct ElementAddress {
+    IROperand base;
+    int64_t scale;
+};
+
+class LoopVectorizer {
+   public:
+    LoopVectorizer(IRFunction& function, IRModule& module, const IRLoop& loop, const IRPassOptions& options,
+                   IRPassStatistics& statistics)
+        : m_function(function), m_module(module), m_loop(loop), m_options(options), m_statistics(statistics) {}
+
+    // adds the header of the vector loop to 'vectorized'
+    bool run(std::set<IRBlockId>& vectorized) {
+        auto exits = ir_loop_exits(m_function, m_loop);
+        if (m_loop.blocks.size() != 2 || exits.size() != 1 || exits.front().first != m_loop.header) {
+            return false;
+        }
+        m_preheader = ir_ensure_preheader(m_function, m_loop);
+        auto counted = ir_counted_loop(m_function, m_loop);
+        if (!counted || counted->step != 1 || counted->body != m_loop.latches.front()) {
+            return false;
+        }
+        m_counted = *counted;
+        m_definitions = ir_definition_blocks(m_function);
+        std::string location = "loop at bb" + std::to_string(m_loop.header) + " in '" + m_function.name + "'";
+        std::string problem = analyze();
+        if (!problem.empty()) {
+            m_statistics.remarks.push_back("not vectorized " + location + ": " + problem);
+            return false;
+        }
+        vectorized.insert(vectorize());
+        m_statistics.counters["loops vectorized"]++;
+        m_statistics.remarks.push_back("vectorized " + location + ": " + std::to_string(lanes()) + " lanes of " +
+                                       ir_type_name(m_lane_type));
+        return true;
+    }
+
+   private:
+    IRFunction& m_function;
+    IRModule& m_module;
+    const IRLoop& m_loop;
+    const IRPassOptions& m_options;
+    IRPassStatistics& m_statistics;
+    IRBlockId m_preheader = 0;
+    IRCountedLoop m_counted;
+    std::map<IRValueId, IRBlockId> m_definitions;
+
+    // every lane of every vector has this type, Void until an access or an operation decides it
+    IRType m_lane_type = IRType::Void;
+    // the counter, and its zero-extension to i64, scaled by a constant- the indices of the loop's accesses
+    std::map<IRValueId, int64_t> m_indices;
+    std::map<IRValueId, ElementAddress> m_addresses;
+    // the values of the body that become vectors, one lane per iteration
+    std::set<IRValueId> m_vectors;
+    // zero-extended lanes, which only a reduction may add
+    std::map<IRValueId, IROperand> m_widened;
+    std::vector<Reduction> m_reductions;
+
+    size_t lanes() const { return m_options.vector_width / ir_type_size(m_lane_type); }
+
+    IRType vector_type() const { return m_options.vector_width == 32 ? IRType::V256 : IRType::V128; }
+
+    bool is_invariant(const IROperand& operand) const {
+        return operand.is_constant() || !m_loop.contains(m_definitions.at(operand.value));
+    }
+
+    bool is_vector(const IROperand& operand) const { return operand.is_value() && m_vectors.count(operand.value); }
+
+    // lanes of a single type, the lanes of the vector width or fewer
+    bool set_lane_type(IRType type) {
+        if (m_lane_type == IRType::Void && type != IRType::Void && ir_type_size(type) * 2 <= m_options.vector_width) {
+            m_lane_type = type;
+        }
+        return type == m_lane_type;
+    }
+
+    // why the loop can't be vectorized, empty when it can. every iteration of the body must touch the counter's
+    // element of each object and nothing else, so running the iterations of a vector side by side changes nothing
+    std::string analyze() {
+        IRMemoryObjects objects(m_function, m_module);
+        auto& header = *m_function.find_block(m_loop.header);
+        for (auto& instruction : header.instructions) {
+            if (instruction.opcode == IROpcode::Phi) {
+                if (instruction.result != m_counted.counter.phi && !find_reduction(instruction)) {
+                    return "%" + std::to_string(instruction.result) + " is neither the counter nor a sum";
+                }
+            } else if (!ir_is_comparison(instruction.opcode) && instruction.opcode != IROpcode::Branch) {
+                return "the header computes more than its condition";
+            }
+        }
+
+        IROperand counter = IROperand::make_value(m_counted.counter.phi, m_counted.counter.type);
+        if (counter.type == IRType::I64) {
+            m_indices[counter.value] = 1;
+        }
+        auto& body = m_function.find_block(m_counted.body)->instructions;
+        bool accesses_memory = false;
+        for (auto& instruction : body) {
+            auto& operands = instruction.operands;
+            if (instruction.opcode == IROpcode::Jump || instruction.result == m_counted.counter.next) {
+                continue;
+            }
+            if (is_index(instruction, counter)) {
+                continue;
+            }
+            if (instruction.opcode == IROpcode::Add && instruction.type == IRType::I64 && is_address(instruction, objects)) {
+                continue;
+            }
+            if (instruction.opcode == IROpcode::Load || instruction.opcode == IROpcode::Store) {
+                IRType type = instruction.opcode == IROpcode::Load ? instruction.type : operands[0].type;
+                auto& address = instruction.opcode == IROpcode::Load ? operands[0] : operands[1];
+                auto element = address.is_value() ? m_addresses.find(address.value) : m_addresses.end();
+                if (element == m_addresses.end() || !set_lane_type(type) ||
+                    element->second.scale != (int64_t)ir_type_size(type)) {
+                    return "'" + to_string(instruction) + "' accesses more than the counter's element";
+                }
+                if (instruction.opcode == IROpcode::Store && !is_vector(operands[0]) && !is_invariant(operands[0])) {
+                    return "'" + to_string(instruction) + "' stores a value no lane holds";
+                }
+                if (instruction.opcode == IROpcode::Load) {
+                    m_vectors.insert(instruction.result);
+                }
+                accesses_memory = true;
+                continue;
+            }
+            if (instruction.opcode == IROpcode::ZExt && is_vector(operands[0])) {
+                m_widened[instruction.result] = operands[0];
+                continue;
+            }
+            if (is_reduction_step(instruction)) {
+                continue;
+            }
+            if (instruction.opcode == IROpcode::Add || instruction.opcode == IROpcode::Sub ||
+                instruction.opcode == IROpcode::Mul) {
+                bool lanes_of_operands = std::all_of(operands.begin(), operands.end(), [&](const IROperand& operand) {
+                    return is_vector(operand) || is_invariant(operand);
+                });
+                if (!set_lane_type(instruction.type) || !lanes_of_operands ||
+                    std::none_of(operands.begin(), operands.end(), [&](const IROperand& operand) { return is_vector(operand); })) {
+                    return "'" + to_string(instruction) + "' isn't an operation of lanes";
+                }
+                // SSE2 and AVX2 multiply words and dwords only
+                size_t lane_size = ir_type_size(instruction.type);
+                if (instruction.opcode == IROpcode::Mul && lane_size != 2 && lane_size != 4) {
+                    return "no vector multiplication of " + ir_type_name(instruction.type);
+                }
+                m_vectors.insert(instruction.result);
+                continue;
+            }
+            return "'" + to_string(instruction) + "' can't be vectorized";
+        }
+        if (!accesses_memory) {
+            return "the loop accesses no memory";
+        }
+        for (auto& reduction : m_reductions) {
+            bool adds_lanes = is_vector(reduction.addend) ||
+                              (reduction.addend.is_value() && m_widened.count(reduction.addend.value));
+            if (!adds_lanes) {
+                return "%" + std::to_string(reduction.phi) + " doesn't sum the lanes";
+            }
+        }
+        return "";
+    }
+
+    // an index of the counter's element, i, zext(i) or i * size
+    bool is_index(const IRInstruction& instruction, const IROperand& counter) {
+        auto& operands = instruction.operands;
+        if (instruction.opcode == IROpcode::ZExt && operands[0] == counter && instruction.type == IRType::I64) {
+            m_indices[instruction.result] = 1;
+            return true;
+        }
+        if (instruction.opcode != IROpcode::Mul || instruction.type != IRType::I64) {
+            return false;
+        }
+        for (size_t i = 0; i < 2; ++i) {
+            auto& index = operands[i];
+            auto& scale = operands[1 - i];
+            if (index.is_value() && m_indices.count(index.value) && m_indices.at(index.value) == 1 &&
+                scale.is_constant()) {
+                m_indices[instruction.result] = scale.constant;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // base + index, with the base the start of an object which isn't reached through other addresses
+    bool is_address(const IRInstruction& instruction, const IRMemoryObjects& objects) {
+        for (size_t i = 0; i < 2; ++i) {
+            auto& base = instruction.operands[i];
+            auto& index = instruction.operands[1 - i];
+            if (!index.is_value() || !m_indices.count(index.value) || !is_invariant(base) || !objects.is_exact(base)) {
+                continue;
+            }
+            m_addresses[instruction.result] = ElementAddress{.base = base, .scale = m_indices.at(index.value)};
+            return true;
+        }
+        return false;
+    }
+
+    bool find_reduction(const IRInstruction& phi) {
+        if (phi.blocks.size() != 2) {
+            return false;
+        }
+        size_t latch_index = phi.blocks[0] == m_loop.latches.front() ? 0 : 1;
+        auto& next = phi.operands[latch_index];
+        if (!next.is_value()) {
+            return false;
+        }
+        auto& body = m_function.find_block(m_counted.body)->instructions;
+        auto addition = std::find_if(body.begin(), body.end(),
+                                     [&](const IRInstruction& instruction) { return instruction.result == next.value; });
+        if (addition == body.end() || addition->opcode != IROpcode::Add) {
+            return false;
+        }
+        auto accumulator = phi.result_operand();
+        size_t addend_index = addition->operands[0] == accumulator ? 1 : 0;
+        if (addition->operands[1 - addend_index] != accumulator) {
+            return false;
+        }
+        m_reductions.push_back(Reduction{.phi = phi.result,
+                                         .type = phi.type,
+                                         .init = phi.operands[1 - latch_index],
+                                         .next = next.value,
+                                         .addend = addition->operands[addend_index]});
+        return true;
+    }
+
+    bool is_reduction_step(const IRInstruction& instruction) const {
+        return std::any_of(m_reductions.begin(), m_reductions.end(),
+                           [&](const Reduction& reduction) { return reduction.next == instruction.result; });
+    }
+
+    IROperand emit(std::vector<IRInstruction>& block, IRInstruction instruction) {
+        instruction.result = m_function.new_value();
+        IROperand result = instruction.result_operand();
+        block.push_back(std::move(instruction));
+        return result;
+    }
+
+    // the vector loop, running an iteration per lane while the counter stays within the bound for all of them,
+    // ahead of the original loop, which runs the remaining iterations- the way loop-unroll places its loops
+    IRBlockId vectorize() {
+        IRBasicBlock header{.id = m_function.next_block_id++, .instructions = {}};
+        IRBasicBlock no_wrap{.id = m_function.next_block_id++, .instructions = {}};
+        IRBasicBlock body{.id = m_function.next_block_id++, .instructions = {}};
+        IRBasicBlock remainder{.id = m_function.next_block_id++, .instructions = {}};
+        IRType type = m_counted.counter.type;
+        int64_t lane_count = (int64_t)lanes();
+
+        // the header's phis, their copies in the new header
+        std::map<IRValueId, IROperand> values;
+        IRInstruction counter{.opcode = IROpcode::Phi, .type = type, .result = m_function.new_value()};
+        values[m_counted.counter.phi] = counter.result_operand();
+        std::vector<IRInstruction> sums;
+        for (auto& reduction : m_reductions) {
+            IRInstruction sum{.opcode = IROpcode::Phi, .type = reduction.type, .result = m_function.new_value()};
+            values[reduction.phi] = sum.result_operand();
+            sums.push_back(std::move(sum));
+        }
+
+        // the counter of the last lane within the bound as well- as in loop-unroll, narrower counters compared in
+        // 64 bits, 64 bit counters checked for not passing the counter
+        IROperand counter_value = counter.result_operand();
+        IROperand last_offset = IROperand::make_constant(lane_count - 1, IRType::I64);
+        if (type == IRType::I64) {
+            IROperand last = emit(header.instructions, IRInstruction{.opcode = IROpcode::Add,
+                                                                     .type = IRType::I64,
+                                                                     .operands = {counter_value, last_offset}});
+            IROperand within = emit(header.instructions, IRInstruction{.opcode = m_counted.comparison,
+                                                                       .type = IRType::I64,
+                                                                       .operands = {last, m_counted.bound}});
+            header.instructions.push_back(
+                IRInstruction{.opcode = IROpcode::Branch, .operands = {within}, .blocks = {no_wrap.id, remainder.id}});
+            IROperand wraps_not = emit(no_wrap.instructions, IRInstruction{.opcode = IROpcode::CmpGt,
+                                                                           .type = IRType::I64,
+                                                                           .operands = {last, counter_value}});
+            no_wrap.instructions.push_back(
+                IRInstruction{.opcode = IROpcode::Branch, .operands = {wraps_not}, .blocks = {body.id, remainder.id}});
+        } else {
+            IROperand wide = emit(header.instructions,
+                                  IRInstruction{.opcode = IROpcode::ZExt, .type = IRType::I64, .operands = {counter_value}});
+            IROperand last = emit(header.instructions, IRInstruction{.opcode = IROpcode::Add,
+                                                                     .type = IRType::I64,
+                                                                     .operands = {wide, last_offset}});
+            IROperand bound = m_counted.bound.is_constant()
+                                  ? IROperand::make_constant(m_counted.bound.constant, IRType::I64)
+                                  : emit(header.instructions, IRInstruction{.opcode = IROpcode::ZExt,
+                                                                            .type = IRType::I64,
+                                                                            .operands = {m_counted.bound}});
+            IROperand within = emit(header.instructions, IRInstruction{.opcode = m_counted.comparison,
+                                                                       .type = IRType::I64,
+                                                                       .operands = {last, bound}});
+            header.instructions.push_back(
+                IRInstruction{.opcode = IROpcode::Branch, .operands = {within}, .blocks = {body.id, remainder.id}});
+        }
+
+        generate_body(body.instructions, counter_value, values);
+        IROperand next = emit(body.instructions,
+                              IRInstruction{.opcode = IROpcode::Add,
+                                            .type = type,
+                                            .operands = {counter_value, IROperand::make_constant(lane_count, type)}});
+        body.instructions.push_back(IRInstruction{.opcode = IROpcode::Jump, .blocks = {header.id}});
+
+        counter.operands = {m_counted.counter.init, next};
+        counter.blocks = {m_preheader, body.id};
+        header.instructions.insert(header.instructions.begin(), std::move(counter));
+        for (size_t i = 0; i < m_reductions.size(); ++i) {
+            sums[i].operands = {m_reductions[i].init, values.at(m_reductions[i].next)};
+            sums[i].blocks = {m_preheader, body.id};
+            header.instructions.insert(header.instructions.begin() + 1 + i, std::move(sums[i]));
+        }
+        remainder.instructions.push_back(IRInstruction{.opcode = IROpcode::Jump, .blocks = {m_loop.header}});
+
+        // the original loop goes on from where the vector loop stopped
+        for (auto& phi : m_function.find_block(m_loop.header)->instructions) {
+            if (phi.opcode != IROpcode::Phi) {
+                break;
+            }
+            size_t index = std::find(phi.blocks.begin(), phi.blocks.end(), m_preheader) - phi.blocks.begin();
+            phi.operands[index] = values.at(phi.result);
+            phi.blocks[index] = remainder.id;
+        }
+        auto& preheader = m_function.find_block(m_preheader)->terminator();
+        std::replace(preheader.blocks.begin(), preheader.blocks.end(), m_loop.header, header.id);
+
+        IRBlockId header_id = header.id;
+        std::vector<IRBasicBlock> blocks;
+        blocks.push_back(std::move(header));
+        if (!no_wrap.instructions.empty()) {
+            blocks.push_back(std::move(no_wrap));
+        }
+        blocks.push_back(std::move(body));
+        blocks.push_back(std::move(remainder));
+        auto original = std::find_if(m_function.blocks.begin(), m_function.blocks.end(),
+                                     [&](const IRBasicBlock& block) { return block.id == m_loop.header; });
+        m_function.blocks.insert(original, std::make_move_iterator(blocks.begin()),
+                                 std::make_move_iterator(blocks.end()));
+        return header_id;
+    }
+
+    // the original body, with the lanes' values in vectors- 'values' maps the original values to theirs
+    void generate_body(std::vector<IRInstruction>& body, const IROperand& counter,
+                       std::map<IRValueId, IROperand>& values) {
+        IRType vector = vector_type();
+        int64_t lane_size = ir_type_size(m_lane_type);
+        auto& preheader = m_function.find_block(m_preheader)->instructions;
+        // invariants become vectors of the same value in every lane, once
+        std::map<std::pair<bool, int64_t>, IROperand> splats;
+        auto lanes_of = [&](const IROperand& operand) {
+            if (is_vector(operand)) {
+                return values.at(operand.value);
+            }
+            auto key = std::make_pair(operand.is_constant(), operand.is_constant() ? operand.constant : operand.value);
+            auto splat = splats.find(key);
+            if (splat != splats.end()) {
+                return splat->second;
+            }
+            IRInstruction instruction{.opcode = IROpcode::VectorSplat,
+                                      .type = vector,
+                                      .result = m_function.new_value(),
+                                      .operands = {operand},
+                                      .immediate = lane_size};
+            IROperand result = instruction.result_operand();
+            preheader.insert(preheader.end() - 1, std::move(instruction));
+            splats[key] = result;
+            return result;
+        };
+
+        // the index and address of the first lane's element, once per scale and base
+        IROperand index = counter;
+        if (counter.type != IRType::I64) {
+            index = emit(body, IRInstruction{.opcode = IROpcode::ZExt, .type = IRType::I64, .operands = {counter}});
+        }
+        IROperand scaled = index;
+        if (lane_size != 1) {
+            scaled = emit(body, IRInstruction{.opcode = IROpcode::Mul,
+                                              .type = IRType::I64,
+                                              .operands = {index, IROperand::make_constant(lane_size, IRType::I64)}});
+        }
+        std::map<std::pair<bool, int64_t>, IROperand> addresses;
+        auto address_of = [&](const IROperand& original) {
+            auto& base = m_addresses.at(original.value).base;
+            auto key = std::make_pair(base.is_constant(), base.is_constant() ? base.constant : base.value);
+            auto address = addresses.find(key);
+            if (address != addresses.end()) {
+                return address->second;
+            }
+            IROperand result =
+                emit(body, IRInstruction{.opcode = IROpcode::Add, .type = IRType::I64, .operands = {base, scaled}});
+            addresses[key] = result;
+            return result;
+        };
+
+        static const std::map<IROpcode, IROpcode> vector_opcodes = {
+            {IROpcode::Add, IROpcode::VectorAdd},
+            {IROpcode::Sub, IROpcode::VectorSub},
+            {IROpcode::Mul, IROpcode::VectorMul},
+        };
+        for (auto& instruction : m_function.find_block(m_counted.body)->instructions) {
+            auto& operands = instruction.operands;
+            if (instruction.opcode == IROpcode::Load) {
+                values[instruction.result] = emit(body, IRInstruction{.opcode = IROpcode::VectorLoad,
+                                                                      .type = vector,
+                                                                      .operands = {address_of(operands[0])},
+                                                                      .immediate = lane_size});
+            } else if (instruction.opcode == IROpcode::Store) {
+                body.push_back(IRInstruction{.opcode = IROpcode::VectorStore,
+                                             .operands = {lanes_of(operands[0]), address_of(operands[1])},
+                                             .immediate = lane_size});
+            } else if (m_vectors.count(instruction.result)) {
+                values[instruction.result] =
+                    emit(body, IRInstruction{.opcode = vector_opcodes.at(instruction.opcode),
+                                             .type = vector,
+                                             .operands = {lanes_of(operands[0]), lanes_of(operands[1])},
+                                             .immediate = lane_size});
+            }
+        }
+
+        // the sums add up the lanes of every iteration at once- exactly in 64 bits, wrapping at their type after
+        for (auto& reduction : m_reductions) {
+            IROperand addend = reduction.addend;
+            if (m_widened.count(addend.value)) {
+                addend = m_widened.at(addend.value);
+            }
+            IROperand sum = emit(body, IRInstruction{.opcode = IROpcode::VectorReduceAdd,
+                                                     .type = IRType::I64,
+                                                     .operands = {values.at(addend.value)},
+                                                     .immediate = lane_size});
+            if (reduction.type != IRType::I64) {
+                sum = emit(body, IRInstruction{.opcode = IROpcode::Trunc, .type = reduction.type, .operands = {sum}});
+            }
+            values[reduction.next] =
+                emit(body, IRInstruction{.opcode = IROpcode::Add,
+                                         .type = reduction.type,
+                                         .operands = {values.at(reduction.phi), sum}});
+        }
+    }
+};
+
+}  // namespace
+
+bool IRLoopVectorizePass::run_on_function(IRFunction& function, IRModule& module, IRPassStatistics& statistics) {
+    if (m_options.vector_width != 16 && m_options.vector_width != 32) {
+        return false;
+    }
+    bool changed = false;
+    // the vector loops and what's left of the original ones are never vectorized again
+    std::set<IRBlockId> done;
+    while (true) {
+        auto loops = ir_find_loops(function);
+        auto loop = std::find_if(loops.begin(), loops.end(), [&](const IRLoop& loop) {
+            return !done.count(loop.header) && loop.header != function.blocks.front().id;
+        });
+        if (loop == loops.end()) {
+            return changed;
+        }
+        done.insert(loop->header);
+        changed = LoopVectorizer(function, module, *loop, m_options, statistics).run(done) || changed;
+    }
+}
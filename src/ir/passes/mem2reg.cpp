@@ -0,0 +1,252 @@
+#include <algorithm>
+#include <set>
+
+#include "ir/ir_cfg.hpp"
+#include "ir/ir_memory.hpp"
+#include "ir/ir_passes.hpp"
+
+namespace {
+
+const IROperand* access_address(const IRInstruction& instruction) {
+    switch (instruction.opcode) {
+        case IROpcode::Load:
+        case IROpcode::VectorLoad:
+        case IROpcode::Zero:
+            return &instruction.operands[0];
+        case IROpcode::Store:
+        case IROpcode::VectorStore:
+            return &instruction.operands[1];
+        default:
+            return nullptr;
+    }
+}
+
+class MemoryPromoter {
+   public:
+    MemoryPromoter(IRFunction& function, IRModule& module, IRPassStatistics& statistics)
+        : m_function(function),
+          m_objects(function, module),
+          m_dominators(function),
+          m_predecessors(ir_predecessors(function)),
+          m_statistics(statistics) {}
+
+    // promotes what it can, false when nothing could be
+    bool run() {
+        auto types = promotable_objects();
+        for (auto [object, type] : types) {
+            promote(object, type);
+        }
+        m_statistics.counters["variables promoted"] += types.size();
+        return !types.empty();
+    }
+
+   private:
+    IRFunction& m_function;
+    IRMemoryObjects m_objects;
+    IRDominatorTree m_dominators;
+    std::vector<std::vector<IRBlockId>> m_predecessors;
+    IRPassStatistics& m_statistics;
+
+    // the object is promoted, and this is one of its accesses- the start of the object, as a whole
+    size_t m_object = 0;
+    IRType m_type = IRType::Void;
+    std::map<IRValueId, IROperand> m_replacements;
+    std::map<IRBlockId, IRValueId> m_phis;
+    std::map<IRBlockId, IROperand> m_end_values;
+
+    // the objects nothing but whole loads and stores of a single type- and zeroing- reach, with that type.
+    // escaped objects are out, calls and unknown addresses may get at them
+    std::map<size_t, IRType> promotable_objects() const {
+        std::map<size_t, IRType> types;
+        std::set<size_t> rejected;
+        for (size_t object = 0; object < m_objects.size(); ++object) {
+            if (m_objects.is_visible(object)) {
+                rejected.insert(object);
+            }
+        }
+        for (auto block : m_dominators.get_order()) {
+            for (auto& instruction : m_function.find_block(block)->instructions) {
+                auto address = access_address(instruction);
+                if (!address) {
+                    continue;
+                }
+                auto points_to = m_objects.points_to(*address);
+                auto object = m_objects.base_object(*address);
+                if (!object || !m_objects.is_exact(*address)) {
+                    rejected.insert(points_to.objects.begin(), points_to.objects.end());
+                    continue;
+                }
+                size_t size_bytes = m_objects.object(*object).size_bytes;
+                if (instruction.opcode == IROpcode::Zero) {
+                    if ((size_t)instruction.immediate != size_bytes) {
+                        rejected.insert(*object);
+                    }
+                    continue;
+                }
+                IRType type = instruction.opcode == IROpcode::Store ? instruction.operands[0].type : instruction.type;
+                auto known = types.find(*object);
+                if (ir_is_vector(type) || ir_type_size(type) != size_bytes ||
+                    (known != types.end() && known->second != type)) {
+                    rejected.insert(*object);
+                }
+                types.insert({*object, type});
+            }
+        }
+        for (auto object : rejected) {
+            types.erase(object);
+        }
+        return types;
+    }
+
+    bool is_access(const IRInstruction& instruction) const {
+        auto address = access_address(instruction);
+        return address && m_objects.is_exact(*address) && m_objects.base_object(*address) == m_object;
+    }
+
+    // the blocks the object's value is read in before it's written- the only ones a phi is worth placing in
+    std::set<IRBlockId> live_in_blocks() const {
+        std::set<IRBlockId> live_in;
+        std::set<IRBlockId> writes;
+        for (auto block : m_dominators.get_order()) {
+            for (auto& instruction : m_function.find_block(block)->instructions) {
+                if (!is_access(instruction)) {
+                    continue;
+                }
+                if (instruction.opcode == IROpcode::Load) {
+                    if (!writes.count(block)) {
+                        live_in.insert(block);
+                    }
+                    break;
+                }
+                writes.insert(block);
+                break;
+            }
+        }
+        // backwards from the reads, up to the writes
+        std::vector<IRBlockId> worklist(live_in.begin(), live_in.end());
+        while (!worklist.empty()) {
+            IRBlockId block = worklist.back();
+            worklist.pop_back();
+            for (auto predecessor : m_predecessors[block]) {
+                if (m_dominators.is_reachable(predecessor) && !writes.count(predecessor) &&
+                    live_in.insert(predecessor).second) {
+                    worklist.push_back(predecessor);
+                }
+            }
+        }
+        return live_in;
+    }
+
+    std::map<IRBlockId, std::set<IRBlockId>> dominance_frontiers() const {
+        std::map<IRBlockId, std::set<IRBlockId>> frontiers;
+        for (auto block : m_dominators.get_order()) {
+            if (m_predecessors[block].size() < 2) {
+                continue;
+            }
+            for (auto predecessor : m_predecessors[block]) {
+                if (!m_dominators.is_reachable(predecessor)) {
+                    continue;
+                }
+                for (IRBlockId runner = predecessor; runner != m_dominators.immediate_dominator(block);
+                     runner = m_dominators.immediate_dominator(runner)) {
+                    frontiers[runner].insert(block);
+                }
+            }
+        }
+        return frontiers;
+    }
+
+    // phis on the iterated dominance frontier of the writes, where the value is live
+    void place_phis() {
+        auto frontiers = dominance_frontiers();
+        auto live_in = live_in_blocks();
+        std::vector<IRBlockId> worklist;
+        for (auto block : m_dominators.get_order()) {
+            auto& instructions = m_function.find_block(block)->instructions;
+            if (std::any_of(instructions.begin(), instructions.end(), [&](const IRInstruction& instruction) {
+                    return is_access(instruction) && instruction.opcode != IROpcode::Load;
+                })) {
+                worklist.push_back(block);
+            }
+        }
+        while (!worklist.empty()) {
+            IRBlockId block = worklist.back();
+            worklist.pop_back();
+            for (auto frontier : frontiers[block]) {
+                if (m_phis.count(frontier) || !live_in.count(frontier)) {
+                    continue;
+                }
+                IRInstruction phi{.opcode = IROpcode::Phi, .type = m_type, .result = m_function.new_value()};
+                m_phis[frontier] = phi.result;
+                auto& instructions = m_function.find_block(frontier)->instructions;
+                instructions.insert(instructions.begin(), std::move(phi));
+                worklist.push_back(frontier);
+            }
+        }
+    }
+
+    // the dominator tree depth first, with the object's value on entry to the block
+    void rename(IRBlockId block_id, IROperand current) {
+        auto phi = m_phis.find(block_id);
+        if (phi != m_phis.end()) {
+            current = IROperand::make_value(phi->second, m_type);
+        }
+        auto& instructions = m_function.find_block(block_id)->instructions;
+        for (size_t i = 0; i < instructions.size();) {
+            auto& instruction = instructions[i];
+            if (!is_access(instruction)) {
+                ++i;
+                continue;
+            }
+            switch (instruction.opcode) {
+                case IROpcode::Load:
+                    m_replacements[instruction.result] = current;
+                    break;
+                case IROpcode::Store:
+                    current = instruction.operands[0];
+                    break;
+                default:
+                    current = IROperand::make_constant(0, m_type);
+                    break;
+            }
+            instructions.erase(instructions.begin() + i);
+        }
+        m_end_values[block_id] = current;
+        for (auto child : m_dominators.children(block_id)) {
+            rename(child, current);
+        }
+    }
+
+    void promote(size_t object, IRType type) {
+        m_object = object;
+        m_type = type;
+        m_phis.clear();
+        m_end_values.clear();
+        place_phis();
+        // globals start zeroed, and a read of a local before any write reads 0 as it does in the lowering
+        rename(m_function.blocks.front().id, IROperand::make_constant(0, type));
+        for (auto [block_id, value] : m_phis) {
+            auto& instructions = m_function.find_block(block_id)->instructions;
+            auto& phi = instructions.front();
+            for (auto predecessor : m_predecessors[block_id]) {
+                auto end_value = m_end_values.find(predecessor);
+                phi.operands.push_back(end_value != m_end_values.end() ? end_value->second
+                                                                       : IROperand::make_constant(0, type));
+                phi.blocks.push_back(predecessor);
+            }
+        }
+        ir_replace_uses(m_function, m_replacements);
+        m_replacements.clear();
+    }
+};
+
+}  // namespace
+
+bool IRPromoteMemoryPass::run_on_function(IRFunction& function, IRModule& module, IRPassStatistics& statistics) {
+    // a promoted pointer can make the accesses through it exact, and what they reach promotable in turn
+    bool changed = false;
+    while (MemoryPromoter(function, module, statistics).run()) {
+        changed = true;
+    }
+    return changed;
+}
@@ -0,0 +1,350 @@
+#include <map>
+#include <set>
+
+#include "ir/ir_cfg.hpp"
+#include "ir/ir_passes.hpp"
+
+namespace {
+
+// the lattice of a value- unknown until proven otherwise, then a single constant, then anything
+struct LatticeValue {
+    enum class State {
+        Unknown,
+        Constant,
+        Overdefined,
+    };
+    State state = State::Unknown;
+    int64_t constant = 0;
+
+    bool is_unknown() const { return state == State::Unknown; }
+    bool is_constant() const { return state == State::Constant; }
+    bool is_overdefined() const { return state == State::Overdefined; }
+};
+
+// sparse conditional constant propagation- values are assumed constant and blocks unreachable until proven
+// otherwise, so constants flow through phis of branches that never go the other way
+class ConstantPropagation {
+   public:
+    explicit ConstantPropagation(IRFunction& function) : m_function(function) {}
+
+    void solve() {
+        m_executable_blocks.insert(m_function.blocks.front().id);
+        auto order = ir_reverse_post_order(m_function);
+        // every step only lowers a value in the lattice or marks an edge- iterating to a fixpoint terminates
+        bool changed = true;
+        while (changed) {
+            changed = false;
+            for (auto block_id : order) {
+                if (!m_executable_blocks.count(block_id)) {
+                    continue;
+                }
+                for (auto& instruction : m_function.find_block(block_id)->instructions) {
+                    changed = visit(block_id, instruction) || changed;
+                }
+            }
+        }
+    }
+
+    // rewrites the function with the solution. returns the number of replaced values and folded branches
+    std::pair<size_t, size_t> apply() {
+        std::map<IRValueId, IROperand> replacements;
+        for (auto& block : m_function.blocks) {
+            for (auto& instruction : block.instructions) {
+                if (instruction.has_result() && lattice(instruction.result).is_constant()) {
+                    replacements[instruction.result] =
+                        IROperand::make_constant(lattice(instruction.result).constant, instruction.type);
+                }
+            }
+        }
+        ir_replace_uses(m_function, replacements);
+        for (auto& block : m_function.blocks) {
+            std::vector<IRInstruction> kept;
+            for (auto& instruction : block.instructions) {
+                if (!replacements.count(instruction.result) || ir_has_side_effects(instruction.opcode)) {
+                    kept.push_back(std::move(instruction));
+                }
+            }
+            block.instructions = std::move(kept);
+        }
+
+        // the edges never taken go away, and with them the blocks only they reached
+        size_t folded_branches = 0;
+        for (auto& block : m_function.blocks) {
+            if (!m_executable_blocks.count(block.id) || block.terminator().opcode != IROpcode::Branch) {
+                continue;
+            }
+            auto& branch = block.terminator();
+            std::vector<IRBlockId> taken;
+            for (auto target : branch.blocks) {
+                if (m_executable_edges.count({block.id, target})) {
+                    taken.push_back(target);
+                }
+            }
+            if (taken.size() != 1 || branch.blocks[0] == branch.blocks[1]) {
+                continue;
+            }
+            IRBlockId dropped = taken.front() == branch.blocks[0] ? branch.blocks[1] : branch.blocks[0];
+            remove_phi_edge(*m_function.find_block(dropped), block.id);
+            branch = IRInstruction{.opcode = IROpcode::Jump, .blocks = {taken.front()}};
+            ++folded_branches;
+        }
+        ir_remove_unreachable_blocks(m_function);
+        return {replacements.size(), folded_branches};
+    }
+
+   private:
+    IRFunction& m_function;
+    std::map<IRValueId, LatticeValue> m_lattice;
+    std::set<IRBlockId> m_executable_blocks;
+    std::set<std::pair<IRBlockId, IRBlockId>> m_executable_edges;
+
+    LatticeValue lattice(IRValueId value) const {
+        auto found = m_lattice.find(value);
+        return found == m_lattice.end() ? LatticeValue{} : found->second;
+    }
+
+    LatticeValue lattice(const IROperand& operand) const {
+        if (operand.is_constant()) {
+            return LatticeValue{.state = LatticeValue::State::Constant, .constant = operand.constant};
+        }
+        return lattice(operand.value);
+    }
+
+    // lowers the value to the meet of its current state and 'value'. returns whether it changed
+    bool lower(IRValueId result, const LatticeValue& value) {
+        LatticeValue current = lattice(result);
+        LatticeValue met = meet(current, value);
+        if (met.state == current.state && met.constant == current.constant) {
+            return false;
+        }
+        m_lattice[result] = met;
+        return true;
+    }
+
+    static LatticeValue meet(const LatticeValue& a, const LatticeValue& b) {
+        if (a.is_unknown()) {
+            return b;
+        }
+        if (b.is_unknown()) {
+            return a;
+        }
+        if (a.is_constant() && b.is_constant() && a.constant == b.constant) {
+            return a;
+        }
+        return LatticeValue{.state = LatticeValue::State::Overdefined};
+    }
+
+    bool mark_edge(IRBlockId from, IRBlockId to) {
+        if (!m_executable_edges.insert({from, to}).second) {
+            return false;
+        }
+        m_executable_blocks.insert(to);
+        return true;
+    }
+
+    bool visit(IRBlockId block_id, const IRInstruction& instruction) {
+        auto& operands = instruction.operands;
+        switch (instruction.opcode) {
+            case IROpcode::Phi: {
+                LatticeValue value;
+                for (size_t i = 0; i < operands.size(); ++i) {
+                    if (m_executable_edges.count({instruction.blocks[i], block_id})) {
+                        value = meet(value, lattice(operands[i]));
+                    }
+                }
+                return lower(instruction.result, value);
+            }
+            case IROpcode::Jump:
+                return mark_edge(block_id, instruction.blocks[0]);
+            case IROpcode::Branch: {
+                LatticeValue condition = lattice(operands[0]);
+                if (condition.is_unknown()) {
+                    return false;
+                }
+                if (condition.is_constant()) {
+                    return mark_edge(block_id, instruction.blocks[condition.constant != 0 ? 0 : 1]);
+                }
+                bool changed = mark_edge(block_id, instruction.blocks[0]);
+                return mark_edge(block_id, instruction.blocks[1]) || changed;
+            }
+            default:
+                break;
+        }
+        if (!instruction.has_result()) {
+            return false;
+        }
+        if (!ir_is_foldable(instruction.opcode)) {
+            // loads, calls, parameters and addresses
+            return lower(instruction.result, LatticeValue{.state = LatticeValue::State::Overdefined});
+        }
+
+        std::vector<int64_t> constants;
+        for (auto& operand : operands) {
+            LatticeValue value = lattice(operand);
+            if (value.is_overdefined()) {
+                return lower(instruction.result, value);
+            }
+            if (value.is_unknown()) {
+                return false;
+            }
+            constants.push_back(value.constant);
+        }
+        auto folded = ir_evaluate(instruction.opcode, instruction.type, constants);
+        if (!folded) {
+            return lower(instruction.result, LatticeValue{.state = LatticeValue::State::Overdefined});
+        }
+        return lower(instruction.result, LatticeValue{.state = LatticeValue::State::Constant, .constant = *folded});
+    }
+
+    static void remove_phi_edge(IRBasicBlock& block, IRBlockId predecessor) {
+        for (auto& instruction : block.instructions) {
+            if (instruction.opcode != IROpcode::Phi) {
+                break;
+            }
+            for (size_t i = 0; i < instruction.blocks.size(); ++i) {
+                if (instruction.blocks[i] == predecessor) {
+                    instruction.blocks.erase(instruction.blocks.begin() + i);
+                    instruction.operands.erase(instruction.operands.begin() + i);
+                    break;
+                }
+            }
+        }
+    }
+};
+
+// the operand 'instruction' always equals, for identities such as x + 0 and x * 1
+std::optional<IROperand> simplify_identity(const IRInstruction& instruction) {
+    auto& operands = instruction.operands;
+    if (instruction.opcode == IROpcode::Phi) {
+        // every incoming value the same, other than the phi itself
+        std::optional<IROperand> same;
+        for (auto& operand : operands) {
+            if (operand.is_value() && operand.value == instruction.result) {
+                continue;
+            }
+            if (same && *same != operand) {
+                return std::nullopt;
+            }
+            same = operand;
+        }
+        return same;
+    }
+    if (!ir_is_binary(instruction.opcode)) {
+        return std::nullopt;
+    }
+    auto& lhs = operands[0];
+    auto& rhs = operands[1];
+    auto is = [](const IROperand& operand, int64_t constant) {
+        return operand.is_constant() && operand.constant == constant;
+    };
+    auto constant = [&instruction](int64_t value) { return IROperand::make_constant(value, instruction.type); };
+    switch (instruction.opcode) {
+        case IROpcode::Add:
+            if (is(rhs, 0)) {
+                return lhs;
+            }
+            if (is(lhs, 0)) {
+                return rhs;
+            }
+            break;
+        case IROpcode::Sub:
+            if (is(rhs, 0)) {
+                return lhs;
+            }
+            if (lhs == rhs) {
+                return constant(0);
+            }
+            break;
+        case IROpcode::Mul:
+            if (is(rhs, 1)) {
+                return lhs;
+            }
+            if (is(lhs, 1)) {
+                return rhs;
+            }
+            if (is(lhs, 0) || is(rhs, 0)) {
+                return constant(0);
+            }
+            break;
+        case IROpcode::UDiv:
+            if (is(rhs, 1)) {
+                return lhs;
+            }
+            break;
+        case IROpcode::URem:
+            if (is(rhs, 1)) {
+                return constant(0);
+            }
+            break;
+        case IROpcode::CmpEq:
+        case IROpcode::CmpLe:
+        case IROpcode::CmpGe:
+            if (lhs == rhs) {
+                return constant(1);
+            }
+            break;
+        case IROpcode::CmpLt:
+        case IROpcode::CmpGt:
+            if (lhs == rhs) {
+                return constant(0);
+            }
+            break;
+        default:
+            break;
+    }
+    return std::nullopt;
+}
+
+size_t simplify_identities(IRFunction& function) {
+    std::map<IRValueId, IROperand> replacements;
+    for (auto& block : function.blocks) {
+        for (auto& instruction : block.instructions) {
+            if (!instruction.has_result()) {
+                continue;
+            }
+            if (auto simplified = simplify_identity(instruction)) {
+                replacements[instruction.result] = *simplified;
+            }
+        }
+    }
+    if (replacements.empty()) {
+        return 0;
+    }
+    ir_replace_uses(function, replacements);
+    for (auto& block : function.blocks) {
+        std::vector<IRInstruction> kept;
+        for (auto& instruction : block.instructions) {
+            if (!replacements.count(instruction.result)) {
+                kept.push_back(std::move(instruction));
+            }
+        }
+        block.instructions = std::move(kept);
+    }
+    return replacements.size();
+}
+
+}  // namespace
+
+bool IRConstantPropagationPass::run_on_function(IRFunction& function, IRModule&, IRPassStatistics& statistics) {
+    bool changed = false;
+    while (true) {
+        ConstantPropagation propagation(function);
+        propagation.solve();
+        auto [values_folded, branches_folded] = propagation.apply();
+        size_t simplified = simplify_identities(function);
+        if (values_folded + branches_folded + simplified == 0) {
+            break;
+        }
+        if (values_folded > 0) {
+            statistics.counters["values folded"] += values_folded;
+        }
+        if (branches_folded > 0) {
+            statistics.counters["branches folded"] += branches_folded;
+        }
+        if (simplified > 0) {
+            statistics.counters["identities simplified"] += simplified;
+        }
+        changed = true;
+    }
+    return changed;
+}
@@ -0,0 +1,175 @@
+#include <algorithm>
+#include <set>
+
+#include "ir/ir_cfg.hpp"
+#include "ir/ir_passes.hpp"
+
+namespace {
+
+// drops the phi operand flowing from 'predecessor' into 'block'- one edge between them went away
+void remove_phi_edge(IRBasicBlock& block, IRBlockId predecessor) {
+    for (auto& instruction : block.instructions) {
+        if (instruction.opcode != IROpcode::Phi) {
+            continue;
+        }
+        for (size_t i = 0; i < instruction.blocks.size(); ++i) {
+            if (instruction.blocks[i] == predecessor) {
+                instruction.blocks.erase(instruction.blocks.begin() + i);
+                instruction.operands.erase(instruction.operands.begin() + i);
+                break;
+            }
+        }
+    }
+}
+
+bool has_phis(const IRBasicBlock& block) {
+    return !block.instructions.empty() && block.instructions.front().opcode == IROpcode::Phi;
+}
+
+// branch on a constant -> jump
+size_t fold_constant_branches(IRFunction& function) {
+    size_t folded = 0;
+    for (auto& block : function.blocks) {
+        if (!block.is_terminated() || block.terminator().opcode != IROpcode::Branch) {
+            continue;
+        }
+        auto& branch = block.terminator();
+        auto& condition = branch.operands.front();
+        bool same_targets = branch.blocks[0] == branch.blocks[1];
+        bool has_phi_target = has_phis(*function.find_block(branch.blocks[0]));
+        if (!condition.is_constant() && !(same_targets && !has_phi_target)) {
+            continue;
+        }
+        IRBlockId taken = !condition.is_constant() || condition.constant != 0 ? branch.blocks[0] : branch.blocks[1];
+        IRBlockId dropped = taken == branch.blocks[0] ? branch.blocks[1] : branch.blocks[0];
+        remove_phi_edge(*function.find_block(dropped), block.id);
+        branch = IRInstruction{.opcode = IROpcode::Jump, .blocks = {taken}};
+        ++folded;
+    }
+    return folded;
+}
+
+// redirects the predecessors of blocks that only jump somewhere else straight to the destination
+size_t bypass_empty_blocks(IRFunction& function) {
+    size_t bypassed = 0;
+    auto predecessors = ir_predecessors(function);
+    for (size_t i = 1; i < function.blocks.size(); ++i) {
+        auto& block = function.blocks[i];
+        if (block.instructions.size() != 1 || block.terminator().opcode != IROpcode::Jump) {
+            continue;
+        }
+        IRBlockId target_id = block.terminator().blocks.front();
+        auto& block_predecessors = predecessors.at(block.id);
+        if (target_id == block.id || block_predecessors.empty()) {
+            continue;
+        }
+        // a predecessor already jumping to the target would need two different values in one phi
+        auto* target = function.find_block(target_id);
+        auto& target_predecessors = predecessors.at(target_id);
+        bool phi_conflict = false;
+        std::set<IRBlockId> seen;
+        for (auto predecessor : block_predecessors) {
+            bool duplicate = !seen.insert(predecessor).second;
+            bool already_target = std::count(target_predecessors.begin(), target_predecessors.end(), predecessor) > 0;
+            phi_conflict = phi_conflict || duplicate || already_target;
+        }
+        if (phi_conflict && has_phis(*target)) {
+            continue;
+        }
+        for (auto& instruction : target->instructions) {
+            if (instruction.opcode != IROpcode::Phi) {
+                break;
+            }
+            auto incoming = std::find(instruction.blocks.begin(), instruction.blocks.end(), block.id);
+            IROperand value = instruction.operands.at(incoming - instruction.blocks.begin());
+            for (auto predecessor : block_predecessors) {
+                instruction.operands.push_back(value);
+                instruction.blocks.push_back(predecessor);
+            }
+        }
+        for (auto predecessor : block_predecessors) {
+            for (auto& successor : function.find_block(predecessor)->terminator().blocks) {
+                if (successor == block.id) {
+                    successor = target_id;
+                }
+            }
+        }
+        // the bypassed block is unreachable now, removing it drops its phi operands as well
+        ++bypassed;
+        predecessors = ir_predecessors(function);
+    }
+    return bypassed;
+}
+
+// appends a block to its only predecessor, when the predecessor always jumps to it
+size_t merge_blocks(IRFunction& function) {
+    size_t merged = 0;
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        auto predecessors = ir_predecessors(function);
+        for (size_t i = 1; i < function.blocks.size(); ++i) {
+            IRBlockId block_id = function.blocks[i].id;
+            if (predecessors.at(block_id).size() != 1) {
+                continue;
+            }
+            IRBlockId predecessor_id = predecessors.at(block_id).front();
+            auto* predecessor = function.find_block(predecessor_id);
+            if (predecessor_id == block_id || predecessor->terminator().opcode != IROpcode::Jump) {
+                continue;
+            }
+
+            IRBasicBlock block = std::move(function.blocks[i]);
+            function.blocks.erase(function.blocks.begin() + i);
+            predecessor = function.find_block(predecessor_id);
+            predecessor->instructions.pop_back();
+            std::map<IRValueId, IROperand> replacements;
+            for (auto& instruction : block.instructions) {
+                if (instruction.opcode == IROpcode::Phi) {
+                    // a single predecessor- the phi is its only operand
+                    replacements[instruction.result] = instruction.operands.front();
+                } else {
+                    predecessor->instructions.push_back(std::move(instruction));
+                }
+            }
+            ir_replace_uses(function, replacements);
+            for (auto successor : predecessor->successors()) {
+                for (auto& instruction : function.find_block(successor)->instructions) {
+                    if (instruction.opcode != IROpcode::Phi) {
+                        break;
+                    }
+                    std::replace(instruction.blocks.begin(), instruction.blocks.end(), block.id, predecessor_id);
+                }
+            }
+            ++merged;
+            changed = true;
+            break;
+        }
+    }
+    return merged;
+}
+
+}  // namespace
+
+bool IRSimplifyCFGPass::run_on_function(IRFunction& function, IRModule&, IRPassStatistics& statistics) {
+    bool changed = false;
+    while (true) {
+        size_t folded = fold_constant_branches(function);
+        size_t removed = ir_remove_unreachable_blocks(function);
+        size_t bypassed = bypass_empty_blocks(function);
+        removed += ir_remove_unreachable_blocks(function);
+        size_t merged = merge_blocks(function);
+        if (folded + removed + bypassed + merged == 0) {
+            break;
+        }
+        if (folded > 0) {
+            statistics.counters["branches folded"] += folded;
+        }
+        if (bypassed > 0) {
+            statistics.counters["empty blocks bypassed"] += bypassed;
+        }
+        statistics.blocks_merged += merged;
+        changed = true;
+    }
+    return changed;
+}
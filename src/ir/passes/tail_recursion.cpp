@@ -0,0 +1,208 @@
+#include <algorithm>
+
+#include "ir/ir_cfg.hpp"
+#include "ir/ir_memory.hpp"
+#include "ir/ir_passes.hpp"
+
+namespace {
+
+// a block ending in a call of the function itself whose result is returned- directly, or combined with one more
+// value through an associative operation
+struct TailCallSite {
+    size_t block_index;
+    // index of the call in the block
+    size_t call_index;
+    // the add/mul between the call and the return, nothing for a plain tail call
+    std::optional<IROpcode> accumulation = std::nullopt;
+};
+
+bool is_self_call(const IRInstruction& instruction, const IRFunction& function) {
+    return instruction.opcode == IROpcode::Call && instruction.symbol == function.name;
+}
+
+std::optional<TailCallSite> find_tail_call(const IRFunction& function, size_t block_index) {
+    auto& instructions = function.blocks[block_index].instructions;
+    size_t size = instructions.size();
+    if (size < 2 || instructions.back().opcode != IROpcode::Return) {
+        return std::nullopt;
+    }
+    auto& return_instruction = instructions.back();
+
+    auto& previous = instructions[size - 2];
+    if (is_self_call(previous, function)) {
+        bool returns_call = return_instruction.operands.empty()
+                                ? true
+                                : previous.has_result() && return_instruction.operands[0] == previous.result_operand();
+        if (!returns_call) {
+            return std::nullopt;
+        }
+        return TailCallSite{.block_index = block_index, .call_index = size - 2};
+    }
+
+    // return f(...) * x, return x + f(...)
+    if (size < 3 || !is_self_call(instructions[size - 3], function) || !instructions[size - 3].has_result()) {
+        return std::nullopt;
+    }
+    auto& call = instructions[size - 3];
+    bool accumulates = (previous.opcode == IROpcode::Add || previous.opcode == IROpcode::Mul) &&
+                       return_instruction.operands.size() == 1 &&
+                       return_instruction.operands[0] == previous.result_operand();
+    if (!accumulates) {
+        return std::nullopt;
+    }
+    // the result on both sides, f(...) * f(...), is no accumulation
+    auto result = call.result_operand();
+    if ((previous.operands[0] == result) == (previous.operands[1] == result)) {
+        return std::nullopt;
+    }
+    return TailCallSite{.block_index = block_index, .call_index = size - 3, .accumulation = previous.opcode};
+}
+
+// another call would get the memory of its own allocas- a loop reuses them, which only works while no address
+// of them outlives an iteration
+bool has_escaping_allocas(const IRFunction& function, const IRModule& module) {
+    IRMemoryObjects objects(function, module);
+    for (size_t i = 0; i < objects.size(); ++i) {
+        if (objects.object(i).kind == IRMemoryObject::Kind::Alloca && objects.is_visible(i)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+}  // namespace
+
+bool IRTailRecursionPass::run_on_function(IRFunction& function, IRModule& module, IRPassStatistics& statistics) {
+    if (function.is_entry || function.blocks.empty()) {
+        return false;
+    }
+    std::vector<TailCallSite> sites;
+    std::optional<IROpcode> accumulation;
+    for (size_t i = 0; i < function.blocks.size(); ++i) {
+        auto site = find_tail_call(function, i);
+        if (!site) {
+            continue;
+        }
+        // a single accumulator- the sites that combine the result differently stay calls
+        if (site->accumulation) {
+            if (accumulation && *accumulation != *site->accumulation) {
+                continue;
+            }
+            accumulation = site->accumulation;
+        }
+        sites.push_back(*site);
+    }
+    if (sites.empty() || has_escaping_allocas(function, module)) {
+        return false;
+    }
+
+    // the entry block keeps the parameters and allocas. the rest of it becomes the loop header every tail call
+    // jumps back to, where phis of the arguments replace the parameters
+    IRBlockId entry_id = function.blocks.front().id;
+    IRBlockId header_id = function.next_block_id++;
+    {
+        auto& entry = function.blocks.front().instructions;
+        auto body_begin = std::find_if(entry.begin(), entry.end(), [](const IRInstruction& instruction) {
+            return instruction.opcode != IROpcode::Param && instruction.opcode != IROpcode::Alloca;
+        });
+        size_t prologue_size = body_begin - entry.begin();
+        IRBasicBlock header{.id = header_id, .instructions = {}};
+        header.instructions.assign(std::make_move_iterator(body_begin), std::make_move_iterator(entry.end()));
+        entry.erase(body_begin, entry.end());
+        entry.push_back(IRInstruction{.opcode = IROpcode::Jump, .blocks = {header_id}});
+        for (auto successor : header.successors()) {
+            for (auto& instruction : function.find_block(successor)->instructions) {
+                if (instruction.opcode != IROpcode::Phi) {
+                    break;
+                }
+                std::replace(instruction.blocks.begin(), instruction.blocks.end(), entry_id, header_id);
+            }
+        }
+        function.blocks.insert(function.blocks.begin() + 1, std::move(header));
+        // every later block moved one place further, and a tail call of the entry block moved into the header
+        for (auto& site : sites) {
+            if (site.block_index > 0) {
+                ++site.block_index;
+            } else {
+                site.block_index = 1;
+                site.call_index -= prologue_size;
+            }
+        }
+    }
+
+    std::vector<IRInstruction> phis;
+    // the argument index of every phi
+    std::vector<size_t> phi_parameters;
+    for (auto& instruction : function.blocks.front().instructions) {
+        if (instruction.opcode == IROpcode::Param) {
+            phi_parameters.push_back(instruction.immediate);
+            phis.push_back(IRInstruction{.opcode = IROpcode::Phi,
+                                         .type = instruction.type,
+                                         .result = function.new_value(),
+                                         .operands = {instruction.result_operand()},
+                                         .blocks = {entry_id}});
+        }
+    }
+    // the phis aren't in the function yet, so they keep reading the parameters
+    for (auto& phi : phis) {
+        ir_replace_uses(function, phi.operands[0].value, phi.result_operand());
+    }
+
+    // the accumulator starts at the operation's identity, and every remaining return combines its value with it
+    IRInstruction accumulator{.opcode = IROpcode::Phi, .type = function.return_type};
+    if (accumulation) {
+        accumulator.result = function.new_value();
+        accumulator.operands.push_back(
+            IROperand::make_constant(*accumulation == IROpcode::Mul ? 1 : 0, function.return_type));
+        accumulator.blocks.push_back(entry_id);
+    }
+
+    for (auto& site : sites) {
+        auto& block = function.blocks[site.block_index];
+        IRInstruction call = block.instructions[site.call_index];
+        for (size_t i = 0; i < phis.size(); ++i) {
+            phis[i].operands.push_back(call.operands.at(phi_parameters[i]));
+            phis[i].blocks.push_back(block.id);
+        }
+        std::optional<IRInstruction> combine;
+        if (accumulation) {
+            IROperand accumulated = accumulator.result_operand();
+            if (site.accumulation) {
+                // the value the call's result was combined with joins the accumulator instead
+                auto& operands = block.instructions[site.call_index + 1].operands;
+                IROperand combined = operands[0] == call.result_operand() ? operands[1] : operands[0];
+                combine = IRInstruction{.opcode = *accumulation,
+                                        .type = function.return_type,
+                                        .result = function.new_value(),
+                                        .operands = {accumulated, combined}};
+                accumulated = combine->result_operand();
+            }
+            accumulator.operands.push_back(accumulated);
+            accumulator.blocks.push_back(block.id);
+        }
+        block.instructions.resize(site.call_index);
+        if (combine) {
+            block.instructions.push_back(std::move(*combine));
+        }
+        block.instructions.push_back(IRInstruction{.opcode = IROpcode::Jump, .blocks = {header_id}});
+    }
+    if (accumulation) {
+        for (auto& block : function.blocks) {
+            if (!block.is_terminated() || block.terminator().opcode != IROpcode::Return) {
+                continue;
+            }
+            IRInstruction combine{.opcode = *accumulation,
+                                  .type = function.return_type,
+                                  .result = function.new_value(),
+                                  .operands = {accumulator.result_operand(), block.terminator().operands.at(0)}};
+            block.terminator().operands[0] = combine.result_operand();
+            block.instructions.insert(block.instructions.end() - 1, std::move(combine));
+        }
+        phis.push_back(std::move(accumulator));
+    }
+
+    auto& header = function.blocks[1].instructions;
+    header.insert(header.begin(), std::make_move_iterator(phis.begin()), std::make_move_iterator(phis.end()));
+    statistics.counters["tail calls eliminated"] += sites.size();
+    return true;
+}
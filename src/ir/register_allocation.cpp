@@ -0,0 +1,335 @@
+#include "ir/ir_register_allocation.hpp"
+
+#include <algorithm>
+
+#include "ir/ir_cfg.hpp"
+
+namespace {
+
+struct RegisterNames {
+    const char* qword;
+    const char* dword;
+    const char* word;
+    const char* byte;
+};
+
+const std::map<IRRegister, RegisterNames> register_names = {
+    {IRRegister::RAX, {"rax", "eax", "ax", "al"}},     {IRRegister::RBX, {"rbx", "ebx", "bx", "bl"}},
+    {IRRegister::RCX, {"rcx", "ecx", "cx", "cl"}},     {IRRegister::RDX, {"rdx", "edx", "dx", "dl"}},
+    {IRRegister::RSI, {"rsi", "esi", "si", "sil"}},    {IRRegister::RDI, {"rdi", "edi", "di", "dil"}},
+    {IRRegister::R8, {"r8", "r8d", "r8w", "r8b"}},     {IRRegister::R9, {"r9", "r9d", "r9w", "r9b"}},
+    {IRRegister::R10, {"r10", "r10d", "r10w", "r10b"}}, {IRRegister::R11, {"r11", "r11d", "r11w", "r11b"}},
+    {IRRegister::R12, {"r12", "r12d", "r12w", "r12b"}}, {IRRegister::R13, {"r13", "r13d", "r13w", "r13b"}},
+    {IRRegister::R14, {"r14", "r14d", "r14w", "r14b"}}, {IRRegister::R15, {"r15", "r15d", "r15w", "r15b"}},
+};
+
+// the registers in the order they're handed out. rax, rcx, rdx and r11 come last among the caller-saved ones- the
+// instructions with fixed registers, division and the strength-reduced sequences, would have to save them
+const std::vector<IRRegister> caller_saved_order = {
+    IRRegister::RSI, IRRegister::RDI, IRRegister::R8,  IRRegister::R9,
+    IRRegister::R10, IRRegister::R11, IRRegister::RCX, IRRegister::RDX, IRRegister::RAX,
+};
+const std::vector<IRRegister> callee_saved_order = {
+    IRRegister::RBX, IRRegister::R12, IRRegister::R13, IRRegister::R14, IRRegister::R15,
+};
+const std::vector<IRRegister> argument_registers = {
+    IRRegister::RDI, IRRegister::RSI, IRRegister::RDX, IRRegister::RCX, IRRegister::R8, IRRegister::R9,
+};
+
+uint32_t bit(IRRegister reg) { return 1u << (uint32_t)reg; }
+
+std::set<IRRegister> registers_of(uint32_t mask) {
+    std::set<IRRegister> registers;
+    for (auto reg : ir_all_registers()) {
+        if (mask & bit(reg)) {
+            registers.insert(reg);
+        }
+    }
+    return registers;
+}
+
+}  // namespace
+
+std::string ir_register_name(IRRegister reg, size_t size_bytes) {
+    auto& names = register_names.at(reg);
+    switch (size_bytes) {
+        case 1:
+            return names.byte;
+        case 2:
+            return names.word;
+        case 4:
+            return names.dword;
+        default:
+            return names.qword;
+    }
+}
+
+bool ir_is_callee_saved(IRRegister reg) {
+    return std::find(callee_saved_order.begin(), callee_saved_order.end(), reg) != callee_saved_order.end();
+}
+
+const std::vector<IRRegister>& ir_argument_registers() { return argument_registers; }
+
+const std::vector<IRRegister>& ir_all_registers() {
+    static const std::vector<IRRegister> registers = []() {
+        std::vector<IRRegister> all;
+        for (auto& [reg, names] : register_names) {
+            all.push_back(reg);
+        }
+        return all;
+    }();
+    return registers;
+}
+
+IRRegisterAllocation::IRRegisterAllocation(const IRFunction& function) : m_function(function) {
+    build_intervals();
+    allocate();
+    find_live_registers();
+}
+
+std::optional<IRRegister> IRRegisterAllocation::register_of(IRValueId value) const {
+    auto reg = m_registers.find(value);
+    if (reg == m_registers.end()) {
+        return std::nullopt;
+    }
+    return reg->second;
+}
+
+std::set<IRRegister> IRRegisterAllocation::live_across(const IRInstruction& instruction) const {
+    return registers_of(m_live_across.at(m_indices.at(&instruction)));
+}
+
+std::set<IRRegister> IRRegisterAllocation::busy(const IRInstruction& instruction) const {
+    return registers_of(m_busy.at(m_indices.at(&instruction)));
+}
+
+std::set<IRRegister> IRRegisterAllocation::used_registers() const {
+    std::set<IRRegister> used;
+    for (auto& [value, reg] : m_registers) {
+        used.insert(reg);
+    }
+    return used;
+}
+
+void IRRegisterAllocation::build_intervals() {
+    auto is_scalar = [](const IROperand& operand) { return operand.is_value() && !ir_is_vector(operand.type); };
+    // the first and last position of every block
+    std::vector<std::pair<size_t, size_t>> ranges(m_function.next_block_id);
+    size_t index = 0;
+    for (auto& block : m_function.blocks) {
+        size_t first = index;
+        for (auto& instruction : block.instructions) {
+            m_indices[&instruction] = index++;
+        }
+        ranges[block.id] = {2 * first, 2 * (index - 1) + 1};
+    }
+
+    // live values at the block boundaries, backwards until nothing changes. a phi's operand is live out of the
+    // predecessor it comes from, its result isn't live into its block
+    std::vector<std::set<IRValueId>> live_in(m_function.next_block_id);
+    std::vector<std::set<IRValueId>> live_out(m_function.next_block_id);
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (auto block = m_function.blocks.rbegin(); block != m_function.blocks.rend(); ++block) {
+            std::set<IRValueId> live;
+            for (auto successor : block->successors()) {
+                live.insert(live_in[successor].begin(), live_in[successor].end());
+                for (auto& phi : m_function.find_block(successor)->instructions) {
+                    if (phi.opcode != IROpcode::Phi) {
+                        break;
+                    }
+                    for (size_t i = 0; i < phi.blocks.size(); ++i) {
+                        if (phi.blocks[i] == block->id && is_scalar(phi.operands[i])) {
+                            live.insert(phi.operands[i].value);
+                        }
+                    }
+                }
+            }
+            live_out[block->id] = live;
+            for (auto instruction = block->instructions.rbegin(); instruction != block->instructions.rend();
+                 ++instruction) {
+                if (instruction->has_result()) {
+                    live.erase(instruction->result);
+                }
+                if (instruction->opcode == IROpcode::Phi) {
+                    continue;
+                }
+                for (auto& operand : instruction->operands) {
+                    if (is_scalar(operand)) {
+                        live.insert(operand.value);
+                    }
+                }
+            }
+            if (live != live_in[block->id]) {
+                live_in[block->id] = std::move(live);
+                changed = true;
+            }
+        }
+    }
+
+    std::map<IRValueId, std::pair<size_t, size_t>> extents;
+    auto extend = [&](IRValueId value, size_t position) {
+        auto [extent, inserted] = extents.try_emplace(value, position, position);
+        extent->second.first = std::min(extent->second.first, position);
+        extent->second.second = std::max(extent->second.second, position);
+    };
+    for (auto& block : m_function.blocks) {
+        auto [start, end] = ranges[block.id];
+        for (auto value : live_in[block.id]) {
+            extend(value, start);
+        }
+        for (auto value : live_out[block.id]) {
+            extend(value, end);
+        }
+        for (auto& instruction : block.instructions) {
+            size_t index = m_indices.at(&instruction);
+            if (instruction.opcode != IROpcode::Phi) {
+                for (auto& operand : instruction.operands) {
+                    if (is_scalar(operand)) {
+                        extend(operand.value, 2 * index);
+                    }
+                }
+            }
+            if (instruction.has_result() && !ir_is_vector(instruction.type)) {
+                // the parameters are all moved out of the argument registers on entry
+                bool at_start = instruction.opcode == IROpcode::Phi || instruction.opcode == IROpcode::Param;
+                extend(instruction.result, at_start ? start : 2 * index + 1);
+            }
+        }
+    }
+    for (auto& [value, extent] : extents) {
+        m_intervals.push_back(Interval{.value = value, .start = extent.first, .end = extent.second});
+    }
+    std::sort(m_intervals.begin(), m_intervals.end(), [](const Interval& a, const Interval& b) {
+        return std::tie(a.start, a.value) < std::tie(b.start, b.value);
+    });
+}
+
+void IRRegisterAllocation::allocate() {
+    // the registers worth trying first for a value- its phi's or its incoming values' when they're free, so the
+    // copies on the edges vanish, and its first operand's when it dies here, so the operation works in place. a
+    // call's result is in rax regardless
+    std::map<IRValueId, std::vector<IRValueId>> hints;
+    // the register the calling convention moves a value from or to- a parameter's, an argument's or a result's.
+    // the first one a value meets wins
+    std::map<IRValueId, IRRegister> conventions;
+    std::vector<size_t> calls;
+    for (auto& block : m_function.blocks) {
+        for (auto& instruction : block.instructions) {
+            if (instruction.opcode == IROpcode::Param && (size_t)instruction.immediate < argument_registers.size()) {
+                conventions.insert({instruction.result, argument_registers[instruction.immediate]});
+            }
+            if (instruction.opcode == IROpcode::Call) {
+                calls.push_back(2 * m_indices.at(&instruction) + 1);
+                for (size_t i = 0; i < instruction.operands.size() && i < argument_registers.size(); ++i) {
+                    if (instruction.operands[i].is_value()) {
+                        conventions.insert({instruction.operands[i].value, argument_registers[i]});
+                    }
+                }
+                if (instruction.has_result()) {
+                    conventions.insert({instruction.result, IRRegister::RAX});
+                }
+            }
+            if (instruction.opcode == IROpcode::Return && !instruction.operands.empty() &&
+                instruction.operands[0].is_value()) {
+                conventions.insert({instruction.operands[0].value, IRRegister::RAX});
+            }
+            if (!instruction.has_result()) {
+                continue;
+            }
+            for (size_t i = 0; i < instruction.operands.size(); ++i) {
+                auto& operand = instruction.operands[i];
+                if (!operand.is_value()) {
+                    continue;
+                }
+                if (instruction.opcode == IROpcode::Phi) {
+                    hints[instruction.result].push_back(operand.value);
+                    hints[operand.value].push_back(instruction.result);
+                } else if (i == 0 && instruction.opcode != IROpcode::Call) {
+                    hints[instruction.result].push_back(operand.value);
+                }
+            }
+        }
+    }
+
+    std::vector<const Interval*> active;
+    uint32_t used = 0;
+    for (auto& interval : m_intervals) {
+        for (auto other = active.begin(); other != active.end();) {
+            if ((*other)->end < interval.start) {
+                used &= ~bit(m_registers.at((*other)->value));
+                other = active.erase(other);
+            } else {
+                ++other;
+            }
+        }
+
+        bool crosses_call = std::any_of(calls.begin(), calls.end(), [&](size_t call) {
+            return interval.start < call && call < interval.end;
+        });
+        std::optional<IRRegister> chosen;
+        for (auto hint : hints[interval.value]) {
+            auto reg = m_registers.find(hint);
+            if (reg != m_registers.end() && !(used & bit(reg->second))) {
+                chosen = reg->second;
+                break;
+            }
+        }
+        // a value living across a call is better off in a callee-saved register than in the one it's passed in
+        auto convention = conventions.find(interval.value);
+        if (!chosen && convention != conventions.end() && !crosses_call && !(used & bit(convention->second))) {
+            chosen = convention->second;
+        }
+        if (!chosen) {
+            auto& first = crosses_call ? callee_saved_order : caller_saved_order;
+            auto& second = crosses_call ? caller_saved_order : callee_saved_order;
+            for (auto order : {&first, &second}) {
+                auto reg = std::find_if(order->begin(), order->end(), [&](IRRegister reg) { return !(used & bit(reg)); });
+                if (reg != order->end()) {
+                    chosen = *reg;
+                    break;
+                }
+            }
+        }
+        if (!chosen) {
+            // the interval ending last gives up its register- the current one when nothing active outlives it
+            auto last = std::max_element(active.begin(), active.end(),
+                                         [](const Interval* a, const Interval* b) { return a->end < b->end; });
+            ++m_spilled;
+            if ((*last)->end <= interval.end) {
+                continue;
+            }
+            chosen = m_registers.at((*last)->value);
+            m_registers.erase((*last)->value);
+            active.erase(last);
+        }
+        m_registers[interval.value] = *chosen;
+        used |= bit(*chosen);
+        active.push_back(&interval);
+    }
+}
+
+void IRRegisterAllocation::find_live_registers() {
+    m_live_across.assign(m_indices.size(), 0);
+    m_busy.assign(m_indices.size(), 0);
+    std::vector<const Interval*> active;
+    size_t next = 0;
+    for (size_t index = 0; index < m_indices.size(); ++index) {
+        for (; next < m_intervals.size() && m_intervals[next].start <= 2 * index + 1; ++next) {
+            if (m_registers.count(m_intervals[next].value)) {
+                active.push_back(&m_intervals[next]);
+            }
+        }
+        active.erase(std::remove_if(active.begin(), active.end(),
+                                    [&](const Interval* interval) { return interval->end < 2 * index; }),
+                     active.end());
+        for (auto interval : active) {
+            uint32_t reg = bit(m_registers.at(interval->value));
+            m_busy[index] |= reg;
+            if (interval->start <= 2 * index && interval->end >= 2 * index + 1) {
+                m_live_across[index] |= reg;
+            }
+        }
+    }
+}
@@ -0,0 +1,411 @@
+#include "ir/ir_verifier.hpp"
+
+#include <map>
+#include <set>
+#include <sstream>
+
+#include "ir/ir_cfg.hpp"
+
+namespace {
+
+struct Definition {
+    IRBlockId block;
+    size_t index;
+    IRType type;
+};
+
+class FunctionVerifier {
+   public:
+    FunctionVerifier(const IRFunction& function, const IRModule& module)
+        : m_function(function), m_module(module), m_dominators(function) {}
+
+    std::vector<std::string> verify() {
+        if (m_function.blocks.empty()) {
+            problem("function has no blocks");
+            return m_problems;
+        }
+        collect_definitions();
+        auto predecessors = ir_predecessors(m_function);
+        if (!predecessors.at(m_function.blocks.front().id).empty()) {
+            problem("the entry block has predecessors");
+        }
+        std::set<IRBlockId> block_ids;
+        for (auto& block : m_function.blocks) {
+            if (!block_ids.insert(block.id).second) {
+                problem("block bb" + std::to_string(block.id) + " is defined twice");
+            }
+        }
+        for (auto& block : m_function.blocks) {
+            verify_block(block, predecessors.at(block.id), block_ids);
+        }
+        return m_problems;
+    }
+
+   private:
+    const IRFunction& m_function;
+    const IRModule& m_module;
+    IRDominatorTree m_dominators;
+    std::map<IRValueId, Definition> m_definitions;
+    std::vector<std::string> m_problems;
+
+    void problem(const std::string& message) { m_problems.push_back("function '" + m_function.name + "': " + message); }
+
+    void problem(const IRInstruction& instruction, const std::string& message) {
+        problem("'" + to_string(instruction) + "': " + message);
+    }
+
+    void collect_definitions() {
+        for (auto& block : m_function.blocks) {
+            for (size_t i = 0; i < block.instructions.size(); ++i) {
+                auto& instruction = block.instructions[i];
+                if (!instruction.has_result()) {
+                    if (instruction.type != IRType::Void) {
+                        problem(instruction, "typed instruction without a result");
+                    }
+                    continue;
+                }
+                if (instruction.result >= m_function.next_value_id) {
+                    problem(instruction, "value id out of range");
+                }
+                if (instruction.type == IRType::Void) {
+                    problem(instruction, "result of type void");
+                }
+                auto [existing, inserted] =
+                    m_definitions.emplace(instruction.result, Definition{block.id, i, instruction.type});
+                if (!inserted) {
+                    problem(instruction, "value is defined more than once");
+                }
+            }
+        }
+    }
+
+    // the definition of 'operand' must dominate the point of use. for phis, that's the end of the incoming block
+    void check_operand(const IRInstruction& instruction, const IROperand& operand, IRBlockId use_block,
+                       size_t use_index) {
+        if (operand.type == IRType::Void) {
+            problem(instruction, "operand of type void");
+        }
+        if (operand.is_constant()) {
+            if (ir_is_vector(operand.type)) {
+                problem(instruction, "vector constant");
+            }
+            if (operand.constant != ir_normalize(operand.constant, operand.type)) {
+                problem(instruction, "constant isn't normalized to its type");
+            }
+            return;
+        }
+        auto definition = m_definitions.find(operand.value);
+        if (definition == m_definitions.end()) {
+            problem(instruction, "use of undefined value %" + std::to_string(operand.value));
+            return;
+        }
+        if (definition->second.type != operand.type) {
+            problem(instruction, "operand %" + std::to_string(operand.value) + " is " +
+                                     ir_type_name(definition->second.type) + ", used as " +
+                                     ir_type_name(operand.type));
+        }
+        if (!m_dominators.is_reachable(use_block)) {
+            return;
+        }
+        auto& def = definition->second;
+        bool dominated = def.block == use_block ? def.index < use_index
+                                                : m_dominators.dominates(def.block, use_block);
+        if (!dominated) {
+            problem(instruction, "use of %" + std::to_string(operand.value) + " isn't dominated by its definition");
+        }
+    }
+
+    void expect_operands(const IRInstruction& instruction, size_t count) {
+        if (instruction.operands.size() != count) {
+            problem(instruction, "expected " + std::to_string(count) + " operands");
+        }
+    }
+
+    void verify_block(const IRBasicBlock& block, const std::vector<IRBlockId>& predecessors,
+                      const std::set<IRBlockId>& block_ids) {
+        std::string name = "bb" + std::to_string(block.id);
+        if (!block.is_terminated()) {
+            problem(name + " doesn't end with a terminator");
+        }
+        bool phis_allowed = true;
+        bool params_allowed = block.id == m_function.blocks.front().id;
+        for (size_t i = 0; i < block.instructions.size(); ++i) {
+            auto& instruction = block.instructions[i];
+            if (ir_is_terminator(instruction.opcode) && i + 1 != block.instructions.size()) {
+                problem(instruction, "terminator in the middle of " + name);
+            }
+            if (instruction.opcode == IROpcode::Param && !params_allowed) {
+                problem(instruction, "param after a non-param instruction or outside of the entry block");
+            }
+            params_allowed = params_allowed && instruction.opcode == IROpcode::Param;
+            if (instruction.opcode == IROpcode::Phi) {
+                if (!phis_allowed) {
+                    problem(instruction, "phi after a non-phi instruction");
+                }
+                verify_phi(block, instruction, predecessors);
+                continue;
+            }
+            phis_allowed = false;
+            for (auto& operand : instruction.operands) {
+                check_operand(instruction, operand, block.id, i);
+            }
+            for (auto target : instruction.blocks) {
+                if (!block_ids.count(target)) {
+                    problem(instruction, "target bb" + std::to_string(target) + " doesn't exist");
+                }
+            }
+            verify_types(instruction);
+        }
+    }
+
+    void verify_phi(const IRBasicBlock& block, const IRInstruction& phi, const std::vector<IRBlockId>& predecessors) {
+        if (phi.operands.size() != phi.blocks.size()) {
+            problem(phi, "phi with a different number of values and blocks");
+            return;
+        }
+        if (ir_is_vector(phi.type)) {
+            problem(phi, "phi of a vector");
+        }
+        std::multiset<IRBlockId> incoming(phi.blocks.begin(), phi.blocks.end());
+        std::multiset<IRBlockId> expected(predecessors.begin(), predecessors.end());
+        if (incoming != expected) {
+            problem(phi, "phi blocks don't match the predecessors of bb" + std::to_string(block.id));
+        }
+        for (size_t i = 0; i < phi.operands.size(); ++i) {
+            if (phi.operands[i].type != phi.type) {
+                problem(phi, "phi operand of a different type");
+            }
+            auto* incoming_block = m_function.find_block(phi.blocks[i]);
+            if (incoming_block) {
+                check_operand(phi, phi.operands[i], incoming_block->id, incoming_block->instructions.size());
+            }
+        }
+    }
+
+    void expect_type(const IRInstruction& instruction, const IROperand& operand, IRType type) {
+        if (operand.type != type) {
+            problem(instruction, "expected an operand of type " + ir_type_name(type));
+        }
+    }
+
+    void verify_types(const IRInstruction& instruction) {
+        auto& operands = instruction.operands;
+        switch (instruction.opcode) {
+            case IROpcode::Param:
+                expect_operands(instruction, 0);
+                if (instruction.immediate < 0 || (size_t)instruction.immediate >= m_function.parameter_types.size() ||
+                    m_function.parameter_types[instruction.immediate] != instruction.type) {
+                    problem(instruction, "doesn't match the function's parameters");
+                }
+                return;
+            case IROpcode::Alloca:
+            case IROpcode::GlobalAddr:
+                expect_operands(instruction, 0);
+                if (instruction.type != IRType::I64) {
+                    problem(instruction, "addresses are i64");
+                }
+                if (instruction.opcode == IROpcode::GlobalAddr) {
+                    bool found = false;
+                    for (auto& global : m_module.globals) {
+                        found = found || global.name == instruction.symbol;
+                    }
+                    if (!found) {
+                        problem(instruction, "unknown global");
+                    }
+                } else if (instruction.immediate <= 0) {
+                    problem(instruction, "alloca of no bytes");
+                }
+                return;
+            case IROpcode::Load:
+                expect_operands(instruction, 1);
+                if (operands.size() == 1) {
+                    expect_type(instruction, operands[0], IRType::I64);
+                }
+                return;
+            case IROpcode::Store:
+                expect_operands(instruction, 2);
+                if (operands.size() == 2) {
+                    expect_type(instruction, operands[1], IRType::I64);
+                }
+                return;
+            case IROpcode::Zero:
+                expect_operands(instruction, 1);
+                if (operands.size() == 1) {
+                    expect_type(instruction, operands[0], IRType::I64);
+                }
+                return;
+            case IROpcode::Neg:
+                expect_operands(instruction, 1);
+                if (operands.size() == 1) {
+                    expect_type(instruction, operands[0], instruction.type);
+                }
+                return;
+            case IROpcode::ZExt:
+            case IROpcode::Trunc: {
+                expect_operands(instruction, 1);
+                if (operands.size() != 1) {
+                    return;
+                }
+                size_t from = ir_type_size(operands[0].type), to = ir_type_size(instruction.type);
+                if (instruction.opcode == IROpcode::ZExt ? from >= to : from <= to) {
+                    problem(instruction, "conversion in the wrong direction");
+                }
+                return;
+            }
+            case IROpcode::Call: {
+                auto* callee = m_module.find_function(instruction.symbol);
+                if (!callee || callee->is_entry) {
+                    problem(instruction, "call of an unknown function");
+                    return;
+                }
+                if (callee->return_type != instruction.type) {
+                    problem(instruction, "result type doesn't match the callee");
+                }
+                expect_operands(instruction, callee->parameter_types.size());
+                for (size_t i = 0; i < operands.size() && i < callee->parameter_types.size(); ++i) {
+                    expect_type(instruction, operands[i], callee->parameter_types[i]);
+                }
+                return;
+            }
+            case IROpcode::Jump:
+                if (instruction.blocks.size() != 1) {
+                    problem(instruction, "jump with other than one target");
+                }
+                expect_operands(instruction, 0);
+                return;
+            case IROpcode::Branch:
+                if (instruction.blocks.size() != 2) {
+                    problem(instruction, "branch with other than two targets");
+                }
+                expect_operands(instruction, 1);
+                return;
+            case IROpcode::Return:
+                if (m_function.is_entry) {
+                    problem(instruction, "return from the entry function");
+                }
+                if (m_function.return_type == IRType::Void) {
+                    expect_operands(instruction, 0);
+                } else {
+                    expect_operands(instruction, 1);
+                    if (operands.size() == 1) {
+                        expect_type(instruction, operands[0], m_function.return_type);
+                    }
+                }
+                return;
+            case IROpcode::Exit:
+                expect_operands(instruction, 1);
+                return;
+            case IROpcode::VectorSplat:
+            case IROpcode::VectorLoad:
+            case IROpcode::VectorStore:
+            case IROpcode::VectorAdd:
+            case IROpcode::VectorSub:
+            case IROpcode::VectorMul:
+            case IROpcode::VectorReduceAdd:
+                verify_vector_types(instruction);
+                return;
+            default:
+                break;
+        }
+        if (ir_is_binary(instruction.opcode)) {
+            expect_operands(instruction, 2);
+            if (operands.size() != 2) {
+                return;
+            }
+            if (operands[0].type != operands[1].type) {
+                problem(instruction, "operands of different types");
+            }
+            if (!ir_is_comparison(instruction.opcode)) {
+                expect_type(instruction, operands[0], instruction.type);
+            }
+            return;
+        }
+        problem(instruction, "unexpected opcode");
+    }
+
+    void verify_vector_types(const IRInstruction& instruction) {
+        auto& operands = instruction.operands;
+        int64_t lane_size = instruction.immediate;
+        if (lane_size != 1 && lane_size != 2 && lane_size != 4 && lane_size != 8) {
+            problem(instruction, "lanes of no integer type");
+            return;
+        }
+        // the vector the instruction works on
+        IRType vector = instruction.opcode == IROpcode::VectorStore || instruction.opcode == IROpcode::VectorReduceAdd
+                            ? (operands.empty() ? IRType::Void : operands[0].type)
+                            : instruction.type;
+        if (!ir_is_vector(vector)) {
+            problem(instruction, "expected a vector");
+            return;
+        }
+        switch (instruction.opcode) {
+            case IROpcode::VectorSplat:
+                expect_operands(instruction, 1);
+                if (operands.size() == 1) {
+                    expect_type(instruction, operands[0], ir_type_from_size(lane_size));
+                }
+                return;
+            case IROpcode::VectorLoad:
+                expect_operands(instruction, 1);
+                if (operands.size() == 1) {
+                    expect_type(instruction, operands[0], IRType::I64);
+                }
+                return;
+            case IROpcode::VectorStore:
+                expect_operands(instruction, 2);
+                if (operands.size() == 2) {
+                    expect_type(instruction, operands[1], IRType::I64);
+                }
+                return;
+            case IROpcode::VectorReduceAdd:
+                expect_operands(instruction, 1);
+                if (instruction.type != IRType::I64) {
+                    problem(instruction, "the sum of the lanes is i64");
+                }
+                return;
+            default:
+                expect_operands(instruction, 2);
+                for (auto& operand : operands) {
+                    expect_type(instruction, operand, instruction.type);
+                }
+                return;
+        }
+    }
+};
+
+}  // namespace
+
+std::vector<std::string> ir_verify(const IRFunction& function, const IRModule& module) {
+    return FunctionVerifier(function, module).verify();
+}
+
+std::vector<std::string> ir_verify(const IRModule& module) {
+    std::vector<std::string> problems;
+    std::set<std::string> names;
+    size_t entries = 0;
+    for (auto& function : module.functions) {
+        if (!names.insert(function.name).second) {
+            problems.push_back("function '" + function.name + "' is defined more than once");
+        }
+        entries += function.is_entry ? 1 : 0;
+        auto function_problems = ir_verify(function, module);
+        problems.insert(problems.end(), function_problems.begin(), function_problems.end());
+    }
+    if (entries > 1) {
+        problems.push_back("more than one entry function");
+    }
+    return problems;
+}
+
+void ir_assert_valid(const IRModule& module, const std::string& stage) {
+    auto problems = ir_verify(module);
+    if (problems.empty()) {
+        return;
+    }
+    std::stringstream message;
+    message << "invalid IR after " << stage << ":";
+    for (auto& problem : problems) {
+        message << std::endl << "    " << problem;
+    }
+    throw IRException(message.str());
+}
@@ -0,0 +1,284 @@
+#include "json.hpp"
+
+#include <cmath>
+#include <cstdio>
+
+namespace {
+
+class JsonParser {
+   public:
+    JsonParser(const std::string& text) : m_text(text), m_index(0) {}
+
+    JsonValue parse_document() {
+        JsonValue value = parse_value();
+        skip_whitespace();
+        if (m_index != m_text.size()) {
+            throw JsonException("Unexpected trailing characters", m_index);
+        }
+        return value;
+    }
+
+   private:
+    const std::string& m_text;
+    size_t m_index;
+
+    void skip_whitespace() {
+        while (m_index < m_text.size() && std::isspace((unsigned char)m_text[m_index])) {
+            ++m_index;
+        }
+    }
+
+    bool try_consume(char ch) {
+        skip_whitespace();
+        if (m_index < m_text.size() && m_text[m_index] == ch) {
+            ++m_index;
+            return true;
+        }
+        return false;
+    }
+
+    void assert_consume(char ch) {
+        if (!try_consume(ch)) {
+            throw JsonException(std::string("Expected '") + ch + "'", m_index);
+        }
+    }
+
+    bool try_consume_word(const std::string& word) {
+        if (m_text.compare(m_index, word.size(), word) != 0) {
+            return false;
+        }
+        m_index += word.size();
+        return true;
+    }
+
+    JsonValue parse_value() {
+        skip_whitespace();
+        if (m_index >= m_text.size()) {
+            throw JsonException("Unexpected end of input", m_index);
+        }
+        char current = m_text[m_index];
+        if (current == '{') return parse_object();
+        if (current == '[') return parse_array();
+        if (current == '"') return JsonValue(parse_string());
+        if (try_consume_word("true")) return JsonValue(true);
+        if (try_consume_word("false")) return JsonValue(false);
+        if (try_consume_word("null")) return JsonValue(nullptr);
+        return parse_number();
+    }
+
+    JsonValue parse_object() {
+        assert_consume('{');
+        JsonValue::Object members;
+        if (try_consume('}')) {
+            return JsonValue(std::move(members));
+        }
+        do {
+            skip_whitespace();
+            std::string key = parse_string();
+            assert_consume(':');
+            members[key] = parse_value();
+        } while (try_consume(','));
+        assert_consume('}');
+        return JsonValue(std::move(members));
+    }
+
+    JsonValue parse_array() {
+        assert_consume('[');
+        JsonValue::Array elements;
+        if (try_consume(']')) {
+            return JsonValue(std::move(elements));
+        }
+        do {
+            elements.push_back(parse_value());
+        } while (try_consume(','));
+        assert_consume(']');
+        return JsonValue(std::move(elements));
+    }
+
+    JsonValue parse_number() {
+        size_t start = m_index;
+        while (m_index < m_text.size() && (std::isdigit((unsigned char)m_text[m_index]) || m_text[m_index] == '-' ||
+                                           m_text[m_index] == '+' || m_text[m_index] == '.' ||
+                                           m_text[m_index] == 'e' || m_text[m_index] == 'E')) {
+            ++m_index;
+        }
+        if (start == m_index) {
+            throw JsonException(std::string("Unexpected character '") + m_text[m_index] + "'", m_index);
+        }
+        try {
+            return JsonValue(std::stod(m_text.substr(start, m_index - start)));
+        } catch (const std::exception&) {
+            throw JsonException("Invalid number", start);
+        }
+    }
+
+    void append_utf8(std::string& out, unsigned int code_point) {
+        if (code_point < 0x80) {
+            out += (char)code_point;
+        } else if (code_point < 0x800) {
+            out += (char)(0xC0 | (code_point >> 6));
+            out += (char)(0x80 | (code_point & 0x3F));
+        } else {
+            out += (char)(0xE0 | (code_point >> 12));
+            out += (char)(0x80 | ((code_point >> 6) & 0x3F));
+            out += (char)(0x80 | (code_point & 0x3F));
+        }
+    }
+
+    std::string parse_string() {
+        if (m_index >= m_text.size() || m_text[m_index] != '"') {
+            throw JsonException("Expected string", m_index);
+        }
+        ++m_index;
+        std::string out;
+        while (m_index < m_text.size() && m_text[m_index] != '"') {
+            char current = m_text[m_index++];
+            if (current != '\\') {
+                out += current;
+                continue;
+            }
+            if (m_index >= m_text.size()) {
+                break;
+            }
+            char escaped = m_text[m_index++];
+            switch (escaped) {
+                case 'n':
+                    out += '\n';
+                    break;
+                case 't':
+                    out += '\t';
+                    break;
+                case 'r':
+                    out += '\r';
+                    break;
+                case 'b':
+                    out += '\b';
+                    break;
+                case 'f':
+                    out += '\f';
+                    break;
+                case 'u': {
+                    if (m_index + 4 > m_text.size()) {
+                        throw JsonException("Invalid unicode escape", m_index);
+                    }
+                    append_utf8(out, std::stoul(m_text.substr(m_index, 4), nullptr, 16));
+                    m_index += 4;
+                    break;
+                }
+                default:
+                    // '"', '\\', '/'
+                    out += escaped;
+            }
+        }
+        if (m_index >= m_text.size()) {
+            throw JsonException("Unterminated string", m_index);
+        }
+        ++m_index;  // closing quote
+        return out;
+    }
+};
+
+void dump_string(const std::string& value, std::string& out) {
+    out += '"';
+    for (unsigned char ch : value) {
+        switch (ch) {
+            case '"':
+                out += "\\\"";
+                break;
+            case '\\':
+                out += "\\\\";
+                break;
+            case '\n':
+                out += "\\n";
+                break;
+            case '\t':
+                out += "\\t";
+                break;
+            case '\r':
+                out += "\\r";
+                break;
+            default:
+                if (ch < 0x20) {
+                    char escaped[8];
+                    snprintf(escaped, sizeof(escaped), "\\u%04x", ch);
+                    out += escaped;
+                } else {
+                    out += (char)ch;
+                }
+        }
+    }
+    out += '"';
+}
+
+}  // namespace
+
+const JsonValue* JsonValue::find(const std::string& key) const {
+    if (!is_object()) {
+        return nullptr;
+    }
+    auto& members = as_object();
+    auto member = members.find(key);
+    return member == members.end() ? nullptr : &member->second;
+}
+
+std::string JsonValue::get_string(const std::string& key, const std::string& fallback) const {
+    auto member = find(key);
+    return member && member->is_string() ? member->as_string() : fallback;
+}
+
+double JsonValue::get_number(const std::string& key, double fallback) const {
+    auto member = find(key);
+    return member && member->is_number() ? member->as_number() : fallback;
+}
+
+bool JsonValue::get_bool(const std::string& key, bool fallback) const {
+    auto member = find(key);
+    return member && member->is_bool() ? member->as_bool() : fallback;
+}
+
+std::string JsonValue::dump() const {
+    std::string out;
+    dump(out);
+    return out;
+}
+
+void JsonValue::dump(std::string& out) const {
+    if (is_null()) {
+        out += "null";
+    } else if (is_bool()) {
+        out += as_bool() ? "true" : "false";
+    } else if (is_number()) {
+        double number = as_number();
+        char buffer[32];
+        if (std::floor(number) == number && std::fabs(number) < 1e15) {
+            snprintf(buffer, sizeof(buffer), "%lld", (long long)number);
+        } else {
+            snprintf(buffer, sizeof(buffer), "%.17g", number);
+        }
+        out += buffer;
+    } else if (is_string()) {
+        dump_string(as_string(), out);
+    } else if (is_array()) {
+        out += '[';
+        bool first = true;
+        for (auto& element : as_array()) {
+            if (!first) out += ',';
+            first = false;
+            element.dump(out);
+        }
+        out += ']';
+    } else {
+        out += '{';
+        bool first = true;
+        for (auto& member : as_object()) {
+            if (!first) out += ',';
+            first = false;
+            dump_string(member.first, out);
+            out += ':';
+            member.second.dump(out);
+        }
+        out += '}';
+    }
+}
+
+JsonValue JsonValue::parse(const std::string& text) { return JsonParser(text).parse_document(); }
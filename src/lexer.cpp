@@ -4,16 +4,28 @@ bool number_verify(const std::string& num_str) {
     // Hexadecimal 0[xX][0-9a-fA-F]+
     // Binary 0[bB][01]+
     // Decimal \d+
-    std::regex pattern("^(0[xX][0-9A-Fa-f]+|0[bB][01]+|\\d+)$");
+    // compiled once per process- building a regex is far more expensive than matching it
+    static const std::regex pattern("^(0[xX][0-9A-Fa-f]+|0[bB][01]+|\\d+)$");
 
     return std::regex_match(num_str, pattern);
 }
 
-std::map<std::string, TokenType> tokenMappingsKeywords = {
+uint64_t parse_int_literal(const std::string& literal) {
+    if (literal.size() > 2 && literal[0] == '0' && (literal[1] == 'b' || literal[1] == 'B')) {
+        return std::stoull(literal.substr(2), nullptr, 2);
+    }
+    if (literal.size() > 2 && literal[0] == '0' && (literal[1] == 'x' || literal[1] == 'X')) {
+        return std::stoull(literal.substr(2), nullptr, 16);
+    }
+    return std::stoull(literal, nullptr, 10);
+}
+
+const std::map<std::string, TokenType> tokenMappingsKeywords = {
     {"exit", TokenType::exit},    {"if", TokenType::_if},         {"else", TokenType::_else},
     {"while", TokenType::_while}, {"func", TokenType::_function}, {"return", TokenType::_return},
+    {"inline", TokenType::_inline}, {"noinline", TokenType::_noinline},
 };
-std::map<char, TokenType> tokenMappingsSymbols = {
+const std::map<char, TokenType> tokenMappingsSymbols = {
     {';', TokenType::semicol},       {'(', TokenType::open_paren},     {')', TokenType::close_paren},
     {'{', TokenType::open_curly},    {'}', TokenType::close_curly},    {'=', TokenType::eq},
     {'+', TokenType::plus},          {'-', TokenType::minus},          {'*', TokenType::star},
@@ -60,7 +72,7 @@ bool Lexer::try_consume_char(char character) {
     TokenMeta meta = {.line_num = m_line, .line_pos = m_col};
     Token token = {
         .meta = meta,
-        .type = tokenMappingsSymbols[character],
+        .type = tokenMappingsSymbols.count(character) ? tokenMappingsSymbols.at(character) : TokenType::none,
         .value = std::nullopt,
     };
     this->tokens.push_back(token);
@@ -94,7 +106,7 @@ bool Lexer::try_consume_word() {
     bool keyword_exists = tokenMappingsKeywords.count(buffer) > 0;
 
     if (keyword_exists) {
-        type = tokenMappingsKeywords[buffer];
+        type = tokenMappingsKeywords.at(buffer);
         value = std::nullopt;
     } else {
         type = TokenType::identifier;
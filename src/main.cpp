@@ -1,21 +1,47 @@
 #include <string.h>
 
-#include "file_util.hpp"
-#include "generator.hpp"
-#include "globals.hpp"
-#include "lexer.hpp"
-#include "parser.hpp"
-#include "semantic_analyzer.hpp"
+#include <filesystem>
+#include <iomanip>
+#include <memory>
 
+#include "compile_cache.hpp"
+#include "compile_server.hpp"
+#include "dlvc.hpp"
+#include "file_util.hpp"
+#include "hash_util.hpp"
 
 #define IS_DEBUG_MODE true
 
-#if IS_DEBUG_MODE
-#include "debug_utils.hpp"
-#endif
+// code generation and optimization arguments, shared by compile and batch
+struct CodegenArguments {
+    dlvc::Backend backend = dlvc::Backend::AST;
+    int optimization_level = 0;
+    std::vector<std::string> passes;
+    std::vector<std::string> print_after;
+    bool pass_statistics = false;
+    bool keep_dead_functions = false;
+    int inline_threshold = -1;
+    int unroll_factor = -1;
+    bool avx2 = false;
+    std::vector<std::string> remarks;
+};
+
+struct CacheArguments {
+    bool enabled = getenv("DLVC_CACHE_DIR") != nullptr;
+    std::string directory = dlvc::CompileCache::default_directory();
+    size_t max_size_bytes = dlvc::CompileCache::DEFAULT_MAX_SIZE_BYTES;
+};
 
-void handle_compile(std::string path);
-void create_executable(std::string asm_code, std::string filename);
+int handle_compile(int argc, char** argv);
+void report_diagnostics(const dlvc::CompileResult& result);
+int handle_batch(int argc, char** argv);
+int handle_cache(int argc, char** argv);
+int handle_serve(int argc, char** argv);
+int handle_server_command(int argc, char** argv);
+bool parse_cache_argument(int argc, char** argv, int& i, CacheArguments& arguments);
+bool parse_codegen_argument(const char* argument, CodegenArguments& arguments);
+void apply_codegen_arguments(const CodegenArguments& arguments, dlvc::CompileOptions& options);
+std::unique_ptr<dlvc::CompileCache> open_cache(const CacheArguments& arguments);
 
 int main(int argc, char** argv) {
     if (argc < 3) {
@@ -27,60 +53,463 @@ int main(int argc, char** argv) {
     char* command = argv[1];
 
     if (strcmp(command, "compile") == 0) {
-        std::string path = argv[2];
-        Globals::getInstance().setCurrentFilePath(path);
-        handle_compile(path);
-        exit(EXIT_SUCCESS);
+        exit(handle_compile(argc, argv));
+    }
+    if (strcmp(command, "batch") == 0) {
+        exit(handle_batch(argc, argv));
+    }
+    if (strcmp(command, "cache") == 0) {
+        exit(handle_cache(argc, argv));
+    }
+    if (strcmp(command, "serve") == 0) {
+        exit(handle_serve(argc, argv));
+    }
+    if (strcmp(command, "server") == 0) {
+        exit(handle_server_command(argc, argv));
     }
     return EXIT_FAILURE;
 }
 
-void handle_compile(std::string path) {
+// compiler compile <file.dlv> [--cache] [--cache-dir <dir>] [--cache-size <MB>] [--incremental] [--server <socket>]
+//                   [--backend=<ast|ir>] [-O0 | -O1 | -O2] [--passes=<pass,...>] [--print-after=<pass>]
+//                   [--inline-threshold=<n>] [--unroll-factor=<n>] [-mavx2] [--remarks=<pass,...>] [--pass-stats]
+//                   [--keep-dead-functions] [--emit=ir]
+// --incremental keeps per-function records of the file in the cache directory, and recompiles only the
+// functions that changed
+// --server sends the compilation, with its code generation arguments, to a running 'compiler serve', whose cache
+// settings apply instead
+// --backend=ir generates the code through the SSA IR, --emit=ir prints the IR instead of building an executable.
+// -O1/-O2 run the optimization pipelines over the IR, --passes runs the given passes instead
+// --print-after prints the IR after the pass(repeatable, 'all' for every pass), --pass-stats prints the time and
+// changes of every pass. --remarks=inline reports every inlining decision. --unroll-factor sets how many iterations
+// an unrolled loop runs per trip, 0 or 1 disables unrolling. -mavx2 vectorizes loops with AVX2 instead of SSE2.
+// functions never called from the top-level statements are neither analyzed nor generated, unless
+// --keep-dead-functions is given
+int handle_compile(int argc, char** argv) {
+    std::string path = argv[2];
+    CacheArguments cache_arguments;
+    CodegenArguments codegen_arguments;
+    bool incremental = false;
+    std::string server_socket;
+    bool emit_ir = false;
+    for (int i = 3; i < argc; ++i) {
+        if (parse_cache_argument(argc, argv, i, cache_arguments)) {
+            continue;
+        }
+        if (parse_codegen_argument(argv[i], codegen_arguments)) {
+            continue;
+        }
+        if (strcmp(argv[i], "--emit=ir") == 0) {
+            emit_ir = true;
+            continue;
+        }
+        if (strcmp(argv[i], "--incremental") == 0) {
+            incremental = true;
+            continue;
+        }
+        if (strcmp(argv[i], "--server") == 0 && i + 1 < argc) {
+            server_socket = argv[++i];
+            continue;
+        }
+        std::cerr << "Unknown compile argument '" << argv[i] << "'" << std::endl;
+        return EXIT_FAILURE;
+    }
+    dlvc::CompileOptions options;
+    options.file_path = path;
+    apply_codegen_arguments(codegen_arguments, options);
+    if (emit_ir) {
+        options.backend = dlvc::Backend::IR;
+        options.dump_ir = true;
+    }
+    if (!server_socket.empty()) {
+        dlvc::CompileResult result = dlvc::compile_on_server(dlvc::ClientRequest{
+            .socket_path = server_socket,
+            .file_path = path,
+            .output_path = "output",
+            .asm_path = "out.asm",
+            .incremental = incremental,
+            .emit_ir = emit_ir,
+            .pass_statistics = codegen_arguments.pass_statistics,
+            .options = options,
+        });
+        report_diagnostics(result);
+        std::cout << result.ir_dump << result.remarks;
+        if (codegen_arguments.pass_statistics) {
+            std::cout << result.pass_report;
+            if (!emit_ir) {
+                std::cout << "dead functions eliminated: " << result.eliminated_functions << std::endl;
+            }
+        }
+        return result.success ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
     std::string file_contents = read_file(path);
-
-    Lexer lexer = Lexer(file_contents);
-    std::vector<Token> tokens;
-    try {
-        tokens = lexer.tokenize();
-    } catch (const LexerException& e) {
-        std::cerr << e.what() << std::endl;
-        exit(EXIT_FAILURE);
+    auto cache = open_cache(cache_arguments);
+    options.dump_ast = IS_DEBUG_MODE;
+    options.cache = cache.get();
+    if (emit_ir || codegen_arguments.pass_statistics || !options.print_after.empty() || !options.remarks.empty()) {
+        // the IR, the pass statistics and the remarks are only produced by an actual compilation
+        options.cache = nullptr;
     }
-
-    Parser parser = Parser(tokens);
-    ASTProgram program;
-    try {
-        program = parser.parse_program();
-    } catch (const ParserException& e) {
-        std::cerr << e.what() << std::endl;
-        exit(EXIT_FAILURE);
+    if (emit_ir) {
+        dlvc::CompileResult result = dlvc::compile_to_asm(file_contents, options);
+        report_diagnostics(result);
+        std::cout << result.ir_dump << result.remarks;
+        if (codegen_arguments.pass_statistics) {
+            std::cout << result.pass_report;
+        }
+        return result.success ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+    if (incremental) {
+        ContentHash source_path_hash;
+        source_path_hash.update(std::filesystem::absolute(path).string());
+        options.incremental_state_path = (std::filesystem::path(cache_arguments.directory) / "incremental" /
+                                          (source_path_hash.hex_digest() + ".json"))
+                                             .string();
     }
 
-    SemanticAnalyzer analyzer = SemanticAnalyzer(program);
-    try {
-        analyzer.analyze();
-    } catch (const SemanticAnalyzerException& e) {
-        std::cerr << e.what() << std::endl;
-        exit(EXIT_FAILURE);
+    dlvc::CompileResult result = dlvc::compile_to_executable(file_contents, "output", options);
+    report_diagnostics(result);
+    std::cout << result.ir_dump << result.remarks;
+    if (codegen_arguments.pass_statistics) {
+        std::cout << result.pass_report;
+        std::cout << "dead functions eliminated: " << result.eliminated_functions << std::endl;
+    }
+    if (incremental && result.total_functions > 0) {
+        std::cout << "incremental: reused " << result.reused_functions << " of " << result.total_functions
+                  << " functions" << std::endl;
+    }
+    if (!result.asm_code.empty()) {
+        write_file("out.asm", result.asm_code);
+    }
+    if (!result.success) {
+        return EXIT_FAILURE;
     }
 
 #if IS_DEBUG_MODE
-    std::cout << debug_utils::visualize_ast(std::make_shared<ASTProgram>(program)) << std::endl;
+    if (!result.ast_dump.empty()) {
+        std::cout << result.ast_dump << std::endl;
+    }
 #endif
+    return EXIT_SUCCESS;
+}
+
+void report_diagnostics(const dlvc::CompileResult& result) {
+    for (auto& diagnostic : result.diagnostics) {
+        auto& stream = diagnostic.severity == dlvc::DiagnosticSeverity::Error ? std::cerr : std::cout;
+        stream << diagnostic.formatted << std::endl;
+    }
+}
+
+// compiler batch <manifest.json | -> [--summary <summary.json>] [--cache] [--cache-dir <dir>] [--cache-size <MB>]
+//                 [--backend=<ast|ir>] [-O0 | -O1 | -O2] [--passes=<pass,...>] [--inline-threshold=<n>]
+//                 [--keep-dead-functions]
+// '-' reads the jobs from stdin, one "<source> [output]" per line
+int handle_batch(int argc, char** argv) {
+    std::string manifest_path = argv[2];
+    std::string summary_path;
+    CacheArguments cache_arguments;
+    CodegenArguments codegen_arguments;
+    for (int i = 3; i < argc; ++i) {
+        if (parse_codegen_argument(argv[i], codegen_arguments)) {
+            continue;
+        }
+        if (strcmp(argv[i], "--summary") == 0 && i + 1 < argc) {
+            summary_path = argv[++i];
+            continue;
+        }
+        if (parse_cache_argument(argc, argv, i, cache_arguments)) {
+            continue;
+        }
+        std::cerr << "Unknown batch argument '" << argv[i] << "'" << std::endl;
+        return EXIT_FAILURE;
+    }
 
-    Generator generator(program);
-    std::string res = generator.generate_program();
+    std::vector<dlvc::BatchJob> jobs;
+    if (manifest_path == "-") {
+        std::stringstream list;
+        list << std::cin.rdbuf();
+        jobs = dlvc::parse_batch_list(list.str());
+    } else {
+        std::string manifest = read_file(manifest_path);
+        std::string base_dir = std::filesystem::path(manifest_path).parent_path().string();
+        std::string error;
+        if (!dlvc::parse_batch_manifest(manifest, base_dir, jobs, error)) {
+            std::cerr << manifest_path << ": " << error << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    auto cache = open_cache(cache_arguments);
+    dlvc::CacheStatistics cache_before = cache ? cache->get_statistics() : dlvc::CacheStatistics();
+    dlvc::CompileOptions options;
+    options.cache = cache.get();
+    apply_codegen_arguments(codegen_arguments, options);
+    auto results = dlvc::compile_batch(jobs, options);
 
-    create_executable(res, "output");
+    size_t failed = 0;
+    double total_ms = 0;
+    for (auto& job_result : results) {
+        report_diagnostics(job_result.result);
+        failed += job_result.result.success ? 0 : 1;
+        total_ms += job_result.elapsed_ms;
+    }
+    for (auto& job_result : results) {
+        std::cout << (job_result.result.success ? "ok      " : "FAILED  ") << job_result.job.source_path;
+        if (job_result.result.success) {
+            std::cout << " -> " << job_result.job.output_path;
+        }
+        std::cout << " (" << std::fixed << std::setprecision(2) << job_result.elapsed_ms << " ms)" << std::endl;
+    }
+    std::cout << "batch: " << results.size() - failed << " succeeded, " << failed << " failed, " << std::fixed
+              << std::setprecision(2) << total_ms << " ms total" << std::endl;
+    if (cache) {
+        dlvc::CacheStatistics cache_after = cache->get_statistics();
+        std::cout << "cache: " << cache_after.hits - cache_before.hits << " hits, "
+                  << cache_after.misses - cache_before.misses << " misses, "
+                  << cache_after.evictions - cache_before.evictions << " evictions" << std::endl;
+    }
+
+    if (!summary_path.empty() && !write_file(summary_path, dlvc::to_json(results).dump())) {
+        std::cerr << "Could not write batch summary to '" << summary_path << "'" << std::endl;
+        return EXIT_FAILURE;
+    }
+    return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
 }
 
-void create_executable(std::string asm_code, std::string filename) {
-    write_file("out.asm", asm_code);
-    system("nasm -f elf64 -g out.asm");
+// compiler cache <stats | clear> [--cache-dir <dir>]
+int handle_cache(int argc, char** argv) {
+    std::string action = argv[2];
+    CacheArguments cache_arguments;
+    for (int i = 3; i < argc; ++i) {
+        if (parse_cache_argument(argc, argv, i, cache_arguments)) {
+            continue;
+        }
+        std::cerr << "Unknown cache argument '" << argv[i] << "'" << std::endl;
+        return EXIT_FAILURE;
+    }
+    dlvc::CompileCache cache(cache_arguments.directory, cache_arguments.max_size_bytes);
 
-    std::string command = "gcc -no-pie -g -o " + filename + " out.o -e main";
-    std::cout << command << std::endl;
-    system(command.c_str());
+    if (action == "stats") {
+        auto statistics = cache.get_statistics();
+        size_t lookups = statistics.hits + statistics.misses;
+        std::cout << "directory: " << cache.get_directory() << std::endl;
+        std::cout << "entries:   " << statistics.entries << std::endl;
+        std::cout << "size:      " << std::fixed << std::setprecision(2)
+                  << statistics.size_bytes / (1024.0 * 1024.0) << " MB" << std::endl;
+        std::cout << "hits:      " << statistics.hits << std::endl;
+        std::cout << "misses:    " << statistics.misses << std::endl;
+        std::cout << "hit rate:  " << std::fixed << std::setprecision(1)
+                  << (lookups ? 100.0 * statistics.hits / lookups : 0.0) << "%" << std::endl;
+        std::cout << "evictions: " << statistics.evictions << std::endl;
+        return EXIT_SUCCESS;
+    }
+    if (action == "clear") {
+        cache.clear();
+        return EXIT_SUCCESS;
+    }
+    std::cerr << "Unknown cache action '" << action << "'" << std::endl;
+    return EXIT_FAILURE;
+}
+
+const char* const SERVE_USAGE =
+    "Usage: compiler serve --socket <path> [--threads <N>] [--cache-dir <dir>] [--cache-size <MB>] [--no-cache]";
+
+// compiler serve --socket <path> [--threads <N>] [--cache-dir <dir>] [--cache-size <MB>] [--no-cache]
+// the compile cache is on by default- keeping it warm is the point of the server. --threads 0 is a thread per core
+int handle_serve(int argc, char** argv) {
+    dlvc::ServerOptions options;
+    CacheArguments cache_arguments;
+    cache_arguments.enabled = true;
+    for (int i = 2; i < argc; ++i) {
+        if (strcmp(argv[i], "--socket") == 0 && i + 1 < argc) {
+            options.socket_path = argv[++i];
+            continue;
+        }
+        if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            const char* count = argv[++i];
+            size_t parsed = 0;
+            try {
+                // std::stoul alone would take "-1" and "4x"
+                options.thread_count = std::stoul(count, &parsed);
+            } catch (const std::exception&) {
+                parsed = 0;
+            }
+            if (parsed == 0 || count[parsed] != '\0' || count[0] == '-') {
+                std::cerr << "Invalid thread count '" << count << "'" << std::endl;
+                std::cerr << SERVE_USAGE << std::endl;
+                return EXIT_FAILURE;
+            }
+            continue;
+        }
+        if (strcmp(argv[i], "--no-cache") == 0) {
+            cache_arguments.enabled = false;
+            continue;
+        }
+        if (parse_cache_argument(argc, argv, i, cache_arguments)) {
+            continue;
+        }
+        std::cerr << "Unknown serve argument '" << argv[i] << "'" << std::endl;
+        return EXIT_FAILURE;
+    }
+    if (options.socket_path.empty()) {
+        std::cerr << SERVE_USAGE << std::endl;
+        return EXIT_FAILURE;
+    }
+    if (cache_arguments.enabled) {
+        options.cache_directory = cache_arguments.directory;
+    }
+    options.cache_size_bytes = cache_arguments.max_size_bytes;
+    options.on_status = [](const std::string& status) { std::cout << status << std::endl; };
+    std::string error;
+    int status = dlvc::serve(options, error);
+    if (status != EXIT_SUCCESS) {
+        std::cerr << error << std::endl;
+    }
+    return status;
+}
+
+// compiler server <stats | shutdown> --socket <path>
+int handle_server_command(int argc, char** argv) {
+    std::string action = argv[2];
+    std::string socket_path;
+    for (int i = 3; i < argc; ++i) {
+        if (strcmp(argv[i], "--socket") == 0 && i + 1 < argc) {
+            socket_path = argv[++i];
+            continue;
+        }
+        std::cerr << "Unknown server argument '" << argv[i] << "'" << std::endl;
+        return EXIT_FAILURE;
+    }
+    if (action != "stats" && action != "shutdown") {
+        std::cerr << "Unknown server action '" << action << "'" << std::endl;
+        return EXIT_FAILURE;
+    }
+    JsonValue response;
+    std::string error;
+    if (!dlvc::send_server_command(socket_path, action, response, error)) {
+        std::cerr << error << std::endl;
+        return EXIT_FAILURE;
+    }
+    if (action == "stats") {
+        std::cout << "requests:  " << response.get_number("requests") << std::endl;
+        std::cout << "cancelled: " << response.get_number("cancelled") << std::endl;
+        std::cout << "threads:   " << response.get_number("threads") << std::endl;
+        std::cout << "hits:      " << response.get_number("cache_hits") << std::endl;
+        std::cout << "misses:    " << response.get_number("cache_misses") << std::endl;
+        std::cout << "entries:   " << response.get_number("cache_entries") << std::endl;
+    }
+    return EXIT_SUCCESS;
+}
+
+// consumes the argument if it's one of the code generation arguments. an unknown backend or optimization level is
+// reported, and left for the caller to reject as an unknown argument
+bool parse_codegen_argument(const char* argument, CodegenArguments& arguments) {
+    auto value_of = [argument](const char* prefix) -> const char* {
+        return strncmp(argument, prefix, strlen(prefix)) == 0 ? argument + strlen(prefix) : nullptr;
+    };
+    if (const char* backend = value_of("--backend=")) {
+        if (!dlvc::parse_backend(backend, arguments.backend)) {
+            std::cerr << "Unknown backend '" << backend << "'" << std::endl;
+            return false;
+        }
+        return true;
+    }
+    if (strcmp(argument, "-O0") == 0 || strcmp(argument, "-O1") == 0 || strcmp(argument, "-O2") == 0) {
+        arguments.optimization_level = argument[2] - '0';
+        return true;
+    }
+    if (const char* passes = value_of("--passes=")) {
+        std::stringstream pass_list(passes);
+        std::string pass;
+        while (std::getline(pass_list, pass, ',')) {
+            if (!pass.empty()) {
+                arguments.passes.push_back(pass);
+            }
+        }
+        return true;
+    }
+    if (const char* pass = value_of("--print-after=")) {
+        arguments.print_after.push_back(pass);
+        return true;
+    }
+    if (strcmp(argument, "--pass-stats") == 0) {
+        arguments.pass_statistics = true;
+        return true;
+    }
+    if (const char* threshold = value_of("--inline-threshold=")) {
+        try {
+            arguments.inline_threshold = std::stoi(threshold);
+        } catch (const std::exception&) {
+            std::cerr << "Invalid inline threshold '" << threshold << "'" << std::endl;
+            return false;
+        }
+        return arguments.inline_threshold >= 0;
+    }
+    if (const char* factor = value_of("--unroll-factor=")) {
+        try {
+            arguments.unroll_factor = std::stoi(factor);
+        } catch (const std::exception&) {
+            std::cerr << "Invalid unroll factor '" << factor << "'" << std::endl;
+            return false;
+        }
+        return arguments.unroll_factor >= 0;
+    }
+    if (strcmp(argument, "-mavx2") == 0) {
+        arguments.avx2 = true;
+        return true;
+    }
+    if (const char* remarks = value_of("--remarks=")) {
+        std::stringstream pass_list(remarks);
+        std::string pass;
+        while (std::getline(pass_list, pass, ',')) {
+            if (!pass.empty()) {
+                arguments.remarks.push_back(pass);
+            }
+        }
+        return true;
+    }
+    if (strcmp(argument, "--keep-dead-functions") == 0) {
+        arguments.keep_dead_functions = true;
+        return true;
+    }
+    return false;
+}
+
+void apply_codegen_arguments(const CodegenArguments& arguments, dlvc::CompileOptions& options) {
+    options.backend = arguments.backend;
+    options.optimization_level = arguments.optimization_level;
+    options.passes = arguments.passes;
+    options.print_after = arguments.print_after;
+    options.eliminate_dead_functions = !arguments.keep_dead_functions;
+    options.inline_threshold = arguments.inline_threshold;
+    options.unroll_factor = arguments.unroll_factor;
+    options.avx2 = arguments.avx2;
+    options.remarks = arguments.remarks;
+}
 
-    system("rm out.o");
+// consumes argv[i] (and its value) if it's one of the cache arguments
+bool parse_cache_argument(int argc, char** argv, int& i, CacheArguments& arguments) {
+    if (strcmp(argv[i], "--cache") == 0) {
+        arguments.enabled = true;
+        return true;
+    }
+    if (strcmp(argv[i], "--cache-dir") == 0 && i + 1 < argc) {
+        arguments.enabled = true;
+        arguments.directory = argv[++i];
+        return true;
+    }
+    if (strcmp(argv[i], "--cache-size") == 0 && i + 1 < argc) {
+        arguments.enabled = true;
+        arguments.max_size_bytes = std::stoull(argv[++i]) * 1024 * 1024;
+        return true;
+    }
+    return false;
+}
+
+// nullptr when caching wasn't requested
+std::unique_ptr<dlvc::CompileCache> open_cache(const CacheArguments& arguments) {
+    if (!arguments.enabled) {
+        return nullptr;
+    }
+    return std::make_unique<dlvc::CompileCache>(arguments.directory, arguments.max_size_bytes);
 }
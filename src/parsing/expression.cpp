@@ -1,6 +1,6 @@
 #include "parser.hpp"
 
-std::map<TokenType, BinOperation> singleCharBinOperationMapping = {
+const std::map<TokenType, BinOperation> singleCharBinOperationMapping = {
     {TokenType::plus, BinOperation::add},       {TokenType::minus, BinOperation::subtract},
     {TokenType::star, BinOperation::multiply},  {TokenType::fslash, BinOperation::divide},
     {TokenType::percent, BinOperation::modulo},
@@ -1,6 +1,18 @@
 #include "parser.hpp"
 
 std::shared_ptr<ASTStatementFunction> Parser::parse_statement_function() {
+    size_t token_begin = m_token_index;
+    InlineHint inline_hint = InlineHint::NONE;
+    if (test_peek(TokenType::_inline) || test_peek(TokenType::_noinline)) {
+        inline_hint = consume().value().type == TokenType::_inline ? InlineHint::always : InlineHint::never;
+        if (!test_peek(TokenType::_function)) {
+            auto nextToken = peek();
+            if (nextToken.has_value()) {
+                throw ParserException("Expected 'func' after inlining annotation", nextToken.value().meta);
+            }
+            throw ParserException("Expected 'func' after inlining annotation");
+        }
+    }
     if (!test_peek(TokenType::_function)) {
         return nullptr;
     }
@@ -24,6 +36,9 @@ std::shared_ptr<ASTStatementFunction> Parser::parse_statement_function() {
         .statement = statement,
         .return_data_type_tokens = data_type_tokens,
         .return_data_type = nullptr,
+        .inline_hint = inline_hint,
+        .token_begin = token_begin,
+        .token_end = m_token_index,
     });
 }
 
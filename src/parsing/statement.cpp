@@ -98,8 +98,12 @@ std::shared_ptr<ASTStatementExit> Parser::parse_statement_exit() {
 std::shared_ptr<ASTStatementVar> Parser::parse_statement_var_declare() {
     // [d_type] [pointer/array modifiers] [identifier];
     // [d_type] [pointer/array modifiers] [identifier] = [expression];
-    if (!(test_peek(TokenType::identifier) && (test_peek(TokenType::star, 1) || test_peek(TokenType::open_square, 1) ||
-                                               test_peek(TokenType::identifier, 1)))) {
+    // an array type's brackets hold nothing or the size- 'arr[i] = ...' is an assignment
+    bool array_type = test_peek(TokenType::open_square, 1) &&
+                      (test_peek(TokenType::close_square, 2) ||
+                       (test_peek(TokenType::int_lit, 2) && test_peek(TokenType::close_square, 3)));
+    if (!(test_peek(TokenType::identifier) &&
+          (test_peek(TokenType::star, 1) || array_type || test_peek(TokenType::identifier, 1)))) {
         return nullptr;
     }
     auto meta = peek().value().meta;
@@ -265,7 +269,7 @@ ASTProgram Parser::parse_program() {
             continue;
         }
         auto statement = parse_statement();
-        if (type == TokenType::_function) {
+        if (type == TokenType::_function || type == TokenType::_inline || type == TokenType::_noinline) {
             // NOTE: could probably figure out a better way to know the statement is a function statement
             auto& func_statement = statement->statement;
             result.functions.push_back(std::get<std::shared_ptr<ASTStatementFunction>>(func_statement));
@@ -39,6 +39,7 @@ SemanticAnalyzer::ExpressionAnalysisResult SemanticAnalyzer::analyze_expression_
             error << "LHS variable does not exist in current scope- " << name;
             throw SemanticAnalyzerException(error.str(), expression.start_token_meta);
         }
+        record_global_use(name);
         variableData->is_initialized = is_initializing;
         return analyze_expression(expression);
     }
@@ -53,6 +54,7 @@ SemanticAnalyzer::ExpressionAnalysisResult SemanticAnalyzer::analyze_expression_
         errorMessage << "Unknown Identifier '" << identifier.value << "'";
         throw SemanticAnalyzerException(errorMessage.str(), identifier.start_token_meta);
     }
+    record_global_use(identifier.value);
     auto is_array = (bool)(dynamic_cast<ArrayType*>(literal_data->data_type.get()));
     if (!literal_data->is_initialized && !is_array) {
         std::stringstream errorMessage;
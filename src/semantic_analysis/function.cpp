@@ -32,6 +32,17 @@ void SemanticAnalyzer::analyze_function_header(ASTStatementFunction& func) {
 }
 
 void SemanticAnalyzer::analyze_function_body(ASTStatementFunction& func) {
+    if (m_fingerprints && m_fingerprints->count(func.name)) {
+        // record what the analysis depends on
+        m_current_record = &m_function_records[func.name];
+        *m_current_record = FunctionCache::FunctionRecord();
+        m_current_record->fingerprint = m_fingerprints->at(func.name);
+        m_current_function_line = func.start_token_meta.line_num;
+        m_globals_initialized_before.clear();
+        for (auto& [name, variable] : m_symbol_table.global_scope()) {
+            m_globals_initialized_before[name] = variable.is_initialized;
+        }
+    }
     m_symbol_table.enterScope();
     m_current_function_name = func.name;
     for (auto& function_param : func.parameters) {
@@ -50,6 +61,12 @@ void SemanticAnalyzer::analyze_function_body(ASTStatementFunction& func) {
     analyze_statement(*func.statement);
     m_current_function_name = "";
     m_symbol_table.exitScope();
+    if (m_current_record) {
+        for (auto& [name, use] : m_current_record->globals) {
+            use.initialized_after = m_symbol_table.global_scope().at(name).is_initialized;
+        }
+        m_current_record = nullptr;
+    }
     auto& function_header = m_function_table.at(func.name);
     // TODO: should handle all execution paths
     if (!function_header.found_return_statement && !function_header.data_type->is_void()) {
@@ -57,6 +74,62 @@ void SemanticAnalyzer::analyze_function_body(ASTStatementFunction& func) {
     }
 }
 
+bool SemanticAnalyzer::can_reuse_function(const ASTStatementFunction& func) {
+    if (!m_previous_records || !m_fingerprints) {
+        return false;
+    }
+    auto previous = m_previous_records->find(func.name);
+    auto fingerprint = m_fingerprints->find(func.name);
+    if (previous == m_previous_records->end() || fingerprint == m_fingerprints->end() ||
+        previous->second.fingerprint != fingerprint->second) {
+        return false;
+    }
+    auto& record = previous->second;
+    for (auto& [callee, signature] : record.callees) {
+        auto callee_fingerprint = m_fingerprints->find(callee);
+        if (callee_fingerprint == m_fingerprints->end() || callee_fingerprint->second.signature != signature) {
+            return false;
+        }
+    }
+    auto& globals = m_symbol_table.global_scope();
+    for (auto& [name, use] : record.globals) {
+        auto global = globals.find(name);
+        if (global == globals.end() || global->second.data_type->toString() != use.data_type ||
+            global->second.is_initialized != use.initialized_before) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void SemanticAnalyzer::reuse_function(const ASTStatementFunction& func) {
+    auto& record = m_previous_records->at(func.name);
+    for (auto& [name, use] : record.globals) {
+        m_symbol_table.global_scope().at(name).is_initialized = use.initialized_after;
+    }
+    for (auto& warning : record.warnings) {
+        m_warnings.push_back(SemanticWarning{
+            .message = warning.message,
+            .position = TokenMeta{.line_num = func.start_token_meta.line_num + warning.line_offset,
+                                  .line_pos = warning.col},
+        });
+    }
+    m_function_records[func.name] = record;
+    m_reused_functions.insert(func.name);
+}
+
+void SemanticAnalyzer::record_global_use(const std::string& name) {
+    if (!m_current_record || m_current_record->globals.count(name) || !m_symbol_table.is_variable_global(name)) {
+        return;
+    }
+    auto& global = m_symbol_table.global_scope().at(name);
+    m_current_record->globals[name] = FunctionCache::GlobalUse{
+        .data_type = global.data_type->toString(),
+        .initialized_before = m_globals_initialized_before[name],
+        .initialized_after = global.is_initialized,
+    };
+}
+
 void SemanticAnalyzer::analyze_statement_return(const std::shared_ptr<ASTStatementReturn>& return_statement) {
     if (m_current_function_name.empty()) {
         throw SemanticAnalyzerException("Can't use 'return' outside of a function", return_statement->start_token_meta);
@@ -93,6 +166,9 @@ SemanticAnalyzer::ExpressionAnalysisResult SemanticAnalyzer::analyze_function_ca
         throw SemanticAnalyzerException(error.str(), start_token_meta);
     }
     auto& function_header_data = m_function_table.at(function_call_expr.function_name);
+    if (m_current_record && m_fingerprints->count(func_name)) {
+        m_current_record->callees[func_name] = m_fingerprints->at(func_name).signature;
+    }
     auto& function_expected_params = function_header_data.parameters;
     std::vector<ASTExpression>& provided_params = function_call_expr.parameters;
     if (provided_params.size() != function_expected_params.size()) {
@@ -1,9 +1,20 @@
 #include "semantic_analyzer.hpp"
 
 void SemanticAnalyzer::semantic_warning(const std::string& message, const TokenMeta& position) {
-    std::cout << "SEMANTIC WARNING AT "
-              << Globals::getInstance().getCurrentFilePosition(position.line_num, position.line_pos) << ": " << message
-              << std::endl;
+    m_warnings.push_back(SemanticWarning{.message = message, .position = position});
+    if (m_current_record) {
+        m_current_record->warnings.push_back(FunctionCache::RecordedWarning{
+            .message = message,
+            .line_offset = position.line_num - m_current_function_line,
+            .col = position.line_pos,
+        });
+    }
+}
+
+void SemanticAnalyzer::set_function_cache(const FunctionCache::FunctionRecords* previous_records,
+                                          const FunctionCache::Fingerprints* fingerprints) {
+    m_previous_records = previous_records;
+    m_fingerprints = fingerprints;
 }
 
 void SemanticAnalyzer::assert_cast_expression(ASTExpression& expression, std::shared_ptr<DataType> data_type,
@@ -98,6 +109,13 @@ void SemanticAnalyzer::analyze() {
     }
     // second passage through functions- function body
     for (auto& function : functions) {
+        if (m_live_functions && !m_live_functions->count(function->name)) {
+            continue;
+        }
+        if (can_reuse_function(*function)) {
+            reuse_function(*function);
+            continue;
+        }
         analyze_function_body(*function);
     }
     this->m_symbol_table.exitScope();
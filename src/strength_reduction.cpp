@@ -0,0 +1,163 @@
+#include "strength_reduction.hpp"
+
+#include <sstream>
+
+namespace {
+
+bool is_power_of_two(uint64_t value) { return value != 0 && (value & (value - 1)) == 0; }
+
+int log2_floor(uint64_t value) { return 63 - __builtin_clzll(value); }
+
+// immediates of 64 bit instructions are sign-extended 32 bit numbers
+bool fits_immediate(uint64_t value) { return value <= INT32_MAX; }
+
+// the lea multipliers- rax + rax * 2/4/8
+bool is_lea_factor(uint64_t value) { return value == 3 || value == 5 || value == 9; }
+
+void lea_multiply(std::stringstream& out, uint64_t factor) {
+    out << "\tlea rax, [rax+rax*" << factor - 1 << "]" << std::endl;
+}
+
+// rax = rax * constant, modulo 2^64
+void multiply_by(std::stringstream& out, uint64_t constant) {
+    if (fits_immediate(constant)) {
+        out << "\timul rax, rax, " << constant << std::endl;
+    } else {
+        out << "\tmov rcx, " << constant << std::endl << "\timul rax, rcx" << std::endl;
+    }
+}
+
+// rax = rax / divisor, for a divisor that isn't a power of two, below 2^63. 'keep_dividend' leaves it in r11
+void divide_by_magic(std::stringstream& out, uint64_t divisor, bool keep_dividend) {
+    int ceil_log2 = log2_floor(divisor) + 1;
+    // the smallest shift whose magic number fits 64 bits and is exact for every dividend- m = ceil(2^(64+s) / d),
+    // with m * d - 2^(64+s) <= 2^s
+    for (int shift = 0; shift < ceil_log2; ++shift) {
+        unsigned __int128 power = (unsigned __int128)1 << (64 + shift);
+        unsigned __int128 magic = (power + divisor - 1) / divisor;
+        if (magic >> 64 == 0 && magic * divisor - power <= ((unsigned __int128)1 << shift)) {
+            if (keep_dividend) {
+                out << "\tmov r11, rax" << std::endl;
+            }
+            out << "\tmov rcx, " << (uint64_t)magic << std::endl << "\tmul rcx" << std::endl;
+            if (shift > 0) {
+                out << "\tshr rdx, " << shift << std::endl;
+            }
+            out << "\tmov rax, rdx" << std::endl;
+            return;
+        }
+    }
+    // the magic number takes 65 bits- the low 64 of it multiply, and the dividend adds the 65th bit back in halves
+    // so the sum can't overflow: q = (t + ((n - t) >> 1)) >> (l - 1), t = high(n * m)
+    unsigned __int128 power = (unsigned __int128)1 << (64 + ceil_log2);
+    uint64_t magic = (uint64_t)((power + divisor - 1) / divisor);
+    out << "\tmov r11, rax" << std::endl
+        << "\tmov rcx, " << magic << std::endl
+        << "\tmul rcx" << std::endl
+        << "\tmov rax, r11" << std::endl
+        << "\tsub rax, rdx" << std::endl
+        << "\tshr rax, 1" << std::endl
+        << "\tadd rax, rdx" << std::endl
+        << "\tshr rax, " << ceil_log2 - 1 << std::endl;
+}
+
+}  // namespace
+
+std::string reduce_multiply(uint64_t constant) {
+    std::stringstream out;
+    if (constant == 0) {
+        out << "\txor eax, eax" << std::endl;
+        return out.str();
+    }
+    if (constant == 1) {
+        return "";
+    }
+    int trailing_zeros = __builtin_ctzll(constant);
+    uint64_t odd = constant >> trailing_zeros;
+    if (odd == 1) {
+        out << "\tshl rax, " << trailing_zeros << std::endl;
+        return out.str();
+    }
+    // 3, 5, 9 and their products- up to two lea- times a power of two
+    for (uint64_t first : {3, 5, 9}) {
+        if (odd % first != 0 || (odd / first != 1 && !is_lea_factor(odd / first))) {
+            continue;
+        }
+        lea_multiply(out, first);
+        if (odd / first != 1) {
+            lea_multiply(out, odd / first);
+        }
+        if (trailing_zeros > 0) {
+            out << "\tshl rax, " << trailing_zeros << std::endl;
+        }
+        return out.str();
+    }
+    // 2^k - 1 and 2^k + 1
+    if (is_power_of_two(constant + 1) || is_power_of_two(constant - 1)) {
+        bool below = is_power_of_two(constant + 1);
+        out << "\tmov rdx, rax" << std::endl
+            << "\tshl rax, " << log2_floor(below ? constant + 1 : constant - 1) << std::endl
+            << (below ? "\tsub rax, rdx" : "\tadd rax, rdx") << std::endl;
+        return out.str();
+    }
+    // the low half of the product is the same signed or unsigned, and the immediate form saves the mov
+    multiply_by(out, constant);
+    return out.str();
+}
+
+std::optional<std::string> reduce_divide(uint64_t constant) {
+    std::stringstream out;
+    if (constant == 0) {
+        return std::nullopt;
+    }
+    if (is_power_of_two(constant)) {
+        if (constant > 1) {
+            out << "\tshr rax, " << log2_floor(constant) << std::endl;
+        }
+        return out.str();
+    }
+    if (constant > INT64_MAX) {
+        // the quotient is 0 or 1
+        out << "\tmov rcx, " << constant << std::endl
+            << "\tcmp rax, rcx" << std::endl
+            << "\tsetae al" << std::endl
+            << "\tmovzx eax, al" << std::endl;
+        return out.str();
+    }
+    divide_by_magic(out, constant, false);
+    return out.str();
+}
+
+std::optional<std::string> reduce_modulo(uint64_t constant) {
+    std::stringstream out;
+    if (constant == 0) {
+        return std::nullopt;
+    }
+    if (is_power_of_two(constant)) {
+        uint64_t mask = constant - 1;
+        if (mask == UINT32_MAX) {
+            // writing a 32 bit register clears the upper half
+            out << "\tmov eax, eax" << std::endl;
+        } else if (fits_immediate(mask)) {
+            out << "\tand rax, " << mask << std::endl;
+        } else {
+            out << "\tmov rcx, " << mask << std::endl << "\tand rax, rcx" << std::endl;
+        }
+        return out.str();
+    }
+    if (constant > INT64_MAX) {
+        out << "\tmov rcx, " << constant << std::endl
+            << "\tmov rdx, rax" << std::endl
+            << "\tsub rdx, rcx" << std::endl
+            << "\tcmp rax, rcx" << std::endl
+            << "\tcmovae rax, rdx" << std::endl;
+        return out.str();
+    }
+    // n - n / d * d
+    divide_by_magic(out, constant, true);
+    multiply_by(out, constant);
+    out << "\tsub r11, rax" << std::endl << "\tmov rax, r11" << std::endl;
+    return out.str();
+}
+
+bool is_address_scale(uint64_t size) { return size == 1 || size == 2 || size == 4 || size == 8; }
@@ -0,0 +1,99 @@
+// calls the functions of calling_convention.dlv from C, as the System V AMD64 ABI has it. exits with the number of
+// calls that went wrong
+#include <stdint.h>
+#include <stdio.h>
+
+int64_t weigh(int64_t a, int32_t b, int16_t c, int8_t d, int64_t e, int64_t f, int64_t g, int8_t h);
+int64_t rotate(int64_t a, int64_t b, int64_t c, int64_t d, int64_t e, int64_t f, int64_t g);
+int64_t quotient(int64_t a, int64_t b, int64_t c);
+int8_t narrow(int64_t x);
+
+typedef void (*function_t)(void);
+
+// bit i is set once a call returned with callee-saved register i changed- rbx, r12, r13, r14, r15
+uint32_t clobbered_registers = 0;
+
+// function(a1, .., a8) with rbx and r12-r15 holding known values, which are checked after the call. every argument
+// is passed as a full qword- the callee has to ignore the upper bits of its narrower parameters
+int64_t checked_call(function_t function, int64_t a1, int64_t a2, int64_t a3, int64_t a4, int64_t a5, int64_t a6,
+                     int64_t a7, int64_t a8);
+__asm__(
+    ".intel_syntax noprefix\n"
+    ".text\n"
+    "checked_call:\n"
+    "    push rbx\n"
+    "    push r12\n"
+    "    push r13\n"
+    "    push r14\n"
+    "    push r15\n"
+    "    mov rax, rdi\n"
+    "    mov rdi, rsi\n"
+    "    mov rsi, rdx\n"
+    "    mov rdx, rcx\n"
+    "    mov rcx, r8\n"
+    "    mov r8, r9\n"
+    // a6-a8 are ours on the stack, above the return address and the five pushes. a7 and a8 are the callee's
+    "    mov r9, [rsp+48]\n"
+    "    push QWORD PTR [rsp+64]\n"
+    "    push QWORD PTR [rsp+64]\n"
+    "    movabs rbx, 0x1b1b1b1b1b1b1b1b\n"
+    "    movabs r12, 0x1c1c1c1c1c1c1c1c\n"
+    "    movabs r13, 0x1d1d1d1d1d1d1d1d\n"
+    "    movabs r14, 0x1e1e1e1e1e1e1e1e\n"
+    "    movabs r15, 0x1f1f1f1f1f1f1f1f\n"
+    "    call rax\n"
+    "    add rsp, 16\n"
+    "    movabs rcx, 0x1b1b1b1b1b1b1b1b\n"
+    "    cmp rbx, rcx\n"
+    "    je 1f\n"
+    "    or DWORD PTR [rip + clobbered_registers], 1\n"
+    "1:  movabs rcx, 0x1c1c1c1c1c1c1c1c\n"
+    "    cmp r12, rcx\n"
+    "    je 1f\n"
+    "    or DWORD PTR [rip + clobbered_registers], 2\n"
+    "1:  movabs rcx, 0x1d1d1d1d1d1d1d1d\n"
+    "    cmp r13, rcx\n"
+    "    je 1f\n"
+    "    or DWORD PTR [rip + clobbered_registers], 4\n"
+    "1:  movabs rcx, 0x1e1e1e1e1e1e1e1e\n"
+    "    cmp r14, rcx\n"
+    "    je 1f\n"
+    "    or DWORD PTR [rip + clobbered_registers], 8\n"
+    "1:  movabs rcx, 0x1f1f1f1f1f1f1f1f\n"
+    "    cmp r15, rcx\n"
+    "    je 1f\n"
+    "    or DWORD PTR [rip + clobbered_registers], 16\n"
+    "1:  pop r15\n"
+    "    pop r14\n"
+    "    pop r13\n"
+    "    pop r12\n"
+    "    pop rbx\n"
+    "    ret\n"
+    ".att_syntax prefix\n");
+
+int failures = 0;
+
+void expect(const char* call, int64_t result, int64_t expected) {
+    if (result != expected || clobbered_registers != 0) {
+        printf("%s returned %lld, expected %lld. clobbered registers: 0x%x\n", call, (long long)result,
+               (long long)expected, clobbered_registers);
+        ++failures;
+    }
+    clobbered_registers = 0;
+}
+
+int main(void) {
+    const int64_t garbage = (int64_t)0xa5a5a5a500000000;
+    expect("weigh", weigh(1, 2, 3, 4, 5, 6, 7, 8), 204);
+    expect("rotate", rotate(3, 1, 2, 3, 4, 5, 6), 453);
+    expect("quotient", quotient(100, 0, 7), 14);
+    expect("narrow", narrow(264), 8);
+
+    expect("checked weigh", checked_call((function_t)weigh, 1, garbage | 2, garbage | 3, garbage | 4, 5, 6, 7,
+                                         garbage | 8),
+           204);
+    expect("checked rotate", checked_call((function_t)rotate, 5, 1, 2, 3, 4, 5, 6, 0), 615);
+    expect("checked quotient", checked_call((function_t)quotient, 100, 0, 7, 0, 0, 0, 0, 0), 14);
+    expect("checked narrow", (int8_t)checked_call((function_t)narrow, 264, 0, 0, 0, 0, 0, 0, 0), 8);
+    return failures;
+}
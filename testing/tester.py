@@ -1,9 +1,11 @@
 import unittest
 import subprocess
 import os
+import re
 import json
+import tempfile
 from dataclasses import dataclass
-from typing import TypedDict, List
+from typing import TypedDict, List, Dict, NotRequired, Optional
 
 __unittest = True # removes tracebacks, somehow lol
 
@@ -12,58 +14,136 @@ class ProgramTestCase(TypedDict):
     file: str
     should_compile: bool
     expected_return_code: int
+    # a C program linked with the program's functions, which has to exit with 0
+    c_harness: NotRequired[str]
 
 @dataclass
 class RunResult:
     compile_success: bool
-    exit_code: int
+    # None when the program timed out
+    exit_code: Optional[int]
     stdout: str
     stderr: str
 
 SCRIPT_DIR = os.path.dirname(os.path.realpath(__file__))
 TEST_CASES_FILE = os.path.join(SCRIPT_DIR, "test_cases.json")
 PROGRAMS_DIR = os.path.join(SCRIPT_DIR, "programs")
+# every case runs once per code generation configuration- the backend, the optimization level over the IR, and the
+# vectors of -O2's loops
+CONFIGURATIONS: Dict[str, List[str]] = {
+    "ast": ["--backend=ast"],
+    "ir": ["--backend=ir"],
+    "ir-O2": ["--backend=ir", "-O2"],
+    "ir-O2-avx2": ["--backend=ir", "-O2", "-mavx2"],
+}
+
+
+# a program that runs longer is stuck- a miscompiled loop condition, usually
+RUN_TIMEOUT_SECONDS = 10
+
+
+def run_executable(path: str) -> RunResult:
+    try:
+        run_process = subprocess.run([path], capture_output=True, text=True, timeout=RUN_TIMEOUT_SECONDS)
+    except subprocess.TimeoutExpired:
+        return RunResult(True, None, "", f"timed out after {RUN_TIMEOUT_SECONDS} seconds")
+    return RunResult(True, run_process.returncode, run_process.stdout, run_process.stderr)
 
 
 class TestCompiler(unittest.TestCase):
+    # configuration -> source file -> batch summary entry of its compilation
+    compiled: Dict[str, Dict[str, dict]] = {}
+    output_dir: tempfile.TemporaryDirectory
+
+    @classmethod
+    def setUpClass(cls):
+        # compile every program with a single 'compiler batch' process per configuration
+        cls.output_dir = tempfile.TemporaryDirectory()
+        sources = sorted({os.path.join(PROGRAMS_DIR, case["file"]) for case in load_cases()})
+        for configuration, arguments in CONFIGURATIONS.items():
+            outputs = [os.path.join(cls.output_dir.name, f"{configuration}_program_{idx}")
+                       for idx in range(len(sources))]
+            manifest = [{"source": source, "output": output, "asm": f"{output}.asm"}
+                        for source, output in zip(sources, outputs)]
+            manifest_file = os.path.join(cls.output_dir.name, f"{configuration}_manifest.json")
+            summary_file = os.path.join(cls.output_dir.name, f"{configuration}_summary.json")
+            with open(manifest_file, "w") as f:
+                json.dump(manifest, f)
+
+            subprocess.run(
+                [f"{SCRIPT_DIR}/../compiler", "batch", manifest_file, "--summary", summary_file,
+                 *arguments],
+                capture_output=True, text=True
+            )
+            with open(summary_file, "r") as f:
+                summary = json.load(f)
+            cls.compiled[configuration] = {job["source"]: job for job in summary["jobs"]}
 
-    @staticmethod
-    def run_program(source_file: str) -> RunResult:
-        # Compile the program
-        compile_process = subprocess.run(
-            [f"{SCRIPT_DIR}/../compiler", "compile", source_file],
-            capture_output=True, text=True
-        )
-        if compile_process.returncode != 0:
-            return RunResult(False, -1, compile_process.stdout, compile_process.stderr)
+    @classmethod
+    def tearDownClass(cls):
+        cls.output_dir.cleanup()
+
+    @classmethod
+    def run_program(cls, source_file: str, configuration: str) -> RunResult:
+        compiled = cls.compiled[configuration][source_file]
+        if not compiled["success"]:
+            errors = "\n".join(d["formatted"] for d in compiled["diagnostics"] if d["severity"] == "error")
+            return RunResult(False, -1, "", errors)
 
         # Run the compiled program
-        run_process = subprocess.run(['./output'], capture_output=True, text=True)
-        return RunResult(True, run_process.returncode, run_process.stdout, run_process.stderr)
+        return run_executable(compiled["output"])
+
+    @classmethod
+    def run_harness(cls, source_file: str, harness_file: str, configuration: str) -> RunResult:
+        # the program's assembly with its functions made global and its own main renamed away, linked into the
+        # harness with gcc
+        output = cls.compiled[configuration][source_file]["output"]
+        with open(source_file, "r") as f:
+            functions = re.findall(r"\bfunc\s+[\w*]+\s+(\w+)\s*\(", f.read())
+        commands = [
+            ["nasm", "-f", "elf64", f"{output}.asm", "-o", f"{output}.o"],
+            ["objcopy", "--redefine-sym", "main=dlv_main",
+             *[f"--globalize-symbol={function}" for function in functions], f"{output}.o"],
+            ["gcc", "-no-pie", harness_file, f"{output}.o", "-o", f"{output}_harness"],
+        ]
+        for command in commands:
+            build_process = subprocess.run(command, capture_output=True, text=True)
+            if build_process.returncode != 0:
+                return RunResult(False, -1, build_process.stdout, build_process.stderr)
+        return run_executable(f"{output}_harness")
 
-    def check_program(self, source_file: str, case_info: ProgramTestCase):
-        test_name = case_info["name"]
-        result = self.run_program(source_file)
+    def check_program(self, source_file: str, case_info: ProgramTestCase, configuration: str):
+        test_name = f"{case_info['name']} ({configuration})"
+        result = self.run_program(source_file, configuration)
         self.assertEqual(result.compile_success, case_info["should_compile"], 
                          f"Unexpected compilation status for test '{test_name}' -\n{result.stderr}")
         if not result.compile_success:
             return
         self.assertEqual(result.exit_code, case_info["expected_return_code"], 
                          f"Status code mismatch for test '{test_name}'.")
+        if "c_harness" in case_info:
+            harness = self.run_harness(source_file, os.path.join(PROGRAMS_DIR, case_info["c_harness"]), configuration)
+            self.assertTrue(harness.compile_success,
+                            f"Could not link the C harness of '{test_name}' -\n{harness.stderr}")
+            self.assertEqual(harness.exit_code, 0, f"C harness of '{test_name}' failed -\n{harness.stdout}")
 
-def load_test_cases():
+def load_cases() -> List[ProgramTestCase]:
     with open(TEST_CASES_FILE, "r") as f:
-        test_cases: List[ProgramTestCase] = json.load(f)
+        return json.load(f)
+
+def load_test_cases():
+    test_cases = load_cases()
 
     for idx, program in enumerate(test_cases):
         source_file = os.path.join(PROGRAMS_DIR, program["file"])
-        test_method = create_test_method(source_file, program)
-        test_method.__name__ = f"test '{program['name']}'"
-        setattr(TestCompiler, test_method.__name__, test_method)
+        for configuration in CONFIGURATIONS:
+            test_method = create_test_method(source_file, program, configuration)
+            test_method.__name__ = f"test '{program['name']}' ({configuration})"
+            setattr(TestCompiler, test_method.__name__, test_method)
 
-def create_test_method(source_file: str, case_info: ProgramTestCase):
+def create_test_method(source_file: str, case_info: ProgramTestCase, configuration: str):
     def test(self: TestCompiler):
-        self.check_program(source_file, case_info)
+        self.check_program(source_file, case_info, configuration)
     return test
 
 